@@ -0,0 +1,15 @@
+graph 100
+ benchmark import brite 3000 /tmp/benchmark-dijkstra.brite
+ import brite /tmp/benchmark-dijkstra.brite
+exit
+
+weight 100
+ weight-graph 100
+ weight-setting inverse-capacity
+exit
+
+routing 100
+ routing-graph 100
+ routing-weight 100
+ benchmark dijkstra all-pairs 3
+exit
@@ -0,0 +1,29 @@
+graph 100
+ import brite etc/topology/RTBarabasi20.brite
+exit
+
+weight 100
+ weight-graph 100
+ weight-setting inverse-capacity
+exit
+
+routing 100
+ routing-graph 100
+ routing-weight 100
+ benchmark dijkstra queue 10
+exit
+
+graph 200
+ import rocketfuel weights etc/rocketfuel/weights-dist/1239/weights.intra
+exit
+
+weight 200
+ weight-graph 200
+ weight-setting import rocketfuel etc/rocketfuel/weights-dist/1239/weights.intra
+exit
+
+routing 200
+ routing-graph 200
+ routing-weight 200
+ benchmark dijkstra queue 10
+exit
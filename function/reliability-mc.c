@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "vector.h"
+#include "random.h"
+#include "workqueue.h"
+#include "network/graph.h"
+
+#include "command.h"
+#include "shell.h"
+
+#include "reliability-mc.h"
+
+#define RELIABILITY_MC_ALWAYS ((unsigned long long) -1)
+
+/* 95% confidence */
+#define RELIABILITY_MC_Z 1.959963984540054
+
+struct reliability_mc_worker
+{
+  unsigned long long *up;       /* sampled link states, by CSR position */
+  unsigned long long *reach;    /* reached samples, by node id */
+  unsigned int *queue;          /* nnodes + 1, circular */
+  char *queued;
+  unsigned long long *count;    /* nsources * nnodes */
+};
+
+struct reliability_mc
+{
+  struct graph_csr *csr;
+  unsigned long long *threshold; /* up if the draw is below, by CSR position */
+  unsigned int *source;
+  unsigned int nsources;
+  unsigned long samples;
+  unsigned long long seed;
+  struct reliability_mc_worker *workers;
+};
+
+static unsigned long long
+reliability_mc_threshold (double reliability)
+{
+  double threshold;
+
+  if (reliability >= 1.0)
+    return RELIABILITY_MC_ALWAYS;
+  if (reliability <= 0.0)
+    return 0;
+
+  threshold = reliability * 18446744073709551616.0;
+  if (threshold >= 18446744073709551615.0)
+    return RELIABILITY_MC_ALWAYS - 1;
+  return (unsigned long long) threshold;
+}
+
+/* draw the link states of the batch'th 64 samples from the batch's own
+   stream, so the estimate is the same for any number of threads, and
+   walk them all at once from each source: reach[v] has the bit of a
+   sample set when v is reachable from the source in that sample.  a
+   node goes back to the queue only when it has reached new samples. */
+static void
+reliability_mc_batch (void *arg, unsigned int batch, unsigned int worker)
+{
+  struct reliability_mc *mc = (struct reliability_mc *) arg;
+  struct reliability_mc_worker *w = &mc->workers[worker];
+  struct graph_csr *csr = mc->csr;
+  unsigned int nnodes = csr->nnodes;
+  unsigned int nedges = csr->ooffset[nnodes];
+  struct random_stream stream;
+  unsigned long long mask, bits, *count;
+  unsigned long left;
+  unsigned int e, i, k, u, v, head, tail;
+
+  left = mc->samples - (unsigned long) batch * RELIABILITY_MC_BATCH;
+  if (left >= RELIABILITY_MC_BATCH)
+    mask = (unsigned long long) -1;
+  else
+    mask = (1ULL << left) - 1;
+
+  random_stream_init (&stream, mc->seed, batch);
+
+  for (e = 0; e < nedges; e++)
+    {
+      if (mc->threshold[e] == RELIABILITY_MC_ALWAYS)
+        {
+          w->up[e] = mask;
+          continue;
+        }
+      bits = 0;
+      if (mc->threshold[e])
+        for (k = 0; k < RELIABILITY_MC_BATCH; k++)
+          if (random_stream_next (&stream) < mc->threshold[e])
+            bits |= 1ULL << k;
+      w->up[e] = bits & mask;
+    }
+
+  for (i = 0; i < mc->nsources; i++)
+    {
+      memset (w->reach, 0, nnodes * sizeof (unsigned long long));
+
+      head = tail = 0;
+      w->reach[mc->source[i]] = mask;
+      w->queue[tail++] = mc->source[i];
+      w->queued[mc->source[i]] = 1;
+
+      while (head != tail)
+        {
+          u = w->queue[head];
+          head = (head + 1 == nnodes + 1 ? 0 : head + 1);
+          w->queued[u] = 0;
+
+          for (e = csr->ooffset[u]; e < csr->ooffset[u + 1]; e++)
+            {
+              v = csr->otarget[e];
+              bits = w->reach[u] & w->up[e] & ~w->reach[v];
+              if (! bits)
+                continue;
+
+              w->reach[v] |= bits;
+              if (! w->queued[v])
+                {
+                  w->queue[tail] = v;
+                  tail = (tail + 1 == nnodes + 1 ? 0 : tail + 1);
+                  w->queued[v] = 1;
+                }
+            }
+        }
+
+      count = &w->count[(unsigned long) i * nnodes];
+      for (v = 0; v < nnodes; v++)
+        count[v] += __builtin_popcountll (w->reach[v]);
+    }
+}
+
+unsigned long long *
+reliability_mc_run (struct graph *G, unsigned int *source,
+                    unsigned int nsources, unsigned long samples,
+                    unsigned int nthreads)
+{
+  struct reliability_mc mc;
+  struct reliability_mc_worker *w;
+  unsigned long long *count;
+  unsigned long ncount;
+  unsigned int nnodes, nedges, nbatches, i, e;
+
+  memset (&mc, 0, sizeof (struct reliability_mc));
+  mc.csr = graph_freeze (G);
+  mc.source = source;
+  mc.nsources = nsources;
+  mc.samples = samples;
+  mc.seed = RELIABILITY_MC_SEED;
+
+  nnodes = mc.csr->nnodes;
+  nedges = mc.csr->ooffset[nnodes];
+  nbatches = (samples + RELIABILITY_MC_BATCH - 1) / RELIABILITY_MC_BATCH;
+  ncount = (unsigned long) nsources * nnodes;
+
+  mc.threshold = (unsigned long long *)
+    calloc (nedges + 1, sizeof (unsigned long long));
+  for (e = 0; e < nedges; e++)
+    {
+      struct link *link = link_lookup_by_id (mc.csr->olink[e], G);
+      mc.threshold[e] = reliability_mc_threshold (link->reliability);
+    }
+
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > nbatches)
+    nthreads = nbatches;
+
+  mc.workers = (struct reliability_mc_worker *)
+    calloc (nthreads + 1, sizeof (struct reliability_mc_worker));
+  for (i = 0; i < nthreads; i++)
+    {
+      w = &mc.workers[i];
+      w->up = (unsigned long long *)
+        calloc (nedges + 1, sizeof (unsigned long long));
+      w->reach = (unsigned long long *)
+        calloc (nnodes + 1, sizeof (unsigned long long));
+      w->queue = (unsigned int *) calloc (nnodes + 1, sizeof (unsigned int));
+      w->queued = (char *) calloc (nnodes + 1, sizeof (char));
+      w->count = (unsigned long long *)
+        calloc (ncount + 1, sizeof (unsigned long long));
+    }
+
+  workqueue_run (nthreads, nbatches, reliability_mc_batch, &mc);
+
+  count = (unsigned long long *)
+    calloc (ncount + 1, sizeof (unsigned long long));
+  for (i = 0; i < nthreads; i++)
+    {
+      w = &mc.workers[i];
+      WORKQUEUE_SUM (count, w->count, ncount);
+      free (w->up);
+      free (w->reach);
+      free (w->queue);
+      free (w->queued);
+      free (w->count);
+    }
+  free (mc.workers);
+  free (mc.threshold);
+
+  return count;
+}
+
+/* the estimate and its 95% Wilson score interval, which stays inside
+   [0, 1] when the reliability is close to 1. */
+void
+reliability_mc_print (FILE *fp, struct node *s, struct node *t,
+                      unsigned long long count, unsigned long samples)
+{
+  double n = (double) samples;
+  double p = (double) count / n;
+  double z2 = RELIABILITY_MC_Z * RELIABILITY_MC_Z;
+  double center, half, denom;
+
+  denom = 1.0 + z2 / n;
+  center = (p + z2 / (2.0 * n)) / denom;
+  half = RELIABILITY_MC_Z *
+    sqrt (p * (1.0 - p) / n + z2 / (4.0 * n * n)) / denom;
+
+  fprintf (fp, "s-t: %u-%u reliability = %.10f "
+           "(%lu samples, 95%% CI [%.10f, %.10f])\n",
+           s->id, t->id, p, samples,
+           (center - half < 0.0 ? 0.0 : center - half),
+           (center + half > 1.0 ? 1.0 : center + half));
+}
+
+DEFINE_COMMAND (calculate_reliability_source_destination_monte_carlo,
+                "calculate reliability source <0-4294967295> destination <0-4294967295> monte-carlo samples <1-4294967295>",
+                "calculate\n"
+                "calculate reliability\n"
+                "specify source node\n"
+                "specify source node\n"
+                "specify destination node\n"
+                "specify destination node\n"
+                "estimate by Monte Carlo sampling\n"
+                "specify number of samples\n"
+                "specify number of samples\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct graph *G = (struct graph *) shell->context;
+  unsigned long sid, tid, samples;
+  unsigned int nthreads = 1;
+  unsigned int source;
+  unsigned long long *count;
+  struct node *s, *t;
+
+  sid = strtoul (argv[3], NULL, 0);
+  tid = strtoul (argv[5], NULL, 0);
+  samples = strtoul (argv[8], NULL, 0);
+  if (argc > 10)
+    nthreads = strtoul (argv[10], NULL, 0);
+
+  s = node_lookup (sid, G);
+  if (! s)
+    {
+      fprintf (shell->terminal, "No such node: %lu\n", sid);
+      return;
+    }
+  t = node_lookup (tid, G);
+  if (! t)
+    {
+      fprintf (shell->terminal, "No such node: %lu\n", tid);
+      return;
+    }
+
+  if (s == t)
+    {
+      fprintf (shell->terminal, "source == destination: %lu\n", tid);
+      return;
+    }
+
+  source = s->id;
+  count = reliability_mc_run (G, &source, 1, samples, nthreads);
+  reliability_mc_print (shell->terminal, s, t, count[t->id], samples);
+  free (count);
+}
+
+ALIAS_COMMAND (calculate_reliability_source_destination_monte_carlo_threads,
+               calculate_reliability_source_destination_monte_carlo,
+                "calculate reliability source <0-4294967295> destination <0-4294967295> monte-carlo samples <1-4294967295> threads <1-1024>",
+                "calculate\n"
+                "calculate reliability\n"
+                "specify source node\n"
+                "specify source node\n"
+                "specify destination node\n"
+                "specify destination node\n"
+                "estimate by Monte Carlo sampling\n"
+                "specify number of samples\n"
+                "specify number of samples\n"
+                "calculate in multiple threads\n"
+                "specify number of threads\n")
+
+/* every sampled state is used for all the pairs: one walk per source
+   and batch gives the source's row of all the destinations. */
+static void
+reliability_mc_all (struct shell *shell, struct graph *G, int half,
+                    unsigned long samples, unsigned int nthreads)
+{
+  struct node *s, *t;
+  struct vector_node *vns, *vnt;
+  struct vector_node vns_cursor, vnt_cursor;
+  unsigned int *source;
+  unsigned int nsources, nnodes, i;
+  unsigned long long *count;
+
+  source = (unsigned int *)
+    calloc (G->nodes->size + 1, sizeof (unsigned int));
+  nsources = 0;
+  for (vns = vector_cursor_head (G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
+    {
+      s = (struct node *) vns->data;
+      source[nsources++] = s->id;
+    }
+
+  count = reliability_mc_run (G, source, nsources, samples, nthreads);
+  nnodes = G->csr->nnodes;
+
+  i = 0;
+  for (vns = vector_cursor_head (G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
+    {
+      s = (struct node *) vns->data;
+      for (vnt = vector_cursor_head (G->nodes, &vnt_cursor); vnt;
+           vnt = vector_cursor_next (vnt))
+        {
+          t = (struct node *) vnt->data;
+          if (s == t)
+            continue;
+          if (half && vns->index >= vnt->index)
+            continue;
+
+          reliability_mc_print (shell->terminal, s, t,
+                                count[(unsigned long) i * nnodes + t->id],
+                                samples);
+        }
+      i++;
+    }
+
+  free (count);
+  free (source);
+}
+
+DEFINE_COMMAND (calculate_reliability_all_to_all_monte_carlo,
+                "calculate reliability all-to-all monte-carlo samples <1-4294967295>",
+                "calculate\n"
+                "calculate reliability\n"
+                "calculate all-to-all reliability\n"
+                "estimate by Monte Carlo sampling\n"
+                "specify number of samples\n"
+                "specify number of samples\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct graph *G = (struct graph *) shell->context;
+  unsigned long samples;
+  unsigned int nthreads = 1;
+
+  samples = strtoul (argv[5], NULL, 0);
+  if (argc > 7)
+    nthreads = strtoul (argv[7], NULL, 0);
+
+  reliability_mc_all (shell, G, 0, samples, nthreads);
+}
+
+ALIAS_COMMAND (calculate_reliability_all_to_all_monte_carlo_threads,
+               calculate_reliability_all_to_all_monte_carlo,
+                "calculate reliability all-to-all monte-carlo samples <1-4294967295> threads <1-1024>",
+                "calculate\n"
+                "calculate reliability\n"
+                "calculate all-to-all reliability\n"
+                "estimate by Monte Carlo sampling\n"
+                "specify number of samples\n"
+                "specify number of samples\n"
+                "calculate in multiple threads\n"
+                "specify number of threads\n")
+
+DEFINE_COMMAND (calculate_reliability_all_to_half_monte_carlo,
+                "calculate reliability all-to-half monte-carlo samples <1-4294967295>",
+                "calculate\n"
+                "calculate reliability\n"
+                "calculate all-to-half reliability\n"
+                "estimate by Monte Carlo sampling\n"
+                "specify number of samples\n"
+                "specify number of samples\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct graph *G = (struct graph *) shell->context;
+  unsigned long samples;
+  unsigned int nthreads = 1;
+
+  samples = strtoul (argv[5], NULL, 0);
+  if (argc > 7)
+    nthreads = strtoul (argv[7], NULL, 0);
+
+  reliability_mc_all (shell, G, 1, samples, nthreads);
+}
+
+ALIAS_COMMAND (calculate_reliability_all_to_half_monte_carlo_threads,
+               calculate_reliability_all_to_half_monte_carlo,
+                "calculate reliability all-to-half monte-carlo samples <1-4294967295> threads <1-1024>",
+                "calculate\n"
+                "calculate reliability\n"
+                "calculate all-to-half reliability\n"
+                "estimate by Monte Carlo sampling\n"
+                "specify number of samples\n"
+                "specify number of samples\n"
+                "calculate in multiple threads\n"
+                "specify number of threads\n")
+
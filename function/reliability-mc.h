@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _RELIABILITY_MC_H_
+#define _RELIABILITY_MC_H_
+
+/* Monte Carlo estimate of the two-terminal reliability.  each sample
+   draws the up/down state of every link independently with
+   link->reliability, and s-t is up if t is reachable from s over the
+   up links, as in the SDP calculation.  64 samples are drawn at once,
+   one per bit of a word, and a batch of samples is propagated from a
+   source through the CSR in a single graph walk. */
+
+#define RELIABILITY_MC_BATCH 64
+#define RELIABILITY_MC_SEED  1
+
+/* number of samples in which each node id is reachable from each
+   source, by count[i * nnodes + t] for source[i]. */
+unsigned long long *
+reliability_mc_run (struct graph *G, unsigned int *source,
+                    unsigned int nsources, unsigned long samples,
+                    unsigned int nthreads);
+
+void reliability_mc_print (FILE *fp, struct node *s, struct node *t,
+                           unsigned long long count, unsigned long samples);
+
+EXTERN_COMMAND (calculate_reliability_source_destination_monte_carlo);
+EXTERN_COMMAND (calculate_reliability_source_destination_monte_carlo_threads);
+EXTERN_COMMAND (calculate_reliability_all_to_all_monte_carlo);
+EXTERN_COMMAND (calculate_reliability_all_to_all_monte_carlo_threads);
+EXTERN_COMMAND (calculate_reliability_all_to_half_monte_carlo);
+EXTERN_COMMAND (calculate_reliability_all_to_half_monte_carlo_threads);
+
+#endif /*_RELIABILITY_MC_H_*/
+
@@ -21,6 +21,7 @@
 #include <includes.h>
 
 #include "vector.h"
+#include "workqueue.h"
 #include "network/graph.h"
 #include "network/weight.h"
 #include "network/path.h"
@@ -30,66 +31,145 @@
 
 #include "reliability.h"
 
-struct cubebit *
-cubebit_create ()
+/* a cube is one block: the header, the '1' and '0' bitmasks, and the
+   labels of the '0' bits, so that a copy is a single memcpy (). the
+   bits in neither mask are 'x'. */
+static void
+cube_layout (struct cube *cube)
 {
-  struct cubebit *cubebit;
+  cube->one = (unsigned long *) (cube + 1);
+  cube->zero = cube->one + cube->nwords;
+  cube->label = (cube_label_t *) (cube->zero + cube->nwords);
+}
+
+/* the cubes of one SDP computation all have the same size, so they
+   are carved from large chunks and recycled through a free list.
+   the chunks are released at once by cube_pool_delete (). */
+struct cube_pool_chunk
+{
+  struct cube_pool_chunk *next;
+};
 
-  cubebit = (struct cubebit *) malloc (sizeof (struct cubebit));
-  cubebit->type = 'x';
-  cubebit->label = 0;
+#define CUBE_POOL_CHUNK_MIN   64
+#define CUBE_POOL_CHUNK_MAX 4096
 
-  return cubebit;
+struct cube_pool *
+cube_pool_create (unsigned int nbits)
+{
+  struct cube_pool *pool;
+  unsigned int nwords = CUBE_NWORDS (nbits);
+
+  assert (nbits <= CUBE_LABEL_MAX);
+
+  pool = (struct cube_pool *) malloc (sizeof (struct cube_pool));
+  memset (pool, 0, sizeof (struct cube_pool));
+  pool->nbits = nbits;
+  pool->size = sizeof (struct cube) + 2 * nwords * sizeof (unsigned long)
+    + nbits * sizeof (cube_label_t);
+  /* keep the next cube in the chunk aligned */
+  pool->size = (pool->size + sizeof (void *) - 1)
+    & ~(sizeof (void *) - 1);
+  pool->chunk_cubes = CUBE_POOL_CHUNK_MIN;
+
+  return pool;
 }
 
 void
-cubebit_delete (struct cubebit *cubebit)
+cube_pool_delete (struct cube_pool *pool)
 {
-  free (cubebit);
+  struct cube_pool_chunk *chunk, *next;
+
+  for (chunk = pool->chunks; chunk; chunk = next)
+    {
+      next = chunk->next;
+      free (chunk);
+    }
+  free (pool);
 }
 
-struct cubebit *
-cubebit_copy (struct cubebit *cubebit)
+static void *
+cube_pool_get (struct cube_pool *pool)
 {
-  struct cubebit *copy;
+  struct cube_pool_chunk *chunk;
+  void *block;
 
-  copy = (struct cubebit *) malloc (sizeof (struct cubebit));
-  copy->type = cubebit->type;
-  copy->label = cubebit->label;
+  if (pool->free)
+    {
+      block = pool->free;
+      pool->free = *(void **) block;
+    }
+  else
+    {
+      if (pool->left == 0)
+        {
+          chunk = (struct cube_pool_chunk *)
+            malloc (sizeof (void *) + pool->chunk_cubes * pool->size);
+          chunk->next = pool->chunks;
+          pool->chunks = chunk;
+          pool->next = (char *) chunk + sizeof (void *);
+          pool->left = pool->chunk_cubes;
+          pool->allocated += pool->chunk_cubes;
+          if (pool->chunk_cubes < CUBE_POOL_CHUNK_MAX)
+            pool->chunk_cubes *= 2;
+        }
+      block = pool->next;
+      pool->next += pool->size;
+      pool->left--;
+    }
 
-  return copy;
+  pool->used++;
+  if (pool->peak < pool->used)
+    pool->peak = pool->used;
+  return block;
+}
+
+static void
+cube_pool_put (void *block, struct cube_pool *pool)
+{
+  *(void **) block = pool->free;
+  pool->free = block;
+  pool->used--;
+}
+
+struct cube *
+cube_alloc (struct cube_pool *pool)
+{
+  struct cube *cube;
+
+  cube = (struct cube *) cube_pool_get (pool);
+  memset (cube, 0, pool->size);
+  cube->pool = pool;
+  cube->size = pool->size;
+  cube->nbits = pool->nbits;
+  cube->nwords = CUBE_NWORDS (pool->nbits);
+  cube_layout (cube);
+
+  return cube;
 }
 
 struct cube *
-cube_create (struct path *path)
+cube_create (struct path *path, struct cube_pool *pool)
 {
   struct cube *cube;
   struct node *node, *prev;
   struct link *link;
   struct vector_node *vn;
-  int i;
-  struct cubebit *cubebit;
-
-  cube = (struct cube *) malloc (sizeof (struct cube));
-  cube->v = vector_create ();
+  struct vector_node vn_cursor;
 
   node = vector_get (path->path, 0);
-  for (i = 0; i < node->g->links->size; i++)
-    {
-      cubebit = cubebit_create ();
-      vector_set (cube->v, i, cubebit);
-    }
+  assert (pool->nbits == node->g->links->size);
+  cube = cube_alloc (pool);
 
   prev = NULL;
-  for (vn = vector_head (path->path); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (path->path, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 
       if (prev)
         {
           link = link_lookup (prev, node, node->g);
-          cubebit = vector_get (cube->v, link->id);
-          cubebit->type = '1';
+          CUBE_SET (cube->one, link->id);
         }
 
       prev = node;
@@ -101,52 +181,45 @@ cube_create (struct path *path)
 void
 cube_delete (struct cube *cube)
 {
-  struct cubebit *cubebit;
-  struct vector_node *vn;
-  for (vn = vector_head (cube->v); vn; vn = vector_next (vn))
-    {
-      cubebit = (struct cubebit *) vn->data;
-      cubebit_delete (cubebit);
-    }
-  vector_delete (cube->v);
-  free (cube);
+  cube_pool_put (cube, cube->pool);
 }
 
 struct cube *
 cube_copy (struct cube *cube)
 {
   struct cube *copy;
-  struct cubebit *cubebit;
-  int i;
 
-  copy = (struct cube *) malloc (sizeof (struct cube));
-  copy->v = vector_create ();
-
-  for (i = 0; i < cube->v->size; i++)
-    {
-      cubebit = cubebit_copy ((struct cubebit *) vector_get (cube->v, i));
-      vector_set (copy->v, i, cubebit);
-    }
+  copy = (struct cube *) cube_pool_get (cube->pool);
+  memcpy (copy, cube, cube->size);
+  cube_layout (copy);
 
   return copy;
 }
 
+char
+cube_type (struct cube *cube, unsigned int i)
+{
+  if (CUBE_ISSET (cube->one, i))
+    return '1';
+  if (CUBE_ISSET (cube->zero, i))
+    return '0';
+  return 'x';
+}
+
 void
 cube_sprint (char *s, int size, struct cube *cube)
 {
   char tmp[256];
-  struct vector_node *vn;
-  struct cubebit *cubebit;
+  unsigned int i;
 
-  for (vn = vector_head (cube->v); vn; vn = vector_next (vn))
+  for (i = 0; i < cube->nbits; i++)
     {
-      cubebit = (struct cubebit *) vn->data;
-      tmp[0] = cubebit->type;
+      tmp[0] = cube_type (cube, i);
       tmp[1] = '\0';
       strncat (s, tmp, size - strlen (s) - 1);
-      if (cubebit->label)
+      if (cube->label[i])
         {
-          snprintf (tmp, sizeof (tmp), "_{%u}", cubebit->label);
+          snprintf (tmp, sizeof (tmp), "_{%u}", cube->label[i]);
           strncat (s, tmp, size - strlen (s) - 1);
         }
     }
@@ -161,41 +234,46 @@ cube_print (FILE *fp, struct cube *cube)
   fprintf (fp, "%s", buf);
 }
 
+/* the largest label of the '0' bits */
+static void
+cube_update_gamma (struct cube *C)
+{
+  unsigned int w, i;
+  unsigned long bits;
+
+  C->gamma = 0;
+  for (w = 0; w < C->nwords; w++)
+    CUBE_FOREACH_BIT (bits, C->zero[w], w, i)
+      if (C->gamma < C->label[i])
+        C->gamma = C->label[i];
+}
+
 int
 get_gamma (struct cube *C)
 {
-  int i;
-  int gamma = 0;
-  struct cubebit *c;
-  for (i = 0; i < C->v->size; i++)
-    {
-      c = (struct cubebit *) vector_get (C->v, i);
-      if (gamma < c->label)
-        gamma = c->label;
-    }
-  return gamma;
+  return C->gamma;
 }
 
 struct cube *
 C_create (struct cube *A, struct cube *B)
 {
   struct cube *C;
-  int i;
-  struct cubebit *a, *b, *c;
+  unsigned int w, i;
+  unsigned long x1, bits;
   int gamma;
 
   C = cube_copy (A);
   gamma = get_gamma (C);
-  for (i = 0; i < A->v->size; i++)
+  for (w = 0; w < A->nwords; w++)
     {
-      a = (struct cubebit *) vector_get (A->v, i);
-      b = (struct cubebit *) vector_get (B->v, i);
-      c = (struct cubebit *) vector_get (C->v, i);
-      if (a->type == 'x' && b->type == '1')
-        {
-          c->type = '0';
-          c->label = gamma + 1;
-        }
+      /* a == 'x' && b == '1' */
+      x1 = B->one[w] & ~(A->one[w] | A->zero[w]);
+      if (! x1)
+        continue;
+      C->zero[w] |= x1;
+      CUBE_FOREACH_BIT (bits, x1, w, i)
+        C->label[i] = gamma + 1;
+      C->gamma = gamma + 1;
     }
 
   return C;
@@ -204,15 +282,41 @@ C_create (struct cube *A, struct cube *B)
 int
 have_01_condition (struct cube *A, struct cube *B)
 {
-  int i;
-  struct cubebit *a, *b;
+  unsigned int w;
+
+  for (w = 0; w < A->nwords; w++)
+    if (A->zero[w] & B->one[w])
+      return 1;
+  return 0;
+}
+
+/* the smallest label v such that, among the '0' bits of A with the
+   label v, some are '1' and some are 'x' in B; 0 if none. */
+int
+split_label (struct cube *A, struct cube *B)
+{
+  unsigned int w, i, v;
+  unsigned long bits, mask;
+  unsigned long mark01[CUBE_NWORDS (A->gamma + 1)];
+  unsigned long mark0x[CUBE_NWORDS (A->gamma + 1)];
+
+  memset (mark01, 0, sizeof (mark01));
+  memset (mark0x, 0, sizeof (mark0x));
+  for (w = 0; w < A->nwords; w++)
+    {
+      mask = A->zero[w] & B->one[w];
+      CUBE_FOREACH_BIT (bits, mask, w, i)
+        CUBE_SET (mark01, A->label[i]);
+      mask = A->zero[w] & ~(B->one[w] | B->zero[w]);
+      CUBE_FOREACH_BIT (bits, mask, w, i)
+        CUBE_SET (mark0x, A->label[i]);
+    }
 
-  for (i = 0; i < A->v->size; i++)
+  for (w = 0; w < CUBE_NWORDS (A->gamma + 1); w++)
     {
-      a = (struct cubebit *) vector_get (A->v, i);
-      b = (struct cubebit *) vector_get (B->v, i);
-      if (a->type == '0' && b->type == '1')
-        return 1;
+      mask = mark01[w] & mark0x[w];
+      CUBE_FOREACH_BIT (bits, mask, w, v)
+        return v;
     }
   return 0;
 }
@@ -220,19 +324,21 @@ have_01_condition (struct cube *A, struct cube *B)
 int
 split_condition (struct cube *A, struct cube *B, int v)
 {
-  int i;
+  unsigned int w, i;
   int condition_01 = 0;
   int condition_0x = 0;
-  struct cubebit *a, *b;
+  unsigned long bits, mask;
 
-  for (i = 0; i < A->v->size; i++)
+  for (w = 0; w < A->nwords; w++)
     {
-      a = (struct cubebit *) vector_get (A->v, i);
-      b = (struct cubebit *) vector_get (B->v, i);
-      if (a->type == '0' && a->label == v && b->type == '1')
-        condition_01++;
-      if (a->type == '0' && a->label == v && b->type == 'x')
-        condition_0x++;
+      mask = A->zero[w] & B->one[w];
+      CUBE_FOREACH_BIT (bits, mask, w, i)
+        if (A->label[i] == v)
+          condition_01++;
+      mask = A->zero[w] & ~(B->one[w] | B->zero[w]);
+      CUBE_FOREACH_BIT (bits, mask, w, i)
+        if (A->label[i] == v)
+          condition_0x++;
     }
 
   if (condition_01 && condition_0x)
@@ -243,16 +349,11 @@ split_condition (struct cube *A, struct cube *B, int v)
 int
 have_x1_condition (struct cube *A, struct cube *B)
 {
-  int i;
-  struct cubebit *a, *b;
+  unsigned int w;
 
-  for (i = 0; i < A->v->size; i++)
-    {
-      a = (struct cubebit *) vector_get (A->v, i);
-      b = (struct cubebit *) vector_get (B->v, i);
-      if (a->type == 'x' && b->type == '1')
-        return 1;
-    }
+  for (w = 0; w < A->nwords; w++)
+    if (B->one[w] & ~(A->one[w] | A->zero[w]))
+      return 1;
   return 0;
 }
 
@@ -261,19 +362,16 @@ have_x1_condition (struct cube *A, struct cube *B)
 #define X1              3
 #define SPLIT_RECURSIVE 4
 
+/* the relation of the cube A to B.  for SPLIT_RECURSIVE, the label
+   to split on is stored in *u. */
 int
-relation (struct cube *A, struct cube *B)
+relation (struct cube *A, struct cube *B, int *u)
 {
-  int gamma, v;
-
   if (have_01_condition (A, B))
     {
-      gamma = get_gamma (A);
-      for (v = 1; v <= gamma; v++)
-        {
-          if (split_condition (A, B, v))
-            return SPLIT_RECURSIVE;
-        }
+      *u = split_label (A, B);
+      if (*u)
+        return SPLIT_RECURSIVE;
       return DISJOINT;
     }
 
@@ -287,21 +385,23 @@ struct cube *
 A1_create (struct cube *A, struct cube *B, int u)
 {
   struct cube *A1;
-  int i;
-  struct cubebit *a, *b, *c;
+  unsigned int w, i;
+  unsigned long bits, mask;
 
   A1 = cube_copy (A);
-  for (i = 0; i < A->v->size; i++)
+  for (w = 0; w < A->nwords; w++)
     {
-      a = (struct cubebit *) vector_get (A->v, i);
-      b = (struct cubebit *) vector_get (B->v, i);
-      c = (struct cubebit *) vector_get (A1->v, i);
-      if (a->type == '0' && a->label == u && b->type == '1')
-        {
-          c->type = '1';
-          c->label = 0;
-        }
+      /* a == '0_u' && b == '1' */
+      mask = A->zero[w] & B->one[w];
+      CUBE_FOREACH_BIT (bits, mask, w, i)
+        if (A->label[i] == u)
+          {
+            CUBE_CLR (A1->zero, i);
+            CUBE_SET (A1->one, i);
+            A1->label[i] = 0;
+          }
     }
+  cube_update_gamma (A1);
 
   return A1;
 }
@@ -310,52 +410,50 @@ struct cube *
 Ax_create (struct cube *A, struct cube *B, int u)
 {
   struct cube *Ax;
-  int i;
-  struct cubebit *a, *b, *c;
+  unsigned int w, i;
+  unsigned long bits, mask;
 
   Ax = cube_copy (A);
-  for (i = 0; i < A->v->size; i++)
+  for (w = 0; w < A->nwords; w++)
     {
-      a = (struct cubebit *) vector_get (A->v, i);
-      b = (struct cubebit *) vector_get (B->v, i);
-      c = (struct cubebit *) vector_get (Ax->v, i);
-      if (a->type == '0' && a->label == u && b->type == 'x')
-        {
-          c->type = 'x';
-          c->label = 0;
-        }
+      /* a == '0_u' && b == 'x' */
+      mask = A->zero[w] & ~(B->one[w] | B->zero[w]);
+      CUBE_FOREACH_BIT (bits, mask, w, i)
+        if (A->label[i] == u)
+          {
+            CUBE_CLR (Ax->zero, i);
+            Ax->label[i] = 0;
+          }
     }
+  cube_update_gamma (Ax);
 
   return Ax;
 }
 
-int detail = 0;
-int sdp_stat = 0;
-int sdp_stat_detail = 0;
 
 void
-operator_little (struct vector *terms, struct cube *B, struct shell *shell,
-                 struct sdp_stat *stat)
+operator_little (struct vector *terms, struct cube *B,
+                 struct sdp_context *ctx, struct sdp_stat *stat)
 {
   struct vector *result;
   struct vector_node *vn;
   struct cube *A, *C, *A1, *Ax;
-  int gamma, u, v;
+  int u;
   struct vector *newterms;
   int class = 0;
 
-  if (detail)
+  if (ctx->detail)
     {
-      fprintf (shell->terminal, "(");
+      fprintf (ctx->fp, "(");
       for (vn = vector_head (terms); vn; vn = vector_next (vn))
         {
           A = (struct cube *) vn->data;
-          fprintf (shell->terminal, " + ");
-          cube_print (shell->terminal, A);
+          fprintf (ctx->fp, " + ");
+          cube_print (ctx->fp, A);
         }
-      fprintf (shell->terminal, ") # ");
-      cube_print (shell->terminal, B);
-      fprintf (shell->terminal, "\n");
+      fprintf (ctx->fp, ") # ");
+      cube_print (ctx->fp, B);
+      fprintf (ctx->fp, "\n");
     }
 
   if (stat)
@@ -365,13 +463,13 @@ operator_little (struct vector *terms, struct cube *B, struct shell *shell,
   for (vn = vector_head (terms); vn; vn = vector_next (vn))
     {
       A = (struct cube *) vn->data;
-      class = relation (A, B);
+      class = relation (A, B, &u);
       switch (class)
         {
         case SUBSET:
           /* Do nothing */
-          if (detail)
-            fprintf (shell->terminal, "= 0 (subset)\n");
+          if (ctx->detail)
+            fprintf (ctx->fp, "= 0 (subset)\n");
           if (stat)
             stat->subset++;
           break;
@@ -379,12 +477,12 @@ operator_little (struct vector *terms, struct cube *B, struct shell *shell,
         case DISJOINT:
           /* add A */
           vector_add (cube_copy (A), result);
-          if (detail)
+          if (ctx->detail)
             {
-              fprintf (shell->terminal, "= ");
-              fprintf (shell->terminal, "+ ");
-              cube_print (shell->terminal, A);
-              fprintf (shell->terminal, " (disjoint)\n");
+              fprintf (ctx->fp, "= ");
+              fprintf (ctx->fp, "+ ");
+              cube_print (ctx->fp, A);
+              fprintf (ctx->fp, " (disjoint)\n");
             }
           if (stat)
             stat->disjoint++;
@@ -393,45 +491,38 @@ operator_little (struct vector *terms, struct cube *B, struct shell *shell,
         case X1:
           C = C_create (A, B);
           vector_add (C, result);
-          if (detail)
+          if (ctx->detail)
             {
-              fprintf (shell->terminal, "= ");
-              fprintf (shell->terminal, "+ ");
-              cube_print (shell->terminal, C);
-              fprintf (shell->terminal, " (x1)\n");
+              fprintf (ctx->fp, "= ");
+              fprintf (ctx->fp, "+ ");
+              cube_print (ctx->fp, C);
+              fprintf (ctx->fp, " (x1)\n");
             }
           if (stat)
             stat->x1++;
           break;
 
         case SPLIT_RECURSIVE:
-          gamma = get_gamma (A);
-          for (v = 1; v <= gamma; v++)
-            {
-              if (! split_condition (A, B, v))
-                continue;
-              u = v;
-              break;
-            }
+          /* u is the smallest label satisfying split_condition () */
           A1 = A1_create (A, B, u);
           Ax = Ax_create (A, B, u);
 
-          if (detail)
+          if (ctx->detail)
             {
-              fprintf (shell->terminal, "= ");
-              fprintf (shell->terminal, "+ ");
-              cube_print (shell->terminal, A1);
-              fprintf (shell->terminal, " # ");
-              cube_print (shell->terminal, B);
-              fprintf (shell->terminal, " + ");
-              cube_print (shell->terminal, Ax);
-              fprintf (shell->terminal, " (split-recursive)\n");
+              fprintf (ctx->fp, "= ");
+              fprintf (ctx->fp, "+ ");
+              cube_print (ctx->fp, A1);
+              fprintf (ctx->fp, " # ");
+              cube_print (ctx->fp, B);
+              fprintf (ctx->fp, " + ");
+              cube_print (ctx->fp, Ax);
+              fprintf (ctx->fp, " (split-recursive)\n");
             }
 
           /* A1 \natural B */
           newterms = vector_create ();
           vector_add (A1, newterms);
-          operator_little (newterms, B, shell, NULL);
+          operator_little (newterms, B, ctx, NULL);
           vector_catenate (result, newterms);
           vector_delete (newterms);
 
@@ -457,34 +548,36 @@ operator_little (struct vector *terms, struct cube *B, struct shell *shell,
   vector_catenate (terms, result);
   vector_delete (result);
 
-  if (detail)
+  if (ctx->detail)
     {
-      fprintf (shell->terminal, "=");
+      fprintf (ctx->fp, "=");
       for (vn = vector_head (terms); vn; vn = vector_next (vn))
         {
           A = (struct cube *) vn->data;
-          fprintf (shell->terminal, " + ");
-          cube_print (shell->terminal, A);
+          fprintf (ctx->fp, " + ");
+          cube_print (ctx->fp, A);
         }
-      fprintf (shell->terminal, "\n");
+      fprintf (ctx->fp, "\n");
     }
 }
 
 double
 calculate_state_reliability (struct node *s, struct node *t,
-                             struct vector *state, struct shell *shell)
+                             struct vector *state, struct sdp_context *ctx)
 {
   struct vector_node *vn;
   struct cube *cube;
-  int i, u;
+  unsigned int i, w;
+  unsigned long bits;
+  int u;
   int gamma;
-  struct cubebit *a;
   struct link *link;
   double reliability = 0.0;
+  double *subreliability;
 
-  if (detail)
+  if (ctx->detail)
     {
-      fprintf (shell->terminal, "calculate reliability from %d to %d",
+      fprintf (ctx->fp, "calculate reliability from %d to %d",
                s->id, t->id);
 
       for (vn = vector_head (state); vn; vn = vector_next (vn))
@@ -492,65 +585,61 @@ calculate_state_reliability (struct node *s, struct node *t,
           cube = (struct cube *) vn->data;
           gamma = get_gamma (cube);
 
-          fprintf (shell->terminal, " + ");
-          for (i = 0; i < cube->v->size; i++)
+          fprintf (ctx->fp, " + ");
+          for (i = 0; i < cube->nbits; i++)
             {
-              a = (struct cubebit *) vector_get (cube->v, i);
-              if (a->type != '1')
+              if (! CUBE_ISSET (cube->one, i))
                 continue;
-              fprintf (shell->terminal, "p%d", i);
+              fprintf (ctx->fp, "p%d", i);
             }
 
           for (u = 1; u <= gamma; u++)
             {
-              fprintf (shell->terminal, "(1 - ");
-              for (i = 0; i < cube->v->size; i++)
+              fprintf (ctx->fp, "(1 - ");
+              for (i = 0; i < cube->nbits; i++)
                 {
-                  a = (struct cubebit *) vector_get (cube->v, i);
-                  if (a->type != '0' || a->label != u)
+                  if (! CUBE_ISSET (cube->zero, i) || cube->label[i] != u)
                     continue;
-                  fprintf (shell->terminal, "p%d", i);
+                  fprintf (ctx->fp, "p%d", i);
                 }
-              fprintf (shell->terminal, ")_{%d}", u);
+              fprintf (ctx->fp, ")_{%d}", u);
             }
         }
-      fprintf (shell->terminal, "\n");
+      fprintf (ctx->fp, "\n");
 
-      fprintf (shell->terminal, " = ");
+      fprintf (ctx->fp, " = ");
       for (vn = vector_head (state); vn; vn = vector_next (vn))
         {
           cube = (struct cube *) vn->data;
           gamma = get_gamma (cube);
-          fprintf (shell->terminal, " + ");
+          fprintf (ctx->fp, " + ");
 
-          for (i = 0; i < cube->v->size; i++)
+          for (i = 0; i < cube->nbits; i++)
             {
-              a = (struct cubebit *) vector_get (cube->v, i);
-              if (a->type != '1')
+              if (! CUBE_ISSET (cube->one, i))
                 continue;
               link = link_lookup_by_id (i, s->g);
-              fprintf (shell->terminal, "(%f)", link->reliability);
+              fprintf (ctx->fp, "(%f)", link->reliability);
             }
 
           for (u = 1; u <= gamma; u++)
             {
-              fprintf (shell->terminal, "(1 - ");
-              for (i = 0; i < cube->v->size; i++)
+              fprintf (ctx->fp, "(1 - ");
+              for (i = 0; i < cube->nbits; i++)
                 {
-                  a = (struct cubebit *) vector_get (cube->v, i);
-                  if (a->type != '0' || a->label != u)
+                  if (! CUBE_ISSET (cube->zero, i) || cube->label[i] != u)
                     continue;
                   link = link_lookup_by_id (i, s->g);
-                  fprintf (shell->terminal, "(%f)", link->reliability);
+                  fprintf (ctx->fp, "(%f)", link->reliability);
                 }
-              fprintf (shell->terminal, ")_{%d}", u);
+              fprintf (ctx->fp, ")_{%d}", u);
             }
         }
-      fprintf (shell->terminal, "\n");
+      fprintf (ctx->fp, "\n");
     }
 
-  if (detail)
-    fprintf (shell->terminal, " = ");
+  if (ctx->detail)
+    fprintf (ctx->fp, " = ");
 
   for (vn = vector_head (state); vn; vn = vector_next (vn))
     {
@@ -559,43 +648,44 @@ calculate_state_reliability (struct node *s, struct node *t,
       cube = (struct cube *) vn->data;
       gamma = get_gamma (cube);
 
-      for (i = 0; i < cube->v->size; i++)
-        {
-          a = (struct cubebit *) vector_get (cube->v, i);
-          if (a->type != '1')
-            continue;
-          link = link_lookup_by_id (i, s->g);
-          if (reliability_term == 0.0)
-            reliability_term = link->reliability;
-          else
-            reliability_term *= link->reliability;
-        }
-
-      if (detail)
-        fprintf (shell->terminal, " + %f", reliability_term);
+      for (w = 0; w < cube->nwords; w++)
+        CUBE_FOREACH_BIT (bits, cube->one[w], w, i)
+          {
+            link = link_lookup_by_id (i, s->g);
+            if (reliability_term == 0.0)
+              reliability_term = link->reliability;
+            else
+              reliability_term *= link->reliability;
+          }
+
+      if (ctx->detail)
+        fprintf (ctx->fp, " + %f", reliability_term);
+
+      /* the product of each label's '0' links, in the link order */
+      subreliability = (double *) calloc (gamma + 1, sizeof (double));
+      for (w = 0; w < cube->nwords; w++)
+        CUBE_FOREACH_BIT (bits, cube->zero[w], w, i)
+          {
+            u = cube->label[i];
+            link = link_lookup_by_id (i, s->g);
+            if (subreliability[u] == 0.0)
+              subreliability[u] = link->reliability;
+            else
+              subreliability[u] *= link->reliability;
+          }
 
       for (u = 1; u <= gamma; u++)
         {
-          double subreliability = 0.0;
-          for (i = 0; i < cube->v->size; i++)
-            {
-              a = (struct cubebit *) vector_get (cube->v, i);
-              if (a->type != '0' || a->label != u)
-                continue;
-              link = link_lookup_by_id (i, s->g);
-              if (subreliability == 0.0)
-                subreliability = link->reliability;
-              else
-                subreliability *= link->reliability;
-            }
           if (reliability_term == 0.0)
-            reliability_term = (1 - subreliability);
+            reliability_term = (1 - subreliability[u]);
           else
-            reliability_term *= (1 - subreliability);
+            reliability_term *= (1 - subreliability[u]);
 
-          if (detail)
-            fprintf (shell->terminal, " * (1 - %f)_{%d}\n", subreliability, u);
+          if (ctx->detail)
+            fprintf (ctx->fp, " * (1 - %f)_{%d}\n",
+                     subreliability[u], u);
         }
+      free (subreliability);
 
       if (reliability == 0.0)
         reliability = reliability_term;
@@ -615,7 +705,7 @@ void
 incremental_path_reliability (struct node *s, struct node *t, struct path *path,
                               unsigned long path_index,
                               struct vector *previous, struct vector *state,
-                              struct shell *shell)
+                              struct sdp_context *ctx)
 {
   struct cube *MPi, *MPj;
   struct cube *cube;
@@ -625,19 +715,19 @@ incremental_path_reliability (struct node *s, struct node *t, struct path *path,
 
   memset (&stat, 0, sizeof (stat));
 
-  if (sdp_stat_detail)
-    fprintf (shell->terminal, "path-%lu:\n", path_index);
+  if (ctx->stat_detail)
+    fprintf (ctx->fp, "path-%lu:\n", path_index);
 
-  MPi = cube_create (path);
+  MPi = cube_create (path, ctx->pool);
 
-  if (detail)
+  if (ctx->detail)
     {
-      fprintf (shell->terminal, "path = ");
-      print_nodelinklist (shell->terminal, path->path);
-      fprintf (shell->terminal, "\n");
-      fprintf (shell->terminal, "cube = ");
-      cube_print (shell->terminal, MPi);
-      fprintf (shell->terminal, "\n");
+      fprintf (ctx->fp, "path = ");
+      print_nodelinklist (ctx->fp, path->path);
+      fprintf (ctx->fp, "\n");
+      fprintf (ctx->fp, "cube = ");
+      cube_print (ctx->fp, MPi);
+      fprintf (ctx->fp, "\n");
     }
 
   result = vector_create ();
@@ -650,29 +740,29 @@ incremental_path_reliability (struct node *s, struct node *t, struct path *path,
     {
       MPj = (struct cube *) vn->data;
 
-      if (detail)
-        fprintf (shell->terminal, "path-%d: ", vn->index);
+      if (ctx->detail)
+        fprintf (ctx->fp, "path-%d: ", vn->index);
 
-      operator_little (result, MPj, shell, &stat);
+      operator_little (result, MPj, ctx, &stat);
 
-      if (sdp_stat_detail)
-        fprintf (shell->terminal, "path-%d: intermediate terms: %u, "
+      if (ctx->stat_detail)
+        fprintf (ctx->fp, "path-%d: intermediate terms: %u, "
                  "subset: %u, disjoint: %u, x1: %u, split-recursive: %u\n",
                  vn->index, result->size, stat.subset, stat.disjoint,
                  stat.x1, stat.split_recursive);
     }
 
-  if (detail)
+  if (ctx->detail)
     {
       /* print result cubes */
-      fprintf (shell->terminal, "result =");
+      fprintf (ctx->fp, "result =");
       for (vn = vector_head (result); vn; vn = vector_next (vn))
         {
           cube = (struct cube *) vn->data;
-          fprintf (shell->terminal, " + ");
-          cube_print (shell->terminal, cube);
+          fprintf (ctx->fp, " + ");
+          cube_print (ctx->fp, cube);
         }
-      fprintf (shell->terminal, "\n");
+      fprintf (ctx->fp, "\n");
     }
 
   vector_catenate (state, result);
@@ -682,18 +772,22 @@ incremental_path_reliability (struct node *s, struct node *t, struct path *path,
   vector_add (cube_copy (MPi), previous);
   cube_delete (MPi);
 
-  if (sdp_stat)
-    fprintf (shell->terminal, "s-t: %u-%u stat[path=%lu]: states: %u, "
+  stat.arena_peak = ctx->pool->peak * ctx->pool->size;
+
+  if (ctx->stat)
+    fprintf (ctx->fp, "s-t: %u-%u stat[path=%lu]: states: %u, "
              "intermediates: %u, subset: %u, disjoint: %u, x1: %u, "
-             "split-recursive: %u\n",
+             "split-recursive: %u, arena-peak: %lu\n",
              s->id, t->id, path_index, stat.states, stat.intermediates,
-             stat.subset, stat.disjoint, stat.x1, stat.split_recursive);
+             stat.subset, stat.disjoint, stat.x1, stat.split_recursive,
+             stat.arena_peak);
 }
 
 
 void
-st_reliability (struct node *s, struct node *t, struct shell *shell)
+st_reliability (struct node *s, struct node *t, struct sdp_context *ctx)
 {
+  struct path_enum *pe;
   struct path *path;
   struct cube *cube;
   struct vector *previous, *state;
@@ -702,20 +796,24 @@ st_reliability (struct node *s, struct node *t, struct shell *shell)
   unsigned long path_index = 0;
   struct timeval start, end;
 
-  if (detail)
-    fprintf (shell->terminal, "# <- operator 'little'\n");
+  if (ctx->detail)
+    fprintf (ctx->fp, "# <- operator 'little'\n");
 
   previous = vector_create ();
   state = vector_create ();
 
+  /* all the cubes of this computation come from one pool */
+  ctx->pool = cube_pool_create (s->g->links->size);
+
   gettimeofday (&start, NULL);
 
-  for (path = path_enum_first (s); path; path = path_enum_next (path))
-    if (path_end (path) == t)
-      {
-        incremental_path_reliability (s, t, path, path_index, previous, state, shell);
-        path_index++;
-      }
+  pe = path_enum_create (s, t, PATH_ENUM_PRUNE_REACH);
+  while ((path = path_enum_step (pe)) != NULL)
+    {
+      incremental_path_reliability (s, t, path, path_index, previous, state, ctx);
+      path_index++;
+    }
+  path_enum_delete (pe);
 
   /* delete path cube list */
   for (vn = vector_head (previous); vn; vn = vector_next (vn))
@@ -725,34 +823,34 @@ st_reliability (struct node *s, struct node *t, struct shell *shell)
     }
   vector_delete (previous);
 
-  if (detail)
+  if (ctx->detail)
     {
       /* print state cubes */
-      fprintf (shell->terminal, "state =");
+      fprintf (ctx->fp, "state =");
       for (vn = vector_head (state); vn; vn = vector_next (vn))
         {
           cube = (struct cube *) vn->data;
-          fprintf (shell->terminal, " + ");
-          cube_print (shell->terminal, cube);
+          fprintf (ctx->fp, " + ");
+          cube_print (ctx->fp, cube);
         }
-      fprintf (shell->terminal, "\n");
+      fprintf (ctx->fp, "\n");
     }
 
   /* calculate reliability */
-  reliability = calculate_state_reliability (s, t, state, shell);
+  reliability = calculate_state_reliability (s, t, state, ctx);
 
   gettimeofday (&end, NULL);
 
-  fprintf (shell->terminal, "s-t: %u-%u reliability = %.10f (%d terms)\n",
+  fprintf (ctx->fp, "s-t: %u-%u reliability = %.10f (%d terms)\n",
            s->id, t->id, reliability, state->size);
 
-  if (sdp_stat)
+  if (ctx->stat)
     {
-      fprintf (shell->terminal, "s-t: %u-%u start time: %lu.%06lu\n", s->id, t->id,
+      fprintf (ctx->fp, "s-t: %u-%u start time: %lu.%06lu\n", s->id, t->id,
                start.tv_sec, start.tv_usec);
-      fprintf (shell->terminal, "s-t: %u-%u end time: %lu.%06lu\n", s->id, t->id,
+      fprintf (ctx->fp, "s-t: %u-%u end time: %lu.%06lu\n", s->id, t->id,
                end.tv_sec, end.tv_usec);
-      fprintf (shell->terminal, "s-t: %u-%u time taken: %lu.%06lu\n", s->id, t->id,
+      fprintf (ctx->fp, "s-t: %u-%u time taken: %lu.%06lu\n", s->id, t->id,
                end.tv_sec - start.tv_sec - (end.tv_usec < start.tv_usec ? 1 : 0),
                (end.tv_usec < start.tv_usec ? 1000000 : 0) +
                 end.tv_usec - start.tv_usec);
@@ -765,6 +863,92 @@ st_reliability (struct node *s, struct node *t, struct shell *shell)
       cube_delete (cube);
     }
   vector_delete (state);
+
+  assert (ctx->pool->used == 0);
+  cube_pool_delete (ctx->pool);
+  ctx->pool = NULL;
+}
+
+/* set up the context from the command's options: detail, stat,
+   stat-detail, and threads <N>.  returns the number of threads. */
+static unsigned int
+sdp_context_set (struct sdp_context *ctx, int argc, char **argv, FILE *fp)
+{
+  unsigned int nthreads = 1;
+  int i;
+
+  memset (ctx, 0, sizeof (struct sdp_context));
+  ctx->fp = fp;
+
+  for (i = 0; i < argc; i++)
+    {
+      if (! strcmp (argv[i], "detail"))
+        ctx->detail++;
+      else if (! strcmp (argv[i], "stat"))
+        ctx->stat++;
+      else if (! strcmp (argv[i], "stat-detail"))
+        {
+          ctx->stat++;
+          ctx->stat_detail++;
+        }
+      else if (! strcmp (argv[i], "threads") && i + 1 < argc)
+        nthreads = strtoul (argv[i + 1], NULL, 0);
+    }
+
+  return nthreads;
+}
+
+struct sdp_thread_arg
+{
+  struct sdp_pair *pairs;
+  struct sdp_context *ctx;
+};
+
+/* each pair writes into its own buffer, printed in order later. */
+static void
+sdp_thread_pair (void *arg, unsigned int item, unsigned int worker)
+{
+  struct sdp_thread_arg *targ = (struct sdp_thread_arg *) arg;
+  struct sdp_pair *pair = &targ->pairs[item];
+  struct sdp_context ctx;
+
+  ctx = *targ->ctx;
+  ctx.fp = open_memstream (&pair->buf, &pair->size);
+  st_reliability (pair->s, pair->t, &ctx);
+  fclose (ctx.fp);
+}
+
+/* calculate the reliability of the pairs, in nthreads threads.  the
+   output is the same as the sequential one, pair by pair. */
+void
+sdp_pairs_run (struct sdp_pair *pairs, unsigned int npairs,
+               unsigned int nthreads, struct sdp_context *ctx)
+{
+  struct sdp_thread_arg targ;
+  unsigned int i;
+
+  if (nthreads <= 1)
+    {
+      for (i = 0; i < npairs; i++)
+        st_reliability (pairs[i].s, pairs[i].t, ctx);
+      return;
+    }
+
+  /* the path enumerators share the CSR: build it before the threads */
+  if (npairs)
+    graph_freeze (pairs[0].s->g);
+
+  targ.pairs = pairs;
+  targ.ctx = ctx;
+  workqueue_run (nthreads, npairs, sdp_thread_pair, &targ);
+
+  for (i = 0; i < npairs; i++)
+    {
+      fwrite (pairs[i].buf, 1, pairs[i].size, ctx->fp);
+      free (pairs[i].buf);
+      pairs[i].buf = NULL;
+    }
+  fflush (ctx->fp);
 }
 
 DEFINE_COMMAND (calculate_reliability_source_destination,
@@ -780,23 +964,9 @@ DEFINE_COMMAND (calculate_reliability_source_destination,
   struct graph *G = (struct graph *) shell->context;
   unsigned long sid, tid;
   struct node *s, *t;
+  struct sdp_context ctx;
 
-  if (! strcmp (argv[argc - 1], "detail"))
-    detail++;
-  if (! strcmp (argv[argc - 1], "stat-detail"))
-    {
-      sdp_stat++;
-      sdp_stat_detail++;
-    }
-  if (! strcmp (argv[argc - 2], "stat-detail"))
-    {
-      sdp_stat++;
-      sdp_stat_detail++;
-    }
-  if (! strcmp (argv[argc - 1], "stat"))
-    sdp_stat++;
-  if (! strcmp (argv[argc - 2], "stat"))
-    sdp_stat++;
+  sdp_context_set (&ctx, argc, argv, shell->terminal);
 
   sid = strtoul (argv[3], NULL, 0);
   tid = strtoul (argv[5], NULL, 0);
@@ -819,10 +989,7 @@ DEFINE_COMMAND (calculate_reliability_source_destination,
       return;
     }
 
-  st_reliability (s, t, shell);
-
-  detail = 0;
-  sdp_stat = 0;
+  st_reliability (s, t, &ctx);
 }
 
 
@@ -893,30 +1060,35 @@ DEFINE_COMMAND (calculate_reliability_all_to_all,
   struct graph *G = (struct graph *) shell->context;
   struct node *s, *t;
   struct vector_node *vns, *vnt;
-
-  if (! strcmp (argv[argc - 1], "detail"))
-    detail++;
-  if (! strcmp (argv[argc - 1], "stat"))
-    sdp_stat++;
-  if (! strcmp (argv[argc - 2], "stat"))
-    sdp_stat++;
-
-  for (vns = vector_head (G->nodes); vns; vns = vector_next (vns))
+  struct vector_node vns_cursor, vnt_cursor;
+  struct sdp_context ctx;
+  struct sdp_pair *pairs;
+  unsigned int npairs, nthreads;
+
+  nthreads = sdp_context_set (&ctx, argc, argv, shell->terminal);
+
+  pairs = (struct sdp_pair *)
+    calloc (G->nodes->size * G->nodes->size + 1, sizeof (struct sdp_pair));
+  npairs = 0;
+  for (vns = vector_cursor_head (G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
     {
       s = (struct node *) vns->data;
-      for (vnt = vector_head (G->nodes); vnt; vnt = vector_next (vnt))
+      for (vnt = vector_cursor_head (G->nodes, &vnt_cursor); vnt;
+           vnt = vector_cursor_next (vnt))
         {
           t = (struct node *) vnt->data;
           if (s == t)
             continue;
 
-          st_reliability (s, t, shell);
-
+          pairs[npairs].s = s;
+          pairs[npairs].t = t;
+          npairs++;
         }
     }
 
-  detail = 0;
-  sdp_stat = 0;
+  sdp_pairs_run (pairs, npairs, nthreads, &ctx);
+  free (pairs);
 }
 
 ALIAS_COMMAND (calculate_reliability_all_to_all_stat,
@@ -927,6 +1099,25 @@ ALIAS_COMMAND (calculate_reliability_all_to_all_stat,
                 "calculate all-to-all reliability\n"
                 "show statistics\n")
 
+ALIAS_COMMAND (calculate_reliability_all_to_all_threads,
+               calculate_reliability_all_to_all,
+                "calculate reliability all-to-all threads <1-1024>",
+                "calculate\n"
+                "calculate reliability\n"
+                "calculate all-to-all reliability\n"
+                "calculate in multiple threads\n"
+                "specify number of threads\n")
+
+ALIAS_COMMAND (calculate_reliability_all_to_all_stat_threads,
+               calculate_reliability_all_to_all,
+                "calculate reliability all-to-all stat threads <1-1024>",
+                "calculate\n"
+                "calculate reliability\n"
+                "calculate all-to-all reliability\n"
+                "show statistics\n"
+                "calculate in multiple threads\n"
+                "specify number of threads\n")
+
 DEFINE_COMMAND (calculate_reliability_all_to_half,
                 "calculate reliability all-to-half",
                 "calculate\n"
@@ -937,28 +1128,36 @@ DEFINE_COMMAND (calculate_reliability_all_to_half,
   struct graph *G = (struct graph *) shell->context;
   struct node *s, *t;
   struct vector_node *vns, *vnt;
-
-  if (! strcmp (argv[argc - 1], "detail"))
-    detail++;
-  if (! strcmp (argv[argc - 1], "stat"))
-    sdp_stat++;
-  if (! strcmp (argv[argc - 2], "stat"))
-    sdp_stat++;
-
-  for (vns = vector_head (G->nodes); vns; vns = vector_next (vns))
+  struct vector_node vns_cursor, vnt_cursor;
+  struct sdp_context ctx;
+  struct sdp_pair *pairs;
+  unsigned int npairs, nthreads;
+
+  nthreads = sdp_context_set (&ctx, argc, argv, shell->terminal);
+
+  pairs = (struct sdp_pair *)
+    calloc (G->nodes->size * G->nodes->size + 1, sizeof (struct sdp_pair));
+  npairs = 0;
+  for (vns = vector_cursor_head (G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
     {
       s = (struct node *) vns->data;
-      for (vnt = vector_head (G->nodes); vnt; vnt = vector_next (vnt))
+      for (vnt = vector_cursor_head (G->nodes, &vnt_cursor); vnt;
+           vnt = vector_cursor_next (vnt))
         {
           t = (struct node *) vnt->data;
 
           if (vns->index < vnt->index)
-            st_reliability (s, t, shell);
+            {
+              pairs[npairs].s = s;
+              pairs[npairs].t = t;
+              npairs++;
+            }
         }
     }
 
-  detail = 0;
-  sdp_stat = 0;
+  sdp_pairs_run (pairs, npairs, nthreads, &ctx);
+  free (pairs);
 }
 
 ALIAS_COMMAND (calculate_reliability_all_to_half_stat,
@@ -969,6 +1168,25 @@ ALIAS_COMMAND (calculate_reliability_all_to_half_stat,
                 "calculate all-to-half reliability\n"
                 "show statistics\n")
 
+ALIAS_COMMAND (calculate_reliability_all_to_half_threads,
+               calculate_reliability_all_to_half,
+                "calculate reliability all-to-half threads <1-1024>",
+                "calculate\n"
+                "calculate reliability\n"
+                "calculate all-to-half reliability\n"
+                "calculate in multiple threads\n"
+                "specify number of threads\n")
+
+ALIAS_COMMAND (calculate_reliability_all_to_half_stat_threads,
+               calculate_reliability_all_to_half,
+                "calculate reliability all-to-half stat threads <1-1024>",
+                "calculate\n"
+                "calculate reliability\n"
+                "calculate all-to-half reliability\n"
+                "show statistics\n"
+                "calculate in multiple threads\n"
+                "specify number of threads\n")
+
 DEFINE_COMMAND (link_all_reliability,
                 "link all reliability <[-]ddd.ddd>",
                 "link\n"
@@ -21,15 +21,50 @@
 #ifndef _RELIABILITY_H_
 #define _RELIABILITY_H_
 
-struct cubebit
+/* a cube has one bit per link: '1', 'x', or '0' with a label.
+   the '1' and '0' bits are kept as bitmasks, so that the relations
+   between the cubes are word-wide operations. */
+typedef unsigned short cube_label_t;
+#define CUBE_LABEL_MAX ((cube_label_t) -1)
+
+#define CUBE_WORD_BITS (sizeof (unsigned long) * 8)
+#define CUBE_NWORDS(nbits) (((nbits) + CUBE_WORD_BITS - 1) / CUBE_WORD_BITS)
+#define CUBE_BIT(i) (1UL << ((i) % CUBE_WORD_BITS))
+#define CUBE_SET(mask, i) ((mask)[(i) / CUBE_WORD_BITS] |= CUBE_BIT (i))
+#define CUBE_CLR(mask, i) ((mask)[(i) / CUBE_WORD_BITS] &= ~CUBE_BIT (i))
+#define CUBE_ISSET(mask, i) ((mask)[(i) / CUBE_WORD_BITS] & CUBE_BIT (i))
+
+/* for each bit i set in the word'th word, of the value mask */
+#define CUBE_FOREACH_BIT(bits, mask, word, i)                        \
+  for ((bits) = (mask);                                             \
+       (bits) &&                                                    \
+         ((i) = (word) * CUBE_WORD_BITS + __builtin_ctzl (bits), 1); \
+       (bits) &= (bits) - 1)
+
+struct cube_pool
 {
-  char type; /* '1', 'x', or '0' */
-  unsigned int label; /* label for '0' */
+  unsigned int nbits;
+  size_t size;                  /* bytes of a cube */
+  void *free;                   /* free list of the returned cubes */
+  struct cube_pool_chunk *chunks;
+  char *next;                   /* next unused cube in the last chunk */
+  unsigned int left;            /* unused cubes in the last chunk */
+  unsigned int chunk_cubes;     /* cubes in the next chunk */
+  unsigned long allocated;      /* cubes in all chunks */
+  unsigned long used;           /* cubes in use */
+  unsigned long peak;           /* the largest used */
 };
 
 struct cube
 {
-  struct vector *v;
+  struct cube_pool *pool;       /* the pool the cube belongs to */
+  size_t size;                  /* bytes, including the arrays below */
+  unsigned int nbits;
+  unsigned int nwords;
+  unsigned int gamma;           /* the largest label */
+  unsigned long *one;           /* '1' bits */
+  unsigned long *zero;          /* '0' bits */
+  cube_label_t *label;          /* label of each '0' bit, 0 otherwise */
 };
 
 struct sdp_stat
@@ -40,15 +75,43 @@ struct sdp_stat
   unsigned int disjoint;
   unsigned int x1;
   unsigned int split_recursive;
+  unsigned long arena_peak;     /* bytes of cubes in use at peak */
+};
+
+/* per-call context of the SDP calculation: the options and the
+   output stream. */
+struct sdp_context
+{
+  int detail;
+  int stat;
+  int stat_detail;
+  FILE *fp;
+  struct cube_pool *pool;       /* set during st_reliability () */
 };
 
-struct cubebit *cubebit_create ();
-void cubebit_delete (struct cubebit *cubebit);
-struct cube *cube_create (struct path *path);
+/* an (s,t) pair and its buffered output, for the threaded run */
+struct sdp_pair
+{
+  struct node *s;
+  struct node *t;
+  char *buf;
+  size_t size;
+};
+
+struct cube_pool *cube_pool_create (unsigned int nbits);
+void cube_pool_delete (struct cube_pool *pool);
+struct cube *cube_alloc (struct cube_pool *pool);
+struct cube *cube_create (struct path *path, struct cube_pool *pool);
+struct cube *cube_copy (struct cube *cube);
+char cube_type (struct cube *cube, unsigned int i);
 void cube_delete (struct cube *cube);
 void cube_sprint (char *s, int size, struct cube *cube);
 void cube_print (FILE *fp, struct cube *cube);
 
+void st_reliability (struct node *s, struct node *t, struct sdp_context *ctx);
+void sdp_pairs_run (struct sdp_pair *pairs, unsigned int npairs,
+                    unsigned int nthreads, struct sdp_context *ctx);
+
 EXTERN_COMMAND (calculate_reliability_source_destination);
 EXTERN_COMMAND (calculate_reliability_source_destination_detail);
 EXTERN_COMMAND (calculate_reliability_source_destination_stat);
@@ -57,8 +120,12 @@ EXTERN_COMMAND (calculate_reliability_source_destination_sdp_stat_detail);
 EXTERN_COMMAND (calculate_reliability_source_destination_sdp_stat_detail_detail);
 EXTERN_COMMAND (calculate_reliability_all_to_all);
 EXTERN_COMMAND (calculate_reliability_all_to_all_stat);
+EXTERN_COMMAND (calculate_reliability_all_to_all_threads);
+EXTERN_COMMAND (calculate_reliability_all_to_all_stat_threads);
 EXTERN_COMMAND (calculate_reliability_all_to_half);
 EXTERN_COMMAND (calculate_reliability_all_to_half_stat);
+EXTERN_COMMAND (calculate_reliability_all_to_half_threads);
+EXTERN_COMMAND (calculate_reliability_all_to_half_stat_threads);
 
 EXTERN_COMMAND (link_all_reliability);
 
@@ -105,7 +105,8 @@ DEFINE_COMMAND (export_ampl_append_routing,
   struct shell *shell = (struct shell *) context;
   struct routing *routing = (struct routing *) shell->context;
   int s, t;
-  struct vector_node *vn;
+  struct route_flat *flat;
+  unsigned int j;
   FILE *fp;
   int c = 0;
 
@@ -117,6 +118,7 @@ DEFINE_COMMAND (export_ampl_append_routing,
       return;
     }
 
+  flat = route_freeze (routing);
   fprintf (fp, "set R :=\n ");
   for (t = 0; t < routing->nnodes; t++)
     {
@@ -124,18 +126,13 @@ DEFINE_COMMAND (export_ampl_append_routing,
         {
           if (s == t)
             continue;
-          for (vn = vector_head (routing->route[s][t].nexthops); vn;
-               vn = vector_next (vn))
+          for (j = ROUTE_FLAT_BEGIN (flat, s, t);
+               j < ROUTE_FLAT_END (flat, s, t); j++)
             {
-              struct nexthop *nexthop = (struct nexthop *) vn->data;
-              if (nexthop)
-                {
-                  fprintf (fp, " (%d,%d,%d)",
-                           t, s, nexthop->node->id);
-                  c++;
-                  if (c % 5 == 0)
-                    fprintf (fp, "\n");
-                }
+              fprintf (fp, " (%d,%d,%d)", t, s, flat->nexthop[j]);
+              c++;
+              if (c % 5 == 0)
+                fprintf (fp, "\n");
             }
         }
       fprintf (fp, "\n ");
@@ -296,7 +293,7 @@ DEFINE_COMMAND(import_ampl_routing_ratio,
                        t, x, y, ratio);
 
               match = NULL;
-              nexthops = routing->route[x][t].nexthops;
+              nexthops = route_nexthops (routing, x, t);
               for (vn = vector_head (nexthops); vn; vn = vector_next (vn))
                 {
                   struct nexthop *n = (struct nexthop *) vector_data (vn);
@@ -324,7 +321,7 @@ DEFINE_COMMAND(import_ampl_routing_ratio,
                        t, x, y, ratio);
 
               match = NULL;
-              nexthops = routing->route[x][t].nexthops;
+              nexthops = route_nexthops (routing, x, t);
               for (vn = vector_head (nexthops); vn; vn = vector_next (vn))
                 {
                   struct nexthop *n = (struct nexthop *) vector_data (vn);
@@ -22,41 +22,41 @@
 #include "shell.h"
 #include "command.h"
 #include "command_shell.h"
+#include "file.h"
+#include "timer.h"
 
 #include "network/graph.h"
+#include "interface/brite.h"
 
-#define REGMATCH_MAX 16
-#define BRITE_NODE_LINE \
-  "^([0-9]+) ([0-9.]+) ([0-9.]+) ([0-9]+) ([0-9]+) ([0-9-]+) ([a-zA-Z_]+)[ ]*$"
-#define BRITE_EDGE_LINE \
-  "^([0-9]+) ([0-9]+) ([0-9]+) ([0-9.]+) ([0-9.]+) ([0-9.]+) ([0-9-]+) ([0-9-]+) ([a-zA-Z_]+)[ ]*([a-zA-Z_]*)[ ]*$"
+/* the fields of the BRITE Node/Edge lines:
+   Node: id xpos ypos indegree outdegree ASid type
+   Edge: id from to length delay bandwidth ASfrom ASto type [direction] */
+#define BRITE_NODE_FIELDS 7
+#define BRITE_EDGE_FIELDS 9
 
+#define BRITE_DIGIT  "0123456789"
+#define BRITE_REAL   "0123456789."
+#define BRITE_ASID   "0123456789-"
+#define BRITE_TYPE \
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_"
 
 int
-scan_node_line (struct shell *shell, char *buf, regex_t *regex_node,
+scan_node_line (struct shell *shell, int argc, char **argv,
                 int *nodeid, double *xpos, double *ypos,
                 int *indegree, int *outdegree, int *asid, char **type)
 {
-  int i, ret;
   char *endptr;
-  char *line;
-  char **p, *argv[REGMATCH_MAX];
-  regmatch_t regmatch[REGMATCH_MAX];
 
-  ret = regexec (regex_node, buf, REGMATCH_MAX, regmatch, 0);
-  if (ret == REG_NOMATCH)
+  if (argc != BRITE_NODE_FIELDS ||
+      ! file_token_is (argv[0], BRITE_DIGIT) ||
+      ! file_token_is (argv[1], BRITE_REAL) ||
+      ! file_token_is (argv[2], BRITE_REAL) ||
+      ! file_token_is (argv[3], BRITE_DIGIT) ||
+      ! file_token_is (argv[4], BRITE_DIGIT) ||
+      ! file_token_is (argv[5], BRITE_ASID) ||
+      ! file_token_is (argv[6], BRITE_TYPE))
     return 0;
 
-  line = buf;
-  p = argv;
-
-  for (i = 1; i < REGMATCH_MAX && regmatch[i].rm_so >= 0; i++)
-    {
-      line[regmatch[i].rm_eo] = '\0';
-      *p++ = &line[regmatch[i].rm_so];
-    }
-  *p = NULL;
-
   *nodeid = strtol (argv[0], &endptr, 0);
   if (*endptr != '\0')
     {
@@ -114,30 +114,25 @@ scan_node_line (struct shell *shell, char *buf, regex_t *regex_node,
 }
 
 int
-scan_edge_line (struct shell *shell, char *buf, regex_t *regex_edge,
+scan_edge_line (struct shell *shell, int argc, char **argv,
                 int *edgeid, int *from, int *to, double *length, double *delay,
                 double *bandwidth, int *asfrom, int *asto, char **type)
 {
-  int i, ret;
   char *endptr;
-  char *line;
-  char **p, *argv[REGMATCH_MAX];
-  regmatch_t regmatch[REGMATCH_MAX];
 
-  ret = regexec (regex_edge, buf, REGMATCH_MAX, regmatch, 0);
-  if (ret == REG_NOMATCH)
+  if ((argc != BRITE_EDGE_FIELDS && argc != BRITE_EDGE_FIELDS + 1) ||
+      ! file_token_is (argv[0], BRITE_DIGIT) ||
+      ! file_token_is (argv[1], BRITE_DIGIT) ||
+      ! file_token_is (argv[2], BRITE_DIGIT) ||
+      ! file_token_is (argv[3], BRITE_REAL) ||
+      ! file_token_is (argv[4], BRITE_REAL) ||
+      ! file_token_is (argv[5], BRITE_REAL) ||
+      ! file_token_is (argv[6], BRITE_ASID) ||
+      ! file_token_is (argv[7], BRITE_ASID) ||
+      ! file_token_is (argv[8], BRITE_TYPE) ||
+      (argc > BRITE_EDGE_FIELDS && ! file_token_is (argv[9], BRITE_TYPE)))
     return 0;
 
-  line = buf;
-  p = argv;
-
-  for (i = 1; i < REGMATCH_MAX && regmatch[i].rm_so >= 0; i++)
-    {
-      line[regmatch[i].rm_eo] = '\0';
-      *p++ = &line[regmatch[i].rm_so];
-    }
-  *p = NULL;
-
   *edgeid = strtol (argv[0], &endptr, 0);
   if (*endptr != '\0')
     {
@@ -210,38 +205,38 @@ scan_edge_line (struct shell *shell, char *buf, regex_t *regex_edge,
   return 1;
 }
 
+/* "Topology: ( 20 Nodes, 37 Edges )": reserve the graph for them. */
+static void
+scan_topology_line (int argc, char **argv, struct graph *G)
+{
+  unsigned long nnodes, nedges;
+
+  if (argc != 7 || strcmp (argv[0], "Topology:") ||
+      ! file_token_is (argv[2], BRITE_DIGIT) ||
+      ! file_token_is (argv[4], BRITE_DIGIT))
+    return;
+
+  nnodes = strtoul (argv[2], NULL, 10);
+  nedges = strtoul (argv[4], NULL, 10);
+  graph_reserve (G, nnodes, nedges * 2);
+}
+
 int
 read_brite_file (struct shell *shell, struct graph *G, char *filename)
 {
-  FILE *fp;
-  int ret;
-  char buf[256];
-  regex_t regex_node, regex_edge;
+  struct file_reader *reader;
+  int ret = 0, argc, argmax = 0;
+  char *buf, **argv = NULL;
+  size_t len;
 
-  fp = fopen (filename, "r");
-  if (fp == NULL)
+  reader = file_reader_open (filename);
+  if (reader == NULL)
     {
       fprintf (shell->terminal, "no such file: %s\n", filename);
       return -1;
     }
 
-  ret = regcomp (&regex_node, BRITE_NODE_LINE, REG_EXTENDED|REG_NEWLINE);
-  if (ret != 0)
-    {
-      regerror (ret, &regex_node, buf, sizeof (buf));
-      fprintf (shell->terminal, "regcomp for Node line failed: %s\n", buf);
-      return -1;
-    }
-
-  ret = regcomp (&regex_edge, BRITE_EDGE_LINE, REG_EXTENDED|REG_NEWLINE);
-  if (ret != 0)
-    {
-      regerror (ret, &regex_edge, buf, sizeof (buf));
-      fprintf (shell->terminal, "regcomp for Edge line failed: %s\n", buf);
-      return -1;
-    }
-
-  while (fgets (buf, sizeof (buf), fp))
+  while ((buf = file_reader_line (reader, &len)) != NULL)
     {
       int nodeid, indegree, outdegree, asid;
       double xpos, ypos;
@@ -249,44 +244,55 @@ read_brite_file (struct shell *shell, struct graph *G, char *filename)
       double length, delay, bandwidth;
       char *type;
 
+      argc = file_split (buf, len, &argv, &argmax);
+      if (argc <= 0)
+        continue;
+
+      if (argv[0][0] == 'T')
+        {
+          scan_topology_line (argc, argv, G);
+          continue;
+        }
+
       /* Node line match */
-      ret = scan_node_line (shell, buf, &regex_node, &nodeid, &xpos, &ypos,
+      ret = scan_node_line (shell, argc, argv, &nodeid, &xpos, &ypos,
                             &indegree, &outdegree, &asid, &type);
       if (ret < 0)
-        return -1;
+        break;
       else if (ret == 1)
         {
           struct node *node;
           node = node_get (nodeid, G);
           node->xpos = xpos;
           node->ypos = ypos;
+          continue;
         }
 
       /* Edge line match */
-      ret = scan_edge_line (shell, buf, &regex_edge, &edgeid, &from, &to, &length,
+      ret = scan_edge_line (shell, argc, argv, &edgeid, &from, &to, &length,
                             &delay, &bandwidth, &asfrom, &asto, &type);
       if (ret < 0)
-        return -1;
+        break;
       else if (ret == 1)
         {
           struct node *s, *t;
           struct link *link;
           s = node_get (from, G);
           t = node_get (to, G);
-          link = link_get (s, t, G);
+          link = link_append (s, t, G);
           link->bandwidth = bandwidth;
           link->delay = delay;
           link->length = length;
-          link = link_get (t, s, G);
+          link = link_append (t, s, G);
           link->bandwidth = bandwidth;
           link->delay = delay;
           link->length = length;
         }
     }
 
-  regfree (&regex_node);
-  regfree (&regex_edge);
-  return 0;
+  free (argv);
+  file_reader_close (reader);
+  return (ret < 0 ? -1 : 0);
 }
 
 DEFINE_COMMAND(import_brite,
@@ -301,5 +307,96 @@ DEFINE_COMMAND(import_brite,
   command_config_add (G->config, argc, argv);
 }
 
+/* write a synthetic BRITE file: each new node attaches to
+   BRITE_BENCHMARK_DEGREE random earlier nodes (as Barabasi-Albert). */
+#define BRITE_BENCHMARK_DEGREE 2
+
+static int
+brite_benchmark_write (char *filename, unsigned long nnodes)
+{
+  FILE *fp;
+  unsigned long i, j = 0, k, nedges, edgeid;
+
+  fp = fopen (filename, "w");
+  if (fp == NULL)
+    return -1;
+
+  srandom (0);
+  nedges = 0;
+  for (i = 1; i < nnodes; i++)
+    nedges += (i < BRITE_BENCHMARK_DEGREE ? i : BRITE_BENCHMARK_DEGREE);
+
+  fprintf (fp, "Topology: ( %lu Nodes, %lu Edges )\n", nnodes, nedges);
+  fprintf (fp, "Model ( 2 ): %lu 1000 100 1 2 %d 10 1024 \n\n",
+           nnodes, BRITE_BENCHMARK_DEGREE);
+
+  fprintf (fp, "Nodes: (%lu)\n", nnodes);
+  for (i = 0; i < nnodes; i++)
+    fprintf (fp, "%lu %ld.00 %ld.00 %d %d -1 RT_NODE \n", i,
+             random () % 1000, random () % 1000,
+             BRITE_BENCHMARK_DEGREE, BRITE_BENCHMARK_DEGREE);
+
+  fprintf (fp, "\nEdges: (%lu):\n", nedges);
+  edgeid = 0;
+  for (i = 1; i < nnodes; i++)
+    for (k = 0; k < BRITE_BENCHMARK_DEGREE && k < i; k++)
+      {
+        j = (k == 0 ? random () % i : (j + 1 + random () % (i - 1)) % i);
+        fprintf (fp, "%lu %lu %lu %ld.%02ld %ld.%02ld 1024.00 -1 -1 E_RT U\n",
+                 edgeid++, i, j, random () % 1000, random () % 100,
+                 random () % 10, random () % 100);
+      }
+
+  fclose (fp);
+  return 0;
+}
+
+DEFINE_COMMAND (benchmark_import_brite,
+                "benchmark import brite <1-10000000> <FILENAME>",
+                "benchmark command\n"
+                "benchmark the import from other data\n"
+                "benchmark the import from BRITE\n"
+                "specify number of nodes\n"
+                "specify the synthetic BRITE filename to write\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct graph *G;
+  FILE *terminal;
+  struct stat statbuf;
+  unsigned long nnodes;
+  timer_counter_t start, end, res;
+  unsigned long long usec;
+  int ret;
+
+  nnodes = strtoul (argv[3], NULL, 0);
+  if (brite_benchmark_write (argv[4], nnodes) < 0)
+    {
+      fprintf (shell->terminal, "cannot write %s: %s\n",
+               argv[4], strerror (errno));
+      return;
+    }
+  stat (argv[4], &statbuf);
+
+  /* import to a scratch graph, without the per-line messages */
+  G = graph_create ();
+  terminal = shell->terminal;
+  shell->terminal = fopen ("/dev/null", "w");
+
+  timer_count (start);
+  ret = read_brite_file (shell, G, argv[4]);
+  timer_count (end);
+  timer_sub (start, end, res);
+  usec = timer_to_usec (res);
 
+  fclose (shell->terminal);
+  shell->terminal = terminal;
+
+  fprintf (shell->terminal, "Benchmark: BRITE import%s: %d nodes %d links, "
+           "%lld bytes\n", (ret < 0 ? " (failed)" : ""),
+           graph_nodes (G), graph_edges (G), (long long) statbuf.st_size);
+  fprintf (shell->terminal, "  %llu us, %.2f MB/s\n", usec,
+           (usec ? (double) statbuf.st_size / usec : 0.0));
+
+  graph_delete (G);
+}
 
@@ -23,7 +23,13 @@
 
 #include "command.h"
 
+struct shell;
+struct graph;
+
+int read_brite_file (struct shell *shell, struct graph *G, char *filename);
+
 EXTERN_COMMAND (import_brite);
+EXTERN_COMMAND (benchmark_import_brite);
 
 #endif /*_BRITE_H_*/
 
@@ -87,7 +87,7 @@ simrouting_agnode (struct node *node, Agraph_t *GVG, char *domain)
 
   snprintf (simple_name, sizeof (simple_name), "%d", node->id);
   if (! node->name)
-    node->name = strdup (simple_name);
+    node_set_name (node, simple_name);
 
   if (domain && node->domain_name)
     {
@@ -396,6 +396,7 @@ read_ospf_lsdb (struct table *lsdb, struct graph *G)
   unsigned int index = 0;
   struct node *v;
   struct table_node *node;
+  char *name;
   int i;
 
   struct table *router_table;
@@ -414,7 +415,9 @@ read_ospf_lsdb (struct table *lsdb, struct graph *G)
       v->addr = node_addr (lsa);
       v->plen = node_plen (lsa);
       v->type = lsa->header.type;
-      v->name = node_name (lsa);
+      name = node_name (lsa);
+      node_set_name (v, name);
+      free (name);
       v->domain_name = node_domain_name (lsa);
 
       if (lsa->header.type == OSPF_LSTYPE_ROUTER)
@@ -571,6 +574,7 @@ read_ospf_lsdb_metric (struct table *lsdb, struct graph *G, struct weight *W)
           assert (W->weight[e->id]);
         }
     }
+  weight_modified (W);
 }
 
 #endif /*HAVE_NETSNMP*/
@@ -24,221 +24,196 @@
 #include "command.h"
 #include "command_shell.h"
 #include "table.h"
+#include "file.h"
+#include "timer.h"
 
 #include "network/graph.h"
 #include "network/weight.h"
+#include "interface/rocketfuel.h"
 
 /* uid @loc [+] [bb] (num_neigh) [&ext] -> <nuid-1> <nuid-2> ... {-euid} ... =name[!] rn */
 
-#define REGMATCH_MAX 16
-
-#define START "^"
-#define END "$"
-#define SPACE "[ \t]+"
-#define MAYSPACE "[ \t]*"
+#define ROCKETFUEL_DIGIT    "0123456789"
+#define ROCKETFUEL_LOCATION \
+  "?ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789,+"
+#define ROCKETFUEL_NAME \
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789.!-"
+#define ROCKETFUEL_EXTERN   "{}-0123456789"
+#define ROCKETFUEL_WEIGHT   "0123456789."
+
+/* true if the token is the digits enclosed by open and close. */
+static int
+rocketfuel_token_enclosed (char *token, char open, char close)
+{
+  size_t len = strlen (token);
+  size_t ndigit;
 
-#define ROCKETFUEL_MAPS_LINE \
-  START "(-*[0-9]+)" SPACE "(@[?A-Za-z0-9,+]+)" SPACE \
-  "(\\+)*" MAYSPACE "(bb)*" MAYSPACE \
-  "\\(([0-9]+)\\)" SPACE "(&[0-9]+)*" MAYSPACE \
-  "->" MAYSPACE "(<[0-9 \t<>]+>)*" MAYSPACE \
-  "(\\{-[0-9\\{\\} \t-]+\\})*" SPACE \
-  "=([A-Za-z0-9.!-]+)" SPACE "r([0-9])" \
-  MAYSPACE END
+  if (len < 3 || token[0] != open || token[len - 1] != close)
+    return 0;
+  ndigit = strspn (&token[1], ROCKETFUEL_DIGIT);
+  return (ndigit == len - 2);
+}
 
 int
-scan_maps_line (struct shell *shell, char *buf, regex_t *regexp,
+scan_maps_line (struct shell *shell, unsigned long lineno,
+                int argc, char **argv,
                 int *nodeid, char **location, int *dnsflag, int *bbflag,
-                int *nnbr, int *next, char **neighbors, char **externs,
-                char **name, int *radius)
+                int *nnbr, int *next, char ***neighbors, int *nneighbors,
+                int *nexterns, char **name, int *radius)
 {
-  int i, ret;
+  int i = 0;
   char *endptr;
-  char *line;
-  int argc;
-  char *argv[REGMATCH_MAX];
-  regmatch_t regmatch[REGMATCH_MAX];
 
-  ret = regexec (regexp, buf, REGMATCH_MAX, regmatch, 0);
-  if (ret == REG_NOMATCH)
-    {
-      fprintf (shell->terminal, "match failed: %s", buf);
-      return -1;
-    }
-  else
-    fprintf (shell->terminal, "matched: %s", buf);
+  *dnsflag = *bbflag = 0;
+  *next = 0;
+  *neighbors = NULL;
+  *nneighbors = *nexterns = 0;
 
-  line = strdup (buf);
-  argc = 0;
-
-  /* regmatch[0] is the entire strings that matched */
-  for (i = 1; i < REGMATCH_MAX; i++)
-    {
-      if (regmatch[i].rm_so == -1)
-        argv[i-1] = NULL;
-      else
-        {
-          line[regmatch[i].rm_eo] = '\0';
-          argv[i-1] = &line[regmatch[i].rm_so];
-          argc = i;
-        }
-    }
-
-#if 1
-  for (i = 0; i < argc; i++)
-    fprintf (shell->terminal, "argv[%d]: %s\n", i, argv[i]);
-#endif /*0*/
-
-  *nodeid = strtol (argv[0], &endptr, 0);
+  /* uid */
+  if (i >= argc || ! file_token_is (&argv[i][strspn (argv[i], "-")],
+                                    ROCKETFUEL_DIGIT))
+    goto mismatch;
+  *nodeid = strtol (argv[i++], &endptr, 0);
   if (*endptr != '\0')
     {
-      fprintf (shell->terminal, "invalid node id: %s\n", argv[0]);
+      fprintf (shell->terminal, "invalid node id: %s\n", argv[i - 1]);
       return -1;
     }
 
-  *location = strdup (argv[1]);
-  if (*location == NULL)
+  /* @loc */
+  if (i >= argc || argv[i][0] != '@' ||
+      ! file_token_is (&argv[i][1], ROCKETFUEL_LOCATION))
+    goto mismatch;
+  *location = argv[i++];
+
+  /* [+] [bb] */
+  if (i < argc && (! strcmp (argv[i], "+") || ! strcmp (argv[i], "+bb")))
     {
-      fprintf (shell->terminal, "strdup for location failed: %s\n",
-               strerror (errno));
-      return -1;
+      *dnsflag = 1;
+      if (argv[i][1] == 'b')
+        *bbflag = 1;
+      i++;
     }
-
-  if (argv[2])
-    *dnsflag = 1;
-  else
-    *dnsflag = 0;
-
-  if (argv[3])
-    *bbflag = 1;
-  else
-    *bbflag = 0;
-
-  /* the first char should be '&' */
-  *nnbr = strtod (argv[4], &endptr);
-  if (*endptr != '\0')
+  if (i < argc && ! *bbflag && ! strcmp (argv[i], "bb"))
     {
-      fprintf (shell->terminal, "invalid #nbr: %s\n", argv[4]);
-      return -1;
+      *bbflag = 1;
+      i++;
     }
 
-  /* the first char should be '&' */
-  if (argv[5])
+  /* (num_neigh) */
+  if (i >= argc || ! rocketfuel_token_enclosed (argv[i], '(', ')'))
+    goto mismatch;
+  *nnbr = strtol (&argv[i++][1], NULL, 10);
+
+  /* [&ext] */
+  if (i < argc && argv[i][0] == '&')
     {
-      *next = strtol (&argv[5][1], &endptr, 0);
+      if (! file_token_is (&argv[i][1], ROCKETFUEL_DIGIT))
+        goto mismatch;
+      *next = strtol (&argv[i++][1], &endptr, 0);
       if (*endptr != '\0')
         {
-          fprintf (shell->terminal, "invalid #ext: %s\n", argv[5]);
+          fprintf (shell->terminal, "invalid #ext: %s\n", argv[i - 1]);
           return -1;
         }
     }
 
-  /* neighbors */
-  if (argv[6])
-    {
-      *neighbors = strdup (argv[6]);
-      if (*neighbors == NULL)
-        {
-          fprintf (shell->terminal, "strdup for neighbors failed: %s\n",
-                   strerror (errno));
-          return -1;
-        }
-    }
+  if (i >= argc || strcmp (argv[i++], "->"))
+    goto mismatch;
 
-  /* externs */
-  if (argv[7])
+  /* <nuid-1> <nuid-2> ... */
+  *neighbors = &argv[i];
+  while (i < argc && argv[i][0] == '<')
     {
-      *externs = strdup (argv[7]);
-      if (*externs == NULL)
-        {
-          fprintf (shell->terminal, "strdup for externs failed: %s\n",
-                   strerror (errno));
-          return -1;
-        }
+      if (! rocketfuel_token_enclosed (argv[i], '<', '>'))
+        goto mismatch;
+      (*nneighbors)++;
+      i++;
     }
 
-  /* name */
-  if (argv[8])
+  /* {-euid} ... */
+  while (i < argc && argv[i][0] == '{')
     {
-      *name = strdup (argv[8]);
-      if (*name == NULL)
-        {
-          fprintf (shell->terminal, "strdup for name failed: %s\n",
-                   strerror (errno));
-          return -1;
-        }
+      if (! file_token_is (argv[i], ROCKETFUEL_EXTERN))
+        goto mismatch;
+      (*nexterns)++;
+      i++;
     }
 
-  *radius = strtol (argv[9], &endptr, 0);
-  if (*endptr != '\0')
-    {
-      fprintf (shell->terminal, "invalid radius: %s\n", argv[9]);
-      return -1;
-    }
+  /* =name[!] */
+  if (i >= argc || argv[i][0] != '=' ||
+      ! file_token_is (&argv[i][1], ROCKETFUEL_NAME))
+    goto mismatch;
+  *name = &argv[i++][1];
 
-#if 1
-/* uid @loc [+] [bb] (num_neigh) [&ext] -> <nuid-1> <nuid-2> ... {-euid} ... =name[!] rn */
+  /* rn */
+  if (i >= argc || argv[i][0] != 'r' || strlen (argv[i]) != 2 ||
+      ! isdigit ((int) argv[i][1]))
+    goto mismatch;
+  *radius = argv[i++][1] - '0';
+
+  if (i != argc)
+    goto mismatch;
+
+  /* the externs follow the neighbors in argv */
   fprintf (shell->terminal,
-           "Load Node[%d]: location: %s flags: %s%s "
-           "neighbors: \"%s\"(%d) externals: \"%s\"(%d) "
-           "name: %s radius: %d\n",
+           "Load Node[%d]: location: %s flags: %s%s neighbors: \"",
            *nodeid, *location,
-           (*dnsflag ? "dns" : ""), (*bbflag ? "bb" : ""),
-           *neighbors, *nnbr,
-           (*externs ? *externs : ""), *next,
-           (*name ? *name : ""), *radius);
-#else
-  fprintf (shell->terminal, "Load Node[%d].\n", *nodeid);
-#endif /*0*/
+           (*dnsflag ? "dns" : ""), (*bbflag ? "bb" : ""));
+  for (i = 0; i < *nneighbors; i++)
+    fprintf (shell->terminal, "%s%s", (i ? " " : ""), (*neighbors)[i]);
+  fprintf (shell->terminal, "\"(%d) externals: \"", *nnbr);
+  for (i = 0; i < *nexterns; i++)
+    fprintf (shell->terminal, "%s%s", (i ? " " : ""),
+             (*neighbors)[*nneighbors + i]);
+  fprintf (shell->terminal, "\"(%d) name: %s radius: %d\n",
+           *next, *name, *radius);
 
-  free (line);
   return 0;
+
+mismatch:
+  fprintf (shell->terminal, "match failed: line %lu\n", lineno);
+  return -1;
 }
 
 int
 read_maps_file (struct shell *shell, struct graph *G, char *filename)
 {
-  FILE *fp;
-  int ret;
-  char buf[8192];
-  regex_t regex;
+  struct file_reader *reader;
+  int ret, i, argc, argmax = 0;
+  char *buf, **argv = NULL;
+  size_t len;
 
 /* uid @loc [+] [bb] (num_neigh) [&ext] -> <nuid-1> <nuid-2> ... {-euid} ... =name[!] rn */
   int nodeid, dnsflag, bbflag, nnbr, next, radius;
-  char *location, *neighbors, *externs, *name;
+  int nneighbors, nexterns;
+  char *location, **neighbors, *name;
 
   struct node *s, *t;
   struct link *link;
-  char *stringp, *neighbor;
-  char *endptr;
   int neighbor_id;
 
-  fp = fopen (filename, "r");
-  if (fp == NULL)
+  reader = file_reader_open (filename);
+  if (reader == NULL)
     {
       fprintf (shell->terminal, "no such file: %s\n", filename);
       return -1;
     }
 
-  ret = regcomp (&regex, ROCKETFUEL_MAPS_LINE, REG_EXTENDED|REG_NEWLINE);
-  if (ret != 0)
+  while ((buf = file_reader_line (reader, &len)) != NULL)
     {
-      regerror (ret, &regex, buf, sizeof (buf));
-      fprintf (shell->terminal, "regcomp failed: %s: %s\n", buf,
-               ROCKETFUEL_MAPS_LINE);
-      return -1;
-    }
-
-  while (fgets (buf, sizeof (buf), fp))
-    {
-      if (strlen (buf) == sizeof (buf) - 1)
-        fprintf (shell->terminal, "*** buffer too short *** : "
-                 "will fail match.\n");
+      argc = file_split (buf, len, &argv, &argmax);
+      if (argc < 0)
+        {
+          fprintf (shell->terminal, "match failed: line %lu\n",
+                   reader->lineno);
+          continue;
+        }
 
-      ret = scan_maps_line (shell, buf, &regex,
+      ret = scan_maps_line (shell, reader->lineno, argc, argv,
                             &nodeid, &location, &dnsflag, &bbflag,
-                            &nnbr, &next, &neighbors, &externs,
-                            &name, &radius);
+                            &nnbr, &next, &neighbors, &nneighbors,
+                            &nexterns, &name, &radius);
 
       if (ret < 0)
         continue;
@@ -248,22 +223,20 @@ read_maps_file (struct shell *shell, struct graph *G, char *filename)
 
       s = node_get (nodeid, G);
 
-      stringp = neighbors;
-      while ((neighbor = strsep (&stringp, " \t")) != NULL)
+      for (i = 0; i < nneighbors; i++)
         {
-          assert (neighbor[0] == '<');
-          neighbor_id = strtol (&neighbor[1], &endptr, 0);
-          assert (endptr[0] == '>');
+          neighbor_id = strtol (&neighbors[i][1], NULL, 10);
           t = node_get (neighbor_id, G);
 
-          link = link_get (s, t, G);
+          link = link_append (s, t, G);
           link->bandwidth = 100; /* XXX */
-          link = link_get (t, s, G);
+          link = link_append (t, s, G);
           link->bandwidth = 100; /* XXX */
         }
     }
 
-  regfree (&regex);
+  free (argv);
+  file_reader_close (reader);
   return 0;
 }
 
@@ -280,65 +253,22 @@ DEFINE_COMMAND(import_graph_rocketfuel_maps,
   command_config_add (G->config, argc, argv);
 }
 
-#define ROCKETFUEL_WEIGHTS_LINE \
-  START "([^ \t]+)" SPACE "([^ \t]+)" SPACE "([0-9.]+)" MAYSPACE END
-
+/* sname tname weight */
 int
-scan_weights_line (struct shell *shell, char *buf, regex_t *regexp,
+scan_weights_line (struct shell *shell, unsigned long lineno,
+                   int argc, char **argv,
                    char **sname, char **tname, double *weight)
 {
-  int i, ret;
   char *endptr;
-  char *line;
-  int argc;
-  char *argv[REGMATCH_MAX];
-  regmatch_t regmatch[REGMATCH_MAX];
-
-  ret = regexec (regexp, buf, REGMATCH_MAX, regmatch, 0);
-  if (ret == REG_NOMATCH)
-    {
-      fprintf (shell->terminal, "match failed: %s", buf);
-      return -1;
-    }
-  else
-    fprintf (shell->terminal, "matched: %s", buf);
-
-  line = strdup (buf);
-  argc = 0;
-
-  /* regmatch[0] is the entire strings that matched */
-  for (i = 1; i < REGMATCH_MAX; i++)
-    {
-      if (regmatch[i].rm_so == -1)
-        argv[i-1] = NULL;
-      else
-        {
-          line[regmatch[i].rm_eo] = '\0';
-          argv[i-1] = &line[regmatch[i].rm_so];
-          argc = i;
-        }
-    }
 
-#if 0
-  for (i = 0; i < argc; i++)
-    fprintf (shell->terminal, "argv[%d]: %s\n", i, argv[i]);
-#endif /*0*/
-
-  *sname = strdup (argv[0]);
-  if (*sname == NULL)
+  if (argc != 3 || ! file_token_is (argv[2], ROCKETFUEL_WEIGHT))
     {
-      fprintf (shell->terminal, "strdup for sname failed: %s\n",
-               strerror (errno));
+      fprintf (shell->terminal, "match failed: line %lu\n", lineno);
       return -1;
     }
 
-  *tname = strdup (argv[1]);
-  if (*tname == NULL)
-    {
-      fprintf (shell->terminal, "strdup for tname failed: %s\n",
-               strerror (errno));
-      return -1;
-    }
+  *sname = argv[0];
+  *tname = argv[1];
 
   *weight = strtod (argv[2], &endptr);
   if (*endptr != '\0')
@@ -353,17 +283,16 @@ scan_weights_line (struct shell *shell, char *buf, regex_t *regexp,
            *sname, *tname, *weight);
 #endif /*0*/
 
-  free (line);
   return 0;
 }
 
 int
 read_weights_file_graph (struct shell *shell, struct graph *G, char *filename)
 {
-  FILE *fp;
-  int ret;
-  char buf[8192];
-  regex_t regex;
+  struct file_reader *reader;
+  int ret, argc, argmax = 0;
+  char *buf, **argv = NULL;
+  size_t len;
 
   char *sname, *tname;
   double weight;
@@ -373,31 +302,19 @@ read_weights_file_graph (struct shell *shell, struct graph *G, char *filename)
   struct table *node_table;
   int index = 0;
 
-  fp = fopen (filename, "r");
-  if (fp == NULL)
+  reader = file_reader_open (filename);
+  if (reader == NULL)
     {
       fprintf (shell->terminal, "no such file: %s\n", filename);
       return -1;
     }
 
-  ret = regcomp (&regex, ROCKETFUEL_WEIGHTS_LINE, REG_EXTENDED|REG_NEWLINE);
-  if (ret != 0)
-    {
-      regerror (ret, &regex, buf, sizeof (buf));
-      fprintf (shell->terminal, "regcomp failed: %s: %s\n", buf,
-               ROCKETFUEL_WEIGHTS_LINE);
-      return -1;
-    }
-
   node_table = table_create ();
 
-  while (fgets (buf, sizeof (buf), fp))
+  while ((buf = file_reader_line (reader, &len)) != NULL)
     {
-      if (strlen (buf) == sizeof (buf) - 1)
-        fprintf (shell->terminal, "*** buffer too short *** : "
-                 "will fail match.\n");
-
-      ret = scan_weights_line (shell, buf, &regex,
+      argc = file_split (buf, len, &argv, &argmax);
+      ret = scan_weights_line (shell, reader->lineno, argc, argv,
                                &sname, &tname, &weight);
 
       if (ret < 0)
@@ -407,8 +324,8 @@ read_weights_file_graph (struct shell *shell, struct graph *G, char *filename)
       if (! s)
         {
           s = node_get (index, G);
-          table_add (sname, strlen (sname) * 8, s, node_table);
-          s->name = strdup (sname);
+          node_set_name (s, sname);
+          table_add (s->name, strlen (s->name) * 8, s, node_table);
           fprintf (shell->terminal, "%d: %s\n", index, s->name);
           index++;
         }
@@ -417,18 +334,19 @@ read_weights_file_graph (struct shell *shell, struct graph *G, char *filename)
       if (! t)
         {
           t = node_get (index, G);
-          table_add (tname, strlen (tname) * 8, t, node_table);
-          t->name = strdup (tname);
+          node_set_name (t, tname);
+          table_add (t->name, strlen (t->name) * 8, t, node_table);
           fprintf (shell->terminal, "%d: %s\n", index, t->name);
           index++;
         }
 
-      link_set (s, t, G);
+      link_append (s, t, G);
     }
 
   table_delete (node_table);
 
-  regfree (&regex);
+  free (argv);
+  file_reader_close (reader);
   return 0;
 }
 
@@ -449,10 +367,10 @@ int
 read_weights_file_weight (struct shell *shell, struct weight *W, char *filename)
 {
   struct graph *G = W->G;
-  FILE *fp;
-  int ret;
-  char buf[8192];
-  regex_t regex;
+  struct file_reader *reader;
+  int ret, argc, argmax = 0;
+  char *buf, **argv = NULL;
+  size_t len;
 
   char *sname, *tname;
   double weight;
@@ -463,47 +381,35 @@ read_weights_file_weight (struct shell *shell, struct weight *W, char *filename)
   struct table *node_table;
   int index = 0;
 
-  fp = fopen (filename, "r");
-  if (fp == NULL)
+  reader = file_reader_open (filename);
+  if (reader == NULL)
     {
       fprintf (shell->terminal, "no such file: %s\n", filename);
       return -1;
     }
 
-  ret = regcomp (&regex, ROCKETFUEL_WEIGHTS_LINE, REG_EXTENDED|REG_NEWLINE);
-  if (ret != 0)
-    {
-      regerror (ret, &regex, buf, sizeof (buf));
-      fprintf (shell->terminal, "regcomp failed: %s: %s\n", buf,
-               ROCKETFUEL_WEIGHTS_LINE);
-      return -1;
-    }
-
   node_table = table_create ();
+  ret = 0;
 
-  while (fgets (buf, sizeof (buf), fp))
+  while ((buf = file_reader_line (reader, &len)) != NULL)
     {
-      if (strlen (buf) == sizeof (buf) - 1)
-        fprintf (shell->terminal, "*** buffer too short *** : "
-                 "will fail match.\n");
-
-      ret = scan_weights_line (shell, buf, &regex,
-                               &sname, &tname, &weight);
-
-      if (ret < 0)
+      argc = file_split (buf, len, &argv, &argmax);
+      if (scan_weights_line (shell, reader->lineno, argc, argv,
+                             &sname, &tname, &weight) < 0)
         continue;
 
       s = table_lookup (sname, strlen (sname) * 8, node_table);
       if (! s)
         {
           s = node_lookup (index, G);
-          if (! s || strcmp (s->name, sname))
+          if (! s || ! s->name || strcmp (s->name, sname))
             {
               fprintf (shell->terminal, "graph mismatch: s: %s %s\n",
-                       (s ? s->name : "NULL"), sname);
-              return -1;
+                       (s && s->name ? s->name : "NULL"), sname);
+              ret = -1;
+              break;
             }
-          table_add (sname, strlen (sname) * 8, s, node_table);
+          table_add (s->name, strlen (s->name) * 8, s, node_table);
           fprintf (shell->terminal, "%d: %s\n", index, s->name);
           index++;
         }
@@ -512,13 +418,14 @@ read_weights_file_weight (struct shell *shell, struct weight *W, char *filename)
       if (! t)
         {
           t = node_lookup (index, G);
-          if (! s || strcmp (t->name, tname))
+          if (! t || ! t->name || strcmp (t->name, tname))
             {
               fprintf (shell->terminal, "graph mismatch: t: %s %s\n",
-                       (t ? t->name : "NULL"), tname);
-              return -1;
+                       (t && t->name ? t->name : "NULL"), tname);
+              ret = -1;
+              break;
             }
-          table_add (tname, strlen (tname) * 8, t, node_table);
+          table_add (t->name, strlen (t->name) * 8, t, node_table);
           fprintf (shell->terminal, "%d: %s\n", index, t->name);
           index++;
         }
@@ -528,22 +435,26 @@ read_weights_file_weight (struct shell *shell, struct weight *W, char *filename)
         {
           fprintf (shell->terminal, "graph mismatch: link not found: %s-%s\n",
                    s->name, t->name);
-          return -1;
+          ret = -1;
+          break;
         }
 
       if (link->id >= W->nedges)
         {
           fprintf (shell->terminal, "graph mismatch: link number mismatch\n");
-          return -1;
+          ret = -1;
+          break;
         }
 
       W->weight[link->id] = (weight_t) (weight * 100);
     }
+  weight_modified (W);
 
   table_delete (node_table);
 
-  regfree (&regex);
-  return 0;
+  free (argv);
+  file_reader_close (reader);
+  return ret;
 }
 
 DEFINE_COMMAND (weight_setting_import_rocketfuel,
@@ -571,4 +482,125 @@ DEFINE_COMMAND (import_weight_rocketfuel_weights,
   command_config_add (W->config, argc, argv);
 }
 
+/* synthetic RocketFuel files: each new router attaches to
+   ROCKETFUEL_BENCHMARK_DEGREE random earlier routers. */
+#define ROCKETFUEL_BENCHMARK_DEGREE 2
+
+static int
+rocketfuel_benchmark_write (char *filename, unsigned long nnodes, int maps)
+{
+  FILE *fp;
+  unsigned long i, j = 0, k, degree;
+  unsigned long nbr[ROCKETFUEL_BENCHMARK_DEGREE];
+  double weight;
+
+  fp = fopen (filename, "w");
+  if (fp == NULL)
+    return -1;
+
+  srandom (0);
+  for (i = 0; i < nnodes; i++)
+    {
+      degree = (i < ROCKETFUEL_BENCHMARK_DEGREE ?
+                i : ROCKETFUEL_BENCHMARK_DEGREE);
+      for (k = 0; k < degree; k++)
+        {
+          j = (k == 0 ? random () % i : (j + 1 + random () % (i - 1)) % i);
+          nbr[k] = j;
+        }
+
+      if (maps)
+        {
+          fprintf (fp, "%lu @City%lu,+ST  \t(%lu) ->", i, i % 100, degree);
+          for (k = 0; k < degree; k++)
+            fprintf (fp, " <%lu>", nbr[k]);
+          fprintf (fp, " \t=r%lu.city%lu.example.net r0\n", i, i % 100);
+          continue;
+        }
+
+      for (k = 0; k < degree; k++)
+        {
+          weight = (random () % 20 + 1) / 2.0;
+          fprintf (fp, "City%lu,+ST%lu City%lu,+ST%lu %g\n",
+                   i % 100, i, nbr[k] % 100, nbr[k], weight);
+          fprintf (fp, "City%lu,+ST%lu City%lu,+ST%lu %g\n",
+                   nbr[k] % 100, nbr[k], i % 100, i, weight);
+        }
+    }
+
+  fclose (fp);
+  return 0;
+}
+
+static void
+rocketfuel_benchmark (struct shell *shell, unsigned long nnodes,
+                      char *filename, int maps)
+{
+  struct graph *G;
+  FILE *terminal;
+  struct stat statbuf;
+  timer_counter_t start, end, res;
+  unsigned long long usec;
+  int ret;
+
+  if (rocketfuel_benchmark_write (filename, nnodes, maps) < 0)
+    {
+      fprintf (shell->terminal, "cannot write %s: %s\n",
+               filename, strerror (errno));
+      return;
+    }
+  stat (filename, &statbuf);
+
+  /* import to a scratch graph, without the per-line messages */
+  G = graph_create ();
+  terminal = shell->terminal;
+  shell->terminal = fopen ("/dev/null", "w");
+
+  timer_count (start);
+  if (maps)
+    ret = read_maps_file (shell, G, filename);
+  else
+    ret = read_weights_file_graph (shell, G, filename);
+  timer_count (end);
+  timer_sub (start, end, res);
+  usec = timer_to_usec (res);
+
+  fclose (shell->terminal);
+  shell->terminal = terminal;
+
+  fprintf (shell->terminal, "Benchmark: RocketFuel %s import%s: "
+           "%d nodes %d links, %lld bytes\n", (maps ? "maps" : "weights"),
+           (ret < 0 ? " (failed)" : ""), graph_nodes (G), graph_edges (G),
+           (long long) statbuf.st_size);
+  fprintf (shell->terminal, "  %llu us, %.2f MB/s\n", usec,
+           (usec ? (double) statbuf.st_size / usec : 0.0));
+
+  graph_delete (G);
+}
+
+DEFINE_COMMAND (benchmark_import_rocketfuel_maps,
+                "benchmark import rocketfuel maps <1-10000000> <FILENAME>",
+                "benchmark command\n"
+                "benchmark the import from other data\n"
+                "benchmark the import from RocketFuel\n"
+                "benchmark the import from RocketFuel maps file\n"
+                "specify number of nodes\n"
+                "specify the synthetic RocketFuel filename to write\n")
+{
+  struct shell *shell = (struct shell *) context;
+  rocketfuel_benchmark (shell, strtoul (argv[4], NULL, 0), argv[5], 1);
+}
+
+DEFINE_COMMAND (benchmark_import_rocketfuel_weights,
+                "benchmark import rocketfuel weights <1-10000000> <FILENAME>",
+                "benchmark command\n"
+                "benchmark the import from other data\n"
+                "benchmark the import from RocketFuel\n"
+                "benchmark the import from RocketFuel weights file\n"
+                "specify number of nodes\n"
+                "specify the synthetic RocketFuel filename to write\n")
+{
+  struct shell *shell = (struct shell *) context;
+  rocketfuel_benchmark (shell, strtoul (argv[4], NULL, 0), argv[5], 0);
+}
 
@@ -23,10 +23,19 @@
 
 #include "command.h"
 
+struct shell;
+struct graph;
+
+int read_maps_file (struct shell *shell, struct graph *G, char *filename);
+int read_weights_file_graph (struct shell *shell, struct graph *G,
+                             char *filename);
+
 EXTERN_COMMAND (import_graph_rocketfuel_maps);
 EXTERN_COMMAND (import_graph_rocketfuel_weights);
 EXTERN_COMMAND (weight_setting_import_rocketfuel);
 EXTERN_COMMAND (import_weight_rocketfuel_weights);
+EXTERN_COMMAND (benchmark_import_rocketfuel_maps);
+EXTERN_COMMAND (benchmark_import_rocketfuel_weights);
 
 #endif /*_ROCKETFUEL_H_*/
 
@@ -0,0 +1,1117 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "includes.h"
+
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "command_shell.h"
+#include "module.h"
+
+#include "network/graph.h"
+#include "network/weight.h"
+#include "network/path.h"
+#include "network/routing.h"
+#include "traffic-model/demand.h"
+
+#include "interface/snapshot.h"
+
+#define SNAPSHOT_ALIGN(x) (((x) + 7) & ~((u_int64_t) 7))
+
+/* FNV-1a, on 64-bit words */
+#define SNAPSHOT_FNV_BASIS 0xcbf29ce484222325ULL
+#define SNAPSHOT_FNV_PRIME 0x100000001b3ULL
+
+/* a mapped image, kept until the end of the program since the
+   instances loaded from it use its arrays in place. */
+struct snapshot_image
+{
+  char *file;
+  char *addr;
+  size_t size;
+};
+
+struct vector *snapshot_images;
+
+static u_int64_t
+snapshot_checksum (u_int64_t h, const void *data, size_t size)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  u_int64_t word;
+
+  for (; size >= sizeof (word); p += sizeof (word), size -= sizeof (word))
+    {
+      memcpy (&word, p, sizeof (word));
+      h = (h ^ word) * SNAPSHOT_FNV_PRIME;
+    }
+
+  /* the tail is zero padded, as in the file */
+  if (size)
+    {
+      word = 0;
+      memcpy (&word, p, size);
+      h = (h ^ word) * SNAPSHOT_FNV_PRIME;
+    }
+  return h;
+}
+
+/* writer */
+
+struct snapshot_writer
+{
+  FILE *fp;
+  u_int64_t offset;
+  u_int64_t checksum;
+  int error;
+};
+
+/* write the data, zero padded to the 8-byte boundary */
+static void
+snapshot_write (struct snapshot_writer *w, const void *data, size_t size)
+{
+  static const char zero[8];
+  size_t pad = SNAPSHOT_ALIGN (size) - size;
+
+  w->checksum = snapshot_checksum (w->checksum, data, size);
+  if (size && fwrite (data, 1, size, w->fp) != size)
+    w->error++;
+  if (pad && fwrite (zero, 1, pad, w->fp) != pad)
+    w->error++;
+  w->offset += size + pad;
+}
+
+/* reserve the space for an array, returning its offset */
+static u_int64_t
+snapshot_layout (u_int64_t *cursor, size_t size)
+{
+  u_int64_t offset = *cursor;
+  *cursor += SNAPSHOT_ALIGN (size);
+  return offset;
+}
+
+/* string table, placed at the end of the section */
+struct snapshot_strings
+{
+  u_int64_t base;
+  char *buf;
+  size_t size;
+  size_t limit;
+};
+
+static void
+snapshot_strings_init (struct snapshot_strings *st, u_int64_t base)
+{
+  memset (st, 0, sizeof (struct snapshot_strings));
+  st->base = base;
+}
+
+static u_int64_t
+snapshot_string (struct snapshot_strings *st, const char *s)
+{
+  u_int64_t offset;
+  size_t len;
+
+  if (s == NULL)
+    return 0;
+
+  len = strlen (s) + 1;
+  if (st->size + len > st->limit)
+    {
+      while (st->size + len > st->limit)
+        st->limit = (st->limit ? st->limit * 2 : 1024);
+      st->buf = (char *) realloc (st->buf, st->limit);
+    }
+  memcpy (st->buf + st->size, s, len);
+  offset = st->base + st->size;
+  st->size += len;
+  return offset;
+}
+
+static u_int64_t *
+snapshot_config (struct snapshot_strings *st, struct vector *config)
+{
+  u_int64_t *lines;
+  unsigned int i;
+
+  lines = (u_int64_t *) calloc (config->size + 1, sizeof (u_int64_t));
+  for (i = 0; i < config->size; i++)
+    lines[i] = snapshot_string (st, (char *) vector_get (config, i));
+  return lines;
+}
+
+static void
+snapshot_section_init (struct snapshot_section *section, u_int32_t type,
+                       struct vector *config, u_int64_t *cursor)
+{
+  section->type = type;
+  section->nconfig = config->size;
+  section->config =
+    snapshot_layout (cursor, config->size * sizeof (u_int64_t));
+}
+
+static void
+snapshot_save_graph (struct snapshot_writer *w, struct graph *G)
+{
+  struct snapshot_graph hdr;
+  struct snapshot_strings st;
+  struct snapshot_node *nodes;
+  struct snapshot_link *links;
+  struct graph_csr *csr;
+  struct node *node;
+  struct link *link;
+  u_int64_t *config, cursor;
+  unsigned int i;
+
+  csr = graph_freeze (G);
+
+  memset (&hdr, 0, sizeof (hdr));
+  hdr.nnodes = G->nodes->size;
+  hdr.nlinks = G->links->size;
+  hdr.nadjacency = csr->nlinks;
+
+  cursor = w->offset;
+  snapshot_layout (&cursor, sizeof (hdr));
+  snapshot_section_init (&hdr.section, SNAPSHOT_GRAPH, G->config, &cursor);
+  hdr.node = snapshot_layout (&cursor,
+                              hdr.nnodes * sizeof (struct snapshot_node));
+  hdr.link = snapshot_layout (&cursor,
+                              hdr.nlinks * sizeof (struct snapshot_link));
+  hdr.ooffset = snapshot_layout (&cursor,
+                                 (hdr.nnodes + 1) * sizeof (u_int32_t));
+  hdr.olink = snapshot_layout (&cursor,
+                               hdr.nadjacency * sizeof (u_int32_t));
+  hdr.ioffset = snapshot_layout (&cursor,
+                                 (hdr.nnodes + 1) * sizeof (u_int32_t));
+  hdr.ilink = snapshot_layout (&cursor,
+                               hdr.nadjacency * sizeof (u_int32_t));
+
+  snapshot_strings_init (&st, cursor);
+  hdr.section.name = snapshot_string (&st, G->name);
+  config = snapshot_config (&st, G->config);
+
+  nodes = (struct snapshot_node *)
+    calloc (hdr.nnodes + 1, sizeof (struct snapshot_node));
+  for (i = 0; i < hdr.nnodes; i++)
+    {
+      node = (struct node *) vector_get (G->nodes, i);
+      if (! node)
+        continue;
+      nodes[i].exist = 1;
+      nodes[i].addr = node->addr.s_addr;
+      nodes[i].plen = node->plen;
+      nodes[i].type = node->type;
+      nodes[i].name = snapshot_string (&st, node->name);
+      nodes[i].domain_name = snapshot_string (&st, node->domain_name);
+      nodes[i].descr = snapshot_string (&st, node->descr);
+      nodes[i].xpos = node->xpos;
+      nodes[i].ypos = node->ypos;
+    }
+
+  links = (struct snapshot_link *)
+    calloc (hdr.nlinks + 1, sizeof (struct snapshot_link));
+  for (i = 0; i < hdr.nlinks; i++)
+    {
+      link = (struct link *) vector_get (G->links, i);
+      if (! link)
+        continue;
+      links[i].exist = 1;
+      links[i].from = (link->from ? link->from->id : SNAPSHOT_NONE);
+      links[i].to = (link->to ? link->to->id : SNAPSHOT_NONE);
+      links[i].inverse = (link->inverse ? link->inverse->id : SNAPSHOT_NONE);
+      links[i].name = snapshot_string (&st, link->name);
+      links[i].descr = snapshot_string (&st, link->descr);
+      links[i].weight = link->weight;
+      links[i].bandwidth = link->bandwidth;
+      links[i].delay = link->delay;
+      links[i].length = link->length;
+      links[i].reliability = link->reliability;
+      links[i].probability = link->probability;
+    }
+
+  hdr.section.size = cursor + SNAPSHOT_ALIGN (st.size) - w->offset;
+
+  snapshot_write (w, &hdr, sizeof (hdr));
+  snapshot_write (w, config, hdr.section.nconfig * sizeof (u_int64_t));
+  snapshot_write (w, nodes, hdr.nnodes * sizeof (struct snapshot_node));
+  snapshot_write (w, links, hdr.nlinks * sizeof (struct snapshot_link));
+  snapshot_write (w, csr->ooffset, (hdr.nnodes + 1) * sizeof (u_int32_t));
+  snapshot_write (w, csr->olink, hdr.nadjacency * sizeof (u_int32_t));
+  snapshot_write (w, csr->ioffset, (hdr.nnodes + 1) * sizeof (u_int32_t));
+  snapshot_write (w, csr->ilink, hdr.nadjacency * sizeof (u_int32_t));
+  snapshot_write (w, st.buf, st.size);
+
+  free (config);
+  free (nodes);
+  free (links);
+  free (st.buf);
+}
+
+static void
+snapshot_save_weight (struct snapshot_writer *w, struct weight *W)
+{
+  struct snapshot_weight hdr;
+  struct snapshot_strings st;
+  u_int64_t *config, cursor;
+
+  memset (&hdr, 0, sizeof (hdr));
+  hdr.nedges = (W->weight ? W->nedges : 0);
+
+  cursor = w->offset;
+  snapshot_layout (&cursor, sizeof (hdr));
+  snapshot_section_init (&hdr.section, SNAPSHOT_WEIGHT, W->config, &cursor);
+  hdr.weight = snapshot_layout (&cursor, hdr.nedges * sizeof (weight_t));
+
+  snapshot_strings_init (&st, cursor);
+  hdr.section.name = snapshot_string (&st, W->name);
+  hdr.graph = snapshot_string (&st, W->G ? W->G->name : NULL);
+  config = snapshot_config (&st, W->config);
+
+  hdr.section.size = cursor + SNAPSHOT_ALIGN (st.size) - w->offset;
+
+  snapshot_write (w, &hdr, sizeof (hdr));
+  snapshot_write (w, config, hdr.section.nconfig * sizeof (u_int64_t));
+  snapshot_write (w, W->weight, hdr.nedges * sizeof (weight_t));
+  snapshot_write (w, st.buf, st.size);
+
+  free (config);
+  free (st.buf);
+}
+
+static void
+snapshot_save_traffic (struct snapshot_writer *w, struct traffic *T)
+{
+  struct snapshot_traffic hdr;
+  struct snapshot_strings st;
+  u_int64_t *config, cursor;
+  unsigned int i;
+
+  memset (&hdr, 0, sizeof (hdr));
+  hdr.nnodes = (T->demands ? T->demands->nnodes : 0);
+  hdr.seed = T->seed;
+  hdr.total = (T->demands ? T->demands->total : 0.0);
+
+  cursor = w->offset;
+  snapshot_layout (&cursor, sizeof (hdr));
+  snapshot_section_init (&hdr.section, SNAPSHOT_TRAFFIC, T->config, &cursor);
+  hdr.traffic = snapshot_layout (&cursor, (size_t) hdr.nnodes * hdr.nnodes *
+                                 sizeof (demand_t));
+
+  snapshot_strings_init (&st, cursor);
+  hdr.section.name = snapshot_string (&st, T->name);
+  hdr.graph = snapshot_string (&st, T->G ? T->G->name : NULL);
+  config = snapshot_config (&st, T->config);
+
+  hdr.section.size = cursor + SNAPSHOT_ALIGN (st.size) - w->offset;
+
+  snapshot_write (w, &hdr, sizeof (hdr));
+  snapshot_write (w, config, hdr.section.nconfig * sizeof (u_int64_t));
+  for (i = 0; i < hdr.nnodes; i++)
+    snapshot_write (w, T->demands->traffic[i],
+                    hdr.nnodes * sizeof (demand_t));
+  snapshot_write (w, st.buf, st.size);
+
+  free (config);
+  free (st.buf);
+}
+
+static void
+snapshot_save_routing (struct snapshot_writer *w, struct routing *R)
+{
+  struct snapshot_routing hdr;
+  struct snapshot_strings st;
+  struct route_flat *flat = NULL;
+  u_int64_t *config, cursor;
+  size_t noffset = 0;
+
+  memset (&hdr, 0, sizeof (hdr));
+  hdr.spf_queue = R->spf_queue;
+  if (R->route || R->flat)
+    {
+      flat = route_freeze (R);
+      hdr.nnodes = R->nnodes;
+      noffset = (size_t) hdr.nnodes * hdr.nnodes + 1;
+      hdr.nroutes = flat->offset[noffset - 1];
+    }
+
+  cursor = w->offset;
+  snapshot_layout (&cursor, sizeof (hdr));
+  snapshot_section_init (&hdr.section, SNAPSHOT_ROUTING, R->config, &cursor);
+  hdr.offset = snapshot_layout (&cursor, noffset * sizeof (u_int32_t));
+  hdr.nexthop = snapshot_layout (&cursor, hdr.nroutes * sizeof (u_int32_t));
+  hdr.ratio = snapshot_layout (&cursor, hdr.nroutes * sizeof (double));
+
+  snapshot_strings_init (&st, cursor);
+  hdr.section.name = snapshot_string (&st, R->name);
+  hdr.graph = snapshot_string (&st, R->G ? R->G->name : NULL);
+  hdr.weight = snapshot_string (&st, R->W ? R->W->name : NULL);
+  config = snapshot_config (&st, R->config);
+
+  hdr.section.size = cursor + SNAPSHOT_ALIGN (st.size) - w->offset;
+
+  snapshot_write (w, &hdr, sizeof (hdr));
+  snapshot_write (w, config, hdr.section.nconfig * sizeof (u_int64_t));
+  if (flat)
+    {
+      snapshot_write (w, flat->offset, noffset * sizeof (u_int32_t));
+      snapshot_write (w, flat->nexthop, hdr.nroutes * sizeof (u_int32_t));
+      snapshot_write (w, flat->ratio, hdr.nroutes * sizeof (double));
+    }
+  snapshot_write (w, st.buf, st.size);
+
+  free (config);
+  free (st.buf);
+}
+
+static struct vector *
+snapshot_instances (char *name)
+{
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  struct module *m;
+
+  for (vn = vector_cursor_head (modules, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      m = (struct module *) vn->data;
+      if (! strcmp (m->name, name))
+        return *m->instances;
+    }
+  return NULL;
+}
+
+DEFINE_COMMAND (save_snapshot,
+                "save snapshot <FILENAME>",
+                "save information\n"
+                "save the instances in a binary image\n"
+                "specify filename\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct snapshot_writer writer;
+  struct snapshot_header header;
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  char *names[] = { "graph", "weight", "traffic", "routing", NULL };
+  struct vector *instances;
+  void *instance;
+  int i;
+
+  memset (&writer, 0, sizeof (writer));
+  writer.fp = fopen (argv[2], "w");
+  if (writer.fp == NULL)
+    {
+      fprintf (shell->terminal, "cannot open file: %s\n", argv[2]);
+      fprintf (shell->terminal, "fopen (): %s\n", strerror (errno));
+      return;
+    }
+
+  /* the header is rewritten with the checksum at the end */
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, SNAPSHOT_MAGIC, sizeof (header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.wordsize = sizeof (long);
+  snapshot_write (&writer, &header, sizeof (header));
+  writer.checksum = SNAPSHOT_FNV_BASIS;
+
+  /* in the order of the references */
+  for (i = 0; names[i]; i++)
+    {
+      instances = snapshot_instances (names[i]);
+      for (vn = vector_cursor_head (instances, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
+        {
+          instance = vn->data;
+          if (! instance)
+            continue;
+          if (i == 0)
+            snapshot_save_graph (&writer, (struct graph *) instance);
+          else if (i == 1)
+            snapshot_save_weight (&writer, (struct weight *) instance);
+          else if (i == 2)
+            snapshot_save_traffic (&writer, (struct traffic *) instance);
+          else
+            snapshot_save_routing (&writer, (struct routing *) instance);
+          header.nsections++;
+        }
+    }
+
+  header.size = writer.offset;
+  header.checksum = writer.checksum;
+  if (fseek (writer.fp, 0, SEEK_SET) < 0 ||
+      fwrite (&header, 1, sizeof (header), writer.fp) != sizeof (header))
+    writer.error++;
+  if (fclose (writer.fp) != 0)
+    writer.error++;
+
+  if (writer.error)
+    fprintf (shell->terminal, "write error: %s: %s\n",
+             argv[2], strerror (errno));
+}
+
+/* reader */
+
+/* the pointer to the array of size at offset, or NULL if it is
+   outside of the image or misaligned. */
+static void *
+snapshot_array (struct snapshot_image *image, u_int64_t offset,
+                u_int64_t size)
+{
+  if (offset % 8 || offset > image->size || size > image->size - offset)
+    return NULL;
+  return image->addr + offset;
+}
+
+/* the string at offset; *error is set if it is not a valid one */
+static char *
+snapshot_string_get (struct snapshot_image *image, u_int64_t offset,
+                     int *error)
+{
+  if (offset == 0)
+    return NULL;
+  if (offset >= image->size ||
+      ! memchr (image->addr + offset, '\0', image->size - offset))
+    {
+      (*error)++;
+      return NULL;
+    }
+  return image->addr + offset;
+}
+
+/* the section of the type and the name in the image before end,
+   or NULL if none */
+static struct snapshot_section *
+snapshot_section_lookup (struct snapshot_image *image, u_int32_t type,
+                         char *name, u_int64_t end)
+{
+  struct snapshot_section *section;
+  u_int64_t offset;
+  char *p;
+  int error = 0;
+
+  for (offset = sizeof (struct snapshot_header); offset < end;
+       offset += section->size)
+    {
+      section = (struct snapshot_section *) (image->addr + offset);
+      p = snapshot_string_get (image, section->name, &error);
+      if (section->type == type && p && ! strcmp (p, name))
+        return section;
+    }
+  return NULL;
+}
+
+/* whether the name refers to a graph (or weight) that already exists
+   or is in a previous section of the image */
+static int
+snapshot_reference (struct snapshot_image *image, char *module,
+                    u_int32_t type, char *name, u_int64_t end)
+{
+  if (name == NULL || instance_lookup (module, name))
+    return 1;
+  return (snapshot_section_lookup (image, type, name, end) != NULL);
+}
+
+/* the number of the nodes and of the links of the graph that already
+   exists or is in a previous section of the image, as routing-graph
+   and weight-graph count them.  returns -1 if there is no such graph. */
+static int
+snapshot_graph_size (struct snapshot_image *image, char *name,
+                     u_int64_t end, u_int64_t *nnodes, u_int64_t *nedges)
+{
+  struct snapshot_graph *g;
+  struct snapshot_link *links;
+  struct graph *G;
+  u_int64_t i;
+
+  G = (struct graph *) instance_lookup ("graph", name);
+  if (G)
+    {
+      *nnodes = G->nodes->size;
+      *nedges = graph_edges (G);
+      return 0;
+    }
+
+  g = (struct snapshot_graph *)
+    snapshot_section_lookup (image, SNAPSHOT_GRAPH, name, end);
+  if (g == NULL)
+    return -1;
+  links = (struct snapshot_link *) (image->addr + g->link);
+  *nnodes = g->nnodes;
+  *nedges = 0;
+  for (i = 0; i < g->nlinks; i++)
+    if (links[i].exist)
+      (*nedges)++;
+  return 0;
+}
+
+static int
+snapshot_check_offsets (u_int32_t *offset, u_int64_t n, u_int64_t max)
+{
+  u_int64_t i;
+  for (i = 0; i < n; i++)
+    if (offset[i] > offset[i + 1])
+      return 0;
+  return (offset[0] == 0 && offset[n] <= max);
+}
+
+/* check a section before anything is created */
+static int
+snapshot_check (struct snapshot_image *image, u_int64_t offset, FILE *fp)
+{
+  struct snapshot_section *section;
+  struct snapshot_graph *g;
+  struct snapshot_weight *w = NULL;
+  struct snapshot_traffic *t;
+  struct snapshot_routing *r = NULL;
+  struct snapshot_node *nodes;
+  struct snapshot_link *links;
+  u_int64_t *config;
+  u_int32_t *ooffset, *olink, *ioffset, *ilink, *nexthop;
+  char *name, *module, *graph = NULL, *weight = NULL;
+  size_t hdrsize;
+  u_int64_t i, nnodes, nedges;
+  int error = 0;
+
+  section = (struct snapshot_section *)
+    snapshot_array (image, offset, sizeof (struct snapshot_section));
+  if (! section || ! snapshot_array (image, offset, section->size) ||
+      section->size < sizeof (struct snapshot_section))
+    return -1;
+
+  switch (section->type)
+    {
+    case SNAPSHOT_GRAPH:
+      module = "graph";
+      hdrsize = sizeof (struct snapshot_graph);
+      break;
+    case SNAPSHOT_WEIGHT:
+      module = "weight";
+      hdrsize = sizeof (struct snapshot_weight);
+      break;
+    case SNAPSHOT_TRAFFIC:
+      module = "traffic";
+      hdrsize = sizeof (struct snapshot_traffic);
+      break;
+    case SNAPSHOT_ROUTING:
+      module = "routing";
+      hdrsize = sizeof (struct snapshot_routing);
+      break;
+    default:
+      return -1;
+    }
+  if (section->size < hdrsize)
+    return -1;
+
+  name = snapshot_string_get (image, section->name, &error);
+  config = (u_int64_t *) snapshot_array (image, section->config,
+                                         section->nconfig * sizeof (u_int64_t));
+  if (error || ! name || ! config)
+    return -1;
+  for (i = 0; i < section->nconfig; i++)
+    snapshot_string_get (image, config[i], &error);
+  if (error)
+    return -1;
+
+  if (instance_lookup (module, name))
+    {
+      fprintf (fp, "%s %s already exists.\n", module, name);
+      return -1;
+    }
+  if (snapshot_section_lookup (image, section->type, name, offset))
+    {
+      fprintf (fp, "%s %s appears twice in the snapshot.\n", module, name);
+      return -1;
+    }
+
+  switch (section->type)
+    {
+    case SNAPSHOT_GRAPH:
+      g = (struct snapshot_graph *) section;
+      nodes = snapshot_array (image, g->node, (u_int64_t) g->nnodes *
+                              sizeof (struct snapshot_node));
+      links = snapshot_array (image, g->link, (u_int64_t) g->nlinks *
+                              sizeof (struct snapshot_link));
+      ooffset = snapshot_array (image, g->ooffset, ((u_int64_t) g->nnodes + 1) *
+                                sizeof (u_int32_t));
+      olink = snapshot_array (image, g->olink, (u_int64_t) g->nadjacency *
+                              sizeof (u_int32_t));
+      ioffset = snapshot_array (image, g->ioffset, ((u_int64_t) g->nnodes + 1) *
+                                sizeof (u_int32_t));
+      ilink = snapshot_array (image, g->ilink, (u_int64_t) g->nadjacency *
+                              sizeof (u_int32_t));
+      if (! nodes || ! links || ! ooffset || ! olink || ! ioffset || ! ilink)
+        return -1;
+      if (! snapshot_check_offsets (ooffset, g->nnodes, g->nadjacency) ||
+          ! snapshot_check_offsets (ioffset, g->nnodes, g->nadjacency))
+        return -1;
+      for (i = 0; i < g->nnodes; i++)
+        {
+          snapshot_string_get (image, nodes[i].name, &error);
+          snapshot_string_get (image, nodes[i].domain_name, &error);
+          snapshot_string_get (image, nodes[i].descr, &error);
+        }
+      for (i = 0; i < g->nlinks; i++)
+        {
+          if (! links[i].exist)
+            continue;
+          if ((links[i].from != SNAPSHOT_NONE &&
+               (links[i].from >= g->nnodes || ! nodes[links[i].from].exist)) ||
+              (links[i].to != SNAPSHOT_NONE &&
+               (links[i].to >= g->nnodes || ! nodes[links[i].to].exist)) ||
+              (links[i].inverse != SNAPSHOT_NONE &&
+               links[i].inverse >= g->nlinks))
+            error++;
+          snapshot_string_get (image, links[i].name, &error);
+          snapshot_string_get (image, links[i].descr, &error);
+        }
+      for (i = 0; i < g->nadjacency; i++)
+        if (olink[i] >= g->nlinks || ! links[olink[i]].exist ||
+            ilink[i] >= g->nlinks || ! links[ilink[i]].exist)
+          error++;
+      break;
+
+    case SNAPSHOT_WEIGHT:
+      w = (struct snapshot_weight *) section;
+      graph = snapshot_string_get (image, w->graph, &error);
+      if (! snapshot_array (image, w->weight,
+                            (u_int64_t) w->nedges * sizeof (weight_t)))
+        error++;
+      break;
+
+    case SNAPSHOT_TRAFFIC:
+      t = (struct snapshot_traffic *) section;
+      graph = snapshot_string_get (image, t->graph, &error);
+      if (! snapshot_array (image, t->traffic, (u_int64_t) t->nnodes *
+                            t->nnodes * sizeof (demand_t)))
+        error++;
+      break;
+
+    case SNAPSHOT_ROUTING:
+      r = (struct snapshot_routing *) section;
+      graph = snapshot_string_get (image, r->graph, &error);
+      weight = snapshot_string_get (image, r->weight, &error);
+      if (r->nnodes == 0)
+        break;
+      ooffset = snapshot_array (image, r->offset, ((u_int64_t) r->nnodes *
+                                r->nnodes + 1) * sizeof (u_int32_t));
+      nexthop = snapshot_array (image, r->nexthop,
+                                r->nroutes * sizeof (u_int32_t));
+      if (! ooffset || ! nexthop || ! graph ||
+          ! snapshot_array (image, r->ratio, r->nroutes * sizeof (double)) ||
+          ! snapshot_check_offsets (ooffset, (u_int64_t) r->nnodes *
+                                    r->nnodes, r->nroutes))
+        return -1;
+      for (i = 0; i < r->nroutes; i++)
+        if (nexthop[i] >= r->nnodes)
+          error++;
+      break;
+    }
+  if (error)
+    return -1;
+
+  if (! snapshot_reference (image, "graph", SNAPSHOT_GRAPH, graph, offset))
+    {
+      fprintf (fp, "%s %s: no such graph: %s\n", module, name, graph);
+      return -1;
+    }
+  if (! snapshot_reference (image, "weight", SNAPSHOT_WEIGHT, weight, offset))
+    {
+      fprintf (fp, "%s %s: no such weight: %s\n", module, name, weight);
+      return -1;
+    }
+
+  /* the arrays are indexed by the ids of the graph's nodes and links */
+  if (graph == NULL ||
+      snapshot_graph_size (image, graph, offset, &nnodes, &nedges) < 0)
+    return 0;
+  if (w && w->nedges &&
+      w->nedges != nedges)
+    {
+      fprintf (fp, "%s %s: %u weights for the %llu links of graph %s\n",
+               module, name, w->nedges, (unsigned long long) nedges, graph);
+      return -1;
+    }
+  if (r && r->nnodes &&
+      r->nnodes != nnodes)
+    {
+      fprintf (fp, "%s %s: %u nodes for the %llu nodes of graph %s\n",
+               module, name, r->nnodes, (unsigned long long) nnodes, graph);
+      return -1;
+    }
+
+  return 0;
+}
+
+static char *
+snapshot_strdup (struct snapshot_image *image, u_int64_t offset)
+{
+  int error = 0;
+  char *s = snapshot_string_get (image, offset, &error);
+  return (s ? strdup (s) : NULL);
+}
+
+/* create the instance of the section, as "module NAME" does */
+static void *
+snapshot_instance (struct snapshot_image *image,
+                   struct snapshot_section *section, char *module_name)
+{
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  struct module *m = NULL;
+  void *instance;
+  int error = 0;
+
+  for (vn = vector_cursor_head (modules, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    if (! strcmp (((struct module *) vn->data)->name, module_name))
+      m = (struct module *) vn->data;
+  assert (m);
+
+  instance = (*m->create_instance)
+    (snapshot_string_get (image, section->name, &error));
+  vector_add (instance, *m->instances);
+  return instance;
+}
+
+static void
+snapshot_load_config (struct snapshot_image *image,
+                      struct snapshot_section *section,
+                      struct vector *config)
+{
+  u_int64_t *lines;
+  unsigned int i;
+
+  lines = (u_int64_t *) (image->addr + section->config);
+  for (i = 0; i < section->nconfig; i++)
+    vector_add_allow_dup (snapshot_strdup (image, lines[i]), config);
+}
+
+static void
+snapshot_load_graph (struct snapshot_image *image, struct snapshot_graph *g)
+{
+  struct snapshot_node *nodes;
+  struct snapshot_link *links;
+  u_int32_t *ooffset, *olink, *ioffset, *ilink;
+  struct graph *G;
+  struct node *node;
+  struct link *link;
+  u_int32_t i, j;
+
+  G = (struct graph *) snapshot_instance (image, &g->section, "graph");
+  snapshot_load_config (image, &g->section, G->config);
+
+  nodes = (struct snapshot_node *) (image->addr + g->node);
+  links = (struct snapshot_link *) (image->addr + g->link);
+  ooffset = (u_int32_t *) (image->addr + g->ooffset);
+  olink = (u_int32_t *) (image->addr + g->olink);
+  ioffset = (u_int32_t *) (image->addr + g->ioffset);
+  ilink = (u_int32_t *) (image->addr + g->ilink);
+
+  for (i = 0; i < g->nnodes; i++)
+    {
+      if (! nodes[i].exist)
+        continue;
+      node = node_create (i, G);
+      node->addr.s_addr = nodes[i].addr;
+      node->plen = nodes[i].plen;
+      node->type = nodes[i].type;
+      node->name = snapshot_strdup (image, nodes[i].name);
+      node->domain_name = snapshot_strdup (image, nodes[i].domain_name);
+      node->descr = snapshot_strdup (image, nodes[i].descr);
+      node->xpos = nodes[i].xpos;
+      node->ypos = nodes[i].ypos;
+      vector_set (G->nodes, i, node);
+    }
+
+  for (i = 0; i < g->nlinks; i++)
+    {
+      if (! links[i].exist)
+        continue;
+      link = link_create (i, G);
+      if (links[i].from != SNAPSHOT_NONE)
+        link->from = node_lookup (links[i].from, G);
+      if (links[i].to != SNAPSHOT_NONE)
+        link->to = node_lookup (links[i].to, G);
+      link->name = snapshot_strdup (image, links[i].name);
+      link->descr = snapshot_strdup (image, links[i].descr);
+      link->weight = links[i].weight;
+      link->bandwidth = links[i].bandwidth;
+      link->delay = links[i].delay;
+      link->length = links[i].length;
+      link->reliability = links[i].reliability;
+      link->probability = links[i].probability;
+      vector_set (G->links, i, link);
+    }
+
+  for (i = 0; i < g->nlinks; i++)
+    {
+      link = link_lookup_by_id (i, G);
+      if (link && links[i].inverse != SNAPSHOT_NONE)
+        link->inverse = link_lookup_by_id (links[i].inverse, G);
+    }
+
+  /* the adjacency in the original order, which decides the order
+     of the equal-cost paths */
+  for (i = 0; i < g->nnodes; i++)
+    {
+      node = node_lookup (i, G);
+      if (! node)
+        continue;
+      for (j = ooffset[i]; j < ooffset[i + 1]; j++)
+        vector_add_allow_dup (link_lookup_by_id (olink[j], G), node->olinks);
+      for (j = ioffset[i]; j < ioffset[i + 1]; j++)
+        vector_add_allow_dup (link_lookup_by_id (ilink[j], G), node->ilinks);
+    }
+
+  graph_reindex (G);
+  graph_thaw (G);
+}
+
+static void
+snapshot_load_weight (struct snapshot_image *image, struct snapshot_weight *w)
+{
+  struct weight *W;
+  int error = 0;
+  char *graph;
+
+  W = (struct weight *) snapshot_instance (image, &w->section, "weight");
+  snapshot_load_config (image, &w->section, W->config);
+
+  graph = snapshot_string_get (image, w->graph, &error);
+  if (graph)
+    W->G = (struct graph *) instance_lookup ("graph", graph);
+  if (w->nedges)
+    {
+      W->nedges = w->nedges;
+      W->weight = (weight_t *) (image->addr + w->weight);
+      W->mapped++;
+    }
+  weight_modified (W);
+}
+
+static void
+snapshot_load_traffic (struct snapshot_image *image,
+                       struct snapshot_traffic *t)
+{
+  struct traffic *T;
+  struct demand_matrix *D;
+  demand_t *traffic;
+  int error = 0;
+  char *graph;
+  u_int32_t i;
+
+  T = (struct traffic *) snapshot_instance (image, &t->section, "traffic");
+  snapshot_load_config (image, &t->section, T->config);
+
+  graph = snapshot_string_get (image, t->graph, &error);
+  if (graph)
+    T->G = (struct graph *) instance_lookup ("graph", graph);
+  T->seed = t->seed;
+  if (! T->G)
+    return;
+
+  /* the rows are in the image */
+  D = (struct demand_matrix *) malloc (sizeof (struct demand_matrix));
+  memset (D, 0, sizeof (struct demand_matrix));
+  D->nnodes = t->nnodes;
+  D->total = t->total;
+  D->traffic = (demand_t **) malloc (sizeof (demand_t *) * (t->nnodes + 1));
+  traffic = (demand_t *) (image->addr + t->traffic);
+  for (i = 0; i < t->nnodes; i++)
+    D->traffic[i] = traffic + (size_t) i * t->nnodes;
+  D->mapped++;
+  T->demands = D;
+}
+
+static void
+snapshot_load_routing (struct snapshot_image *image,
+                       struct snapshot_routing *r)
+{
+  struct routing *R;
+  struct route_flat *flat;
+  int error = 0;
+  char *graph, *weight;
+
+  R = (struct routing *) snapshot_instance (image, &r->section, "routing");
+  snapshot_load_config (image, &r->section, R->config);
+
+  graph = snapshot_string_get (image, r->graph, &error);
+  weight = snapshot_string_get (image, r->weight, &error);
+  if (graph)
+    R->G = (struct graph *) instance_lookup ("graph", graph);
+  if (weight)
+    R->W = (struct weight *) instance_lookup ("weight", weight);
+  R->spf_queue = r->spf_queue;
+  if (r->nnodes == 0)
+    return;
+
+  /* the frozen routes are used in place; route_thaw () builds
+     route[][] from them only when the routes get modified. */
+  flat = (struct route_flat *) malloc (sizeof (struct route_flat));
+  memset (flat, 0, sizeof (struct route_flat));
+  flat->nnodes = r->nnodes;
+  flat->offset = (unsigned int *) (image->addr + r->offset);
+  flat->nexthop = (unsigned int *) (image->addr + r->nexthop);
+  flat->ratio = (double *) (image->addr + r->ratio);
+  flat->mapped++;
+
+  R->nnodes = r->nnodes;
+  R->flat = flat;
+}
+
+DEFINE_COMMAND (load_snapshot,
+                "load snapshot <FILENAME>",
+                "load information\n"
+                "load the instances from a binary image\n"
+                "specify filename\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct snapshot_image *image;
+  struct snapshot_header *header;
+  struct snapshot_section *section;
+  struct stat st;
+  u_int64_t offset;
+  u_int32_t i;
+  void *addr;
+  int fd;
+
+  fd = open (argv[2], O_RDONLY);
+  if (fd < 0)
+    {
+      fprintf (shell->terminal, "cannot open file: %s\n", argv[2]);
+      fprintf (shell->terminal, "open (): %s\n", strerror (errno));
+      return;
+    }
+  if (fstat (fd, &st) < 0 || st.st_size < sizeof (struct snapshot_header))
+    {
+      fprintf (shell->terminal, "not a snapshot: %s\n", argv[2]);
+      close (fd);
+      return;
+    }
+
+  /* private, so that the instances can modify the arrays in place */
+  addr = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (addr == MAP_FAILED)
+    {
+      fprintf (shell->terminal, "mmap (): %s: %s\n",
+               argv[2], strerror (errno));
+      return;
+    }
+
+  image = (struct snapshot_image *) malloc (sizeof (struct snapshot_image));
+  image->file = strdup (argv[2]);
+  image->addr = (char *) addr;
+  image->size = st.st_size;
+
+  header = (struct snapshot_header *) image->addr;
+  if (memcmp (header->magic, SNAPSHOT_MAGIC, sizeof (header->magic)))
+    {
+      fprintf (shell->terminal, "not a snapshot: %s\n", argv[2]);
+      goto unmap;
+    }
+  if (header->version != SNAPSHOT_VERSION ||
+      header->byte_order != SNAPSHOT_BYTE_ORDER ||
+      header->wordsize != sizeof (long))
+    {
+      fprintf (shell->terminal,
+               "snapshot version %u, %u-byte words "
+               "of a different byte order: %s\n",
+               header->version, header->wordsize, argv[2]);
+      goto unmap;
+    }
+  if (header->size != image->size ||
+      header->checksum !=
+      snapshot_checksum (SNAPSHOT_FNV_BASIS,
+                         image->addr + sizeof (struct snapshot_header),
+                         image->size - sizeof (struct snapshot_header)))
+    {
+      fprintf (shell->terminal, "snapshot corrupted: %s\n", argv[2]);
+      goto unmap;
+    }
+
+  offset = sizeof (struct snapshot_header);
+  for (i = 0; i < header->nsections; i++)
+    {
+      if (snapshot_check (image, offset, shell->terminal) < 0)
+        {
+          fprintf (shell->terminal, "bad snapshot section %u: %s\n",
+                   i, argv[2]);
+          goto unmap;
+        }
+      section = (struct snapshot_section *) (image->addr + offset);
+      offset += section->size;
+    }
+
+  offset = sizeof (struct snapshot_header);
+  for (i = 0; i < header->nsections; i++)
+    {
+      section = (struct snapshot_section *) (image->addr + offset);
+      switch (section->type)
+        {
+        case SNAPSHOT_GRAPH:
+          snapshot_load_graph (image, (struct snapshot_graph *) section);
+          break;
+        case SNAPSHOT_WEIGHT:
+          snapshot_load_weight (image, (struct snapshot_weight *) section);
+          break;
+        case SNAPSHOT_TRAFFIC:
+          snapshot_load_traffic (image, (struct snapshot_traffic *) section);
+          break;
+        case SNAPSHOT_ROUTING:
+          snapshot_load_routing (image, (struct snapshot_routing *) section);
+          break;
+        }
+      offset += section->size;
+    }
+
+  vector_add (image, snapshot_images);
+  return;
+
+unmap:
+  munmap (image->addr, image->size);
+  free (image->file);
+  free (image);
+}
+
+void
+snapshot_init ()
+{
+  snapshot_images = vector_create ();
+}
+
+void
+snapshot_finish ()
+{
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  struct snapshot_image *image;
+
+  for (vn = vector_cursor_head (snapshot_images, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      image = (struct snapshot_image *) vn->data;
+      munmap (image->addr, image->size);
+      free (image->file);
+      free (image);
+    }
+  vector_delete (snapshot_images);
+}
+
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2007,2008  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+/* Binary snapshot of the graph, weight, traffic and routing
+   instances.  The image is mapped (MAP_PRIVATE) on load, and the
+   large arrays (weights, demand matrix and the flat routing table)
+   are used in place; the instances that point into an image have
+   the "mapped" flag set, and do not free () those arrays.
+
+   All integers are in the host byte order and word size, which are
+   recorded in the header and checked on load.  Every array starts
+   at an 8-byte aligned offset from the beginning of the file.  A
+   string is referred to by its offset, 0 meaning NULL. */
+
+#define SNAPSHOT_MAGIC      "SIMRSNAP"
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+#define SNAPSHOT_GRAPH      1
+#define SNAPSHOT_WEIGHT     2
+#define SNAPSHOT_TRAFFIC    3
+#define SNAPSHOT_ROUTING    4
+
+#define SNAPSHOT_NONE       ((u_int32_t) -1)
+
+struct snapshot_header
+{
+  char magic[8];
+  u_int32_t version;
+  u_int32_t byte_order;
+  u_int32_t wordsize;           /* sizeof (long) */
+  u_int32_t nsections;
+  u_int64_t size;               /* of the whole file */
+  u_int64_t checksum;           /* of the bytes after the header */
+};
+
+/* common part of the sections, which follow the header in turn */
+struct snapshot_section
+{
+  u_int32_t type;
+  u_int32_t nconfig;
+  u_int64_t size;               /* including this header */
+  u_int64_t name;               /* instance name */
+  u_int64_t config;             /* u_int64_t [nconfig]: config lines */
+};
+
+struct snapshot_node
+{
+  u_int32_t exist;
+  u_int32_t addr;
+  u_int32_t plen;
+  u_int32_t type;
+  u_int64_t name;
+  u_int64_t domain_name;
+  u_int64_t descr;
+  double xpos;
+  double ypos;
+};
+
+struct snapshot_link
+{
+  u_int32_t exist;
+  u_int32_t from;               /* node id, SNAPSHOT_NONE if none */
+  u_int32_t to;
+  u_int32_t inverse;            /* link id, SNAPSHOT_NONE if none */
+  u_int64_t name;
+  u_int64_t descr;
+  u_int64_t weight;
+  double bandwidth;
+  double delay;
+  double length;
+  double reliability;
+  double probability;
+};
+
+struct snapshot_graph
+{
+  struct snapshot_section section;
+  u_int32_t nnodes;             /* G->nodes->size */
+  u_int32_t nlinks;             /* G->links->size */
+  u_int32_t nadjacency;         /* CSR nlinks */
+  u_int32_t pad;
+  u_int64_t node;               /* struct snapshot_node [nnodes] */
+  u_int64_t link;               /* struct snapshot_link [nlinks] */
+  u_int64_t ooffset;            /* u_int32_t [nnodes + 1] */
+  u_int64_t olink;              /* u_int32_t [nadjacency] */
+  u_int64_t ioffset;            /* u_int32_t [nnodes + 1] */
+  u_int64_t ilink;              /* u_int32_t [nadjacency] */
+};
+
+struct snapshot_weight
+{
+  struct snapshot_section section;
+  u_int64_t graph;              /* graph name */
+  u_int32_t nedges;
+  u_int32_t pad;
+  u_int64_t weight;             /* weight_t [nedges], in place */
+};
+
+struct snapshot_traffic
+{
+  struct snapshot_section section;
+  u_int64_t graph;              /* graph name */
+  u_int32_t nnodes;
+  u_int32_t seed;
+  double total;
+  u_int64_t traffic;            /* demand_t [nnodes][nnodes], in place */
+};
+
+struct snapshot_routing
+{
+  struct snapshot_section section;
+  u_int64_t graph;              /* graph name */
+  u_int64_t weight;             /* weight name */
+  u_int32_t nnodes;
+  u_int32_t spf_queue;
+  u_int64_t nroutes;            /* number of the nexthops */
+  u_int64_t offset;             /* struct route_flat, in place */
+  u_int64_t nexthop;
+  u_int64_t ratio;
+};
+
+void snapshot_init ();
+void snapshot_finish ();
+
+EXTERN_COMMAND (save_snapshot);
+EXTERN_COMMAND (load_snapshot);
+
+#endif /*_SNAPSHOT_H_*/
+
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _BITSET_H_
+#define _BITSET_H_
+
+/* fixed-size set of small integers (e.g., node ids), one bit each. */
+#define BITSET_WORD_BITS (sizeof (unsigned long) * 8)
+#define BITSET_NWORDS(nbits) (((nbits) + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS)
+#define BITSET_BIT(i) (1UL << ((i) % BITSET_WORD_BITS))
+#define BITSET_SET(set, i) ((set)[(i) / BITSET_WORD_BITS] |= BITSET_BIT (i))
+#define BITSET_CLR(set, i) ((set)[(i) / BITSET_WORD_BITS] &= ~BITSET_BIT (i))
+#define BITSET_ISSET(set, i) ((set)[(i) / BITSET_WORD_BITS] & BITSET_BIT (i))
+
+static inline unsigned long *
+bitset_create (unsigned int nbits)
+{
+  return (unsigned long *)
+    calloc (BITSET_NWORDS (nbits) + 1, sizeof (unsigned long));
+}
+
+static inline void
+bitset_delete (unsigned long *set)
+{
+  free (set);
+}
+
+static inline void
+bitset_clear (unsigned long *set, unsigned int nbits)
+{
+  memset (set, 0, BITSET_NWORDS (nbits) * sizeof (unsigned long));
+}
+
+#endif /*_BITSET_H_*/
+
@@ -0,0 +1,147 @@
+/*
+ * Monotone bucket queue (Dial).
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "bucketq.h"
+
+#define BUCKETQ_QUEUED 1
+#define BUCKETQ_POPPED 2
+
+struct bucketq *
+bucketq_create (unsigned int nitems, unsigned long maxstep)
+{
+  struct bucketq *queue;
+  unsigned int i;
+
+  queue = (struct bucketq *) malloc (sizeof (struct bucketq));
+  memset (queue, 0, sizeof (struct bucketq));
+
+  queue->nitems = nitems;
+  queue->nbuckets = maxstep + 1;
+  queue->bucket = (unsigned int *)
+    malloc (queue->nbuckets * sizeof (unsigned int));
+  for (i = 0; i < queue->nbuckets; i++)
+    queue->bucket[i] = BUCKETQ_NONE;
+  queue->next = (unsigned int *) malloc ((nitems + 1) * sizeof (unsigned int));
+  queue->prev = (unsigned int *) malloc ((nitems + 1) * sizeof (unsigned int));
+  queue->key = (unsigned long *)
+    malloc ((nitems + 1) * sizeof (unsigned long));
+  queue->state = (unsigned char *) malloc (nitems + 1);
+
+  bucketq_clear (queue);
+  return queue;
+}
+
+void
+bucketq_delete (struct bucketq *queue)
+{
+  free (queue->bucket);
+  free (queue->next);
+  free (queue->prev);
+  free (queue->key);
+  free (queue->state);
+  free (queue);
+}
+
+void
+bucketq_clear (struct bucketq *queue)
+{
+  unsigned int i;
+
+  /* the buckets are empty again once the queue is drained */
+  if (queue->size)
+    for (i = 0; i < queue->nbuckets; i++)
+      queue->bucket[i] = BUCKETQ_NONE;
+  memset (queue->state, 0, queue->nitems + 1);
+  queue->size = 0;
+  queue->last = 0;
+  queue->cursor = 0;
+}
+
+static void
+bucketq_unlink (unsigned int item, struct bucketq *queue)
+{
+  unsigned int b = queue->key[item] % queue->nbuckets;
+
+  if (queue->prev[item] != BUCKETQ_NONE)
+    queue->next[queue->prev[item]] = queue->next[item];
+  else
+    queue->bucket[b] = queue->next[item];
+  if (queue->next[item] != BUCKETQ_NONE)
+    queue->prev[queue->next[item]] = queue->prev[item];
+}
+
+int
+bucketq_push (unsigned int item, unsigned long key, struct bucketq *queue)
+{
+  unsigned int b;
+
+  assert (item < queue->nitems);
+  if (queue->state[item] == BUCKETQ_POPPED)
+    return 0;
+
+  if (queue->state[item] == BUCKETQ_QUEUED)
+    {
+      if (key >= queue->key[item])
+        return 1;
+      bucketq_unlink (item, queue);
+    }
+  else
+    queue->size++;
+
+  assert (key >= queue->last && key - queue->last < queue->nbuckets);
+
+  b = key % queue->nbuckets;
+  queue->key[item] = key;
+  queue->prev[item] = BUCKETQ_NONE;
+  queue->next[item] = queue->bucket[b];
+  if (queue->bucket[b] != BUCKETQ_NONE)
+    queue->prev[queue->bucket[b]] = item;
+  queue->bucket[b] = item;
+  queue->state[item] = BUCKETQ_QUEUED;
+  return 1;
+}
+
+unsigned int
+bucketq_pop (struct bucketq *queue)
+{
+  unsigned int item;
+
+  if (queue->size == 0)
+    return BUCKETQ_NONE;
+
+  /* the queued keys are in [last, last + maxstep]: scan forward
+     from the bucket of the last popped key. */
+  while (queue->bucket[queue->cursor] == BUCKETQ_NONE)
+    {
+      queue->cursor++;
+      if (queue->cursor == queue->nbuckets)
+        queue->cursor = 0;
+    }
+
+  item = queue->bucket[queue->cursor];
+  bucketq_unlink (item, queue);
+  queue->state[item] = BUCKETQ_POPPED;
+  queue->last = queue->key[item];
+  queue->size--;
+  return item;
+}
@@ -0,0 +1,59 @@
+/*
+ * Monotone bucket queue (Dial).
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _BUCKETQ_H_
+#define _BUCKETQ_H_
+
+/* priority queue of the item ids [0, nitems) with integer keys, for
+   the monotone use of Dijkstra's algorithm: a pushed key must not be
+   smaller than the last popped key, and must not exceed it by more
+   than maxstep (the largest edge weight).  the buckets are a circular
+   array of maxstep + 1 doubly linked lists, so that push, decrease
+   and pop are O(1) (pop is amortized over the bucket scan). */
+
+#define BUCKETQ_NONE ((unsigned int) -1)
+
+struct bucketq
+{
+  unsigned int nitems;
+  unsigned int nbuckets;
+  unsigned int size;
+  unsigned long last;
+  unsigned int cursor;
+
+  unsigned int *bucket;         /* head item of each bucket */
+  unsigned int *next;           /* per item */
+  unsigned int *prev;           /* per item */
+  unsigned long *key;           /* per item */
+  unsigned char *state;         /* per item */
+};
+
+struct bucketq *bucketq_create (unsigned int nitems, unsigned long maxstep);
+void bucketq_delete (struct bucketq *queue);
+void bucketq_clear (struct bucketq *queue);
+
+/* insert the item, or decrease its key if it is already queued.
+   returns 0 if the item has been popped already (ignored). */
+int bucketq_push (unsigned int item, unsigned long key,
+                  struct bucketq *queue);
+unsigned int bucketq_pop (struct bucketq *queue);
+
+#endif /*_BUCKETQ_H_*/
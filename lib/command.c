@@ -803,7 +803,7 @@ command_config_add (struct vector *config, int argc, char **argv)
       left -= ret;
     }
 
-  vector_add (strdup (config_line), config);
+  vector_add_allow_dup (strdup (config_line), config);
 }
 
 void
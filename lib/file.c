@@ -20,6 +20,8 @@
 
 #include <includes.h>
 
+#include "file.h"
+
 void
 path_disassemble (char *pathname, char **dirname, char **filename)
 {
@@ -135,3 +137,130 @@ restore_stdio ()
   stderr = save_stderr;
 }
 
+struct file_reader *
+file_reader_open (char *filename)
+{
+  struct file_reader *reader;
+  FILE *fp;
+
+  fp = fopen (filename, "r");
+  if (fp == NULL)
+    return NULL;
+
+  reader = (struct file_reader *) malloc (sizeof (struct file_reader));
+  memset (reader, 0, sizeof (struct file_reader));
+  reader->fp = fp;
+  reader->size = FILE_READER_BLOCK;
+  reader->buf = (char *) malloc (reader->size + 1);
+  return reader;
+}
+
+void
+file_reader_close (struct file_reader *reader)
+{
+  fclose (reader->fp);
+  free (reader->buf);
+  free (reader);
+}
+
+/* returns the next line, or NULL on the end of file. the line is valid
+   until the next call. len (if not NULL) receives the length of the
+   line, which may contain NUL bytes that came from the file. */
+char *
+file_reader_line (struct file_reader *reader, size_t *len)
+{
+  char *line, *newline;
+  size_t ret;
+
+  while (1)
+    {
+      newline = memchr (&reader->buf[reader->start], '\n',
+                        reader->end - reader->start);
+      if (newline || (reader->eof && reader->start < reader->end))
+        break;
+      if (reader->eof)
+        return NULL;
+
+      /* move the partial line to the head, and grow the buffer
+         if the line fills the whole of it */
+      if (reader->start > 0)
+        {
+          memmove (reader->buf, &reader->buf[reader->start],
+                   reader->end - reader->start);
+          reader->end -= reader->start;
+          reader->start = 0;
+        }
+      if (reader->end == reader->size)
+        {
+          reader->size *= 2;
+          reader->buf = (char *) realloc (reader->buf, reader->size + 1);
+        }
+
+      ret = fread (&reader->buf[reader->end], 1,
+                   reader->size - reader->end, reader->fp);
+      if (ret == 0)
+        reader->eof++;
+      reader->end += ret;
+      reader->bytes += ret;
+    }
+
+  /* the last line without the newline ends at the end of data,
+     for which the buffer has one extra byte */
+  if (newline == NULL)
+    newline = &reader->buf[reader->end];
+
+  line = &reader->buf[reader->start];
+  *newline = '\0';
+  reader->start = newline - reader->buf + 1;
+  if (reader->start > reader->end)
+    reader->start = reader->end;
+  reader->lineno++;
+
+  if (len)
+    *len = newline - line;
+  return line;
+}
+
+/* split the line into the whitespace-separated tokens in place.
+   *argv (of *max entries) is grown as needed, and is to be freed by
+   the caller. returns the number of the tokens, or -1 if the line
+   contains a NUL byte. */
+int
+file_split (char *line, size_t len, char ***argv, int *max)
+{
+  char *p, *end = line + len;
+  int argc = 0;
+
+  p = line;
+  while (p < end)
+    {
+      while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        *p++ = '\0';
+      if (p == end)
+        break;
+
+      if (argc == *max)
+        {
+          *max = (*max ? *max * 2 : 16);
+          *argv = (char **) realloc (*argv, *max * sizeof (char *));
+        }
+      (*argv)[argc++] = p;
+
+      while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+        {
+          if (*p == '\0')
+            return -1;
+          p++;
+        }
+    }
+
+  return argc;
+}
+
+/* true if the token is not empty and consists of the chars in accept. */
+int
+file_token_is (char *token, const char *accept)
+{
+  return (token[0] != '\0' && token[strspn (token, accept)] == '\0');
+}
+
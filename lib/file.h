@@ -29,6 +29,30 @@ int file_truncate (char *file);
 int redirect_stdio (FILE *std, FILE *fp);
 int restore_stdio ();
 
+/* buffered line reader: reads the file in large blocks and returns
+   the lines in place, NUL-terminated and without the newline.
+   the buffer grows for the lines longer than the block. */
+#define FILE_READER_BLOCK 65536
+
+struct file_reader
+{
+  FILE *fp;
+  char *buf;
+  size_t size;
+  size_t start;
+  size_t end;
+  int eof;
+  unsigned long lineno;
+  unsigned long long bytes;
+};
+
+struct file_reader *file_reader_open (char *filename);
+void file_reader_close (struct file_reader *reader);
+char *file_reader_line (struct file_reader *reader, size_t *len);
+
+int file_split (char *line, size_t len, char ***argv, int *max);
+int file_token_is (char *token, const char *accept);
+
 #endif /*_FILE_H_*/
 
 
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "hash.h"
+
+#define HASH_DEFSIZ 64
+
+struct hash *
+hash_create ()
+{
+  struct hash *h;
+
+  h = (struct hash *) malloc (sizeof (struct hash));
+  h->size = HASH_DEFSIZ;
+  h->count = 0;
+  h->bucket = (struct hash_entry **)
+    calloc (h->size, sizeof (struct hash_entry *));
+  return h;
+}
+
+void
+hash_clear (struct hash *h)
+{
+  struct hash_entry *e, *next;
+  unsigned int i;
+
+  for (i = 0; i < h->size; i++)
+    {
+      for (e = h->bucket[i]; e; e = next)
+        {
+          next = e->next;
+          free (e);
+        }
+      h->bucket[i] = NULL;
+    }
+  h->count = 0;
+}
+
+void
+hash_delete (struct hash *h)
+{
+  hash_clear (h);
+  free (h->bucket);
+  free (h);
+}
+
+/* double the buckets, keeping the load factor at most 1. */
+static void
+hash_expand (struct hash *h)
+{
+  struct hash_entry **bucket, *e, *next;
+  unsigned int i, size;
+
+  size = h->size * 2;
+  bucket = (struct hash_entry **) calloc (size, sizeof (struct hash_entry *));
+  if (bucket == NULL)
+    return;
+
+  for (i = 0; i < h->size; i++)
+    for (e = h->bucket[i]; e; e = next)
+      {
+        next = e->next;
+        e->next = bucket[e->key & (size - 1)];
+        bucket[e->key & (size - 1)] = e;
+      }
+
+  free (h->bucket);
+  h->bucket = bucket;
+  h->size = size;
+}
+
+void
+hash_add (unsigned int key, void *data, struct hash *h)
+{
+  struct hash_entry *e;
+
+  if (h->count >= h->size)
+    hash_expand (h);
+
+  e = (struct hash_entry *) malloc (sizeof (struct hash_entry));
+  e->key = key;
+  e->data = data;
+  e->next = h->bucket[key & (h->size - 1)];
+  h->bucket[key & (h->size - 1)] = e;
+  h->count++;
+}
+
+void
+hash_remove (unsigned int key, void *data, struct hash *h)
+{
+  struct hash_entry **prev, *e;
+
+  for (prev = &h->bucket[key & (h->size - 1)]; (e = *prev) != NULL;
+       prev = &e->next)
+    if (e->key == key && e->data == data)
+      {
+        *prev = e->next;
+        free (e);
+        h->count--;
+        return;
+      }
+}
+
+/* FNV-1a */
+unsigned int
+hash_string (const char *s)
+{
+  unsigned int key = 2166136261U;
+
+  while (*s)
+    {
+      key ^= (unsigned char) *s++;
+      key *= 16777619U;
+    }
+  return key;
+}
+
+unsigned int
+hash_pointer (const void *a)
+{
+  return hash_pointer_pair (a, NULL);
+}
+
+unsigned int
+hash_pointer_pair (const void *a, const void *b)
+{
+  unsigned long x, y;
+
+  /* drop the alignment bits, then mix as the Fibonacci hashing */
+  x = (unsigned long) a >> 4;
+  y = (unsigned long) b >> 4;
+  x = (x * 0x9e3779b1UL) ^ (y + 0x7f4a7c15UL + (x << 6) + (x >> 2));
+  return (unsigned int) (x ^ (x >> 16) ^ (x >> 32 >> 16));
+}
+
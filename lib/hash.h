@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _HASH_H_
+#define _HASH_H_
+
+/* chained hash of data pointers by an unsigned int key (the hash value).
+   the same key may be shared by many data; the caller walks the chain
+   from hash_head () and checks the data itself:
+
+     struct hash_entry *e;
+     for (e = hash_head (key, h); e; e = e->next)
+       if (e->key == key && match (e->data))
+         ...
+ */
+
+struct hash_entry
+{
+  unsigned int key;
+  void *data;
+  struct hash_entry *next;
+};
+
+struct hash
+{
+  struct hash_entry **bucket;
+  unsigned int size;     /* number of buckets, power of 2 */
+  unsigned int count;    /* number of entries */
+};
+
+static inline struct hash_entry *
+hash_head (unsigned int key, struct hash *h)
+{
+  return h->bucket[key & (h->size - 1)];
+}
+
+struct hash *hash_create ();
+void hash_delete (struct hash *h);
+void hash_clear (struct hash *h);
+
+void hash_add (unsigned int key, void *data, struct hash *h);
+void hash_remove (unsigned int key, void *data, struct hash *h);
+
+unsigned int hash_string (const char *s);
+unsigned int hash_pointer (const void *a);
+unsigned int hash_pointer_pair (const void *a, const void *b);
+
+#endif /*_HASH_H_*/
+
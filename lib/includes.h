@@ -22,6 +22,7 @@
 #include <sys/resource.h>
 #include <sys/param.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <arpa/telnet.h>
@@ -37,6 +38,7 @@
 #include <dirent.h>
 #include <float.h>
 #include <limits.h>
+#include <pthread.h>
 
 #ifndef MIN
 #define MIN(a,b)  ((a) > (b) ? (b) : (a))
@@ -0,0 +1,179 @@
+/*
+ * Monotone radix heap.
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "radixheap.h"
+
+#define RADIXHEAP_BITS (sizeof (unsigned long) * 8)
+
+/* 0 if key == last, otherwise one plus the position of the highest
+   bit in which they differ. */
+static inline unsigned int
+radixheap_bucket (unsigned long key, unsigned long last)
+{
+  unsigned long diff = key ^ last;
+  unsigned int bit;
+
+  if (diff == 0)
+    return 0;
+#ifdef __GNUC__
+  bit = RADIXHEAP_BITS - __builtin_clzl (diff);
+#else
+  for (bit = 0; diff; bit++)
+    diff >>= 1;
+#endif
+  return bit;
+}
+
+struct radixheap *
+radixheap_create (unsigned int nitems)
+{
+  struct radixheap *queue;
+
+  queue = (struct radixheap *) malloc (sizeof (struct radixheap));
+  memset (queue, 0, sizeof (struct radixheap));
+
+  queue->nitems = nitems;
+  queue->next = (unsigned int *) malloc ((nitems + 1) * sizeof (unsigned int));
+  queue->prev = (unsigned int *) malloc ((nitems + 1) * sizeof (unsigned int));
+  queue->key = (unsigned long *)
+    malloc ((nitems + 1) * sizeof (unsigned long));
+  queue->where = (unsigned char *) malloc (nitems + 1);
+  queue->popped = (unsigned char *) malloc (nitems + 1);
+
+  radixheap_clear (queue);
+  return queue;
+}
+
+void
+radixheap_delete (struct radixheap *queue)
+{
+  free (queue->next);
+  free (queue->prev);
+  free (queue->key);
+  free (queue->where);
+  free (queue->popped);
+  free (queue);
+}
+
+void
+radixheap_clear (struct radixheap *queue)
+{
+  unsigned int i;
+
+  for (i = 0; i < RADIXHEAP_NBUCKETS; i++)
+    queue->bucket[i] = RADIXHEAP_NONE;
+  memset (queue->where, 0, queue->nitems + 1);
+  memset (queue->popped, 0, queue->nitems + 1);
+  queue->size = 0;
+  queue->last = 0;
+}
+
+static void
+radixheap_unlink (unsigned int item, struct radixheap *queue)
+{
+  unsigned int b = queue->where[item] - 1;
+
+  if (queue->prev[item] != RADIXHEAP_NONE)
+    queue->next[queue->prev[item]] = queue->next[item];
+  else
+    queue->bucket[b] = queue->next[item];
+  if (queue->next[item] != RADIXHEAP_NONE)
+    queue->prev[queue->next[item]] = queue->prev[item];
+  queue->where[item] = 0;
+}
+
+static void
+radixheap_link (unsigned int item, struct radixheap *queue)
+{
+  unsigned int b = radixheap_bucket (queue->key[item], queue->last);
+
+  queue->prev[item] = RADIXHEAP_NONE;
+  queue->next[item] = queue->bucket[b];
+  if (queue->bucket[b] != RADIXHEAP_NONE)
+    queue->prev[queue->bucket[b]] = item;
+  queue->bucket[b] = item;
+  queue->where[item] = b + 1;
+}
+
+int
+radixheap_push (unsigned int item, unsigned long key,
+                struct radixheap *queue)
+{
+  assert (item < queue->nitems);
+  if (queue->popped[item])
+    return 0;
+
+  if (queue->where[item])
+    {
+      if (key >= queue->key[item])
+        return 1;
+      radixheap_unlink (item, queue);
+    }
+  else
+    queue->size++;
+
+  assert (key >= queue->last);
+
+  queue->key[item] = key;
+  radixheap_link (item, queue);
+  return 1;
+}
+
+unsigned int
+radixheap_pop (struct radixheap *queue)
+{
+  unsigned int b, item, next;
+  unsigned long min;
+
+  if (queue->size == 0)
+    return RADIXHEAP_NONE;
+
+  if (queue->bucket[0] == RADIXHEAP_NONE)
+    {
+      /* find the first non-empty bucket, and make its minimum the
+         new last key; all its items move to lower buckets. */
+      for (b = 1; queue->bucket[b] == RADIXHEAP_NONE; b++)
+        ;
+
+      min = queue->key[queue->bucket[b]];
+      for (item = queue->bucket[b]; item != RADIXHEAP_NONE;
+           item = queue->next[item])
+        if (queue->key[item] < min)
+          min = queue->key[item];
+      queue->last = min;
+
+      item = queue->bucket[b];
+      queue->bucket[b] = RADIXHEAP_NONE;
+      for (; item != RADIXHEAP_NONE; item = next)
+        {
+          next = queue->next[item];
+          radixheap_link (item, queue);
+        }
+    }
+
+  item = queue->bucket[0];
+  radixheap_unlink (item, queue);
+  queue->popped[item] = 1;
+  queue->size--;
+  return item;
+}
@@ -0,0 +1,58 @@
+/*
+ * Monotone radix heap.
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _RADIXHEAP_H_
+#define _RADIXHEAP_H_
+
+/* radix heap of the item ids [0, nitems) with unsigned long keys.
+   monotone: a pushed key must not be smaller than the last popped
+   key.  bucket 0 holds the keys equal to the last popped key, and
+   bucket b the keys whose highest bit differing from it is b - 1.
+   push and decrease are O(1), pop is O(log C) amortized. */
+
+#define RADIXHEAP_NONE ((unsigned int) -1)
+#define RADIXHEAP_NBUCKETS (sizeof (unsigned long) * 8 + 1)
+
+struct radixheap
+{
+  unsigned int nitems;
+  unsigned int size;
+  unsigned long last;
+
+  unsigned int bucket[RADIXHEAP_NBUCKETS]; /* head item of each bucket */
+  unsigned int *next;           /* per item */
+  unsigned int *prev;           /* per item */
+  unsigned long *key;           /* per item */
+  unsigned char *where;         /* per item: bucket + 1, 0 if not queued */
+  unsigned char *popped;        /* per item */
+};
+
+struct radixheap *radixheap_create (unsigned int nitems);
+void radixheap_delete (struct radixheap *queue);
+void radixheap_clear (struct radixheap *queue);
+
+/* insert the item, or decrease its key if it is already queued.
+   returns 0 if the item has been popped already (ignored). */
+int radixheap_push (unsigned int item, unsigned long key,
+                    struct radixheap *queue);
+unsigned int radixheap_pop (struct radixheap *queue);
+
+#endif /*_RADIXHEAP_H_*/
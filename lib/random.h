@@ -24,5 +24,48 @@
 void
 random_init (unsigned int s);
 
+/* counter-based generator: the value is a function of the key and the
+   counter alone (the splitmix64 finalizer of key + counter * gamma),
+   so a stream can be derived from an explicit seed and a stream
+   number (e.g., the trial), and gives the same values in whichever
+   thread and order the streams are run. */
+struct random_stream
+{
+  unsigned long long key;
+  unsigned long long counter;
+};
+
+static inline unsigned long long
+random_counter (unsigned long long key, unsigned long long counter)
+{
+  unsigned long long z;
+
+  z = key + (counter + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static inline void
+random_stream_init (struct random_stream *stream, unsigned long long seed,
+                    unsigned long long number)
+{
+  stream->key = random_counter (seed, number);
+  stream->counter = 0;
+}
+
+static inline unsigned long long
+random_stream_next (struct random_stream *stream)
+{
+  return random_counter (stream->key, stream->counter++);
+}
+
+/* uniform in [0, 1), by the upper 53 bits */
+static inline double
+random_stream_double (struct random_stream *stream)
+{
+  return (random_stream_next (stream) >> 11) * (1.0 / 9007199254740992.0);
+}
+
 #endif /*_RANDOM_H_*/
 
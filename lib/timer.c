@@ -30,10 +30,12 @@ gettimeofday_sub (struct timeval *start, struct timeval *end,
                  + end->tv_usec - start->tv_usec;
 }
 
-inline unsigned long long rdtsc() {
-    unsigned long long ret;
-    __asm__ volatile ("rdtsc" : "=A" (ret));
-    return ret;
+unsigned long long
+rdtsc ()
+{
+  unsigned int lo, hi;
+  __asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((unsigned long long) hi << 32) | lo;
 }
 
 
@@ -21,6 +21,7 @@
 #include <includes.h>
 
 #include "vector.h"
+#include "hash.h"
 
 /* the initial size of the array */
 #define VECTOR_DEFSIZ 1
@@ -103,6 +104,32 @@ vector_lookup_index_bsearch (void *data, vector_cmp_t cmp,
   return -1;
 }
 
+/* membership by the optional index (vector_create_indexed ()). */
+static inline int
+vector_index_member (void *data, struct vector *v)
+{
+  struct hash_entry *e;
+  unsigned int key = hash_pointer (data);
+  for (e = hash_head (key, v->index); e; e = e->next)
+    if (e->data == data)
+      return 1;
+  return 0;
+}
+
+static inline void
+vector_index_add (void *data, struct vector *v)
+{
+  if (v->index && data)
+    hash_add (hash_pointer (data), data, v->index);
+}
+
+static inline void
+vector_index_remove (void *data, struct vector *v)
+{
+  if (v->index && data)
+    hash_remove (hash_pointer (data), data, v->index);
+}
+
 int
 vector_lookup_index (void *data, struct vector *v)
 {
@@ -110,6 +137,8 @@ vector_lookup_index (void *data, struct vector *v)
 
   if (v->size == 0)
     return -1;
+  if (v->index && data && ! vector_index_member (data, v))
+    return -1;
 
   for (index = 0; index < v->size; index++)
     if (v->array[index] == data)
@@ -133,6 +162,8 @@ void *
 vector_lookup (void *data, struct vector *v)
 {
   int index;
+  if (v->index && data)
+    return (vector_index_member (data, v) ? data : NULL);
   index = vector_lookup_index (data, v);
   if (index < 0)
     return NULL;
@@ -155,6 +186,26 @@ vector_expand (struct vector *v)
   v->limit *= 2;
 }
 
+/* grow the array so that it holds at least limit entries without
+   further realloc (), for the callers who know the final size. */
+void
+vector_reserve (struct vector *v, unsigned int limit)
+{
+  void *newarray;
+
+  if (v->limit >= limit)
+    return;
+
+  newarray = (void **) realloc (v->array, limit * sizeof (void *));
+  if (newarray == NULL)
+    return;
+  memset ((caddr_t)newarray + v->limit * sizeof (void *), 0,
+          (limit - v->limit) * sizeof (void *));
+
+  v->array = newarray;
+  v->limit = limit;
+}
+
 void
 vector_add (void *data, struct vector *v)
 {
@@ -181,6 +232,7 @@ vector_add (void *data, struct vector *v)
 
   /* add */
   v->array[v->size++] = data;
+  vector_index_add (data, v);
 }
 
 void
@@ -202,6 +254,7 @@ vector_add_allow_dup (void *data, struct vector *v)
 
   /* add */
   v->array[v->size++] = data;
+  vector_index_add (data, v);
 }
 
 void
@@ -223,30 +276,26 @@ vector_remove (void *data, struct vector *v)
       assert (0);
       return;
     }
+  vector_index_remove (data, v);
 
-  /* remove */
-  v->array[index] = NULL;
+  /* remove, and shift the rest (the entries beyond the size are NULL) */
+  memmove (&v->array[index], &v->array[index + 1],
+           (v->size - index - 1) * sizeof (void *));
   v->size--;
-
-  /* shift */
-  if (index + 1 < v->limit)
-    memmove (&v->array[index], &v->array[index + 1],
-             (v->limit - index - 1) * sizeof (void *));
+  v->array[v->size] = NULL;
 }
 
 void
 vector_remove_index (int index, struct vector *v)
 {
   assert (index >= 0);
+  vector_index_remove (v->array[index], v);
 
-  /* remove */
-  v->array[index] = NULL;
+  /* remove, and shift the rest (the entries beyond the size are NULL) */
+  memmove (&v->array[index], &v->array[index + 1],
+           (v->size - index - 1) * sizeof (void *));
   v->size--;
-
-  /* shift */
-  if (index + 1 < v->limit)
-    memmove (&v->array[index], &v->array[index + 1],
-             (v->limit - index - 1) * sizeof (void *));
+  v->array[v->size] = NULL;
 }
 
 void
@@ -254,6 +303,8 @@ vector_clear (struct vector *v)
 {
   memset (v->array, 0, v->limit * sizeof (void *));
   v->size = 0;
+  if (v->index)
+    hash_clear (v->index);
 }
 
 /* You will not want to sort when you use below functions */
@@ -275,7 +326,10 @@ vector_set (struct vector *v, int index, void *data)
     }
 
   /* add */
+  if (index < v->size)
+    vector_index_remove (v->array[index], v);
   v->array[index] = data;
+  vector_index_add (data, v);
   if (v->size <= index)
     v->size = index + 1;
 }
@@ -361,9 +415,26 @@ vector_create ()
   return v;
 }
 
+/* a vector used as a set: vector_lookup () and the duplicate check of
+   vector_add () are O(1) by a hash of the data pointers, at the cost
+   of one hash entry per element. vector_copy () does not copy it. */
+struct vector *
+vector_create_indexed ()
+{
+  struct vector *v;
+
+  v = vector_create ();
+  if (v == NULL)
+    return NULL;
+  v->index = hash_create ();
+  return v;
+}
+
 void
 vector_delete (struct vector *v)
 {
+  if (v->index)
+    hash_delete (v->index);
   free (v->array);
   free (v);
 }
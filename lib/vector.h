@@ -23,6 +23,8 @@
 
 typedef int (*vector_cmp_t) (const void *, const void *);
 
+struct hash;
+
 struct vector_node
 {
   struct vector *vector;
@@ -37,6 +39,9 @@ struct vector
   void **array;
   unsigned int limit;
   unsigned int size;
+
+  /* membership index, only by vector_create_indexed () */
+  struct hash *index;
 };
 
 void vector_sort (vector_cmp_t cmp, struct vector *v);
@@ -45,6 +50,10 @@ int vector_lookup_index (void *data, struct vector *v);
 void *vector_lookup_bsearch (void *data, vector_cmp_t cmp, struct vector *v);
 void *vector_lookup (void *data, struct vector *v);
 
+void vector_reserve (struct vector *v, unsigned int limit);
+/* vector_add () rejects the duplicate by vector_lookup (), which is
+   a linear scan unless the vector is indexed. the callers that know
+   the data is new use vector_add_allow_dup (), the unchecked append. */
 void vector_add (void *data, struct vector *v);
 void vector_add_allow_dup (void *data, struct vector *v);
 void vector_add_sort (void *data, vector_cmp_t cmp, struct vector *v);
@@ -59,7 +68,46 @@ struct vector_node *vector_head (struct vector *vector);
 struct vector_node *vector_next (struct vector_node *node);
 void vector_break (struct vector_node *node);
 
+/* allocation-free version of vector_head ()/vector_next ().
+   the cursor is provided by the caller (usually on the stack),
+   so nothing has to be freed on the loop end or on the break.
+   the semantics (reload on deletion) are the same as vector_next ().
+
+     struct vector_node *vn, vn_cursor;
+     for (vn = vector_cursor_head (v, &vn_cursor); vn;
+          vn = vector_cursor_next (vn))
+       ...
+ */
+static inline struct vector_node *
+vector_cursor_head (struct vector *vector, struct vector_node *cursor)
+{
+  if (vector->size == 0)
+    return NULL;
+
+  cursor->vector = vector;
+  cursor->index = 0;
+  cursor->data = vector->array[0];
+  return cursor;
+}
+
+static inline struct vector_node *
+vector_cursor_next (struct vector_node *cursor)
+{
+  /* vector might be deleted. in the case, reload data only */
+  if (cursor->index < cursor->vector->size &&
+      cursor->data == cursor->vector->array[cursor->index])
+    cursor->index++;
+
+  /* if index reaches end, return NULL */
+  if (cursor->index >= cursor->vector->size)
+    return NULL;
+
+  cursor->data = cursor->vector->array[cursor->index];
+  return cursor;
+}
+
 struct vector *vector_create ();
+struct vector *vector_create_indexed ();
 void vector_delete (struct vector *v);
 
 void vector_assert (struct vector *v);
@@ -0,0 +1,168 @@
+/*
+ * Work-stealing worker pool.
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "workqueue.h"
+
+/* each worker owns a contiguous range of items [head, tail).
+   the owner takes items from the head, and an idle worker steals
+   the latter half of the range of another worker from the tail. */
+
+struct workqueue_worker
+{
+  pthread_t thread;
+  int running;          /* the thread has been created */
+  pthread_mutex_t mutex;
+  unsigned int id;
+  unsigned int head;
+  unsigned int tail;
+  struct workqueue *wq;
+};
+
+struct workqueue
+{
+  unsigned int nworkers;
+  struct workqueue_worker *workers;
+  workqueue_func_t func;
+  void *arg;
+};
+
+static int
+workqueue_take (struct workqueue_worker *w, unsigned int *item)
+{
+  int ret = 0;
+  pthread_mutex_lock (&w->mutex);
+  if (w->head < w->tail)
+    {
+      *item = w->head++;
+      ret = 1;
+    }
+  pthread_mutex_unlock (&w->mutex);
+  return ret;
+}
+
+static int
+workqueue_steal (struct workqueue_worker *w)
+{
+  struct workqueue *wq = w->wq;
+  struct workqueue_worker *victim;
+  unsigned int i, n, head = 0, tail = 0;
+
+  for (i = 1; i < wq->nworkers; i++)
+    {
+      victim = &wq->workers[(w->id + i) % wq->nworkers];
+
+      pthread_mutex_lock (&victim->mutex);
+      n = victim->tail - victim->head;
+      if (n)
+        {
+          tail = victim->tail;
+          head = tail - (n + 1) / 2;
+          victim->tail = head;
+        }
+      pthread_mutex_unlock (&victim->mutex);
+
+      if (n)
+        {
+          pthread_mutex_lock (&w->mutex);
+          w->head = head;
+          w->tail = tail;
+          pthread_mutex_unlock (&w->mutex);
+          return 1;
+        }
+    }
+
+  return 0;
+}
+
+static void *
+workqueue_worker_main (void *arg)
+{
+  struct workqueue_worker *w = (struct workqueue_worker *) arg;
+  struct workqueue *wq = w->wq;
+  unsigned int item;
+
+  do
+    {
+      while (workqueue_take (w, &item))
+        (*wq->func) (wq->arg, item, w->id);
+    }
+  while (workqueue_steal (w));
+
+  return NULL;
+}
+
+void
+workqueue_run (unsigned int nworkers, unsigned int nitems,
+               workqueue_func_t func, void *arg)
+{
+  struct workqueue wq;
+  unsigned int i;
+
+  if (nworkers > nitems)
+    nworkers = nitems;
+
+  /* no thread for the single worker */
+  if (nworkers <= 1)
+    {
+      for (i = 0; i < nitems; i++)
+        (*func) (arg, i, 0);
+      return;
+    }
+
+  wq.nworkers = nworkers;
+  wq.func = func;
+  wq.arg = arg;
+  wq.workers = (struct workqueue_worker *)
+    calloc (nworkers, sizeof (struct workqueue_worker));
+
+  /* split the items evenly at first */
+  for (i = 0; i < nworkers; i++)
+    {
+      struct workqueue_worker *w = &wq.workers[i];
+      w->id = i;
+      w->wq = &wq;
+      w->head = (unsigned long long) nitems * i / nworkers;
+      w->tail = (unsigned long long) nitems * (i + 1) / nworkers;
+      pthread_mutex_init (&w->mutex, NULL);
+    }
+
+  for (i = 0; i < nworkers; i++)
+    if (pthread_create (&wq.workers[i].thread, NULL,
+                        workqueue_worker_main, &wq.workers[i]) == 0)
+      wq.workers[i].running = 1;
+
+  /* the caller runs the workers whose thread could not be created,
+     so that their ranges are still done. */
+  for (i = 0; i < nworkers; i++)
+    if (! wq.workers[i].running)
+      workqueue_worker_main (&wq.workers[i]);
+
+  for (i = 0; i < nworkers; i++)
+    if (wq.workers[i].running)
+      pthread_join (wq.workers[i].thread, NULL);
+
+  for (i = 0; i < nworkers; i++)
+    pthread_mutex_destroy (&wq.workers[i].mutex);
+  free (wq.workers);
+}
+
@@ -0,0 +1,44 @@
+/*
+ * Work-stealing worker pool.
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _WORKQUEUE_H_
+#define _WORKQUEUE_H_
+
+/* func (arg, item, worker) is called once for each item in
+   [0, nitems), from one of the nworkers threads.  worker is the
+   index of the calling thread in [0, nworkers), which can be used
+   to select per-worker scratch data (e.g., a priority queue). */
+typedef void (*workqueue_func_t) (void *arg, unsigned int item,
+                                  unsigned int worker);
+
+void workqueue_run (unsigned int nworkers, unsigned int nitems,
+                    workqueue_func_t func, void *arg);
+
+/* merge a per-worker counter array: sum[i] += count[i] for i in [0, n) */
+#define WORKQUEUE_SUM(sum, count, n)                          \
+  do {                                                        \
+    unsigned long workqueue_i;                                \
+    for (workqueue_i = 0; workqueue_i < (n); workqueue_i++)   \
+      (sum)[workqueue_i] += (count)[workqueue_i];             \
+  } while (0)
+
+#endif /*_WORKQUEUE_H_*/
+
@@ -0,0 +1,626 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "module.h"
+#include "timer.h"
+#include "bitset.h"
+#include "workqueue.h"
+
+#include "network/graph.h"
+#include "network/path.h"
+#include "network/routing.h"
+#include "network/route-dag.h"
+#include "network/failure-sweep.h"
+
+#define FAILURE_SWEEP_MAX_COMBINATIONS (1ULL << 22)
+
+static unsigned long long
+failure_sweep_binomial (unsigned int n, unsigned int k)
+{
+  unsigned long long c = 1;
+  unsigned int i;
+
+  if (k > n)
+    return 0;
+  for (i = 1; i <= k; i++)
+    c = c * (n - k + i) / i;
+  return c;
+}
+
+static inline unsigned int
+failure_sweep_bin (double p)
+{
+  unsigned int bin;
+
+  if (p >= 1.0 - FAILURE_SWEEP_EPSILON)
+    return FAILURE_SWEEP_BINS - 1;
+  bin = (unsigned int) (p * (FAILURE_SWEEP_BINS - 1));
+  return (bin < FAILURE_SWEEP_BINS - 1 ? bin : FAILURE_SWEEP_BINS - 2);
+}
+
+/* the routing DAG of every destination, without failure */
+static void
+failure_sweep_prepare (struct failure_sweep *fs)
+{
+  struct route_flat *flat = fs->flat;
+  struct route_dag *dag;
+  unsigned int n = fs->nnodes;
+  unsigned int t, u, v, i, j, begin, end, nentries;
+  unsigned long *usage;
+  double sum, *base;
+
+  dag = route_dag_create (fs->routing, ROUTE_DAG_ORDER_ONLY);
+  for (t = 0; t < n; t++)
+    {
+      route_dag_compute (dag, t);
+
+      memcpy (&fs->order[(size_t) t * n], dag->order,
+              dag->norder * sizeof (unsigned int));
+      fs->norder[t] = dag->norder;
+      memcpy (&fs->pred_offset[(size_t) t * (n + 1)], dag->pred_offset,
+              (n + 1) * sizeof (unsigned int));
+      nentries = ROUTE_FLAT_BEGIN (flat, 0, t + 1) - dag->base;
+      memcpy (&fs->pred[dag->base], dag->pred,
+              nentries * sizeof (unsigned int));
+
+      usage = &fs->usage[(size_t) t * fs->usage_words];
+      for (u = 0; u < n; u++)
+        {
+          if (u == t)
+            continue;
+          begin = ROUTE_FLAT_BEGIN (flat, u, t);
+          end = ROUTE_FLAT_END (flat, u, t);
+          sum = 0.0;
+          for (j = begin; j < end; j++)
+            sum += flat->ratio[j];
+          for (j = begin; j < end; j++)
+            {
+              fs->ratio[j] = (sum > 0.0 ? flat->ratio[j] / sum
+                                        : 1.0 / (end - begin));
+              if (! fs->links)
+                BITSET_SET (usage, flat->nexthop[j]);
+              else if (fs->linkpos[j] != UINT_MAX)
+                BITSET_SET (usage, fs->linkpos[j]);
+            }
+        }
+
+      /* the probabilities without failure, t first */
+      base = &fs->base[(size_t) t * n];
+      for (i = 0; i < fs->norder[t]; i++)
+        {
+          u = fs->order[(size_t) t * n + i];
+          if (u == t)
+            {
+              base[u] = 1.0;
+              continue;
+            }
+          for (j = ROUTE_FLAT_BEGIN (flat, u, t);
+               j < ROUTE_FLAT_END (flat, u, t); j++)
+            {
+              v = flat->nexthop[j];
+              base[u] += fs->ratio[j] * base[v];
+            }
+        }
+      for (u = 0; u < n; u++)
+        if (u != t)
+          fs->base_hist[t * FAILURE_SWEEP_BINS +
+                        failure_sweep_bin (base[u])]++;
+    }
+  route_dag_delete (dag);
+}
+
+static struct failure_sweep *
+failure_sweep_create (struct routing *routing, unsigned int k, int links)
+{
+  struct failure_sweep *fs;
+  struct route_flat *flat;
+  struct graph_csr *csr;
+  unsigned int n, ncsr, nbits, u, v, i, pos, inverse;
+
+  fs = (struct failure_sweep *) malloc (sizeof (struct failure_sweep));
+  memset (fs, 0, sizeof (struct failure_sweep));
+  fs->routing = routing;
+  fs->flat = flat = route_freeze (routing);
+  fs->csr = csr = graph_freeze (routing->G);
+  fs->nnodes = n = flat->nnodes;
+  fs->k = k;
+  fs->links = links;
+
+  ncsr = csr->ooffset[csr->nnodes];
+  fs->link_from = (unsigned int *) calloc (ncsr + 1, sizeof (unsigned int));
+  for (u = 0; u < csr->nnodes; u++)
+    for (pos = csr->ooffset[u]; pos < csr->ooffset[u + 1]; pos++)
+      fs->link_from[pos] = u;
+
+  fs->linkpos = route_flat_linkpos (flat, csr);
+
+  if (! links)
+    fs->nelements = n;
+  else
+    {
+      /* a link and its inverse fail together */
+      fs->element = (unsigned int *)
+        calloc (2 * ncsr + 2, sizeof (unsigned int));
+      for (pos = 0; pos < ncsr; pos++)
+        {
+          u = fs->link_from[pos];
+          v = csr->otarget[pos];
+          inverse = UINT_MAX;
+          for (i = csr->ooffset[v]; i < csr->ooffset[v + 1]; i++)
+            if (csr->otarget[i] == u)
+              inverse = i;
+          if (inverse != UINT_MAX && inverse < pos)
+            continue;
+          fs->element[2 * fs->nelements] = pos;
+          fs->element[2 * fs->nelements + 1] = inverse;
+          fs->nelements++;
+        }
+    }
+
+  fs->order = (unsigned int *)
+    calloc ((size_t) n * n + 1, sizeof (unsigned int));
+  fs->norder = (unsigned int *) calloc (n + 1, sizeof (unsigned int));
+  fs->pred_offset = (unsigned int *)
+    calloc ((size_t) n * (n + 1) + 1, sizeof (unsigned int));
+  fs->pred = (unsigned int *)
+    calloc (flat->offset[n * n] + 1, sizeof (unsigned int));
+  fs->ratio = (double *) calloc (flat->offset[n * n] + 1, sizeof (double));
+  fs->base = (double *) calloc ((size_t) n * n + 1, sizeof (double));
+  fs->base_hist = (unsigned int *)
+    calloc ((size_t) n * FAILURE_SWEEP_BINS + 1, sizeof (unsigned int));
+  nbits = (links ? ncsr : n);
+  fs->usage_words = BITSET_NWORDS (nbits);
+  fs->usage = (unsigned long *)
+    calloc ((size_t) n * fs->usage_words + 1, sizeof (unsigned long));
+
+  failure_sweep_prepare (fs);
+
+  fs->offset = (unsigned long long *)
+    calloc (fs->nelements + 1, sizeof (unsigned long long));
+  for (i = 0; i < fs->nelements; i++)
+    fs->offset[i + 1] = fs->offset[i] +
+      failure_sweep_binomial (fs->nelements - 1 - i, k - 1);
+  fs->ncombinations = fs->offset[fs->nelements];
+
+  return fs;
+}
+
+static void
+failure_sweep_delete (struct failure_sweep *fs)
+{
+  free (fs->link_from);
+  free (fs->linkpos);
+  if (fs->element)
+    free (fs->element);
+  free (fs->order);
+  free (fs->norder);
+  free (fs->pred_offset);
+  free (fs->pred);
+  free (fs->ratio);
+  free (fs->base);
+  free (fs->base_hist);
+  free (fs->usage);
+  free (fs->offset);
+  if (fs->result)
+    free (fs->result);
+  free (fs);
+}
+
+/* the pairs toward t under the failures of the worker */
+static void
+failure_sweep_destination (struct failure_sweep *fs,
+                           struct failure_sweep_worker *w, unsigned int t,
+                           struct failure_sweep_result *result)
+{
+  struct route_flat *flat = fs->flat;
+  unsigned int n = fs->nnodes;
+  unsigned int *pred_offset = &fs->pred_offset[(size_t) t * (n + 1)];
+  unsigned int *pred = &fs->pred[ROUTE_FLAT_BEGIN (flat, 0, t)];
+  unsigned long *usage = &fs->usage[(size_t) t * fs->usage_words];
+  double *base = &fs->base[(size_t) t * n];
+  unsigned int c, e, f, u, v, i, j, nstack, bin;
+  int touched;
+  double p, pv;
+
+  if (! fs->links && BITSET_ISSET (w->failed, t))
+    {
+      result->stdown += n - 1;
+      return;
+    }
+
+  for (bin = 0; bin < FAILURE_SWEEP_BINS; bin++)
+    result->hist[bin] += fs->base_hist[t * FAILURE_SWEEP_BINS + bin];
+
+  w->generation++;
+  nstack = 0;
+  touched = 0;
+
+  /* the failed sources, and the nodes that forward into a failure */
+  for (c = 0; c < fs->k; c++)
+    {
+      e = w->combination[c];
+      if (! fs->links)
+        {
+          result->stdown++;
+          result->hist[failure_sweep_bin (base[e])]--;
+          if (! BITSET_ISSET (usage, e))
+            continue;
+          touched++;
+          for (i = pred_offset[e]; i < pred_offset[e + 1]; i++)
+            if (w->mark[pred[i]] != w->generation)
+              {
+                w->mark[pred[i]] = w->generation;
+                w->stack[nstack++] = pred[i];
+              }
+        }
+      else
+        for (i = 0; i < 2; i++)
+          {
+            f = fs->element[2 * e + i];
+            if (f == UINT_MAX || ! BITSET_ISSET (usage, f))
+              continue;
+            touched++;
+            u = fs->link_from[f];
+            if (u != t && w->mark[u] != w->generation)
+              {
+                w->mark[u] = w->generation;
+                w->stack[nstack++] = u;
+              }
+          }
+    }
+
+  if (! touched)
+    {
+      w->pruned++;
+      return;
+    }
+  w->computed++;
+
+  /* and all the nodes that forward to those */
+  while (nstack)
+    {
+      u = w->stack[--nstack];
+      for (i = pred_offset[u]; i < pred_offset[u + 1]; i++)
+        if (w->mark[pred[i]] != w->generation)
+          {
+            w->mark[pred[i]] = w->generation;
+            w->stack[nstack++] = pred[i];
+          }
+    }
+
+  /* recompute those, in the topological order of the DAG */
+  for (i = 0; i < fs->norder[t]; i++)
+    {
+      u = fs->order[(size_t) t * n + i];
+      if (w->mark[u] != w->generation)
+        continue;
+      if (BITSET_ISSET (w->failed, u))
+        {
+          w->p[u] = 0.0;
+          continue;
+        }
+
+      p = 0.0;
+      for (j = ROUTE_FLAT_BEGIN (flat, u, t); j < ROUTE_FLAT_END (flat, u, t);
+           j++)
+        {
+          if (fs->links && fs->linkpos[j] != UINT_MAX &&
+              BITSET_ISSET (w->failed_link, fs->linkpos[j]))
+            continue;
+          v = flat->nexthop[j];
+          if (BITSET_ISSET (w->failed, v))
+            pv = 0.0;
+          else if (w->mark[v] == w->generation)
+            pv = w->p[v];
+          else
+            pv = base[v];
+          p += fs->ratio[j] * pv;
+        }
+      w->p[u] = p;
+
+      result->hist[failure_sweep_bin (base[u])]--;
+      result->hist[failure_sweep_bin (p)]++;
+      if (p < base[u] - FAILURE_SWEEP_EPSILON)
+        result->affected++;
+    }
+}
+
+static void
+failure_sweep_evaluate (struct failure_sweep *fs,
+                        struct failure_sweep_worker *w,
+                        unsigned long long rank)
+{
+  struct failure_sweep_result *result = &fs->result[rank];
+  unsigned int c, e, t;
+
+  for (c = 0; c < fs->k; c++)
+    {
+      e = w->combination[c];
+      if (! fs->links)
+        BITSET_SET (w->failed, e);
+      else
+        {
+          BITSET_SET (w->failed_link, fs->element[2 * e]);
+          if (fs->element[2 * e + 1] != UINT_MAX)
+            BITSET_SET (w->failed_link, fs->element[2 * e + 1]);
+        }
+    }
+
+  for (t = 0; t < fs->nnodes; t++)
+    failure_sweep_destination (fs, w, t, result);
+
+  for (c = 0; c < fs->k; c++)
+    {
+      e = w->combination[c];
+      if (! fs->links)
+        BITSET_CLR (w->failed, e);
+      else
+        {
+          BITSET_CLR (w->failed_link, fs->element[2 * e]);
+          if (fs->element[2 * e + 1] != UINT_MAX)
+            BITSET_CLR (w->failed_link, fs->element[2 * e + 1]);
+        }
+    }
+}
+
+/* all the combinations whose smallest element is first, in the
+   lexicographic order, which is also the order of their rank. */
+static void
+failure_sweep_first (void *arg, unsigned int first, unsigned int worker)
+{
+  struct failure_sweep *fs = (struct failure_sweep *) arg;
+  struct failure_sweep_worker *w = &fs->workers[worker];
+  unsigned int *c = w->combination;
+  unsigned int k = fs->k, n = fs->nelements;
+  unsigned long long rank;
+  int i, j;
+
+  if (fs->offset[first] == fs->offset[first + 1])
+    return;
+
+  for (i = 0; i < (int) k; i++)
+    c[i] = first + i;
+
+  for (rank = fs->offset[first]; ; rank++)
+    {
+      failure_sweep_evaluate (fs, w, rank);
+
+      for (i = k - 1; i >= 1 && c[i] == n - k + i; i--)
+        ;
+      if (i < 1)
+        break;
+      c[i]++;
+      for (j = i + 1; j < (int) k; j++)
+        c[j] = c[j - 1] + 1;
+    }
+}
+
+static void
+failure_sweep_print_element (FILE *terminal, struct failure_sweep *fs,
+                             unsigned int e)
+{
+  unsigned int pos;
+
+  if (! fs->links)
+    fprintf (terminal, " %u", e);
+  else
+    {
+      pos = fs->element[2 * e];
+      fprintf (terminal, " %u-%u", fs->link_from[pos],
+               fs->csr->otarget[pos]);
+    }
+}
+
+DEFINE_COMMAND (simulate_failure_sweep_nodes,
+                "simulate failure-sweep routing <0-4294967295> failure-nodes <1-3>",
+                "simulate\n"
+                "simulate all the combinations of failures\n"
+                "specify routing\n"
+                "specify routing ID\n"
+                "specify number of failure nodes\n"
+                "specify number of failure nodes\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing;
+  struct failure_sweep *fs;
+  struct failure_sweep_worker *w;
+  struct failure_sweep_result *result;
+  unsigned int k, nthreads = 1, i, j, bin, npairs;
+  unsigned long long rank, stdown, affected, computed, pruned, sum;
+  unsigned long long total[FAILURE_SWEEP_BINS];
+  unsigned int c[3];
+  int links, l;
+  timer_counter_t start, end, res;
+
+  routing = (struct routing *) instance_lookup ("routing", argv[3]);
+  if (! routing)
+    {
+      fprintf (shell->terminal, "No such routing instance: %s\n", argv[3]);
+      return;
+    }
+  if (routing->route == NULL && routing->flat == NULL)
+    {
+      fprintf (shell->terminal, "no route calculated for routing-%s.\n",
+               routing->name);
+      return;
+    }
+
+  links = ! strcmp (argv[4], "failure-links");
+  k = strtoul (argv[5], NULL, 0);
+  if (argc > 7)
+    nthreads = strtoul (argv[7], NULL, 0);
+
+  timer_count (start);
+
+  /* the flat table, the CSR and the DAGs are built before the workers */
+  fs = failure_sweep_create (routing, k, links);
+  if (fs->ncombinations == 0 ||
+      fs->ncombinations > FAILURE_SWEEP_MAX_COMBINATIONS)
+    {
+      fprintf (shell->terminal, "cannot sweep %llu combinations "
+               "of %u failure %s\n", fs->ncombinations, k,
+               (links ? "links" : "nodes"));
+      failure_sweep_delete (fs);
+      return;
+    }
+
+  fs->result = (struct failure_sweep_result *)
+    calloc (fs->ncombinations, sizeof (struct failure_sweep_result));
+
+  if (nthreads > fs->nelements)
+    nthreads = fs->nelements;
+  fs->workers = (struct failure_sweep_worker *)
+    calloc (nthreads, sizeof (struct failure_sweep_worker));
+  for (i = 0; i < nthreads; i++)
+    {
+      w = &fs->workers[i];
+      w->failed = bitset_create (fs->nnodes);
+      w->failed_link = bitset_create (fs->csr->ooffset[fs->csr->nnodes]);
+      w->combination = (unsigned int *) calloc (k, sizeof (unsigned int));
+      w->p = (double *) calloc (fs->nnodes, sizeof (double));
+      w->mark = (unsigned int *) calloc (fs->nnodes, sizeof (unsigned int));
+      w->stack = (unsigned int *) calloc (fs->nnodes, sizeof (unsigned int));
+    }
+
+  workqueue_run (nthreads, fs->nelements, failure_sweep_first, fs);
+
+  timer_count (end);
+  timer_sub (start, end, res);
+
+  /* the combinations in the order of their rank */
+  npairs = fs->nnodes * (fs->nnodes - 1);
+  memset (total, 0, sizeof (total));
+  stdown = affected = 0;
+  for (i = 0; i < k; i++)
+    c[i] = i;
+  for (rank = 0; rank < fs->ncombinations; rank++)
+    {
+      result = &fs->result[rank];
+
+      fprintf (shell->terminal, "routing-%s failure", routing->name);
+      for (i = 0; i < k; i++)
+        failure_sweep_print_element (shell->terminal, fs, c[i]);
+      fprintf (shell->terminal, " stdown %u affected %u hist:",
+               result->stdown, result->affected);
+      for (bin = 0; bin < FAILURE_SWEEP_BINS; bin++)
+        {
+          fprintf (shell->terminal, " %u", result->hist[bin]);
+          total[bin] += result->hist[bin];
+        }
+      fprintf (shell->terminal, " all-success %f\n",
+               (npairs > result->stdown ?
+                (double) result->hist[FAILURE_SWEEP_BINS - 1] /
+                (npairs - result->stdown) : 0.0));
+      stdown += result->stdown;
+      affected += result->affected;
+
+      for (l = k - 1; l >= 1 && c[l] == fs->nelements - k + l; l--)
+        ;
+      if (l < 1)
+        {
+          c[0]++;
+          for (j = 1; j < k; j++)
+            c[j] = c[j - 1] + 1;
+        }
+      else
+        {
+          c[l]++;
+          for (j = l + 1; j < k; j++)
+            c[j] = c[j - 1] + 1;
+        }
+    }
+
+  computed = pruned = 0;
+  for (i = 0; i < nthreads; i++)
+    {
+      computed += fs->workers[i].computed;
+      pruned += fs->workers[i].pruned;
+    }
+
+  fprintf (shell->terminal, "routing-%s failure-sweep %u %s: "
+           "%llu combinations stdown %llu affected %llu hist:",
+           routing->name, k, (links ? "links" : "nodes"),
+           fs->ncombinations, stdown, affected);
+  sum = 0;
+  for (bin = 0; bin < FAILURE_SWEEP_BINS; bin++)
+    {
+      fprintf (shell->terminal, " %llu", total[bin]);
+      sum += total[bin];
+    }
+  fprintf (shell->terminal, " all-success %f\n",
+           (sum ? (double) total[FAILURE_SWEEP_BINS - 1] / sum : 0.0));
+  fprintf (shell->terminal, "destination passes: %llu recomputed, "
+           "%llu pruned\n", computed, pruned);
+  fprintf (shell->terminal, "failure-sweep time: %llu us\n",
+           timer_to_usec (res));
+
+  for (i = 0; i < nthreads; i++)
+    {
+      w = &fs->workers[i];
+      bitset_delete (w->failed);
+      bitset_delete (w->failed_link);
+      free (w->combination);
+      free (w->p);
+      free (w->mark);
+      free (w->stack);
+    }
+  free (fs->workers);
+  failure_sweep_delete (fs);
+}
+
+ALIAS_COMMAND (simulate_failure_sweep_nodes_threads,
+               simulate_failure_sweep_nodes,
+               "simulate failure-sweep routing <0-4294967295> failure-nodes <1-3> threads <1-1024>",
+               "simulate\n"
+               "simulate all the combinations of failures\n"
+               "specify routing\n"
+               "specify routing ID\n"
+               "specify number of failure nodes\n"
+               "specify number of failure nodes\n"
+               "calculate in multiple threads\n"
+               "specify number of threads\n")
+
+ALIAS_COMMAND (simulate_failure_sweep_links,
+               simulate_failure_sweep_nodes,
+               "simulate failure-sweep routing <0-4294967295> failure-links <1-3>",
+               "simulate\n"
+               "simulate all the combinations of failures\n"
+               "specify routing\n"
+               "specify routing ID\n"
+               "specify number of failure links (both directions)\n"
+               "specify number of failure links\n")
+
+ALIAS_COMMAND (simulate_failure_sweep_links_threads,
+               simulate_failure_sweep_nodes,
+               "simulate failure-sweep routing <0-4294967295> failure-links <1-3> threads <1-1024>",
+               "simulate\n"
+               "simulate all the combinations of failures\n"
+               "specify routing\n"
+               "specify routing ID\n"
+               "specify number of failure links (both directions)\n"
+               "specify number of failure links\n"
+               "calculate in multiple threads\n"
+               "specify number of threads\n")
+
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _FAILURE_SWEEP_H_
+#define _FAILURE_SWEEP_H_
+
+/* exhaustive k-failure sweep: every combination of k failure nodes
+   (or k failure links, both directions of each) is evaluated, and for
+   each pair the exact probability that a packet forwarded by the
+   nexthop ratios reaches the destination without meeting a failure
+   is computed over the routing DAG of the destination.
+
+   the per-destination routing DAGs do not depend on the failures, and
+   are kept: their topological order, the nodes that forward to each
+   node, and the failure-free probabilities.  a combination changes
+   the probability of a pair only if the failures are on the DAG of
+   the destination (a usage bitset tells), and only for the nodes that
+   forward into a failure, so only those are recomputed. */
+
+#define FAILURE_SWEEP_BINS 11     /* [0.0-0.1) ... [0.9-1.0), 1.0 */
+#define FAILURE_SWEEP_EPSILON 1e-9
+
+struct failure_sweep_result
+{
+  unsigned int stdown;          /* pairs whose s or t failed */
+  unsigned int affected;        /* pairs with lower probability */
+  unsigned int hist[FAILURE_SWEEP_BINS];
+};
+
+struct failure_sweep_worker
+{
+  unsigned long *failed;        /* failure nodes */
+  unsigned long *failed_link;   /* failure links, by CSR position */
+  unsigned int *combination;    /* the k elements */
+  double *p;                    /* probability of the recomputed nodes */
+  unsigned int *mark;           /* recomputed if equal to generation */
+  unsigned int generation;
+  unsigned int *stack;
+  unsigned long long computed;  /* destination passes recomputed */
+  unsigned long long pruned;    /* destination passes skipped */
+};
+
+struct failure_sweep
+{
+  struct routing *routing;
+  struct route_flat *flat;
+  struct graph_csr *csr;
+  unsigned int nnodes;
+  unsigned int k;
+  int links;                    /* links fail instead of nodes */
+
+  /* the failure elements: the nodes, or the links as CSR positions
+     of the two directions (the second is UINT_MAX if none) */
+  unsigned int nelements;
+  unsigned int *element;        /* links only: [2 * element] */
+  unsigned int *link_from;      /* source node by CSR position */
+  unsigned int *linkpos;        /* CSR position by flat position */
+
+  /* by destination */
+  unsigned int *order;          /* [t * nnodes + i] */
+  unsigned int *norder;
+  unsigned int *pred_offset;    /* [t * (nnodes + 1) + u] */
+  unsigned int *pred;           /* by flat position */
+  double *ratio;                /* by flat position, normalized */
+  double *base;                 /* [t * nnodes + s], without failure */
+  unsigned int *base_hist;      /* [t * BINS + bin] */
+  unsigned int usage_words;
+  unsigned long *usage;         /* transit nodes or links toward t */
+
+  /* combinations with the first element i start at offset[i] */
+  unsigned long long *offset;
+  unsigned long long ncombinations;
+  struct failure_sweep_result *result;
+
+  struct failure_sweep_worker *workers;
+};
+
+EXTERN_COMMAND (simulate_failure_sweep_nodes);
+EXTERN_COMMAND (simulate_failure_sweep_nodes_threads);
+EXTERN_COMMAND (simulate_failure_sweep_links);
+EXTERN_COMMAND (simulate_failure_sweep_links_threads);
+
+#endif /*_FAILURE_SWEEP_H_*/
+
@@ -54,16 +54,18 @@ packet_forward_with_fail (struct node *s, struct node *t, struct routing *R,
   struct vector *router_mask;
   struct path *path;
   unsigned long mask;
-  struct nexthop *nexthop;
+  struct route_flat *flat;
+  unsigned int begin, size, index;
   int i;
   struct node *node;
-  struct vector *table;
   char buf[256];
 
   seed = time (NULL);
   fprintf (stderr, "seed: %lu\n", (unsigned long) seed);
   srandom ((unsigned int) seed);
 
+  flat = route_freeze (R);
+
   router_mask = vector_create ();
   for (i = 0; i < graph_nodes (s->g); i++)
     {
@@ -82,17 +84,17 @@ packet_forward_with_fail (struct node *s, struct node *t, struct routing *R,
       while (node->id != t->id)
         {
           vector_add (node, path->path);
-          table = R->route[node->id][t->id].nexthops;
+          begin = ROUTE_FLAT_BEGIN (flat, node->id, t->id);
+          size = ROUTE_FLAT_SIZE (flat, node->id, t->id);
           mask = (unsigned long) vector_get (router_mask, node->id);
-          nexthop = vector_get (table, (nbits (flowlabel & mask) % table->size));
+          index = nbits (flowlabel & mask) % size;
           fprintf (stderr, "node %d: flowlabel %#lx, mask %#lx,"
                            " value: %#lx, bits: %d"
                            " #nexthop %d, index %d, nexthop %d\n", 
                    node->id, flowlabel, mask,
                    flowlabel & mask, nbits (flowlabel & mask),
-                   table->size, (nbits (flowlabel & mask) % table->size),
-                   nexthop->node->id);
-          node = nexthop->node;
+                   size, index, flat->nexthop[begin + index]);
+          node = node_lookup (flat->nexthop[begin + index], R->G);
         }
 
       sprint_nodelist (buf, sizeof (buf), path->path);
@@ -21,8 +21,35 @@
 #include <includes.h>
 
 #include "vector.h"
+#include "hash.h"
 #include "graph.h"
 
+static void
+node_index_add (struct node *v, struct graph *g)
+{
+  if (v->name)
+    hash_add (hash_string (v->name), v, g->node_index);
+}
+
+static void
+node_index_remove (struct node *v, struct graph *g)
+{
+  if (v->name)
+    hash_remove (hash_string (v->name), v, g->node_index);
+}
+
+static void
+link_index_add (struct link *e, struct graph *g)
+{
+  hash_add (hash_pointer_pair (e->from, e->to), e, g->link_index);
+}
+
+static void
+link_index_remove (struct link *e, struct graph *g)
+{
+  hash_remove (hash_pointer_pair (e->from, e->to), e, g->link_index);
+}
+
 struct node *
 node_create (unsigned int id, struct graph *g)
 {
@@ -43,13 +70,18 @@ void
 node_delete (struct node *v)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
+
+  if (vector_get (v->g->nodes, v->id) == v)
+    node_index_remove (v, v->g);
 
   if (v->name)
     free (v->name);
   if (v->domain_name)
     free (v->domain_name);
 
-  for (vn = vector_head (v->olinks); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (v->olinks, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct link *e = (struct link *) vn->data;
       if (e)
@@ -57,7 +89,8 @@ node_delete (struct node *v)
     }
   vector_delete (v->olinks);
 
-  for (vn = vector_head (v->ilinks); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (v->ilinks, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct link *e = (struct link *) vn->data;
       if (e)
@@ -73,9 +106,13 @@ node_add (struct node *v, struct graph *g)
 {
   struct node *exist;
   exist = vector_get (g->nodes, v->id);
-  if (exist && exist != v)
+  if (exist == v)
+    return;
+  if (exist)
     node_delete (exist);
   vector_set (g->nodes, v->id, v);
+  node_index_add (v, g);
+  graph_thaw (g);
 }
 
 void
@@ -83,7 +120,11 @@ node_remove (struct node *v, struct graph *g)
 {
   assert (v->g == g);
   if (vector_get (g->nodes, v->id) == v)
-    vector_set (g->nodes, v->id, NULL);
+    {
+      node_index_remove (v, g);
+      vector_set (g->nodes, v->id, NULL);
+    }
+  graph_thaw (g);
 }
 
 struct node *
@@ -92,20 +133,39 @@ node_lookup (unsigned int id, struct graph *g)
   return (struct node *) vector_get (g->nodes, id);
 }
 
+/* the one with the largest id if the name is not unique */
 struct node *
 node_lookup_by_name (char *name, struct graph *g)
 {
-  struct vector_node *vn;
+  struct hash_entry *e;
   struct node *node, *match = NULL;
-  for (vn = vector_head (g->nodes); vn; vn = vector_next (vn))
+  unsigned int key;
+
+  key = hash_string (name);
+  for (e = hash_head (key, g->node_index); e; e = e->next)
     {
-      node = (struct node *) vector_data (vn);
-      if (! strcmp (name, node->name))
+      node = (struct node *) e->data;
+      if (e->key == key && ! strcmp (name, node->name) &&
+          (match == NULL || match->id < node->id))
         match = node;
     }
   return match;
 }
 
+void
+node_set_name (struct node *v, char *name)
+{
+  int indexed = (vector_get (v->g->nodes, v->id) == v);
+
+  if (indexed)
+    node_index_remove (v, v->g);
+  if (v->name)
+    free (v->name);
+  v->name = (name ? strdup (name) : NULL);
+  if (indexed)
+    node_index_add (v, v->g);
+}
+
 struct link *
 link_create (unsigned int id, struct graph *g)
 {
@@ -125,6 +185,8 @@ link_delete (struct link *e)
 {
   link_remove (e, e->g);
 
+  if (e->from && e->to)
+    link_index_remove (e, e->g);
   if (e->from)
     vector_remove (e, e->from->olinks);
   if (e->to)
@@ -148,6 +210,7 @@ link_add (struct link *e, struct graph *g)
   if (exist && exist != e)
     link_delete (exist);
   vector_set (g->links, e->id, e);
+  graph_thaw (g);
 }
 
 void
@@ -160,13 +223,14 @@ link_remove (struct link *e, struct graph *g)
     vector_set (g->links, e->id, NULL);
 #else
   assert (vector_get (g->links, e->id) == e);
-  vector_remove (e, g->links);
+  vector_remove_index (e->id, g->links);
   for (i = e->id; i < g->links->size; i++)
     {
       struct link *link = vector_get (g->links, i);
       link->id = i;
     }
 #endif
+  graph_thaw (g);
 }
 
 struct graph *
@@ -178,10 +242,14 @@ graph_create ()
   memset (g, 0, sizeof (struct graph));
 
   g->name = strdup ("simrouting");
+  g->version = graph_version_next ();
   g->nodes = vector_create ();
   g->links = vector_create ();
 
   g->config = vector_create ();
+
+  g->node_index = hash_create ();
+  g->link_index = hash_create ();
   return g;
 }
 
@@ -189,22 +257,30 @@ void
 graph_clear (struct graph *G)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct link *link;
   struct node *node;
+  int i;
 
-  for (vn = vector_head (G->links); vn; vn = vector_next (vn))
+  /* from the tail, so that link_remove () renumbers nothing */
+  for (i = (int) G->links->size - 1; i >= 0; i--)
     {
-      link = (struct link *) vn->data;
+      link = (struct link *) vector_get (G->links, i);
       if (link)
         link_delete (link);
     }
 
-  for (vn = vector_head (G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
       if (node)
         node_delete (node);
     }
+
+  hash_clear (G->node_index);
+  hash_clear (G->link_index);
+  graph_thaw (G);
 }
 
 void
@@ -214,6 +290,8 @@ graph_delete (struct graph *g)
 
   vector_delete (g->nodes);
   vector_delete (g->links);
+  hash_delete (g->node_index);
+  hash_delete (g->link_index);
 
   command_config_clear (g->config);
   vector_delete (g->config);
@@ -273,12 +351,15 @@ link_lookup_by_id (unsigned int id, struct graph *g)
   return (struct link *) vector_get (g->links, id);
 }
 
-struct link *
-link_lookup (struct node *s, struct node *t, struct graph *g)
+/* the last one in s->olinks if there are parallel links */
+static struct link *
+link_lookup_olinks (struct node *s, struct node *t)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct link *e, *match = NULL;
-  for (vn = vector_head (s->olinks); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (s->olinks, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       e = (struct link *) vn->data;
       if (e && e->to == t)
@@ -287,6 +368,26 @@ link_lookup (struct node *s, struct node *t, struct graph *g)
   return match;
 }
 
+struct link *
+link_lookup (struct node *s, struct node *t, struct graph *g)
+{
+  struct hash_entry *he;
+  struct link *e, *match = NULL;
+  unsigned int key;
+
+  key = hash_pointer_pair (s, t);
+  for (he = hash_head (key, s->g->link_index); he; he = he->next)
+    {
+      e = (struct link *) he->data;
+      if (he->key != key || e->from != s || e->to != t)
+        continue;
+      if (match)
+        return link_lookup_olinks (s, t);
+      match = e;
+    }
+  return match;
+}
+
 struct link *
 link_lookup_by_node_id (unsigned int source, unsigned int sink, struct graph *g)
 {
@@ -320,8 +421,10 @@ link_connect (struct link *e, struct node *s, struct node *t, struct graph *g)
 
   e->from = s;
   e->to = t;
-  vector_add (e, s->olinks);
-  vector_add (e, t->ilinks);
+  vector_add_allow_dup (e, s->olinks);
+  vector_add_allow_dup (e, t->ilinks);
+  link_index_add (e, e->g);
+  graph_thaw (g);
 
   inverse = link_lookup (t, s, g);
   if (inverse && e != inverse)
@@ -361,6 +464,34 @@ link_set (struct node *s, struct node *t, struct graph *g)
   link_connect (e, s, t, g);
 }
 
+/* for the bulk construction by the importers: create the link s->t
+   with the id next to the last one, instead of looking for a hole in
+   the link ids (vector_empty_index () is a linear scan). the ids are
+   the same as link_get () would give unless the link ids have holes. */
+struct link *
+link_append (struct node *s, struct node *t, struct graph *g)
+{
+  struct link *e;
+
+  e = link_lookup (s, t, g);
+  if (e)
+    return e;
+
+  e = link_create (g->links->size, g);
+  link_add (e, g);
+  link_connect (e, s, t, g);
+
+  return e;
+}
+
+/* reserve the node/link vectors for nnodes/nlinks more entries. */
+void
+graph_reserve (struct graph *G, unsigned int nnodes, unsigned int nlinks)
+{
+  vector_reserve (G->nodes, G->nodes->size + nnodes);
+  vector_reserve (G->links, G->links->size + nlinks);
+}
+
 struct link *
 link_get_by_node_id (unsigned int source, unsigned int sink, struct graph *g)
 {
@@ -386,9 +517,11 @@ int
 graph_nodes (struct graph *G)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct node *v;
   int nnodes = 0;
-  for (vn = vector_head (G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       v = (struct node *) vn->data;
       if (v == NULL)
@@ -402,9 +535,11 @@ int
 graph_edges (struct graph *G)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct link *e;
   int nedges = 0;
-  for (vn = vector_head (G->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (G->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       e = (struct link *) vn->data;
       if (e == NULL)
@@ -428,7 +563,7 @@ node_copy_create (struct node *node, struct graph *g)
   copy->addr = node->addr;
   copy->plen = node->plen;
 
-  STRDUP_REPLACE (copy->name, node->name);
+  node_set_name (copy, node->name);
   STRDUP_REPLACE (copy->domain_name, node->domain_name);
   STRDUP_REPLACE (copy->descr, node->descr);
 
@@ -470,12 +605,14 @@ graph_copy_create (struct graph *G)
 {
   struct graph *copy;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct node *node;
   struct link *link;
 
   copy = graph_create ();
 
-  for (vn = vector_head (G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
       if (! node)
@@ -483,7 +620,8 @@ graph_copy_create (struct graph *G)
       node_copy_create (node, copy);
     }
 
-  for (vn = vector_head (G->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (G->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       link = (struct link *) vn->data;
       if (! link)
@@ -498,12 +636,14 @@ void
 graph_copy (struct graph *dst, struct graph *src)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct node *node;
   struct link *link;
 
   graph_clear (dst);
 
-  for (vn = vector_head (src->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (src->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
       if (! node)
@@ -511,7 +651,8 @@ graph_copy (struct graph *dst, struct graph *src)
       node_copy_create (node, dst);
     }
 
-  for (vn = vector_head (src->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (src->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       link = (struct link *) vn->data;
       if (! link)
@@ -520,15 +661,47 @@ graph_copy (struct graph *dst, struct graph *src)
     }
 }
 
+/* rebuild the indexes, for those who fill the node/link vectors
+   directly (snapshot). */
+void
+graph_reindex (struct graph *G)
+{
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  struct node *node;
+  struct link *link;
+
+  hash_clear (G->node_index);
+  hash_clear (G->link_index);
+
+  for (vn = vector_cursor_head (G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      node = (struct node *) vn->data;
+      if (node)
+        node_index_add (node, G);
+    }
+
+  for (vn = vector_cursor_head (G->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      link = (struct link *) vn->data;
+      if (link && link->from && link->to)
+        link_index_add (link, G);
+    }
+}
+
 void
 graph_pack_id (struct graph *G)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct node *node;
   struct link *link;
   unsigned int new_id;
 
-  for (vn = vector_head (G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
       if (! node)
@@ -542,7 +715,8 @@ graph_pack_id (struct graph *G)
       vector_set (G->nodes, node->id, node);
     }
 
-  for (vn = vector_head (G->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (G->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       link = (struct link *) vn->data;
       if (! link)
@@ -555,6 +729,8 @@ graph_pack_id (struct graph *G)
       link->id = new_id;
       vector_set (G->links, link->id, link);
     }
+
+  graph_thaw (G);
 }
 
 void
@@ -563,15 +739,18 @@ graph_print (struct graph *g)
   struct node *v;
   struct link *e;
   struct vector_node *vn, *vno;
+  struct vector_node vn_cursor, vno_cursor;
 
-  for (vn = vector_head (g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       v = (struct node *) vn->data;
       if (v == NULL)
         continue;
       printf ("node[%d]: ", v->id);
       printf ("neighbor: ");
-      for (vno = vector_head (v->olinks); vno; vno = vector_next (vno))
+      for (vno = vector_cursor_head (v->olinks, &vno_cursor); vno;
+           vno = vector_cursor_next (vno))
         {
           e = (struct link *) vno->data;
           printf (" %d", e->to->id);
@@ -580,7 +759,8 @@ graph_print (struct graph *g)
     }
 
   printf ("Graph Link:\n");
-  for (vn = vector_head (g->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       e = (struct link *) vn->data;
       if (e == NULL)
@@ -590,3 +770,127 @@ graph_print (struct graph *g)
     }
 }
 
+static void
+graph_csr_delete (struct graph_csr *csr)
+{
+  free (csr->node);
+  free (csr->ooffset);
+  free (csr->otarget);
+  free (csr->olink);
+  free (csr->obandwidth);
+  free (csr->ioffset);
+  free (csr->isource);
+  free (csr->ilink);
+  free (csr->ibandwidth);
+  free (csr);
+}
+
+/* build (or return the cached) CSR snapshot of the graph.
+   the snapshot stays valid until the next node_add (), node_remove (),
+   link_add (), link_remove (), link_connect () or graph_pack_id ()
+   on the graph, which drop it by graph_thaw (). */
+struct graph_csr *
+graph_freeze (struct graph *G)
+{
+  struct graph_csr *csr;
+  struct vector_node *vn, *vnl;
+  struct vector_node vn_cursor, vnl_cursor;
+  struct node *node;
+  struct link *link;
+  unsigned int i, o, n;
+
+  if (G->csr)
+    return G->csr;
+
+  csr = (struct graph_csr *) malloc (sizeof (struct graph_csr));
+  memset (csr, 0, sizeof (struct graph_csr));
+
+  csr->nnodes = G->nodes->size;
+  csr->node = (struct node **)
+    calloc (csr->nnodes + 1, sizeof (struct node *));
+  csr->ooffset = (unsigned int *)
+    calloc (csr->nnodes + 1, sizeof (unsigned int));
+  csr->ioffset = (unsigned int *)
+    calloc (csr->nnodes + 1, sizeof (unsigned int));
+
+  /* count the degrees */
+  for (vn = vector_cursor_head (G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      node = (struct node *) vn->data;
+      if (! node)
+        continue;
+      csr->node[node->id] = node;
+      csr->ooffset[node->id + 1] = node->olinks->size;
+      csr->ioffset[node->id + 1] = node->ilinks->size;
+    }
+  for (i = 0; i < csr->nnodes; i++)
+    {
+      csr->ooffset[i + 1] += csr->ooffset[i];
+      csr->ioffset[i + 1] += csr->ioffset[i];
+    }
+  csr->nlinks = csr->ooffset[csr->nnodes];
+  assert (csr->nlinks == csr->ioffset[csr->nnodes]);
+
+  n = (csr->nlinks ? csr->nlinks : 1);
+  csr->otarget = (unsigned int *) malloc (n * sizeof (unsigned int));
+  csr->olink = (unsigned int *) malloc (n * sizeof (unsigned int));
+  csr->obandwidth = (double *) malloc (n * sizeof (double));
+  csr->isource = (unsigned int *) malloc (n * sizeof (unsigned int));
+  csr->ilink = (unsigned int *) malloc (n * sizeof (unsigned int));
+  csr->ibandwidth = (double *) malloc (n * sizeof (double));
+
+  /* fill in the adjacency, in the same order as the vectors */
+  for (i = 0; i < csr->nnodes; i++)
+    {
+      node = csr->node[i];
+      if (! node)
+        continue;
+
+      o = csr->ooffset[i];
+      for (vnl = vector_cursor_head (node->olinks, &vnl_cursor); vnl;
+           vnl = vector_cursor_next (vnl))
+        {
+          link = (struct link *) vnl->data;
+          csr->otarget[o] = link->to->id;
+          csr->olink[o] = link->id;
+          csr->obandwidth[o] = link->bandwidth;
+          o++;
+        }
+
+      o = csr->ioffset[i];
+      for (vnl = vector_cursor_head (node->ilinks, &vnl_cursor); vnl;
+           vnl = vector_cursor_next (vnl))
+        {
+          link = (struct link *) vnl->data;
+          csr->isource[o] = link->from->id;
+          csr->ilink[o] = link->id;
+          csr->ibandwidth[o] = link->bandwidth;
+          o++;
+        }
+    }
+
+  G->csr = csr;
+  return csr;
+}
+
+/* the versions of the graphs and the weights are drawn from one
+   counter, so that a version is never reused by another instance. */
+static unsigned long graph_version_last = 0;
+
+unsigned long
+graph_version_next ()
+{
+  return ++graph_version_last;
+}
+
+/* drop the CSR snapshot; the next graph_freeze () rebuilds it. */
+void
+graph_thaw (struct graph *G)
+{
+  G->version = graph_version_next ();
+  if (G->csr == NULL)
+    return;
+  graph_csr_delete (G->csr);
+  G->csr = NULL;
+}
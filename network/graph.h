@@ -22,6 +22,7 @@
 #define _GRAPH_H_
 
 #include "vector.h"
+#include "hash.h"
 #include "command.h"
 
 struct node
@@ -74,6 +75,30 @@ struct link
   double probability;  /* routing probability */
 };
 
+/* immutable compressed sparse row (CSR) snapshot of a graph.
+   the adjacency of node id v is [offset[v], offset[v + 1]) in the
+   per-direction arrays, kept in the order of the olinks/ilinks vectors.
+   node and link ids are the same as in the graph, so the arrays can be
+   used with weight->weight[] and the per-node routing tables as is. */
+struct graph_csr
+{
+  unsigned int nnodes;      /* graph->nodes->size */
+  unsigned int nlinks;      /* number of connected links */
+  struct node **node;       /* node pointer by node id */
+
+  /* forward (outgoing) adjacency */
+  unsigned int *ooffset;    /* nnodes + 1 */
+  unsigned int *otarget;    /* link->to->id */
+  unsigned int *olink;      /* link->id */
+  double *obandwidth;       /* link->bandwidth */
+
+  /* reverse (incoming) adjacency */
+  unsigned int *ioffset;    /* nnodes + 1 */
+  unsigned int *isource;    /* link->from->id */
+  unsigned int *ilink;      /* link->id */
+  double *ibandwidth;       /* link->bandwidth */
+};
+
 struct graph
 {
   unsigned long id;
@@ -82,6 +107,20 @@ struct graph
   struct vector *links;
 
   struct vector *config;
+
+  /* CSR snapshot, built on demand by graph_freeze ().
+     NULL when the graph has been modified since. */
+  struct graph_csr *csr;
+
+  /* renewed at each modification (by graph_thaw ()), and unique over
+     the graphs and the weights: identifies the contents. */
+  unsigned long version;
+
+  /* indexes for node_lookup_by_name () and link_lookup ():
+     name -> node, kept by node_add ()/node_remove ()/node_set_name (),
+     (from, to) -> link, kept by link_connect ()/link_delete (). */
+  struct hash *node_index;
+  struct hash *link_index;
 };
 
 struct node *node_create (unsigned int id, struct graph *g);
@@ -90,6 +129,7 @@ void node_add (struct node *v, struct graph *g);
 void node_remove (struct node *v, struct graph *g);
 struct node *node_lookup (unsigned int id, struct graph *g);
 struct node *node_lookup_by_name (char *name, struct graph *g);
+void node_set_name (struct node *v, char *name);
 
 struct link *link_create (unsigned int id, struct graph *g);
 void link_delete (struct link *e);
@@ -99,6 +139,7 @@ void link_remove (struct link *e, struct graph *g);
 struct graph *graph_create ();
 void graph_clear (struct graph *G);
 void graph_delete (struct graph *g);
+void graph_reindex (struct graph *G);
 
 struct node *node_get (unsigned int id, struct graph *g);
 struct node *node_get_by_name (char *name, struct graph *g);
@@ -113,6 +154,8 @@ struct link *link_get (struct node *s, struct node *t, struct graph *g);
 struct link *link_get_by_node_id (unsigned int source, unsigned int sink, struct graph *g);
 void link_set (struct node *s, struct node *t, struct graph *g);
 void link_set_by_node_id (unsigned int source, unsigned int sink, struct graph *g);
+struct link *link_append (struct node *s, struct node *t, struct graph *g);
+void graph_reserve (struct graph *G, unsigned int nnodes, unsigned int nlinks);
 
 int graph_nodes (struct graph *G);
 int graph_edges (struct graph *G);
@@ -126,6 +169,10 @@ void graph_pack_id (struct graph *G);
 
 void graph_print (struct graph *g);
 
+struct graph_csr *graph_freeze (struct graph *G);
+void graph_thaw (struct graph *G);
+unsigned long graph_version_next ();
+
 #endif /*_GRAPH_H_*/
 
 
@@ -44,6 +44,7 @@
 
 #include "function/connectivity.h"
 #include "function/reliability.h"
+#include "function/reliability-mc.h"
 
 struct command_set *cmdset_graph;
 struct vector *graphs;
@@ -79,11 +80,13 @@ show_graph_instance (FILE *terminal, void *instance)
   struct node *v;
   struct link *e;
   struct vector_node *vn, *vno;
+  struct vector_node vn_cursor, vno_cursor;
 
   fprintf (terminal, "Graph %s (%lu):\n  %d nodes, %d edges\n\n",
            g->name, g->id, graph_nodes (g), graph_edges (g));
   fprintf (terminal, "nodes:\n");
-  for (vn = vector_head (g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       v = (struct node *) vn->data;
       if (v == NULL)
@@ -91,7 +94,8 @@ show_graph_instance (FILE *terminal, void *instance)
       fprintf (terminal, "  node[%d]: ", v->id);
       fprintf (terminal, "%-32s: ", v->name);
       fprintf (terminal, "neighbor: ");
-      for (vno = vector_head (v->olinks); vno; vno = vector_next (vno))
+      for (vno = vector_cursor_head (v->olinks, &vno_cursor); vno;
+           vno = vector_cursor_next (vno))
         {
           e = (struct link *) vno->data;
           fprintf (terminal, " %d", e->to->id);
@@ -100,7 +104,8 @@ show_graph_instance (FILE *terminal, void *instance)
     }
 
   fprintf (terminal, "positions:\n");
-  for (vn = vector_head (g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       v = (struct node *) vn->data;
       if (v == NULL)
@@ -110,7 +115,8 @@ show_graph_instance (FILE *terminal, void *instance)
     }
 
   fprintf (terminal, "domainnames:\n");
-  for (vn = vector_head (g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       v = (struct node *) vn->data;
       if (v == NULL)
@@ -120,7 +126,8 @@ show_graph_instance (FILE *terminal, void *instance)
     }
 
   fprintf (terminal, "links:\n");
-  for (vn = vector_head (g->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       e = (struct link *) vn->data;
       if (e == NULL)
@@ -156,9 +163,11 @@ void
 graph_save_config (struct graph *g)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   char buf[128];
 
-  for (vn = vector_head (g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *v = (struct node *) vn->data;
 
@@ -168,20 +177,20 @@ graph_save_config (struct graph *g)
       if (v->name)
         {
           snprintf (buf, sizeof (buf), "  node %d name %s", v->id, v->name);
-          vector_add (strdup (buf), g->config);
+          vector_add_allow_dup (strdup (buf), g->config);
         }
 
       if (v->domain_name)
         {
           snprintf (buf, sizeof (buf), "  node %d domain-name %s",
                     v->id, v->domain_name);
-          vector_add (strdup (buf), g->config);
+          vector_add_allow_dup (strdup (buf), g->config);
         }
 
       if (v->descr)
         {
           snprintf (buf, sizeof (buf), "  node %d description %s", v->id, v->descr);
-          vector_add (strdup (buf), g->config);
+          vector_add_allow_dup (strdup (buf), g->config);
         }
 
       if (v->type)
@@ -190,11 +199,12 @@ graph_save_config (struct graph *g)
             snprintf (buf, sizeof (buf), "  node %d type router", v->id);
           else if (v->type == NODE_TYPE_NETWORK)
             snprintf (buf, sizeof (buf), "  node %d type network", v->id);
-          vector_add (strdup (buf), g->config);
+          vector_add_allow_dup (strdup (buf), g->config);
         }
     }
 
-  for (vn = vector_head (g->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct link *e = (struct link *) vn->data;
 
@@ -203,12 +213,12 @@ graph_save_config (struct graph *g)
 
       snprintf (buf, sizeof (buf), "  link %d source-node %d sink-node %d",
                 e->id, e->from->id, e->to->id);
-      vector_add (strdup (buf), g->config);
+      vector_add_allow_dup (strdup (buf), g->config);
 
       if (e->descr)
         {
           snprintf (buf, sizeof (buf), "  link %d description %s", e->id, e->descr);
-          vector_add (strdup (buf), g->config);
+          vector_add_allow_dup (strdup (buf), g->config);
         }
     }
 }
@@ -228,9 +238,7 @@ DEFINE_COMMAND(node_name,
   id = strtoul (argv[1], NULL, 0);
   node = node_get (id, graph);
 
-  if (node->name)
-    free (node->name);
-  node->name = strdup (argv[3]);
+  node_set_name (node, argv[3]);
 
   command_config_add (graph->config, argc, argv);
 }
@@ -396,6 +404,9 @@ DEFINE_COMMAND(link_bandwidth_delay_length,
   link->delay = strtod (argv[5], NULL);
   link->length = strtod (argv[7], NULL);
 
+  /* the CSR snapshot caches the bandwidth */
+  graph_thaw (graph);
+
   command_config_add (graph->config, argc, argv);
 }
 
@@ -415,8 +426,10 @@ DEFINE_COMMAND(link_bandwidth_delay_length_all,
   struct graph *graph = (struct graph *) shell->context;
   struct link *link;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
-  for (vn = vector_head (graph->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (graph->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       link = (struct link *) vn->data;
       link->bandwidth = strtod (argv[3], NULL);
@@ -424,6 +437,9 @@ DEFINE_COMMAND(link_bandwidth_delay_length_all,
       link->length = strtod (argv[7], NULL);
     }
 
+  /* the CSR snapshot caches the bandwidth */
+  graph_thaw (graph);
+
   command_config_add (graph->config, argc, argv);
 }
 
@@ -532,7 +548,8 @@ DEFINE_COMMAND (import_routing,
   struct graph *G = (struct graph *) shell->context;
   struct routing *R = NULL;
   unsigned long dest;
-  struct vector_node *vn;
+  struct route_flat *flat;
+  unsigned int j;
   int i;
   struct link *link;
   struct node *os, *ot, *s, *t;
@@ -551,22 +568,20 @@ DEFINE_COMMAND (import_routing,
       return;
     }
 
+  flat = route_freeze (R);
   for (i = 0; i < R->nnodes; i++)
     {
       if (i == dest)
         continue;
-      for (vn = vector_head (R->route[i][dest].nexthops); vn;
-           vn = vector_next (vn))
+      for (j = ROUTE_FLAT_BEGIN (flat, i, dest);
+           j < ROUTE_FLAT_END (flat, i, dest); j++)
         {
-          struct nexthop *nexthop = (struct nexthop *) vn->data;
-          if (nexthop == NULL)
-            continue;
           os = node_get (i, R->G);
-          ot = node_get (nexthop->node->id, R->G);
+          ot = node_get (flat->nexthop[j], R->G);
           s = node_copy_create (os, G);
           t = node_copy_create (ot, G);
           link = link_get (s, t, G);
-          link->probability = nexthop->ratio;
+          link->probability = flat->ratio[j];
         }
     }
 }
@@ -713,14 +728,19 @@ DEFINE_COMMAND (graph_scale_link_bandwidth,
   struct shell *shell = (struct shell *) context;
   struct graph *graph = (struct graph *) shell->context;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct link *link;
   double scale;
   scale = strtod (argv[2], NULL);
-  for (vn = vector_head (graph->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (graph->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       link = (struct link *) vn->data;
       link->bandwidth *= scale;
     }
+
+  /* the CSR snapshot caches the bandwidth */
+  graph_thaw (graph);
 }
 
 int
@@ -755,6 +775,7 @@ void
 link_contract (struct link *link, struct node *newnode)
 {
   struct vector_node *vnj;
+  struct vector_node vnj_cursor;
   struct node *s, *t;
 
   s = link->from;
@@ -769,7 +790,8 @@ link_contract (struct link *link, struct node *newnode)
 
   if (s != newnode)
     {
-      for (vnj = vector_head (s->olinks); vnj; vnj = vector_next (vnj))
+      for (vnj = vector_cursor_head (s->olinks, &vnj_cursor); vnj;
+           vnj = vector_cursor_next (vnj))
         {
           struct link *link = (struct link *) vnj->data;
           struct node *peer = link->to;
@@ -796,7 +818,8 @@ link_contract (struct link *link, struct node *newnode)
 
   if (t != newnode)
     {
-      for (vnj = vector_head (t->olinks); vnj; vnj = vector_next (vnj))
+      for (vnj = vector_cursor_head (t->olinks, &vnj_cursor); vnj;
+           vnj = vector_cursor_next (vnj))
         {
           struct link *link = (struct link *) vnj->data;
           struct node *peer = link->to;
@@ -838,16 +861,18 @@ DEFINE_COMMAND(contract_edges_both_node_group,
   char *newnode_name = argv[7];
   struct node *newnode;
   struct vector_node *vni;
+  struct vector_node vni_cursor;
   int count = 0;
 
   newnode = node_get (vector_empty_index (g->nodes), g);
-  newnode->name = strdup (newnode_name);
+  node_set_name (newnode, newnode_name);
   newnode->domain_name = strdup (newnode_name);
 
   fprintf (stdout, "newnode: id: %d domain-name: %s\n",
            newnode->id, newnode->domain_name);
 
-  for (vni = vector_head (g->links); vni; vni = vector_next (vni))
+  for (vni = vector_cursor_head (g->links, &vni_cursor); vni;
+       vni = vector_cursor_next (vni))
     {
       struct link *e = (struct link *) vni->data;
       struct node *s, *t;
@@ -891,16 +916,18 @@ DEFINE_COMMAND(contract_edges_both_node_domain_suffix,
   char *suffix = argv[3];
   struct node *newnode;
   struct vector_node *vni;
+  struct vector_node vni_cursor;
   int count = 0;
 
   newnode = node_get (vector_empty_index (g->nodes), g);
-  newnode->name = strdup (suffix);
+  node_set_name (newnode, suffix);
   newnode->domain_name = strdup (suffix);
 
   fprintf (stdout, "newnode: id: %d domain-name: %s\n",
            newnode->id, newnode->domain_name);
 
-  for (vni = vector_head (g->links); vni; vni = vector_next (vni))
+  for (vni = vector_cursor_head (g->links, &vni_cursor); vni;
+       vni = vector_cursor_next (vni))
     {
       struct link *e = (struct link *) vni->data;
       struct node *s, *t;
@@ -941,8 +968,10 @@ DEFINE_COMMAND(remove_stub_node,
   struct link *out, *in;
   int ocount, icount;
   struct vector_node *vni, *vnj;
+  struct vector_node vni_cursor, vnj_cursor;
 
-  for (vni = vector_head (g->nodes); vni; vni = vector_next (vni))
+  for (vni = vector_cursor_head (g->nodes, &vni_cursor); vni;
+       vni = vector_cursor_next (vni))
     {
       node = (struct node *) vni->data;
 
@@ -951,7 +980,8 @@ DEFINE_COMMAND(remove_stub_node,
 
       out = NULL;
       ocount = 0;
-      for (vnj = vector_head (node->olinks); vnj; vnj = vector_next (vnj))
+      for (vnj = vector_cursor_head (node->olinks, &vnj_cursor); vnj;
+           vnj = vector_cursor_next (vnj))
         if (vnj->data)
           {
             out = (struct link *) vnj->data;
@@ -960,7 +990,8 @@ DEFINE_COMMAND(remove_stub_node,
 
       in = NULL;
       icount = 0;
-      for (vnj = vector_head (node->ilinks); vnj; vnj = vector_next (vnj))
+      for (vnj = vector_cursor_head (node->ilinks, &vnj_cursor); vnj;
+           vnj = vector_cursor_next (vnj))
         if (vnj->data)
           {
             in = (struct link *) vnj->data;
@@ -1002,12 +1033,15 @@ DEFINE_COMMAND(show_connectivity,
   struct graph *g = (struct graph *) shell->context;
 
   struct vector_node *vn;
+
+  struct vector_node vn_cursor;
   struct connectivity c;
   struct link *link;
   int i, itop;
 
   connectivity_init (g->nodes->size, &c);
-  for (vn = vector_head (g->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       link = (struct link *) vn->data;
       if (! link)
@@ -1037,6 +1071,8 @@ DEFINE_COMMAND(renovate_maximum_connected_component,
   struct graph *g = (struct graph *) shell->context;
 
   struct vector_node *vn;
+
+  struct vector_node vn_cursor;
   struct connectivity c;
   struct link *link;
   struct node *node;
@@ -1044,7 +1080,8 @@ DEFINE_COMMAND(renovate_maximum_connected_component,
   int maximum = 0, maximum_top;
 
   connectivity_init (g->nodes->size, &c);
-  for (vn = vector_head (g->links); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->links, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       link = (struct link *) vn->data;
       connectivity_connect (link->from->id, link->to->id, &c);
@@ -1068,7 +1105,8 @@ DEFINE_COMMAND(renovate_maximum_connected_component,
         }
     }
 
-  for (vn = vector_head (g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 
@@ -1132,6 +1170,9 @@ graph_init ()
   INSTALL_COMMAND (cmdset_graph, import_routing);
   INSTALL_COMMAND (cmdset_graph, import_graph_rocketfuel_maps);
   INSTALL_COMMAND (cmdset_graph, import_graph_rocketfuel_weights);
+  INSTALL_COMMAND (cmdset_graph, benchmark_import_brite);
+  INSTALL_COMMAND (cmdset_graph, benchmark_import_rocketfuel_maps);
+  INSTALL_COMMAND (cmdset_graph, benchmark_import_rocketfuel_weights);
 
   INSTALL_COMMAND (cmdset_graph, realloc_identifiers);
 
@@ -1151,6 +1192,9 @@ graph_init ()
   INSTALL_COMMAND (cmdset_graph, show_path_cost);
   INSTALL_COMMAND (cmdset_graph, show_path_probability);
   INSTALL_COMMAND (cmdset_graph, show_path_probability_failure);
+  INSTALL_COMMAND (cmdset_graph, show_path_max_hops);
+  INSTALL_COMMAND (cmdset_graph, show_path_max_cost);
+  INSTALL_COMMAND (cmdset_graph, benchmark_path_enum);
   INSTALL_COMMAND (cmdset_graph, packet_forwarding_failure);
 
   INSTALL_COMMAND (cmdset_graph, save_graph_config);
@@ -1178,8 +1222,18 @@ graph_init ()
   INSTALL_COMMAND (cmdset_graph, calculate_reliability_source_destination_sdp_stat_detail_detail);
   INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_all);
   INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_all_stat);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_all_threads);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_all_stat_threads);
   INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_half);
   INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_half_stat);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_half_threads);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_half_stat_threads);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_source_destination_monte_carlo);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_source_destination_monte_carlo_threads);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_all_monte_carlo);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_all_monte_carlo_threads);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_half_monte_carlo);
+  INSTALL_COMMAND (cmdset_graph, calculate_reliability_all_to_half_monte_carlo_threads);
 
   INSTALL_COMMAND (cmdset_graph, link_all_reliability);
 }
@@ -1188,8 +1242,10 @@ void
 graph_finish ()
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct graph *graph;
-  for (vn = vector_head (graphs); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (graphs, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       graph = (struct graph *) vn->data;
       if (graph)
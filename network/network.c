@@ -25,10 +25,15 @@
 #include "command.h"
 #include "command_shell.h"
 #include "module.h"
+#include "workqueue.h"
+#include "random.h"
+#include "bitset.h"
 
 #include "network/weight.h"
 #include "network/path.h"
 #include "network/routing.h"
+#include "network/tag-hash.h"
+#include "network/failure-sweep.h"
 #include "network/graph.h"
 #include "network/graph_cmd.h"
 #include "traffic-model/demand.h"
@@ -54,6 +59,7 @@ network_delete (struct network *network)
 {
   int i;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct flow *flow;
 
   if (network->name)
@@ -61,7 +67,8 @@ network_delete (struct network *network)
 
   if (network->flows)
     {
-      for (vn = vector_head (network->flows); vn; vn = vector_next (vn))
+      for (vn = vector_cursor_head (network->flows, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
         {
           flow = (struct flow *) vn->data;
           vector_delete (flow->path);
@@ -84,6 +91,13 @@ network_delete (struct network *network)
       free (network->flows_on_edge);
     }
 
+  if (network->load_on_edge)
+    free (network->load_on_edge);
+  if (network->drop_on_node)
+    free (network->drop_on_node);
+  if (network->dsts_on_edge)
+    free (network->dsts_on_edge);
+
   command_config_clear (network->config);
   vector_delete (network->config);
   free (network);
@@ -221,10 +235,10 @@ load_flow (u_int source, u_int sink, demand_t demand, struct network *N)
   flow->sink = sink;
   flow->bandwidth = demand;
   flow->path = vector_create ();
-  vector_add (flow, N->flows);
+  vector_add_allow_dup (flow, N->flows);
 
-  vector_add ((void *)source, flow->path);
-  vector_add (flow, N->flows_on_node[source]);
+  vector_add_allow_dup ((void *)source, flow->path);
+  vector_add_allow_dup (flow, N->flows_on_node[source]);
 
   fprintf (stderr, "load_flow: %2u->%2u: %f\n", source, sink, demand);
 }
@@ -235,6 +249,7 @@ flow_divide (struct flow *flow, double ratio, struct network *N)
   int p, q;
   struct flow *newflow;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   newflow = (struct flow *) malloc (sizeof (struct flow));
   memset (newflow, 0, sizeof (struct flow));
@@ -242,17 +257,18 @@ flow_divide (struct flow *flow, double ratio, struct network *N)
   newflow->sink = flow->sink;
   newflow->bandwidth = flow->bandwidth * ratio;
   newflow->path = vector_create ();
-  vector_add (newflow, N->flows);
+  vector_add_allow_dup (newflow, N->flows);
 
   p = -1;
-  for (vn = vector_head (flow->path); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (flow->path, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       q = (int) vn->data;
-      vector_add ((void *)q, newflow->path);
+      vector_add_allow_dup ((void *)q, newflow->path);
       if (p >= 0)
         {
           struct link *link = link_get_by_node_id (p, q, N->G);
-          vector_add (newflow, N->flows_on_edge[link->id]);
+          vector_add_allow_dup (newflow, N->flows_on_edge[link->id]);
         }
       p = q;
     }
@@ -276,7 +292,12 @@ load_traffic_flows (struct network *N)
   struct demand_matrix *demands;
   struct flow *flow;
   struct vector_node *vni, *vnj, *vnk;
+  struct vector_node vni_cursor, vnj_cursor, vnk_cursor;
   double drop_ratio;
+  struct route_flat *flat;
+  unsigned int k, next;
+
+  flat = route_freeze (N->R);
 
   demands = demand_matrix_copy (N->T->demands);
   for (i = 0; i < N->nnodes; i++)
@@ -286,7 +307,8 @@ load_traffic_flows (struct network *N)
 
   while (! is_loading_complete (N))
   for (i = 0; i < N->nnodes; i++)
-    for (vni = vector_head (N->flows_on_node[i]); vni; vni = vector_next (vni))
+    for (vni = vector_cursor_head (N->flows_on_node[i], &vni_cursor); vni;
+         vni = vector_cursor_next (vni))
       {
         fprintf (stderr, "vni->index: %d, vector->size: %d\n",
                  vni->index, N->flows_on_node[i]->size);
@@ -298,44 +320,52 @@ load_traffic_flows (struct network *N)
                  flow, flow->source, flow->sink, flow->bandwidth, i);
 
         drop_ratio = 1.0;
-        for (vnj = vector_head (N->R->route[i][flow->sink].nexthops); vnj;
-             vnj = vector_next (vnj))
+        for (k = ROUTE_FLAT_BEGIN (flat, i, flow->sink);
+             k < ROUTE_FLAT_END (flat, i, flow->sink); k++)
           {
-            struct nexthop *nexthop = (struct nexthop *) vnj->data;
-            struct link *link = link_get_by_node_id (i, nexthop->node->id, N->G);
-            struct flow *newflow = flow_divide (flow, nexthop->ratio, N);
-            drop_ratio -= nexthop->ratio;
+            struct link *link;
+            struct flow *newflow;
 
-            vector_add ((void *)nexthop->node->id, newflow->path);
-            vector_add (newflow, N->flows_on_edge[link->id]);
-            if (newflow->sink != nexthop->node->id)
-              vector_add (newflow, N->flows_on_node[nexthop->node->id]);
+            next = flat->nexthop[k];
+            link = link_get_by_node_id (i, next, N->G);
+            newflow = flow_divide (flow, flat->ratio[k], N);
+            drop_ratio -= flat->ratio[k];
+
+            /* the path check catches a forwarding loop; the flow is new
+               to the rest, as the path does not repeat a node */
+            vector_add ((void *)next, newflow->path);
+            vector_add_allow_dup (newflow, N->flows_on_edge[link->id]);
+            if (newflow->sink != next)
+              vector_add_allow_dup (newflow, N->flows_on_node[next]);
 
             fprintf (stderr, "    ->%u(%p): %u->%u(%f/%f) @edge[%u](%u-%u)\n",
-                     nexthop->node->id, newflow, 
+                     next, newflow, 
                      newflow->source, newflow->sink,
                      newflow->bandwidth, flow->bandwidth, link->id,
-                     i, nexthop->node->id);
+                     i, next);
 
             fprintf (stderr, "      newflow(%u->%u)[%p]:",
                      newflow->source, newflow->sink, newflow);
-            for (vnk = vector_head (newflow->path); vnk; vnk = vector_next (vnk))
+            for (vnk = vector_cursor_head (newflow->path, &vnk_cursor); vnk;
+                 vnk = vector_cursor_next (vnk))
               fprintf (stderr, " %d", (int) vnk->data);
             fprintf (stderr, "\n");
           }
 
         fprintf (stderr, "    path flow(%u->%u)[%p]:",
                  flow->source, flow->sink, flow);
-        for (vnj = vector_head (flow->path); vnj; vnj = vector_next (vnj))
+        for (vnj = vector_cursor_head (flow->path, &vnj_cursor); vnj;
+             vnj = vector_cursor_next (vnj))
           fprintf (stderr, " %d", (int) vnj->data);
         fprintf (stderr, "\n");
 
 #if 1
         flow->bandwidth *= drop_ratio;
-        vector_add (flow, N->flows_drop_on_node[i]);
+        vector_add_allow_dup (flow, N->flows_drop_on_node[i]);
 #else
         p = -1;
-        for (vnj = vector_head (flow->path); vnj; vnj = vector_next (vnj))
+        for (vnj = vector_cursor_head (flow->path, &vnj_cursor); vnj;
+             vnj = vector_cursor_next (vnj))
           {
             q = (int) vnj->data;
             if (p >= 0)
@@ -357,6 +387,221 @@ load_traffic_flows (struct network *N)
   demand_matrix_delete (demands);
 }
 
+/* scratch of Tarjan's strongly connected components on the nexthop
+   graph toward a destination */
+struct load_traffic_scc
+{
+  unsigned int *index;          /* DFS number, 0 if not visited yet */
+  unsigned int *low;
+  unsigned int *stack;          /* Tarjan's stack */
+  unsigned int *path;           /* the DFS path */
+  unsigned int *pos;            /* next nexthop entry to visit */
+  unsigned char *onstack;
+  unsigned char *cyclic;        /* on a forwarding loop */
+};
+
+#define LOAD_TRAFFIC_END(flat, u, t) \
+  ((u) == (t) ? ROUTE_FLAT_BEGIN (flat, u, t) : ROUTE_FLAT_END (flat, u, t))
+
+/* mark the nodes on a forwarding loop toward t: those in a strongly
+   connected component of the nexthops with more than one node, or
+   forwarding to themselves.  Tarjan's algorithm, without recursion. */
+static void
+load_traffic_loop_nodes (struct route_flat *flat, unsigned int t,
+                         struct load_traffic_scc *scc)
+{
+  unsigned int n = flat->nnodes;
+  unsigned int r, u, v, k, i, depth, sp, count;
+
+  memset (scc->index, 0, n * sizeof (unsigned int));
+  memset (scc->onstack, 0, n);
+  memset (scc->cyclic, 0, n);
+  count = sp = 0;
+
+  for (r = 0; r < n; r++)
+    {
+      if (scc->index[r])
+        continue;
+
+      scc->index[r] = scc->low[r] = ++count;
+      scc->stack[sp++] = r;
+      scc->onstack[r] = 1;
+      scc->pos[r] = ROUTE_FLAT_BEGIN (flat, r, t);
+      depth = 0;
+      scc->path[depth++] = r;
+
+      while (depth)
+        {
+          u = scc->path[depth - 1];
+          if (scc->pos[u] < LOAD_TRAFFIC_END (flat, u, t))
+            {
+              v = flat->nexthop[scc->pos[u]++];
+              if (v == u)
+                scc->cyclic[u] = 1;
+              else if (! scc->index[v])
+                {
+                  scc->index[v] = scc->low[v] = ++count;
+                  scc->stack[sp++] = v;
+                  scc->onstack[v] = 1;
+                  scc->pos[v] = ROUTE_FLAT_BEGIN (flat, v, t);
+                  scc->path[depth++] = v;
+                }
+              else if (scc->onstack[v] && scc->low[u] > scc->index[v])
+                scc->low[u] = scc->index[v];
+              continue;
+            }
+
+          depth--;
+          if (depth && scc->low[scc->path[depth - 1]] > scc->low[u])
+            scc->low[scc->path[depth - 1]] = scc->low[u];
+          if (scc->low[u] != scc->index[u])
+            continue;
+
+          /* u is the root of a component: pop it */
+          k = sp;
+          do
+            k--;
+          while (scc->stack[k] != u);
+          for (i = k; i < sp; i++)
+            {
+              scc->onstack[scc->stack[i]] = 0;
+              if (sp - k > 1)
+                scc->cyclic[scc->stack[i]] = 1;
+            }
+          sp = k;
+        }
+    }
+}
+
+/* load the demands in O(N * E): for each destination t, the demands
+   toward t are summed at each node, and pushed along t's nexthops in
+   the topological order of the nexthop DAG, so each node forwards
+   its total once.  the part not forwarded (1 - sum of the ratios)
+   is dropped at the node, as in load_traffic_flows ().  the traffic
+   that enters a node on a forwarding loop (and the node's own
+   demand) is dropped at that node; the loop nodes' nexthops are left
+   out of the order, so the nodes downstream of a loop still forward
+   their own demand. */
+void
+load_traffic_aggregate (struct network *N)
+{
+  struct route_flat *flat;
+  struct graph_csr *csr;
+  struct demand_matrix *demands = N->T->demands;
+  struct load_traffic_scc scc;
+  unsigned int n = N->nnodes;
+  unsigned int s, t, k, j, e, head, tail;
+  unsigned int *indeg, *order, *mark;
+  double *in;
+  double x, f, forwarded;
+
+  flat = route_freeze (N->R);
+  csr = graph_freeze (N->G);
+
+  if (N->load_on_edge)
+    free (N->load_on_edge);
+  if (N->drop_on_node)
+    free (N->drop_on_node);
+  if (N->dsts_on_edge)
+    free (N->dsts_on_edge);
+  N->load_on_edge = (double *) calloc (N->nedges + 1, sizeof (double));
+  N->drop_on_node = (double *) calloc (n + 1, sizeof (double));
+  N->dsts_on_edge = (unsigned int *)
+    calloc (N->nedges + 1, sizeof (unsigned int));
+  N->ndemands = 0;
+
+  in = (double *) malloc ((n + 1) * sizeof (double));
+  indeg = (unsigned int *) malloc ((n + 1) * sizeof (unsigned int));
+  order = (unsigned int *) malloc ((n + 1) * sizeof (unsigned int));
+  mark = (unsigned int *) malloc ((N->nedges + 1) * sizeof (unsigned int));
+  memset (mark, 0xff, (N->nedges + 1) * sizeof (unsigned int));
+
+  scc.index = (unsigned int *) malloc ((n + 1) * sizeof (unsigned int));
+  scc.low = (unsigned int *) malloc ((n + 1) * sizeof (unsigned int));
+  scc.stack = (unsigned int *) malloc ((n + 1) * sizeof (unsigned int));
+  scc.path = (unsigned int *) malloc ((n + 1) * sizeof (unsigned int));
+  scc.pos = (unsigned int *) malloc ((n + 1) * sizeof (unsigned int));
+  scc.onstack = (unsigned char *) malloc (n + 1);
+  scc.cyclic = (unsigned char *) malloc (n + 1);
+
+  for (t = 0; t < n; t++)
+    {
+      load_traffic_loop_nodes (flat, t, &scc);
+
+      memset (indeg, 0, n * sizeof (unsigned int));
+      for (s = 0; s < n; s++)
+        {
+          in[s] = (s == t ? 0.0 : demands->traffic[s][t]);
+          if (in[s] != 0.0)
+            N->ndemands++;
+          if (s == t || scc.cyclic[s])
+            continue;
+          for (j = ROUTE_FLAT_BEGIN (flat, s, t);
+               j < ROUTE_FLAT_END (flat, s, t); j++)
+            indeg[flat->nexthop[j]]++;
+        }
+
+      head = tail = 0;
+      for (s = 0; s < n; s++)
+        if (indeg[s] == 0)
+          order[tail++] = s;
+
+      while (head < tail)
+        {
+          s = order[head++];
+          if (s == t)
+            continue;
+          if (scc.cyclic[s])
+            {
+              N->drop_on_node[s] += in[s];
+              continue;
+            }
+
+          x = in[s];
+          forwarded = 0.0;
+          for (j = ROUTE_FLAT_BEGIN (flat, s, t);
+               j < ROUTE_FLAT_END (flat, s, t); j++)
+            {
+              k = flat->nexthop[j];
+              forwarded += flat->ratio[j];
+              f = x * flat->ratio[j];
+              if (f != 0.0)
+                {
+                  for (e = csr->ooffset[s]; e < csr->ooffset[s + 1]; e++)
+                    if (csr->otarget[e] == k)
+                      break;
+                  assert (e < csr->ooffset[s + 1]);
+                  e = csr->olink[e];
+
+                  N->load_on_edge[e] += f;
+                  if (mark[e] != t)
+                    {
+                      mark[e] = t;
+                      N->dsts_on_edge[e]++;
+                    }
+                  in[k] += f;
+                }
+              if (--indeg[k] == 0)
+                order[tail++] = k;
+            }
+          N->drop_on_node[s] += x * (1.0 - forwarded);
+        }
+      assert (tail == n);
+    }
+
+  free (scc.index);
+  free (scc.low);
+  free (scc.stack);
+  free (scc.path);
+  free (scc.pos);
+  free (scc.onstack);
+  free (scc.cyclic);
+  free (in);
+  free (indeg);
+  free (order);
+  free (mark);
+}
+
 DEFINE_COMMAND (network_load_traffic_flows,
                 "network-load traffic-flows",
                 "load traffic flows on network\n"
@@ -365,6 +610,9 @@ DEFINE_COMMAND (network_load_traffic_flows,
   struct shell *shell = (struct shell *) context;
   struct network *N = (struct network *) shell->context;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
+  int i;
+
   if (N->G == NULL)
     {
       fprintf (shell->terminal, "no graph specified: do network-graph first.\n");
@@ -383,7 +631,8 @@ DEFINE_COMMAND (network_load_traffic_flows,
 
   if (N->flows)
     {
-      for (vn = vector_head (N->flows); vn; vn = vector_next (vn))
+      for (vn = vector_cursor_head (N->flows, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
         {
           struct flow *flow = (struct flow *) vn->data;
           vector_remove (flow, N->flows);
@@ -394,10 +643,35 @@ DEFINE_COMMAND (network_load_traffic_flows,
     }
   N->flows = vector_create ();
 
-  load_traffic_flows (N);
+  /* forget the flow fragments of the previous per-flow loading */
+  for (i = 0; i < N->nnodes; i++)
+    {
+      vector_clear (N->flows_on_node[i]);
+      vector_clear (N->flows_drop_on_node[i]);
+    }
+  for (i = 0; i < N->nedges; i++)
+    vector_clear (N->flows_on_edge[i]);
+
+  if (argc > 2 && ! strcmp (argv[2], "per-flow"))
+    {
+      N->load_mode = NETWORK_LOAD_PER_FLOW;
+      load_traffic_flows (N);
+    }
+  else
+    {
+      N->load_mode = NETWORK_LOAD_AGGREGATE;
+      load_traffic_aggregate (N);
+    }
   command_config_add (N->config, argc, argv);
 }
 
+ALIAS_COMMAND (network_load_traffic_flows_per_flow,
+               network_load_traffic_flows,
+               "network-load traffic-flows per-flow",
+               "load traffic flows on network\n"
+               "load traffic flows on network\n"
+               "track each flow's path (debug, slow)\n")
+
 void
 show_network_summary_header (FILE *terminal)
 {
@@ -423,9 +697,11 @@ show_network_instance (FILE *terminal, void *instance)
   struct network *N = (struct network *) instance;
   int i;
   struct vector_node *vni, *vnj, *vnk;
+  struct vector_node vni_cursor, vnj_cursor, vnk_cursor;
   struct flow *flow;
   double load, util;
   struct node *node;
+  int nflows;
 
   double avg, med, max, min;
   double vari;
@@ -434,34 +710,58 @@ show_network_instance (FILE *terminal, void *instance)
 
   fprintf (terminal, "Network %lu:\n", N->id);
 
-  fprintf (terminal, "#Flows: %d\n", N->flows->size);
-  for (vni = vector_head (N->flows); vni; vni = vector_next (vni))
+  if (N->load_mode == NETWORK_LOAD_AGGREGATE)
     {
-      flow = (struct flow *) vni->data;
-      fprintf (terminal, "Flow: %2d->%2d: %f:",
-               flow->source, flow->sink, flow->bandwidth);
-      for (vnj = vector_head (flow->path); vnj; vnj = vector_next (vnj))
-        fprintf (terminal, " %d", (int) vnj->data);
-      fprintf (terminal, "\n");
-    }
-
-  for (i = 0; i < N->nnodes; i++)
-    fprintf (terminal, "Node[%d]: %d flows left\n", i, N->flows_on_node[i]->size);
+      if (! N->load_on_edge)
+        {
+          fprintf (terminal,
+                   "no traffic loaded: do network-load first.\n");
+          return;
+        }
 
-  for (i = 0; i < N->nnodes; i++)
+      fprintf (terminal, "#Demands: %lu\n", N->ndemands);
+      for (i = 0; i < N->nnodes; i++)
+        fprintf (terminal,
+                 "Node[%d]: total bandwidth of flows dropped: %f\n",
+                 i, N->drop_on_node[i]);
+    }
+  else
     {
-      double total_dropped = 0.0;
-      for (vni = vector_head (N->flows_drop_on_node[i]); vni; vni = vector_next (vni))
+      fprintf (terminal, "#Flows: %d\n", N->flows->size);
+      for (vni = vector_cursor_head (N->flows, &vni_cursor); vni;
+           vni = vector_cursor_next (vni))
         {
           flow = (struct flow *) vni->data;
-          total_dropped += flow->bandwidth;
+          fprintf (terminal, "Flow: %2d->%2d: %f:",
+                   flow->source, flow->sink, flow->bandwidth);
+          for (vnj = vector_cursor_head (flow->path, &vnj_cursor); vnj;
+               vnj = vector_cursor_next (vnj))
+            fprintf (terminal, " %d", (int) vnj->data);
+          fprintf (terminal, "\n");
+        }
+
+      for (i = 0; i < N->nnodes; i++)
+        fprintf (terminal, "Node[%d]: %d flows left\n",
+                 i, N->flows_on_node[i]->size);
+
+      for (i = 0; i < N->nnodes; i++)
+        {
+          double total_dropped = 0.0;
+          for (vni = vector_cursor_head (N->flows_drop_on_node[i],
+                                         &vni_cursor); vni;
+               vni = vector_cursor_next (vni))
+            {
+              flow = (struct flow *) vni->data;
+              total_dropped += flow->bandwidth;
 #if 0
-          fprintf (terminal, "dropped: on %d: %d->%d, bandwidth %f\n",
-                   i, flow->source, flow->sink, flow->bandwidth);
+              fprintf (terminal, "dropped: on %d: %d->%d, bandwidth %f\n",
+                       i, flow->source, flow->sink, flow->bandwidth);
 #endif
+            }
+          fprintf (terminal,
+                   "Node[%d]: total bandwidth of flows dropped: %f\n",
+                   i, total_dropped);
         }
-      fprintf (terminal, "Node[%d]: total bandwidth of flows dropped: %f\n",
-               i, total_dropped);
     }
 
   med = max = min = 0.0;
@@ -469,28 +769,41 @@ show_network_instance (FILE *terminal, void *instance)
   vari = 0.0;
 
   fprintf (terminal, "Edge[%2s]: %3s %3s %9s %9s %5s %6s\n",
-           "##", "src", "dst", "Load", "Bandwidth", "Util", "#Flows");
+           "##", "src", "dst", "Load", "Bandwidth", "Util",
+           (N->load_mode == NETWORK_LOAD_AGGREGATE ? "#Dsts" : "#Flows"));
 
-  for (vni = vector_head (N->G->nodes); vni; vni = vector_next (vni))
+  for (vni = vector_cursor_head (N->G->nodes, &vni_cursor); vni;
+       vni = vector_cursor_next (vni))
     {
       node = (struct node *) vni->data;
-      for (vnj = vector_head (node->olinks); vnj; vnj = vector_next (vnj))
+      for (vnj = vector_cursor_head (node->olinks, &vnj_cursor); vnj;
+           vnj = vector_cursor_next (vnj))
         {
           struct link *link = (struct link *) vnj->data;
           i = link->id;
 
           load = 0.0;
-          for (vnk = vector_head (N->flows_on_edge[i]); vnk;
-               vnk = vector_next (vnk))
+          if (N->load_mode == NETWORK_LOAD_AGGREGATE)
             {
-              flow = (struct flow *) vnk->data;
-              load += flow->bandwidth;
+              load = N->load_on_edge[i];
+              nflows = N->dsts_on_edge[i];
+            }
+          else
+            {
+              for (vnk = vector_cursor_head (N->flows_on_edge[i],
+                                             &vnk_cursor); vnk;
+                   vnk = vector_cursor_next (vnk))
+                {
+                  flow = (struct flow *) vnk->data;
+                  load += flow->bandwidth;
+                }
+              nflows = N->flows_on_edge[i]->size;
             }
 
           util = load / link->bandwidth;
           fprintf (terminal, "Edge[%2d]: %3u %3u %9.3f %9.3f %5.3f %6d\n",
                    i, link->from->id, link->to->id, load, link->bandwidth, util,
-                   N->flows_on_edge[i]->size);
+                   nflows);
 
           if (max < util)
             max = util;
@@ -533,13 +846,22 @@ DEFINE_COMMAND (show_flows_on_link,
   struct network *network = (struct network *) shell->context;
   unsigned long id = 0;
   struct vector_node *vni, *vnj;
+  struct vector_node vni_cursor, vnj_cursor;
   struct flow *flow;
 
   id = strtoul (argv[4], NULL, 0);
 
+  if (network->load_mode == NETWORK_LOAD_AGGREGATE)
+    {
+      fprintf (shell->terminal, "flows are not tracked: "
+               "do network-load traffic-flows per-flow.\n");
+      return;
+    }
+
   fprintf (shell->terminal, "#Flows on link[%lu]: %d\n",
            id, network->flows_on_edge[id]->size);
-  for (vni = vector_head (network->flows_on_edge[id]); vni; vni = vector_next (vni))
+  for (vni = vector_cursor_head (network->flows_on_edge[id], &vni_cursor); vni;
+       vni = vector_cursor_next (vni))
     {
       flow = (struct flow *) vni->data;
 
@@ -548,7 +870,8 @@ DEFINE_COMMAND (show_flows_on_link,
 
       fprintf (shell->terminal, "Flow: %2d->%2d: %f:",
                flow->source, flow->sink, flow->bandwidth);
-      for (vnj = vector_head (flow->path); vnj; vnj = vector_next (vnj))
+      for (vnj = vector_cursor_head (flow->path, &vnj_cursor); vnj;
+           vnj = vector_cursor_next (vnj))
         fprintf (shell->terminal, " %d", (int) vnj->data);
       fprintf (shell->terminal, "\n");
     }
@@ -617,6 +940,17 @@ chash_selection (int router_id, unsigned int tag,
   return (tag + seed);
 }
 
+/* same as chash_selection (), by the keyed permutation of the router
+   instead of its table: tag_hashes has a struct tag_hash per router. */
+int
+chash_selection_keyed (int router_id, unsigned int tag,
+                       void *tag_hashes)
+{
+  struct tag_hash *th;
+  th = (struct tag_hash *) vector_get (tag_hashes, router_id);
+  return (tag + tag_hash_value (th, tag));
+}
+
 int
 deflection_selection (int router_id, unsigned int tag,
                       void *router_primes)
@@ -692,6 +1026,7 @@ deflect_2_tag_forward (struct node *dst, unsigned int tag,
   struct vector *deflection_set;
   struct prev_hop_entry *e, *entry;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   int index;
 
   /* forward until the destination is reached */
@@ -705,8 +1040,10 @@ deflect_2_tag_forward (struct node *dst, unsigned int tag,
       else
         {
           entry = NULL;
-          for (vn = vector_head (dinfo_table[current->id]->prev_hop_table[dst->id]);
-               vn; vn = vector_next (vn))
+          for (vn = vector_cursor_head
+                 (dinfo_table[current->id]->prev_hop_table[dst->id],
+                  &vn_cursor);
+               vn; vn = vector_cursor_next (vn))
             {
               e = (struct prev_hop_entry *) vn->data;
               if (e->prev_hop == prev)
@@ -759,6 +1096,7 @@ deflect_3_tag_forward (struct node *dst, unsigned int tag,
   struct vector *deflection_set;
   struct prev_hop_entry *e, *entry;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   int index;
 
   /* forward until the destination is reached */
@@ -772,8 +1110,10 @@ deflect_3_tag_forward (struct node *dst, unsigned int tag,
       else
         {
           entry = NULL;
-          for (vn = vector_head (dinfo_table[current->id]->prev_hop_table[dst->id]);
-               vn; vn = vector_next (vn))
+          for (vn = vector_cursor_head
+                 (dinfo_table[current->id]->prev_hop_table[dst->id],
+                  &vn_cursor);
+               vn; vn = vector_cursor_next (vn))
             {
               e = (struct prev_hop_entry *) vn->data;
               if (e->prev_hop == prev)
@@ -823,17 +1163,20 @@ drouting_tag_forward (struct node *dst, unsigned int tag,
                       void *router_seeds, struct path *path)
 {
   struct node *prev = NULL, *current = NULL, *next = NULL;
-  struct nexthop *nexthop;
-  struct vector *nexthop_set;
+  struct route_flat *flat;
+  unsigned int begin, size;
   int index;
 
+  flat = route_freeze (drouting);
+
   while (path_end (path) != dst)
     {
       prev = current;
       current = path_end (path);
 
-      nexthop_set = drouting->route[current->id][dst->id].nexthops;
-      if (nexthop_set->size == 0)
+      begin = ROUTE_FLAT_BEGIN (flat, current->id, dst->id);
+      size = ROUTE_FLAT_SIZE (flat, current->id, dst->id);
+      if (size == 0)
         {
           fprintf (stderr, "no route from %d to %d\n", current->id, dst->id);
           return;
@@ -841,15 +1184,13 @@ drouting_tag_forward (struct node *dst, unsigned int tag,
 
       /* select the next-hop */
       index = (*nhselection) (current->id, tag, router_seeds);
-      nexthop = vector_get (nexthop_set, index % nexthop_set->size);
-      next = nexthop->node;
+      next = node_lookup (flat->nexthop[begin + index % size], drouting->G);
 
 #if 0
       fprintf (stderr, "  drouting forward: node: %d from: %d dst: %d "
                "#nexthops: %d tag: %d index: %#x %d-th nexthop: %d\n",
                current->id, (prev ? prev->id : -1), dst->id,
-               nexthop_set->size, tag, index,
-               index % nexthop_set->size, next->id);
+               size, tag, index, index % size, next->id);
       fflush (stderr);
 #endif
 
@@ -861,19 +1202,18 @@ drouting_tag_forward (struct node *dst, unsigned int tag,
 
 
 #define FLOW_LABEL_MASK 0x000fffff
-
-unsigned long *tag_hash_table_create (unsigned long size);
-void tag_hash_table_delete (unsigned long *table);
+#define FLOW_LABEL_BITS 20
 
 int
 count_path_failure (struct path *path, struct vector *failure_nodes)
 {
   int fcount = 0;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   /* does the path contain failures ? */
-  for (vn = vector_head (failure_nodes); vn;
-       vn = vector_next (vn))
+  for (vn = vector_cursor_head (failure_nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *node = (struct node *) vn->data;
       if (vector_lookup (node, path->path))
@@ -1046,7 +1386,7 @@ void
 drouting_count_retry (struct shell *shell,
                       struct node *src, struct node *dst,
                       struct routing *drouting,
-                      struct vector *hash_tables,
+                      struct vector *tag_hashes,
                       struct vector *failure_nodes)
 {
   int count, fcount;
@@ -1061,7 +1401,7 @@ drouting_count_retry (struct shell *shell,
       vector_add (src, path->path);
       tag = (unsigned long) random () & FLOW_LABEL_MASK;
       drouting_tag_forward (dst, tag, drouting,
-                            chash_selection, hash_tables,
+                            chash_selection_keyed, tag_hashes,
                             path);
 
       fcount = count_path_failure (path, failure_nodes);
@@ -1096,7 +1436,7 @@ void
 drouting_default_ok (struct shell *shell,
                      struct node *src, struct node *dst,
                      struct routing *drouting,
-                     struct vector *hash_tables,
+                     struct vector *tag_hashes,
                      struct vector *failure_nodes)
 {
   int count = 0;
@@ -1132,6 +1472,8 @@ DEFINE_COMMAND (simulate_deflection,
   struct vector *router_primes;
 
   struct vector_node *vn, *vns, *vnt;
+
+  struct vector_node vns_cursor, vnt_cursor, vn_cursor;
   struct node *node, *src, *dst;
 
   int i, n;
@@ -1164,7 +1506,8 @@ DEFINE_COMMAND (simulate_deflection,
 #endif /*1*/
 
   router_primes = vector_create ();
-  for (vns = vector_head (deflection->G->nodes); vns; vns = vector_next (vns))
+  for (vns = vector_cursor_head (deflection->G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
     {
       node = (struct node *) vns->data;
       prime = (int) vector_get (prime_vector, random () % 10 + 10);
@@ -1177,7 +1520,7 @@ DEFINE_COMMAND (simulate_deflection,
     {
       /* prepare failure nodes */
       fprintf (shell->terminal, "%d-th trial: failure node: ", n);
-      failure_nodes = vector_create ();
+      failure_nodes = vector_create_indexed ();
       for (i = 0; i < nfailures; i++)
         {
           failure_id = random () % deflection->G->nodes->size;
@@ -1188,14 +1531,15 @@ DEFINE_COMMAND (simulate_deflection,
       fprintf (shell->terminal, "\n");
 
       /* for each source */
-      for (vns = vector_head (deflection->G->nodes); vns;
-           vns = vector_next (vns))
+      for (vns = vector_cursor_head (deflection->G->nodes, &vns_cursor); vns;
+           vns = vector_cursor_next (vns))
         {
           src = (struct node *) vns->data;
 
           /* for each destination */
-          for (vnt = vector_head (deflection->G->nodes); vnt;
-               vnt = vector_next (vnt))
+          for (vnt = vector_cursor_head (deflection->G->nodes,
+                                         &vnt_cursor); vnt;
+               vnt = vector_cursor_next (vnt))
             {
               dst = (struct node *) vnt->data;
 
@@ -1203,8 +1547,8 @@ DEFINE_COMMAND (simulate_deflection,
                 continue;
 
               stdown = 0;
-              for (vn = vector_head (failure_nodes); vn;
-                   vn = vector_next (vn))
+              for (vn = vector_cursor_head (failure_nodes, &vn_cursor); vn;
+                   vn = vector_cursor_next (vn))
                 {
                   node = (struct node *) vn->data;
                   if (node == src || node == dst)
@@ -1223,13 +1567,10 @@ DEFINE_COMMAND (simulate_deflection,
 
               /* if the path does not contain failure, skip */
               isfail = 0;
-              for (vn = vector_head (failure_nodes); vn;
-                   vn = vector_next (vn))
-                {
-                  node = (struct node *) vn->data;
-                  if (vector_lookup (node, path->path))
-                    isfail++;
-                }
+              for (vn = vector_cursor_head (path->path, &vn_cursor); vn;
+                   vn = vector_cursor_next (vn))
+                if (vector_lookup (vn->data, failure_nodes))
+                  isfail++;
 
               if (path_end (path) == dst)
                 {
@@ -1268,9 +1609,11 @@ DEFINE_COMMAND (simulate_drouting,
   struct routing *drouting;
 
   time_t seed;
-  struct vector *hash_tables;
+  struct vector *tag_hashes;
 
   struct vector_node *vn, *vns, *vnt;
+
+  struct vector_node vns_cursor, vnt_cursor, vn_cursor;
   struct node *node, *src, *dst;
 
   int i, n;
@@ -1278,7 +1621,6 @@ DEFINE_COMMAND (simulate_drouting,
   struct vector *failure_nodes;
   struct path *path;
   unsigned long tag;
-  unsigned long *table;
   int stdown, isfail;
 
   ntrials = strtoul (argv[4], NULL, 0);
@@ -1295,18 +1637,15 @@ DEFINE_COMMAND (simulate_drouting,
   fprintf (shell->terminal, "seed: %lu\n", (unsigned long) seed);
   srandom ((unsigned int) seed);
 
-  /* create router seeds (complete hash table) */
-  hash_tables = vector_create ();
-  for (vns = vector_head (drouting->G->nodes); vns; vns = vector_next (vns))
+  /* create router seeds (keyed permutation of the flow labels,
+     instead of a table of FLOW_LABEL_MASK entries per router) */
+  tag_hashes = vector_create ();
+  for (vns = vector_cursor_head (drouting->G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
     {
       node = (struct node *) vns->data;
-      table = (unsigned long *) tag_hash_table_create (FLOW_LABEL_MASK);
-#if 0
-      for (i = 0; i < FLOW_LABEL_MASK; i++)
-        fprintf (stderr, "node %d: table[%#x]: %#x\n",
-                 node->id, i, table[i]);
-#endif /*0*/
-      vector_set (hash_tables, node->id, (void *) table);
+      vector_set (tag_hashes, node->id,
+                  (void *) tag_hash_create (FLOW_LABEL_BITS));
     }
 
   /* execute "ntrials" times */
@@ -1314,7 +1653,7 @@ DEFINE_COMMAND (simulate_drouting,
     {
       /* prepare failure nodes */
       fprintf (shell->terminal, "%d-th trial: failure node: ", n);
-      failure_nodes = vector_create ();
+      failure_nodes = vector_create_indexed ();
       for (i = 0; i < nfailures; i++)
         {
           failure_id = random () % drouting->G->nodes->size;
@@ -1325,14 +1664,14 @@ DEFINE_COMMAND (simulate_drouting,
       fprintf (shell->terminal, "\n");
 
       /* for each source */
-      for (vns = vector_head (drouting->G->nodes); vns;
-           vns = vector_next (vns))
+      for (vns = vector_cursor_head (drouting->G->nodes, &vns_cursor); vns;
+           vns = vector_cursor_next (vns))
         {
           src = (struct node *) vns->data;
 
           /* for each destination */
-          for (vnt = vector_head (drouting->G->nodes); vnt;
-               vnt = vector_next (vnt))
+          for (vnt = vector_cursor_head (drouting->G->nodes, &vnt_cursor); vnt;
+               vnt = vector_cursor_next (vnt))
             {
               dst = (struct node *) vnt->data;
 
@@ -1340,8 +1679,8 @@ DEFINE_COMMAND (simulate_drouting,
                 continue;
 
               stdown = 0;
-              for (vn = vector_head (failure_nodes); vn;
-                   vn = vector_next (vn))
+              for (vn = vector_cursor_head (failure_nodes, &vn_cursor); vn;
+                   vn = vector_cursor_next (vn))
                 {
                   node = (struct node *) vn->data;
                   if (node == src || node == dst)
@@ -1355,7 +1694,7 @@ DEFINE_COMMAND (simulate_drouting,
               vector_add (src, path->path);
               tag = (unsigned long) random () & FLOW_LABEL_MASK;
               drouting_tag_forward (dst, tag, drouting,
-                                    chash_selection, hash_tables, path);
+                                    chash_selection_keyed, tag_hashes, path);
               route_path_probability (path, dst, drouting);
               fprintf (shell->terminal, "    drouting primary path: ");
               print_nodelist (shell->terminal, path->path);
@@ -1364,21 +1703,18 @@ DEFINE_COMMAND (simulate_drouting,
 
               /* if the path does not contain failure, skip */
               isfail = 0;
-              for (vn = vector_head (failure_nodes); vn;
-                   vn = vector_next (vn))
-                {
-                  node = (struct node *) vn->data;
-                  if (vector_lookup (node, path->path))
-                    isfail++;
-                }
+              for (vn = vector_cursor_head (path->path, &vn_cursor); vn;
+                   vn = vector_cursor_next (vn))
+                if (vector_lookup (vn->data, failure_nodes))
+                  isfail++;
 
               if (path_end (path) == dst)
                 {
                   if (isfail)
-                    drouting_count_retry (shell, src, dst, drouting, hash_tables,
+                    drouting_count_retry (shell, src, dst, drouting, tag_hashes,
                                           failure_nodes);
                   else
-                    drouting_default_ok (shell, src, dst, drouting, hash_tables,
+                    drouting_default_ok (shell, src, dst, drouting, tag_hashes,
                                           failure_nodes);
                 }
 
@@ -1389,6 +1725,11 @@ DEFINE_COMMAND (simulate_drouting,
     }
 
   vector_delete (failure_nodes);
+
+  for (i = 0; i < tag_hashes->size; i++)
+    if (vector_get (tag_hashes, i))
+      tag_hash_delete ((struct tag_hash *) vector_get (tag_hashes, i));
+  vector_delete (tag_hashes);
 }
 
 
@@ -1411,16 +1752,17 @@ DEFINE_COMMAND (simulate_deflection_drouting,
   int prime;
   struct vector *prime_vector;
   struct vector *router_primes;
-  struct vector *hash_tables;
+  struct vector *tag_hashes;
 
   struct vector_node *vn, *vns, *vnt;
+
+  struct vector_node vns_cursor, vnt_cursor, vn_cursor;
   struct node *node, *src, *dst;
 
   int i, n;
   int failure_id;
   struct vector *failure_nodes;
   struct path *path;
-  unsigned long *table;
   int stdown, isfail;
 
   ntrials = strtoul (argv[6], NULL, 0);
@@ -1454,7 +1796,8 @@ DEFINE_COMMAND (simulate_deflection_drouting,
 #endif /*1*/
 
   router_primes = vector_create ();
-  for (vns = vector_head (deflection->G->nodes); vns; vns = vector_next (vns))
+  for (vns = vector_cursor_head (deflection->G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
     {
       node = (struct node *) vns->data;
       prime = (int) vector_get (prime_vector, random () % 10 + 10);
@@ -1462,18 +1805,15 @@ DEFINE_COMMAND (simulate_deflection_drouting,
     }
   vector_delete (prime_vector);
 
-  /* create router seeds (complete hash table) */
-  hash_tables = vector_create ();
-  for (vns = vector_head (drouting->G->nodes); vns; vns = vector_next (vns))
+  /* create router seeds (keyed permutation of the flow labels,
+     instead of a table of FLOW_LABEL_MASK entries per router) */
+  tag_hashes = vector_create ();
+  for (vns = vector_cursor_head (drouting->G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
     {
       node = (struct node *) vns->data;
-      table = (unsigned long *) tag_hash_table_create (FLOW_LABEL_MASK);
-#if 0
-      for (i = 0; i < FLOW_LABEL_MASK; i++)
-        fprintf (stderr, "node %d: table[%#x]: %#x\n",
-                 node->id, i, table[i]);
-#endif /*0*/
-      vector_set (hash_tables, node->id, (void *) table);
+      vector_set (tag_hashes, node->id,
+                  (void *) tag_hash_create (FLOW_LABEL_BITS));
     }
 
 
@@ -1482,7 +1822,7 @@ DEFINE_COMMAND (simulate_deflection_drouting,
     {
       /* prepare failure nodes */
       fprintf (shell->terminal, "%d-th trial: failure node: ", n);
-      failure_nodes = vector_create ();
+      failure_nodes = vector_create_indexed ();
       for (i = 0; i < nfailures; i++)
         {
           failure_id = random () % deflection->G->nodes->size;
@@ -1493,14 +1833,15 @@ DEFINE_COMMAND (simulate_deflection_drouting,
       fprintf (shell->terminal, "\n");
 
       /* for each source */
-      for (vns = vector_head (deflection->G->nodes); vns;
-           vns = vector_next (vns))
+      for (vns = vector_cursor_head (deflection->G->nodes, &vns_cursor); vns;
+           vns = vector_cursor_next (vns))
         {
           src = (struct node *) vns->data;
 
           /* for each destination */
-          for (vnt = vector_head (deflection->G->nodes); vnt;
-               vnt = vector_next (vnt))
+          for (vnt = vector_cursor_head (deflection->G->nodes,
+                                         &vnt_cursor); vnt;
+               vnt = vector_cursor_next (vnt))
             {
               dst = (struct node *) vnt->data;
 
@@ -1508,8 +1849,8 @@ DEFINE_COMMAND (simulate_deflection_drouting,
                 continue;
 
               stdown = 0;
-              for (vn = vector_head (failure_nodes); vn;
-                   vn = vector_next (vn))
+              for (vn = vector_cursor_head (failure_nodes, &vn_cursor); vn;
+                   vn = vector_cursor_next (vn))
                 {
                   node = (struct node *) vn->data;
                   if (node == src || node == dst)
@@ -1528,13 +1869,10 @@ DEFINE_COMMAND (simulate_deflection_drouting,
 
               /* if the path does not contain failure, skip */
               isfail = 0;
-              for (vn = vector_head (failure_nodes); vn;
-                   vn = vector_next (vn))
-                {
-                  node = (struct node *) vn->data;
-                  if (vector_lookup (node, path->path))
-                    isfail++;
-                }
+              for (vn = vector_cursor_head (path->path, &vn_cursor); vn;
+                   vn = vector_cursor_next (vn))
+                if (vector_lookup (vn->data, failure_nodes))
+                  isfail++;
 
               if (! isfail)
                 {
@@ -1556,12 +1894,17 @@ DEFINE_COMMAND (simulate_deflection_drouting,
                                       deflection, router_primes,
                                       failure_nodes);
               drouting_count_retry (shell, src, dst,
-                                    drouting, hash_tables,
+                                    drouting, tag_hashes,
                                     failure_nodes);
             }
         }
       vector_delete (failure_nodes);
     }
+
+  for (i = 0; i < tag_hashes->size; i++)
+    if (vector_get (tag_hashes, i))
+      tag_hash_delete ((struct tag_hash *) vector_get (tag_hashes, i));
+  vector_delete (tag_hashes);
 }
 
 #endif /*0*/
@@ -1584,6 +1927,7 @@ DEFINE_COMMAND (simulate_failure_recovery,
   struct routing *routing;
   time_t seed;
   struct vector_node *vn, *vns, *vnt;
+  struct vector_node vns_cursor, vnt_cursor, vn_cursor;
   struct node *node, *src, *dst;
   int i, n, m;
   struct vector *failure_nodes;
@@ -1611,7 +1955,7 @@ DEFINE_COMMAND (simulate_failure_recovery,
     {
       /* prepare failure nodes */
       fprintf (shell->terminal, "%d-th trial: failure node: ", n);
-      failure_nodes = vector_create ();
+      failure_nodes = vector_create_indexed ();
       for (i = 0; i < nfailures; i++)
         {
           do {
@@ -1624,14 +1968,14 @@ DEFINE_COMMAND (simulate_failure_recovery,
       fprintf (shell->terminal, "\n");
 
       /* for each source */
-      for (vns = vector_head (routing->G->nodes); vns;
-           vns = vector_next (vns))
+      for (vns = vector_cursor_head (routing->G->nodes, &vns_cursor); vns;
+           vns = vector_cursor_next (vns))
         {
           src = (struct node *) vns->data;
 
           /* for each destination */
-          for (vnt = vector_head (routing->G->nodes); vnt;
-               vnt = vector_next (vnt))
+          for (vnt = vector_cursor_head (routing->G->nodes, &vnt_cursor); vnt;
+               vnt = vector_cursor_next (vnt))
             {
               dst = (struct node *) vnt->data;
 
@@ -1639,8 +1983,8 @@ DEFINE_COMMAND (simulate_failure_recovery,
                 continue;
 
               stdown = 0;
-              for (vn = vector_head (failure_nodes); vn;
-                   vn = vector_next (vn))
+              for (vn = vector_cursor_head (failure_nodes, &vn_cursor); vn;
+                   vn = vector_cursor_next (vn))
                 {
                   node = (struct node *) vn->data;
                   if (node == src || node == dst)
@@ -1661,13 +2005,10 @@ DEFINE_COMMAND (simulate_failure_recovery,
 
                   /* if the path does not contain failure, skip */
                   isfail = 0;
-                  for (vn = vector_head (failure_nodes); vn;
-                       vn = vector_next (vn))
-                    {
-                      node = (struct node *) vn->data;
-                      if (vector_lookup (node, path->path))
-                        isfail++;
-                    }
+                  for (vn = vector_cursor_head (path->path, &vn_cursor); vn;
+                       vn = vector_cursor_next (vn))
+                    if (vector_lookup (vn->data, failure_nodes))
+                      isfail++;
 
                   fprintf (shell->terminal, "  m: %d path: ", m);
                   print_nodelist (shell->terminal, path->path);
@@ -1689,6 +2030,284 @@ DEFINE_COMMAND (simulate_failure_recovery,
     }
 }
 
+/* aggregated, multi-threaded failure-recovery simulation.
+   the trials are independent: each one draws its failure nodes and
+   forwarding decisions from its own counter-based stream, derived
+   from the seed and the trial number, so the result is the same for
+   any number of threads.  instead of the paths, the success ratio of
+   each (s,t) in each trial is counted in a histogram. */
+
+#define FAILURE_RECOVERY_BINS 11   /* [0.0-0.1) ... [0.9-1.0), 1.0 */
+
+struct failure_recovery
+{
+  struct routing *routing;
+  struct route_flat *flat;
+  unsigned int nnodes;
+  unsigned int nfailures;
+  unsigned int mtrials;
+  unsigned long long seed;
+  struct failure_recovery_worker *workers;
+};
+
+struct failure_recovery_worker
+{
+  unsigned long *failed;        /* bitset of the failure nodes */
+  unsigned int *stdown;         /* by s * nnodes + t */
+  unsigned int *hist;           /* by (s * nnodes + t) * BINS + bin */
+};
+
+/* forward from s toward t at random by the nexthop ratios, as
+   route_path_random_forward () does, and stop at the first failure
+   node.  returns 1 if t is reached without a failure. */
+static int
+failure_recovery_forward (unsigned int s, unsigned int t,
+                          struct failure_recovery *fr,
+                          unsigned long *failed,
+                          struct random_stream *stream)
+{
+  struct route_flat *flat = fr->flat;
+  unsigned int current, hops, j, begin, end;
+  double needle, max, sum;
+
+  current = s;
+  for (hops = 0; current != t; hops++)
+    {
+      if (BITSET_ISSET (failed, current) || hops >= fr->nnodes)
+        return 0;
+
+      begin = ROUTE_FLAT_BEGIN (flat, current, t);
+      end = ROUTE_FLAT_END (flat, current, t);
+      if (begin == end)
+        return 0;
+
+      sum = 0.0;
+      for (j = begin; j < end; j++)
+        sum += flat->ratio[j];
+
+      needle = random_stream_double (stream);
+      if (sum > 0.0)
+        {
+          /* the last nexthop takes the rounding error of the ratios */
+          max = 0.0;
+          for (j = begin; j < end - 1; j++)
+            {
+              max += flat->ratio[j];
+              if (needle < max)
+                break;
+            }
+        }
+      else
+        {
+          /* no ratios (e.g., plain ECMP routes): split evenly,
+             as route_dag_ratio () */
+          j = begin + (unsigned int) (needle * (end - begin));
+          if (j >= end)
+            j = end - 1;
+        }
+      current = flat->nexthop[j];
+    }
+
+  return (BITSET_ISSET (failed, t) ? 0 : 1);
+}
+
+static void
+failure_recovery_trial (void *arg, unsigned int trial, unsigned int worker)
+{
+  struct failure_recovery *fr = (struct failure_recovery *) arg;
+  struct failure_recovery_worker *w = &fr->workers[worker];
+  struct random_stream stream;
+  unsigned int i, s, t, m, id, success, bin;
+  unsigned long st;
+
+  random_stream_init (&stream, fr->seed, trial);
+
+  /* prepare distinct failure nodes */
+  bitset_clear (w->failed, fr->nnodes);
+  for (i = 0; i < fr->nfailures; i++)
+    {
+      do
+        id = random_stream_next (&stream) % fr->nnodes;
+      while (BITSET_ISSET (w->failed, id));
+      BITSET_SET (w->failed, id);
+    }
+
+  for (s = 0; s < fr->nnodes; s++)
+    for (t = 0; t < fr->nnodes; t++)
+      {
+        if (s == t)
+          continue;
+
+        st = (unsigned long) s * fr->nnodes + t;
+        if (BITSET_ISSET (w->failed, s) || BITSET_ISSET (w->failed, t))
+          {
+            w->stdown[st]++;
+            continue;
+          }
+
+        success = 0;
+        for (m = 0; m < fr->mtrials; m++)
+          success += failure_recovery_forward (s, t, fr, w->failed, &stream);
+
+        bin = success * (FAILURE_RECOVERY_BINS - 1) / fr->mtrials;
+        w->hist[st * FAILURE_RECOVERY_BINS + bin]++;
+      }
+}
+
+DEFINE_COMMAND (simulate_failure_recovery_seed,
+                "simulate failure-recovery routing <0-4294967295> ntrials <0-10000> failure-nodes <1-100> st-trial <1-1000> seed <0-4294967295>",
+                "simulate\n"
+                "simulate failure-recovery simulation\n"
+                "specify routing\n"
+                "specify routing ID\n"
+                "specify number of trials\n"
+                "specify number of trials\n"
+                "specify number of failure nodes\n"
+                "specify number of failure nodes\n"
+                "specify number of trials between src and dst\n"
+                "specify number of trials between src and dst\n"
+                "aggregate the results with an explicit random seed\n"
+                "specify random seed\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct failure_recovery fr;
+  struct failure_recovery_worker *w;
+  unsigned int ntrials, nthreads = 1;
+  unsigned int i, s, t, bin, nnodes;
+  unsigned long st, npairs;
+  unsigned int *stdown, *hist;
+  unsigned long long total[FAILURE_RECOVERY_BINS];
+  unsigned long long down, sum;
+  double ratio;
+
+  memset (&fr, 0, sizeof (struct failure_recovery));
+  fr.routing = (struct routing *) instance_lookup ("routing", argv[3]);
+  if (! fr.routing)
+    {
+      fprintf (shell->terminal, "No such routing instance: %s\n", argv[3]);
+      return;
+    }
+  if (fr.routing->route == NULL && fr.routing->flat == NULL)
+    {
+      fprintf (shell->terminal, "no route calculated for routing-%s.\n",
+               fr.routing->name);
+      return;
+    }
+
+  ntrials = strtoul (argv[5], NULL, 0);
+  fr.nfailures = strtoul (argv[7], NULL, 0);
+  fr.mtrials = strtoul (argv[9], NULL, 0);
+  fr.seed = strtoul (argv[11], NULL, 0);
+  if (argc > 13)
+    nthreads = strtoul (argv[13], NULL, 0);
+
+  fr.flat = route_freeze (fr.routing);
+  fr.nnodes = nnodes = fr.flat->nnodes;
+  if (fr.nfailures > nnodes)
+    {
+      fprintf (shell->terminal, "too many failure nodes: %u (%u nodes)\n",
+               fr.nfailures, nnodes);
+      return;
+    }
+
+  if (nthreads < 1)
+    nthreads = 1;
+  if (ntrials && nthreads > ntrials)
+    nthreads = ntrials;
+
+  npairs = (unsigned long) nnodes * nnodes;
+  fr.workers = (struct failure_recovery_worker *)
+    calloc (nthreads, sizeof (struct failure_recovery_worker));
+  for (i = 0; i < nthreads; i++)
+    {
+      w = &fr.workers[i];
+      w->failed = bitset_create (nnodes);
+      w->stdown = (unsigned int *) calloc (npairs + 1, sizeof (unsigned int));
+      w->hist = (unsigned int *)
+        calloc (npairs * FAILURE_RECOVERY_BINS + 1, sizeof (unsigned int));
+    }
+
+  workqueue_run (nthreads, ntrials, failure_recovery_trial, &fr);
+
+  stdown = fr.workers[0].stdown;
+  hist = fr.workers[0].hist;
+  for (i = 1; i < nthreads; i++)
+    {
+      w = &fr.workers[i];
+      WORKQUEUE_SUM (stdown, w->stdown, npairs);
+      WORKQUEUE_SUM (hist, w->hist, npairs * FAILURE_RECOVERY_BINS);
+    }
+
+  fprintf (shell->terminal, "seed: %llu\n", fr.seed);
+  fprintf (shell->terminal,
+           "routing-%s failure-recovery: %u trials, %u failure nodes, "
+           "%u st-trials\n", fr.routing->name, ntrials, fr.nfailures,
+           fr.mtrials);
+  fprintf (shell->terminal,
+           "success ratio histogram: bin i = [i/%d, (i+1)/%d), "
+           "bin %d = 1.0\n", FAILURE_RECOVERY_BINS - 1,
+           FAILURE_RECOVERY_BINS - 1, FAILURE_RECOVERY_BINS - 1);
+
+  memset (total, 0, sizeof (total));
+  down = 0;
+  sum = 0;
+  for (s = 0; s < nnodes; s++)
+    for (t = 0; t < nnodes; t++)
+      {
+        if (s == t)
+          continue;
+
+        st = (unsigned long) s * nnodes + t;
+        fprintf (shell->terminal, "routing-%s %u-%u stdown %u hist:",
+                 fr.routing->name, s, t, stdown[st]);
+        for (bin = 0; bin < FAILURE_RECOVERY_BINS; bin++)
+          {
+            fprintf (shell->terminal, " %u",
+                     hist[st * FAILURE_RECOVERY_BINS + bin]);
+            total[bin] += hist[st * FAILURE_RECOVERY_BINS + bin];
+          }
+        fprintf (shell->terminal, "\n");
+        down += stdown[st];
+      }
+
+  fprintf (shell->terminal, "routing-%s failures %u stdown %llu hist:",
+           fr.routing->name, fr.nfailures, down);
+  for (bin = 0; bin < FAILURE_RECOVERY_BINS; bin++)
+    {
+      fprintf (shell->terminal, " %llu", total[bin]);
+      sum += total[bin];
+    }
+  ratio = (sum ? (double) total[FAILURE_RECOVERY_BINS - 1] / sum : 0.0);
+  fprintf (shell->terminal, " all-success %f\n", ratio);
+
+  for (i = 0; i < nthreads; i++)
+    {
+      w = &fr.workers[i];
+      bitset_delete (w->failed);
+      free (w->stdown);
+      free (w->hist);
+    }
+  free (fr.workers);
+}
+
+ALIAS_COMMAND (simulate_failure_recovery_seed_threads,
+               simulate_failure_recovery_seed,
+                "simulate failure-recovery routing <0-4294967295> ntrials <0-10000> failure-nodes <1-100> st-trial <1-1000> seed <0-4294967295> threads <1-1024>",
+                "simulate\n"
+                "simulate failure-recovery simulation\n"
+                "specify routing\n"
+                "specify routing ID\n"
+                "specify number of trials\n"
+                "specify number of trials\n"
+                "specify number of failure nodes\n"
+                "specify number of failure nodes\n"
+                "specify number of trials between src and dst\n"
+                "specify number of trials between src and dst\n"
+                "aggregate the results with an explicit random seed\n"
+                "specify random seed\n"
+                "calculate in multiple threads\n"
+                "specify number of threads\n")
+
 
 
 void
@@ -1703,6 +2322,7 @@ network_init ()
   INSTALL_COMMAND (cmdset_network, show_network);
   INSTALL_COMMAND (cmdset_network, show_flows_on_link);
   INSTALL_COMMAND (cmdset_network, network_load_traffic_flows);
+  INSTALL_COMMAND (cmdset_network, network_load_traffic_flows_per_flow);
 #if 0
   INSTALL_COMMAND (cmdset_network, simulate_deflection);
   INSTALL_COMMAND (cmdset_network, simulate_drouting);
@@ -1710,14 +2330,22 @@ network_init ()
 #endif /*0*/
 
   INSTALL_COMMAND (cmdset_network, simulate_failure_recovery);
+  INSTALL_COMMAND (cmdset_network, simulate_failure_recovery_seed);
+  INSTALL_COMMAND (cmdset_network, simulate_failure_recovery_seed_threads);
+  INSTALL_COMMAND (cmdset_network, simulate_failure_sweep_nodes);
+  INSTALL_COMMAND (cmdset_network, simulate_failure_sweep_nodes_threads);
+  INSTALL_COMMAND (cmdset_network, simulate_failure_sweep_links);
+  INSTALL_COMMAND (cmdset_network, simulate_failure_sweep_links_threads);
 }
 
 void
 network_finish ()
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct network *network;
-  for (vn = vector_head (networks); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (networks, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       network = (struct network *) vn->data;
       if (network)
@@ -43,8 +43,24 @@ struct network
   struct vector **flows_on_edge;
   struct vector **flows_drop_on_node;
   struct vector *config;
+
+  /* how the last network-load computed the loads */
+  int load_mode;
+
+  /* NETWORK_LOAD_AGGREGATE results */
+  unsigned long ndemands;
+  double *load_on_edge;
+  double *drop_on_node;
+  unsigned int *dsts_on_edge;   /* destinations using the edge */
 };
 
+/* network-load traffic-flows pushes the demands toward each
+   destination through its nexthop DAG at once (aggregate).  with
+   "per-flow", every (s,t) flow is split and tracked hop by hop as
+   struct flow, for debugging. */
+#define NETWORK_LOAD_AGGREGATE 0
+#define NETWORK_LOAD_PER_FLOW  1
+
 struct flow
 {
   int source;
@@ -53,6 +69,8 @@ struct flow
   struct vector *path;
 };
 
+void load_traffic_aggregate (struct network *N);
+
 void network_init ();
 void network_finish ();
 
@@ -60,6 +78,8 @@ struct vector *prime_vector_create (int limit);
 
 int chash_selection (int router_id, unsigned int tag,
                      void *hash_tables);
+int chash_selection_keyed (int router_id, unsigned int tag,
+                           void *tag_hashes);
 int deflection_selection (int router_id, unsigned int tag,
                           void *router_primes);
 
@@ -21,6 +21,8 @@
 #include <includes.h>
 
 #include "vector.h"
+#include "bitset.h"
+#include "timer.h"
 #include "graph.h"
 #include "module.h"
 
@@ -67,12 +69,12 @@ sprint_nodelist (char *buf, int size, struct vector *path)
   char *p = buf;
   int left = size;
   int ret;
-  struct vector_node *vn;
+  struct vector_node *vn, vn_cursor;
   struct node *x;
 
   /* print head node of the path */
   memset (buf, 0, size);
-  vn = vector_head (path);
+  vn = vector_cursor_head (path, &vn_cursor);
   if (! vn)
     return NULL;
   x = (struct node *) vn->data;
@@ -81,7 +83,7 @@ sprint_nodelist (char *buf, int size, struct vector *path)
   left -= ret;
 
   /* print the rest nodes */
-  while (left > 0 && (vn = vector_next (vn)) != NULL)
+  while (left > 0 && (vn = vector_cursor_next (vn)) != NULL)
     {
       x = (struct node *) vn->data;
       ret = snprintf (p, left, " %d", x->id);
@@ -105,13 +107,15 @@ char *
 sprint_nodelinklist (char *buf, int size, struct vector *path)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct node *node, *prev;
   struct link *link;
   char tmp[128];
 
   memset (tmp, 0, sizeof (tmp));
   prev = NULL;
-  for (vn = vector_head (path); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (path, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 
@@ -231,10 +235,12 @@ path_enum_next (struct path *path)
   struct link *link, *currentlink;
   int index;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   /* first try to lengthen the path by adding the node with least ID */
   current = path_end (path);
-  for (vn = vector_head (current->olinks); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (current->olinks, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       link = (struct link *) vn->data;
 
@@ -244,7 +250,6 @@ path_enum_next (struct path *path)
 
       /* a new longer path found. return it. */
       vector_add (link->to, path->path);
-      vector_break (vn);
       return path;
     }
 
@@ -262,7 +267,8 @@ path_enum_next (struct path *path)
       parent = vector_get (path->path, index - 1);
       currentlink = link_get (parent, current, parent->g);
 
-      for (vn = vector_head (parent->olinks); vn; vn = vector_next (vn))
+      for (vn = vector_cursor_head (parent->olinks, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
         {
           link = (struct link *) vn->data;
           if (link == currentlink)
@@ -282,7 +288,6 @@ path_enum_next (struct path *path)
           /* new link found. return the path
              after replacing the current node */
           vector_set (path->path, index, link->to);
-          vector_break (vn);
           return path;
         }
     }
@@ -294,16 +299,220 @@ path_enum_next (struct path *path)
   return NULL;
 }
 
+/* the nodes that have a path to t, by the reverse adjacency */
+static void
+path_enum_reach_create (struct path_enum *pe)
+{
+  struct graph_csr *csr = pe->csr;
+  unsigned int head, tail, u, v, i;
+
+  pe->reach = bitset_create (csr->nnodes);
+  head = tail = 0;
+  pe->queue[tail++] = pe->t;
+  BITSET_SET (pe->reach, pe->t);
+  while (head < tail)
+    {
+      u = pe->queue[head++];
+      for (i = csr->ioffset[u]; i < csr->ioffset[u + 1]; i++)
+        {
+          v = csr->isource[i];
+          if (BITSET_ISSET (pe->reach, v))
+            continue;
+          BITSET_SET (pe->reach, v);
+          pe->queue[tail++] = v;
+        }
+    }
+}
+
+/* whether t is reachable from v without the nodes on the path.
+   each call walks the graph once, but a node that passes leads to
+   at least one s-t path, so the check costs O(m) per path prefix
+   that is part of an answer. */
+static int
+path_enum_reachable (struct path_enum *pe, unsigned int v)
+{
+  struct graph_csr *csr = pe->csr;
+  unsigned int head, tail, u, w, i;
+
+  if (++pe->generation == 0)
+    {
+      memset (pe->mark, 0, csr->nnodes * sizeof (unsigned int));
+      pe->generation = 1;
+    }
+
+  head = tail = 0;
+  pe->queue[tail++] = v;
+  pe->mark[v] = pe->generation;
+  while (head < tail)
+    {
+      u = pe->queue[head++];
+      for (i = csr->ooffset[u]; i < csr->ooffset[u + 1]; i++)
+        {
+          w = csr->otarget[i];
+          if (w == (unsigned int) pe->t)
+            return 1;
+          if (pe->mark[w] == pe->generation || BITSET_ISSET (pe->visited, w))
+            continue;
+          pe->mark[w] = pe->generation;
+          pe->queue[tail++] = w;
+        }
+    }
+  return 0;
+}
+
+struct path_enum *
+path_enum_create (struct node *s, struct node *t, int flags)
+{
+  struct path_enum *pe;
+  unsigned int nnodes;
+
+  pe = (struct path_enum *) malloc (sizeof (struct path_enum));
+  memset (pe, 0, sizeof (struct path_enum));
+
+  pe->csr = graph_freeze (s->g);
+  nnodes = pe->csr->nnodes;
+  pe->s = s->id;
+  pe->t = (t ? (int) t->id : -1);
+  pe->flags = (t ? flags : 0);
+
+  pe->node = (unsigned int *) calloc (nnodes + 1, sizeof (unsigned int));
+  pe->next = (unsigned int *) calloc (nnodes + 1, sizeof (unsigned int));
+  pe->cost = (unsigned long *) calloc (nnodes + 1, sizeof (unsigned long));
+  pe->visited = bitset_create (nnodes);
+  pe->queue = (unsigned int *) calloc (nnodes + 1, sizeof (unsigned int));
+
+  if (t)
+    path_enum_reach_create (pe);
+  if (pe->flags & PATH_ENUM_PRUNE_REACH)
+    pe->mark = (unsigned int *) calloc (nnodes + 1, sizeof (unsigned int));
+
+  pe->path = path_create ();
+  return pe;
+}
+
+void
+path_enum_set_max_hops (struct path_enum *pe, unsigned int max_hops)
+{
+  pe->max_hops = max_hops;
+}
+
+void
+path_enum_set_max_cost (struct path_enum *pe, struct weight *W,
+                        unsigned long max_cost)
+{
+  pe->W = W;
+  pe->max_cost = max_cost;
+}
+
+void
+path_enum_delete (struct path_enum *pe)
+{
+  free (pe->node);
+  free (pe->next);
+  free (pe->cost);
+  bitset_delete (pe->visited);
+  free (pe->queue);
+  if (pe->reach)
+    bitset_delete (pe->reach);
+  if (pe->mark)
+    free (pe->mark);
+  path_delete (pe->path);
+  free (pe);
+}
+
+/* the next path, or NULL at the end */
+struct path *
+path_enum_step (struct path_enum *pe)
+{
+  struct graph_csr *csr = pe->csr;
+  unsigned int u, v, e;
+  unsigned long cost;
+
+  if (! pe->started)
+    {
+      pe->started++;
+      pe->depth = 0;
+      pe->node[0] = pe->s;
+      pe->next[0] = csr->ooffset[pe->s];
+      pe->cost[0] = 0;
+      BITSET_SET (pe->visited, pe->s);
+      vector_add_allow_dup (csr->node[pe->s], pe->path->path);
+      pe->path->cost = 0;
+
+      /* the path of the source alone */
+      if (pe->t < 0 || pe->s == (unsigned int) pe->t)
+        return pe->path;
+    }
+
+  while (pe->path->path->size)
+    {
+      u = pe->node[pe->depth];
+
+      /* backtrack when the node is done: all its links tried, or it
+         is the destination, or the path is at the hop limit */
+      if (pe->next[pe->depth] == csr->ooffset[u + 1] ||
+          (pe->t >= 0 && u == (unsigned int) pe->t) ||
+          (pe->max_hops && pe->depth >= pe->max_hops))
+        {
+          BITSET_CLR (pe->visited, u);
+          vector_remove_index (pe->path->path->size - 1, pe->path->path);
+          if (pe->depth == 0)
+            break;
+          pe->depth--;
+          continue;
+        }
+
+      e = pe->next[pe->depth]++;
+      v = csr->otarget[e];
+      if (BITSET_ISSET (pe->visited, v))
+        continue;
+
+      cost = pe->cost[pe->depth];
+      if (pe->W)
+        {
+          cost += pe->W->weight[csr->olink[e]];
+          if (pe->max_cost && cost > pe->max_cost)
+            continue;
+        }
+
+      if (pe->t >= 0 && v != (unsigned int) pe->t)
+        {
+          if (! BITSET_ISSET (pe->reach, v))
+            continue;
+          if ((pe->flags & PATH_ENUM_PRUNE_REACH) &&
+              ! path_enum_reachable (pe, v))
+            continue;
+        }
+
+      pe->depth++;
+      pe->node[pe->depth] = v;
+      pe->next[pe->depth] = csr->ooffset[v];
+      pe->cost[pe->depth] = cost;
+      BITSET_SET (pe->visited, v);
+      vector_add_allow_dup (csr->node[v], pe->path->path);
+
+      if (pe->t < 0 || v == (unsigned int) pe->t)
+        {
+          pe->path->cost = cost;
+          return pe->path;
+        }
+    }
+
+  return NULL;
+}
+
 unsigned long
 path_cost (struct path *path, struct weight *W)
 {
   struct node *s = NULL, *t = NULL;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct link *link;
 
   path->cost = 0;
 
-  for (vn = vector_head (path->path); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (path->path, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       s = t;
       t = (struct node *) vn->data;
@@ -326,11 +535,13 @@ path_probability (struct path *path)
 {
   struct node *s = NULL, *t = NULL;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct link *link;
 
   path->probability = 1.0;
 
-  for (vn = vector_head (path->path); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (path->path, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       s = t;
       t = (struct node *) vn->data;
@@ -345,7 +556,6 @@ path_probability (struct path *path)
         {
           fprintf (stderr, "link %u-%u: probability is not set\n",
                    link->from->id, link->to->id);
-          vector_break (vn);
           path->probability = 1.0;
           return path->probability;
         }
@@ -357,8 +567,11 @@ path_probability (struct path *path)
 }
 
 void
-path_print (FILE *fp, struct node *s, struct node *t)
+path_print_limit (FILE *fp, struct node *s, struct node *t,
+                  unsigned int max_hops, struct weight *W,
+                  unsigned long max_cost)
 {
+  struct path_enum *pe;
   struct path *path;
   char buf[256];
   unsigned long max = 0;
@@ -375,26 +588,37 @@ path_print (FILE *fp, struct node *s, struct node *t)
       return;
     }
 
-  for (path = path_enum_first (s); path; path = path_enum_next (path))
-    if (path_end (path) == t)
-      {
-        num++;
-        if (max < path->path->size)
-          max = path->path->size;
-        if (min == 0 || min > path->path->size)
-          min = path->path->size;
-        sum += path->path->size;
-
-        sprint_nodelist (buf, sizeof (buf), path->path);
-        fprintf (stderr, "path: %s\n", buf);
-      }
+  pe = path_enum_create (s, t, PATH_ENUM_PRUNE_REACH);
+  path_enum_set_max_hops (pe, max_hops);
+  path_enum_set_max_cost (pe, W, max_cost);
+  while ((path = path_enum_step (pe)) != NULL)
+    {
+      num++;
+      if (max < path->path->size)
+        max = path->path->size;
+      if (min == 0 || min > path->path->size)
+        min = path->path->size;
+      sum += path->path->size;
+
+      sprint_nodelist (buf, sizeof (buf), path->path);
+      fprintf (stderr, "path: %s\n", buf);
+    }
+  path_enum_delete (pe);
+
   avg = (double)sum / num;
   fprintf (fp, "num: %lu, min: %lu, max: %lu, avg: %f\n", num, min, max, avg);
 }
 
+void
+path_print (FILE *fp, struct node *s, struct node *t)
+{
+  path_print_limit (fp, s, t, 0, NULL, 0);
+}
+
 void
 path_print_source_to_all (FILE *fp, struct node *s)
 {
+  struct path_enum *pe;
   struct path *path;
   char buf[256];
   unsigned long max = 0;
@@ -402,7 +626,8 @@ path_print_source_to_all (FILE *fp, struct node *s)
   unsigned long sum = 0;
   double avg = 0.0;
 
-  for (path = path_enum_first (s); path; path = path_enum_next (path))
+  pe = path_enum_create (s, NULL, 0);
+  while ((path = path_enum_step (pe)) != NULL)
     {
       num++;
       if (max < path->path->size)
@@ -412,6 +637,7 @@ path_print_source_to_all (FILE *fp, struct node *s)
       sprint_nodelist (buf, sizeof (buf), path->path);
       fprintf (fp, "path: %s\n", buf);
     }
+  path_enum_delete (pe);
   avg = (double)sum / num;
   fprintf (fp, "num: %lu, max: %lu, avg: %f\n", num, max, avg);
 }
@@ -419,9 +645,11 @@ path_print_source_to_all (FILE *fp, struct node *s)
 void
 path_print_all_to_dest (FILE *fp, struct node *t)
 {
+  struct path_enum *pe;
   struct path *path;
   char buf[256];
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct node *s;
   unsigned long max = 0;
   unsigned long min = 0;
@@ -429,22 +657,24 @@ path_print_all_to_dest (FILE *fp, struct node *t)
   unsigned long sum = 0;
   double avg = 0.0;
 
-  for (vn = vector_head (t->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (t->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       s = (struct node *) vn->data;
-      for (path = path_enum_first (s); path; path = path_enum_next (path))
-        if (path_end (path) == t)
-          {
-            num++;
-            if (max < path->path->size)
-              max = path->path->size;
-            if (min == 0 || min > path->path->size)
-              min = path->path->size;
-            sum += path->path->size;
-
-            sprint_nodelist (buf, sizeof (buf), path->path);
-            fprintf (fp, "path: %s\n", buf);
-          }
+      pe = path_enum_create (s, t, PATH_ENUM_PRUNE_REACH);
+      while ((path = path_enum_step (pe)) != NULL)
+        {
+          num++;
+          if (max < path->path->size)
+            max = path->path->size;
+          if (min == 0 || min > path->path->size)
+            min = path->path->size;
+          sum += path->path->size;
+
+          sprint_nodelist (buf, sizeof (buf), path->path);
+          fprintf (fp, "path: %s\n", buf);
+        }
+      path_enum_delete (pe);
     }
   avg = (double)sum / num;
   fprintf (fp, "num: %lu, min: %lu, max: %lu, avg: %f\n", num, min, max, avg);
@@ -453,33 +683,37 @@ path_print_all_to_dest (FILE *fp, struct node *t)
 void
 path_print_cost (FILE *fp, struct node *s, struct node *t, struct weight *weight)
 {
+  struct path_enum *pe;
   struct path *path;
 
-  for (path = path_enum_first (s); path; path = path_enum_next (path))
-    if (path_end (path) == t)
-      {
-        path_cost (path, weight);
-        print_path (fp, path);
-        fprintf (fp, "\n");
-      }
+  pe = path_enum_create (s, t, PATH_ENUM_PRUNE_REACH);
+  while ((path = path_enum_step (pe)) != NULL)
+    {
+      path_cost (path, weight);
+      print_path (fp, path);
+      fprintf (fp, "\n");
+    }
+  path_enum_delete (pe);
 }
 
 void
 path_print_probability (FILE *fp, struct node *s, struct node *t)
 {
+  struct path_enum *pe;
   struct path *path;
   char buf[256];
   double p;
   double sum = 0.0;
 
-  for (path = path_enum_first (s); path; path = path_enum_next (path))
-    if (path_end (path) == t)
-      {
-        p = path_probability (path);
-        sprint_nodelist (buf, sizeof (buf), path->path);
-        fprintf (fp, "path: %s: %f\n", buf, p);
-        sum += p;
-      }
+  pe = path_enum_create (s, t, PATH_ENUM_PRUNE_REACH);
+  while ((path = path_enum_step (pe)) != NULL)
+    {
+      p = path_probability (path);
+      sprint_nodelist (buf, sizeof (buf), path->path);
+      fprintf (fp, "path: %s: %f\n", buf, p);
+      sum += p;
+    }
+  path_enum_delete (pe);
 
   fprintf (fp, "sum of all path's probability: %f\n", sum);
 }
@@ -488,32 +722,34 @@ void
 path_print_probability_with_fail (FILE *fp, struct node *s, struct node *t,
                                   struct node *fs, struct node *ft)
 {
+  struct path_enum *pe;
   struct path *path;
   char buf[256];
   double ret;
   double p_valid = 0.0;
   double p_inval = 0.0;
 
-  for (path = path_enum_first (s); path; path = path_enum_next (path))
-    if (path_is_dest (t, path))
-      {
-        ret = path_probability (path);
-        sprint_nodelist (buf, sizeof (buf), path->path);
-        if (path_is_include (path, fs, ft))
-          {
-            fprintf (fp, "path: %s, invalid: p=%.3f\n", buf, ret);
-            fprintf (fp, "p_inval: %.3f = %.3f + %.3f\n",
-                     p_inval + ret, p_inval, ret);
-            p_inval += ret;
-          }
-        else
-          {
-            fprintf (fp, "path: %s, valid: p=%.3f\n", buf, ret);
-            fprintf (fp, "p_valid: %.3f = %.3f + %.3f\n",
-                     p_valid + ret, p_valid, ret);
-            p_valid += ret;
-          }
-      }
+  pe = path_enum_create (s, t, PATH_ENUM_PRUNE_REACH);
+  while ((path = path_enum_step (pe)) != NULL)
+    {
+      ret = path_probability (path);
+      sprint_nodelist (buf, sizeof (buf), path->path);
+      if (path_is_include (path, fs, ft))
+        {
+          fprintf (fp, "path: %s, invalid: p=%.3f\n", buf, ret);
+          fprintf (fp, "p_inval: %.3f = %.3f + %.3f\n",
+                   p_inval + ret, p_inval, ret);
+          p_inval += ret;
+        }
+      else
+        {
+          fprintf (fp, "path: %s, valid: p=%.3f\n", buf, ret);
+          fprintf (fp, "p_valid: %.3f = %.3f + %.3f\n",
+                   p_valid + ret, p_valid, ret);
+          p_valid += ret;
+        }
+    }
+  path_enum_delete (pe);
 
   fprintf (fp, "failed link: %d-%d, p_valid=%.3f, p_inval=%.3f",
            fs->id, ft->id, p_valid, p_inval);
@@ -613,11 +849,14 @@ DEFINE_COMMAND (show_path_all,
   struct graph *G = (struct graph *) shell->context;
   struct node *s, *t;
   struct vector_node *vns, *vnt;
+  struct vector_node vns_cursor, vnt_cursor;
 
-  for (vns = vector_head (G->nodes); vns; vns = vector_next (vns))
+  for (vns = vector_cursor_head (G->nodes, &vns_cursor); vns;
+       vns = vector_cursor_next (vns))
     {
       s = (struct node *) vns->data;
-      for (vnt = vector_head (G->nodes); vnt; vnt = vector_next (vnt))
+      for (vnt = vector_cursor_head (G->nodes, &vnt_cursor); vnt;
+           vnt = vector_cursor_next (vnt))
          {
            t = (struct node *) vnt->data;
 
@@ -791,3 +1030,183 @@ DEFINE_COMMAND (show_path_probability_failure,
 
 
 
+
+DEFINE_COMMAND (show_path_max_hops,
+                "show path source <0-4294967295> destination <0-4294967295> max-hops <1-4294967295>",
+                "display information\n"
+                "display path information\n"
+                "specify source node\n"
+                "specify source node\n"
+                "specify destination node\n"
+                "specify destination node\n"
+                "limit the number of hops of the paths\n"
+                "specify the number of hops\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct graph *G = (struct graph *) shell->context;
+  unsigned long source_id, dest_id, max_hops;
+  struct node *start, *dest;
+
+  source_id = strtoul (argv[3], NULL, 0);
+  dest_id = strtoul (argv[5], NULL, 0);
+  max_hops = strtoul (argv[7], NULL, 0);
+
+  start = node_lookup (source_id, G);
+  if (! start)
+    {
+      fprintf (shell->terminal, "No such node: %lu\n", source_id);
+      return;
+    }
+
+  dest = node_lookup (dest_id, G);
+  if (! dest)
+    {
+      fprintf (shell->terminal, "No such node: %lu\n", dest_id);
+      return;
+    }
+
+  path_print_limit (shell->terminal, start, dest, max_hops, NULL, 0);
+
+  fprintf (shell->terminal, "\n");
+}
+
+DEFINE_COMMAND (show_path_max_cost,
+                "show path source <0-4294967295> destination <0-4294967295> max-cost <1-4294967295> weight <0-4294967295>",
+                "display information\n"
+                "display path information\n"
+                "specify source node\n"
+                "specify source node\n"
+                "specify destination node\n"
+                "specify destination node\n"
+                "limit the cost of the paths\n"
+                "specify the cost\n"
+                "specify weight\n"
+                "specify weight\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct graph *G = (struct graph *) shell->context;
+  unsigned long source_id, dest_id, max_cost;
+  struct node *start, *dest;
+  struct weight *W = NULL;
+
+  source_id = strtoul (argv[3], NULL, 0);
+  dest_id = strtoul (argv[5], NULL, 0);
+  max_cost = strtoul (argv[7], NULL, 0);
+
+  W = (struct weight *) instance_lookup ("weight", argv[9]);
+  if (W == NULL)
+    {
+      fprintf (shell->terminal, "no such weight: weight-%s\n", argv[9]);
+      return;
+    }
+  if (W->G != G)
+    {
+      fprintf (shell->terminal, "weight-%s is not of this graph.\n", argv[9]);
+      return;
+    }
+
+  start = node_lookup (source_id, G);
+  if (! start)
+    {
+      fprintf (shell->terminal, "No such node: %lu\n", source_id);
+      return;
+    }
+
+  dest = node_lookup (dest_id, G);
+  if (! dest)
+    {
+      fprintf (shell->terminal, "No such node: %lu\n", dest_id);
+      return;
+    }
+
+  path_print_limit (shell->terminal, start, dest, 0, W, max_cost);
+
+  fprintf (shell->terminal, "\n");
+}
+
+DEFINE_COMMAND (benchmark_path_enum,
+                "benchmark path-enum source <0-4294967295> destination <0-4294967295>",
+                "benchmark routing calculation.\n"
+                "benchmark the s-t path enumeration\n"
+                "specify source node\n"
+                "specify source node\n"
+                "specify destination node\n"
+                "specify destination node\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct graph *G = (struct graph *) shell->context;
+  unsigned long source_id, dest_id;
+  struct node *s, *t;
+  struct path_enum *pe;
+  struct path *path;
+  struct vector *paths;
+  unsigned long count[3], mismatch = 0, i;
+  unsigned long long usec[3];
+  timer_counter_t start, end, res;
+  int type, flags;
+
+  source_id = strtoul (argv[3], NULL, 0);
+  dest_id = strtoul (argv[5], NULL, 0);
+
+  s = node_lookup (source_id, G);
+  if (! s)
+    {
+      fprintf (shell->terminal, "No such node: %lu\n", source_id);
+      return;
+    }
+  t = node_lookup (dest_id, G);
+  if (! t)
+    {
+      fprintf (shell->terminal, "No such node: %lu\n", dest_id);
+      return;
+    }
+
+  /* the s-t paths by path_enum_next (), to check the others against */
+  paths = vector_create ();
+  count[0] = 0;
+  timer_count (start);
+  for (path = path_enum_first (s); path; path = path_enum_next (path))
+    if (path_end (path) == t)
+      {
+        vector_add_allow_dup (path_copy (path), paths);
+        count[0]++;
+      }
+  timer_count (end);
+  timer_sub (start, end, res);
+  usec[0] = timer_to_usec (res);
+
+  for (type = 1; type <= 2; type++)
+    {
+      flags = (type == 2 ? PATH_ENUM_PRUNE_REACH : 0);
+      count[type] = 0;
+      timer_count (start);
+      pe = path_enum_create (s, t, flags);
+      while ((path = path_enum_step (pe)) != NULL)
+        {
+          if (count[type] >= paths->size ||
+              ! vector_is_same (path->path,
+                                ((struct path *)
+                                 vector_get (paths, count[type]))->path))
+            mismatch++;
+          count[type]++;
+        }
+      path_enum_delete (pe);
+      timer_count (end);
+      timer_sub (start, end, res);
+      usec[type] = timer_to_usec (res);
+    }
+
+  for (i = 0; i < paths->size; i++)
+    path_delete ((struct path *) vector_get (paths, i));
+  vector_delete (paths);
+
+  fprintf (shell->terminal, "Benchmark: path %lu-%lu: %lu paths\n",
+           source_id, dest_id, count[0]);
+  fprintf (shell->terminal, "  path_enum_next: %llu us\n", usec[0]);
+  fprintf (shell->terminal, "  path_enum_step: %llu us, %lu paths\n",
+           usec[1], count[1]);
+  fprintf (shell->terminal, "  path_enum_step (prune-reach): %llu us, "
+           "%lu paths\n", usec[2], count[2]);
+  if (mismatch)
+    fprintf (shell->terminal, "  path mismatch: %lu\n", mismatch);
+}
@@ -48,9 +48,55 @@ int path_compare (struct path *p1, struct path *p2);
 struct path *path_enum_first (struct node *src);
 struct path *path_enum_next (struct path *path);
 
+/* explicit-stack enumeration of the simple paths from s, over the
+   CSR of the graph.  the state is the stack of (node, next adjacency
+   position) and the bitset of the nodes on the path, so a step
+   resumes in O(1).  with a destination t, only the s-t paths are
+   returned, in the same order as path_enum_next () finds them.
+   the path returned is owned by the enumerator. */
+#define PATH_ENUM_PRUNE_REACH 0x01  /* skip nodes that cannot reach t
+                                       without the nodes on the path */
+
+struct path_enum
+{
+  struct graph_csr *csr;
+  unsigned int s;
+  int t;                        /* -1: all paths from s */
+  int flags;
+  int started;
+
+  unsigned int depth;           /* of the last node on the stack */
+  unsigned int *node;           /* node id by depth */
+  unsigned int *next;           /* next CSR position by depth */
+  unsigned long *cost;          /* path cost by depth */
+  unsigned long *visited;       /* bitset of the nodes on the path */
+
+  /* pruning */
+  unsigned int max_hops;        /* 0: no limit */
+  unsigned long max_cost;       /* 0: no limit */
+  struct weight *W;
+  unsigned long *reach;         /* bitset of the nodes that reach t */
+  unsigned int *mark;           /* scratch of the reachability check */
+  unsigned int generation;
+  unsigned int *queue;
+
+  struct path *path;
+};
+
+struct path_enum *path_enum_create (struct node *s, struct node *t,
+                                    int flags);
+void path_enum_set_max_hops (struct path_enum *pe, unsigned int max_hops);
+void path_enum_set_max_cost (struct path_enum *pe, struct weight *W,
+                             unsigned long max_cost);
+struct path *path_enum_step (struct path_enum *pe);
+void path_enum_delete (struct path_enum *pe);
+
 double path_probability (struct path *path);
 
 void path_print (FILE *fp, struct node *s, struct node *t);
+void path_print_limit (FILE *fp, struct node *s, struct node *t,
+                       unsigned int max_hops, struct weight *W,
+                       unsigned long max_cost);
 void path_print_source_to_all (FILE *fp, struct node *s);
 void path_print_cost (FILE *fp, struct node *s, struct node *t, struct weight *W);
 void path_print_probability (FILE *fp, struct node *s, struct node *t);
@@ -64,6 +110,9 @@ EXTERN_COMMAND (show_path_all);
 EXTERN_COMMAND (show_path_cost);
 EXTERN_COMMAND (show_path_probability);
 EXTERN_COMMAND (show_path_probability_failure);
+EXTERN_COMMAND (show_path_max_hops);
+EXTERN_COMMAND (show_path_max_cost);
+EXTERN_COMMAND (benchmark_path_enum);
 
 #endif /*_PATH_H_*/
 
@@ -0,0 +1,587 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "timer.h"
+#include "workqueue.h"
+
+#include "network/graph.h"
+#include "network/path.h"
+#include "network/routing.h"
+#include "network/route-dag.h"
+
+struct route_dag *
+route_dag_create (struct routing *routing, int flags)
+{
+  struct route_dag *dag;
+  unsigned int n, t;
+
+  dag = (struct route_dag *) malloc (sizeof (struct route_dag));
+  memset (dag, 0, sizeof (struct route_dag));
+  dag->routing = routing;
+  dag->flat = route_freeze (routing);
+  dag->flags = flags;
+  dag->nnodes = n = dag->flat->nnodes;
+
+  /* the scratch by nexthop is for one destination at a time */
+  for (t = 0; t < n; t++)
+    if (dag->nentries < ROUTE_FLAT_BEGIN (dag->flat, 0, t + 1) -
+                        ROUTE_FLAT_BEGIN (dag->flat, 0, t))
+      dag->nentries = ROUTE_FLAT_BEGIN (dag->flat, 0, t + 1) -
+                      ROUTE_FLAT_BEGIN (dag->flat, 0, t);
+
+  dag->order = (unsigned int *) calloc (n + 1, sizeof (unsigned int));
+  dag->pred_offset = (unsigned int *) calloc (n + 1, sizeof (unsigned int));
+  dag->pred = (unsigned int *) calloc (dag->nentries + 1, sizeof (unsigned int));
+  dag->remain = (unsigned int *) calloc (n + 1, sizeof (unsigned int));
+
+  dag->count = (unsigned long long *)
+    calloc (n + 1, sizeof (unsigned long long));
+  dag->length_sum = (unsigned long long *)
+    calloc (n + 1, sizeof (unsigned long long));
+  dag->length_max = (unsigned int *) calloc (n + 1, sizeof (unsigned int));
+  dag->length_min = (unsigned int *) calloc (n + 1, sizeof (unsigned int));
+  dag->reach = (double *) calloc (n + 1, sizeof (double));
+  dag->hops = (double *) calloc (n + 1, sizeof (double));
+  if (flags & ROUTE_DAG_HOP_DIST)
+    dag->hop_dist = (double *) calloc ((size_t) n * n + 1, sizeof (double));
+
+  dag->ratio = (double *) calloc (dag->nentries + 1, sizeof (double));
+  dag->traverse = (double *) calloc (dag->nentries + 1, sizeof (double));
+  dag->mass = (double *) calloc (n + 1, sizeof (double));
+
+  return dag;
+}
+
+void
+route_dag_delete (struct route_dag *dag)
+{
+  free (dag->order);
+  free (dag->pred_offset);
+  free (dag->pred);
+  free (dag->remain);
+  free (dag->count);
+  free (dag->length_sum);
+  free (dag->length_max);
+  free (dag->length_min);
+  free (dag->reach);
+  free (dag->hops);
+  if (dag->hop_dist)
+    free (dag->hop_dist);
+  free (dag->ratio);
+  free (dag->traverse);
+  free (dag->mass);
+  free (dag);
+}
+
+static inline unsigned long long
+route_dag_add (unsigned long long a, unsigned long long b)
+{
+  return (a + b < a ? ULLONG_MAX : a + b);
+}
+
+/* the ratios of the nexthops of u as given, or an even split when
+   none is set (e.g., by the SPF calculations) */
+static void
+route_dag_ratio (struct route_dag *dag, unsigned int u)
+{
+  struct route_flat *flat = dag->flat;
+  unsigned int j, begin, end;
+  double sum = 0.0;
+
+  begin = ROUTE_FLAT_BEGIN (flat, u, dag->t);
+  end = ROUTE_FLAT_END (flat, u, dag->t);
+  for (j = begin; j < end; j++)
+    sum += flat->ratio[j];
+  for (j = begin; j < end; j++)
+    dag->ratio[j - dag->base] = (sum > 0.0 ? flat->ratio[j] : 1.0 / (end - begin));
+}
+
+static void
+route_dag_node (struct route_dag *dag, unsigned int u)
+{
+  struct route_flat *flat = dag->flat;
+  unsigned int n = dag->nnodes;
+  unsigned int j, v, h;
+  double r;
+
+  if (u == dag->t)
+    {
+      dag->count[u] = 1;
+      dag->length_sum[u] = 1;
+      dag->length_max[u] = 1;
+      dag->length_min[u] = 1;
+      dag->reach[u] = 1.0;
+      dag->hops[u] = 0.0;
+      if (dag->hop_dist)
+        dag->hop_dist[(size_t) u * n] = 1.0;
+      return;
+    }
+
+  route_dag_ratio (dag, u);
+  for (j = ROUTE_FLAT_BEGIN (flat, u, dag->t);
+       j < ROUTE_FLAT_END (flat, u, dag->t); j++)
+    {
+      v = flat->nexthop[j];
+      r = dag->ratio[j - dag->base];
+
+      if (dag->count[v])
+        {
+          dag->count[u] = route_dag_add (dag->count[u], dag->count[v]);
+          dag->length_sum[u] =
+            route_dag_add (dag->length_sum[u],
+                           route_dag_add (dag->length_sum[v], dag->count[v]));
+          if (dag->length_max[u] < dag->length_max[v] + 1)
+            dag->length_max[u] = dag->length_max[v] + 1;
+          if (dag->length_min[u] > dag->length_min[v] + 1)
+            dag->length_min[u] = dag->length_min[v] + 1;
+        }
+
+      dag->reach[u] += r * dag->reach[v];
+      dag->hops[u] += r * (dag->hops[v] + dag->reach[v]);
+
+      if (dag->hop_dist)
+        for (h = 1; h < n; h++)
+          dag->hop_dist[(size_t) u * n + h] +=
+            r * dag->hop_dist[(size_t) v * n + h - 1];
+    }
+}
+
+/* compute the aggregates of all the sources toward t.
+   returns the number of unresolved nodes (on or behind a loop). */
+unsigned int
+route_dag_compute (struct route_dag *dag, unsigned int t)
+{
+  struct route_flat *flat = dag->flat;
+  unsigned int n = dag->nnodes;
+  unsigned int u, v, j, i, head;
+
+  dag->t = t;
+  dag->base = ROUTE_FLAT_BEGIN (flat, 0, t);
+
+  if (! (dag->flags & ROUTE_DAG_ORDER_ONLY))
+    {
+      memset (dag->count, 0, n * sizeof (unsigned long long));
+      memset (dag->length_sum, 0, n * sizeof (unsigned long long));
+      memset (dag->length_max, 0, n * sizeof (unsigned int));
+      for (u = 0; u < n; u++)
+        dag->length_min[u] = UINT_MAX;
+      memset (dag->reach, 0, n * sizeof (double));
+      memset (dag->hops, 0, n * sizeof (double));
+      if (dag->hop_dist)
+        memset (dag->hop_dist, 0, (size_t) n * n * sizeof (double));
+    }
+
+  /* the nodes that forward to each node, and the number of the
+     nexthops of each node yet to be resolved */
+  memset (dag->pred_offset, 0, (n + 1) * sizeof (unsigned int));
+  for (u = 0; u < n; u++)
+    {
+      dag->remain[u] = 0;
+      if (u == t)
+        continue;
+      for (j = ROUTE_FLAT_BEGIN (flat, u, t); j < ROUTE_FLAT_END (flat, u, t);
+           j++)
+        {
+          dag->pred_offset[flat->nexthop[j] + 1]++;
+          dag->remain[u]++;
+        }
+    }
+  for (v = 0; v < n; v++)
+    dag->pred_offset[v + 1] += dag->pred_offset[v];
+  for (u = 0; u < n; u++)
+    {
+      if (u == t)
+        continue;
+      for (j = ROUTE_FLAT_BEGIN (flat, u, t); j < ROUTE_FLAT_END (flat, u, t);
+           j++)
+        {
+          v = flat->nexthop[j];
+          dag->pred[dag->pred_offset[v]++] = u;
+        }
+    }
+  for (v = n; v > 0; v--)
+    dag->pred_offset[v] = dag->pred_offset[v - 1];
+  dag->pred_offset[0] = 0;
+
+  /* Kahn's order from t and the dead ends */
+  dag->norder = 0;
+  dag->order[dag->norder++] = t;
+  for (u = 0; u < n; u++)
+    if (u != t && dag->remain[u] == 0)
+      dag->order[dag->norder++] = u;
+
+  for (head = 0; head < dag->norder; head++)
+    {
+      v = dag->order[head];
+      if (! (dag->flags & ROUTE_DAG_ORDER_ONLY))
+        route_dag_node (dag, v);
+      for (i = dag->pred_offset[v]; i < dag->pred_offset[v + 1]; i++)
+        {
+          u = dag->pred[i];
+          if (--dag->remain[u] == 0)
+            dag->order[dag->norder++] = u;
+        }
+    }
+
+  return n - dag->norder;
+}
+
+/* the probability that a packet from source (or from every node if
+   source < 0, as a sum) traverses each nexthop toward t, by pushing
+   the probability mass from the sources down the DAG. */
+void
+route_dag_traverse (struct route_dag *dag, int source)
+{
+  struct route_flat *flat = dag->flat;
+  unsigned int n = dag->nnodes;
+  unsigned int u, j, i;
+  double flow;
+
+  memset (dag->mass, 0, n * sizeof (double));
+  memset (dag->traverse, 0, dag->nentries * sizeof (double));
+
+  for (i = 0; i < dag->norder; i++)
+    {
+      u = dag->order[i];
+      if (source < 0 || (unsigned int) source == u)
+        dag->mass[u] = 1.0;
+    }
+
+  for (i = dag->norder; i-- > 0; )
+    {
+      u = dag->order[i];
+      if (u == dag->t || dag->mass[u] == 0.0)
+        continue;
+      for (j = ROUTE_FLAT_BEGIN (flat, u, dag->t);
+           j < ROUTE_FLAT_END (flat, u, dag->t); j++)
+        {
+          flow = dag->mass[u] * dag->ratio[j - dag->base];
+          dag->traverse[j - dag->base] += flow;
+          dag->mass[flat->nexthop[j]] += flow;
+        }
+    }
+}
+
+/* the state of each node toward the t of the last route_dag_compute ().
+   only the topological order is needed: the nexthops of a node are
+   decided before the node, and the nodes left out of the order are
+   on a loop or forward into one. */
+void
+route_dag_verify (struct route_dag *dag, unsigned char *status)
+{
+  struct route_flat *flat = dag->flat;
+  unsigned int t = dag->t;
+  unsigned int u, i, j;
+  unsigned char state;
+
+  for (u = 0; u < dag->nnodes; u++)
+    status[u] = ROUTE_VERIFY_LOOP;
+
+  for (i = 0; i < dag->norder; i++)
+    {
+      u = dag->order[i];
+      if (u == t)
+        {
+          status[u] = ROUTE_VERIFY_OK;
+          continue;
+        }
+      if (ROUTE_FLAT_BEGIN (flat, u, t) == ROUTE_FLAT_END (flat, u, t))
+        {
+          status[u] = ROUTE_VERIFY_NOROUTE;
+          continue;
+        }
+
+      status[u] = ROUTE_VERIFY_OK;
+      for (j = ROUTE_FLAT_BEGIN (flat, u, t); j < ROUTE_FLAT_END (flat, u, t);
+           j++)
+        {
+          state = status[flat->nexthop[j]];
+          if (state == ROUTE_VERIFY_NOROUTE ||
+              state == ROUTE_VERIFY_BLACKHOLE)
+            status[u] = ROUTE_VERIFY_BLACKHOLE;
+        }
+    }
+}
+
+struct route_dag_summary
+{
+  unsigned long long count;
+  unsigned long long length_sum;
+  unsigned int length_max;
+  unsigned int length_min;
+  int noroute;
+};
+
+static void
+route_dag_summary_get (struct route_dag *dag, unsigned int s,
+                       struct route_dag_summary *summary)
+{
+  summary->noroute = (ROUTE_FLAT_BEGIN (dag->flat, s, dag->t) ==
+                      ROUTE_FLAT_END (dag->flat, s, dag->t));
+  summary->count = dag->count[s];
+  summary->length_sum = dag->length_sum[s];
+  summary->length_max = dag->length_max[s];
+  summary->length_min = dag->length_min[s];
+}
+
+/* the same summary line as route_path_show () */
+static void
+route_dag_summary_show (unsigned int s, unsigned int t,
+                        struct route_dag_summary *summary, FILE *terminal)
+{
+  if (s == t)
+    return;
+
+  if (summary->noroute)
+    fprintf (terminal, "no route %d-%d, maybe disconnected\n", s, t);
+  else if (summary->count == 0)
+    fprintf (terminal, "no complete route %d-%d, loop or blackhole\n",
+             s, t);
+  else
+    fprintf (terminal, "EVAL: %02d-%02d route #paths: %llu "
+             "avglen: %f maxlen: %u minlen: %u\n",
+             s, t, summary->count,
+             (double) summary->length_sum / summary->count,
+             summary->length_max, summary->length_min);
+  fflush (terminal);
+}
+
+void
+route_dag_path_show (struct route_dag *dag, unsigned int s, FILE *terminal)
+{
+  struct route_dag_summary summary;
+
+  route_dag_summary_get (dag, s, &summary);
+  route_dag_summary_show (s, dag->t, &summary, terminal);
+}
+
+/* route_path_show () for all the pairs, with one DAG pass per
+   destination.  the lines are streamed destination by destination
+   (destination-major), so that no n * n table is kept. */
+void
+route_dag_path_show_all (struct routing *routing, FILE *terminal)
+{
+  struct route_dag *dag;
+  struct vector_node *vn, *vnn;
+  struct vector_node vn_cursor, vnn_cursor;
+  struct node *src, *dst;
+
+  dag = route_dag_create (routing, 0);
+
+  for (vnn = vector_cursor_head (routing->G->nodes, &vnn_cursor); vnn;
+       vnn = vector_cursor_next (vnn))
+    {
+      dst = (struct node *) vnn->data;
+      route_dag_compute (dag, dst->id);
+      for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
+        {
+          src = (struct node *) vn->data;
+          route_dag_path_show (dag, src->id, terminal);
+        }
+    }
+
+  route_dag_delete (dag);
+}
+
+DEFINE_COMMAND (show_route_dag_destination,
+                "show route dag destination <0-4294967295>",
+                "display information\n"
+                "display route\n"
+                "display aggregates over the routing DAG\n"
+                "specify destination node\n"
+                "node ID of the destination\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct route_dag *dag;
+  struct route_flat *flat;
+  unsigned int s, t, h, j, unresolved;
+  int source = -1;
+  double p;
+
+  if (routing->route == NULL && routing->flat == NULL)
+    {
+      fprintf (shell->terminal, "no route calculated.\n");
+      return;
+    }
+
+  t = strtoul (argv[4], NULL, 0);
+  if (argc > 6)
+    source = strtoul (argv[6], NULL, 0);
+
+  dag = route_dag_create (routing, ROUTE_DAG_HOP_DIST);
+  flat = dag->flat;
+  if (t >= dag->nnodes ||
+      (source >= 0 && (unsigned int) source >= dag->nnodes))
+    {
+      fprintf (shell->terminal, "No such node: %u\n",
+               (t >= dag->nnodes ? t : (unsigned int) source));
+      route_dag_delete (dag);
+      return;
+    }
+
+  unresolved = route_dag_compute (dag, t);
+  if (unresolved)
+    fprintf (shell->terminal, "%u nodes on a routing loop toward %u\n",
+             unresolved, t);
+
+  for (s = 0; s < dag->nnodes; s++)
+    {
+      if (s == t || (source >= 0 && (unsigned int) source != s))
+        continue;
+
+      fprintf (shell->terminal, "EVAL: %02d-%02d route #paths: %llu "
+               "reach: %f expected-hops: %f hop-distribution:",
+               s, t, dag->count[s], dag->reach[s],
+               (dag->reach[s] > 0.0 ? dag->hops[s] / dag->reach[s] : 0.0));
+      for (h = 0; h < dag->nnodes; h++)
+        {
+          p = dag->hop_dist[(size_t) s * dag->nnodes + h];
+          if (p > 0.0)
+            fprintf (shell->terminal, " %u:%f", h, p);
+        }
+      fprintf (shell->terminal, "\n");
+    }
+
+  route_dag_traverse (dag, source);
+  for (s = 0; s < dag->nnodes; s++)
+    for (j = ROUTE_FLAT_BEGIN (flat, s, t); j < ROUTE_FLAT_END (flat, s, t);
+         j++)
+      if (dag->traverse[j - dag->base] > 0.0)
+        fprintf (shell->terminal, "EVAL: link %02d-%02d toward %02d "
+                 "traversal: %f\n", s, flat->nexthop[j], t,
+                 dag->traverse[j - dag->base]);
+
+  route_dag_delete (dag);
+}
+
+ALIAS_COMMAND (show_route_dag_destination_source,
+               show_route_dag_destination,
+               "show route dag destination <0-4294967295> source <0-4294967295>",
+               "display information\n"
+               "display route\n"
+               "display aggregates over the routing DAG\n"
+               "specify destination node\n"
+               "node ID of the destination\n"
+               "specify source node\n"
+               "node ID of the source\n")
+
+struct route_verify
+{
+  struct route_dag **dags;      /* by worker */
+  unsigned char *status;        /* [t * nnodes + s] */
+};
+
+static void
+route_verify_destination (void *arg, unsigned int t, unsigned int worker)
+{
+  struct route_verify *rv = (struct route_verify *) arg;
+  struct route_dag *dag = rv->dags[worker];
+
+  route_dag_compute (dag, t);
+  route_dag_verify (dag, &rv->status[(size_t) t * dag->nnodes]);
+}
+
+static const char *route_verify_name[] =
+{
+  "ok", "no-route", "blackhole", "loop",
+};
+
+DEFINE_COMMAND (verify_routing,
+                "verify routing",
+                "verify\n"
+                "verify the routes for loops and blackholes\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct route_verify rv;
+  struct route_flat *flat;
+  unsigned int nthreads = 1;
+  unsigned int s, t, n, i;
+  unsigned long npairs[4];
+  unsigned char state;
+  timer_counter_t start, end, res;
+
+  if (routing->route == NULL && routing->flat == NULL)
+    {
+      fprintf (shell->terminal, "no route calculated.\n");
+      return;
+    }
+
+  if (argc > 3)
+    nthreads = strtoul (argv[3], NULL, 0);
+
+  timer_count (start);
+
+  /* the flat table is built here, before the workers share it */
+  flat = route_freeze (routing);
+  n = flat->nnodes;
+  if (nthreads > n)
+    nthreads = (n ? n : 1);
+
+  rv.dags = (struct route_dag **)
+    calloc (nthreads, sizeof (struct route_dag *));
+  for (i = 0; i < nthreads; i++)
+    rv.dags[i] = route_dag_create (routing, ROUTE_DAG_ORDER_ONLY);
+  rv.status = (unsigned char *) calloc ((size_t) n * n + 1, 1);
+
+  workqueue_run (nthreads, n, route_verify_destination, &rv);
+
+  timer_count (end);
+  timer_sub (start, end, res);
+
+  memset (npairs, 0, sizeof (npairs));
+  for (t = 0; t < n; t++)
+    for (s = 0; s < n; s++)
+      {
+        state = rv.status[(size_t) t * n + s];
+        npairs[state]++;
+        if (state != ROUTE_VERIFY_OK)
+          fprintf (shell->terminal, "verify: %s %d-%d\n",
+                   route_verify_name[state], s, t);
+      }
+
+  fprintf (shell->terminal, "verify routing: %u destinations, "
+           "%lu loop, %lu blackhole, %lu no-route pairs\n",
+           n, npairs[ROUTE_VERIFY_LOOP], npairs[ROUTE_VERIFY_BLACKHOLE],
+           npairs[ROUTE_VERIFY_NOROUTE]);
+  fprintf (shell->terminal, "verify routing time: %llu us\n",
+           timer_to_usec (res));
+
+  for (i = 0; i < nthreads; i++)
+    route_dag_delete (rv.dags[i]);
+  free (rv.dags);
+  free (rv.status);
+}
+
+ALIAS_COMMAND (verify_routing_threads,
+               verify_routing,
+               "verify routing threads <1-1024>",
+               "verify\n"
+               "verify the routes for loops and blackholes\n"
+               "specify the number of threads\n"
+               "number of threads\n")
+
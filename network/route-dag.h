@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _ROUTE_DAG_H_
+#define _ROUTE_DAG_H_
+
+/* aggregates over all the routing paths toward a destination t, by
+   dynamic programming over the nexthop DAG instead of enumerating
+   the paths: one pass in topological order (t first) gives, for all
+   the sources at once, the number of paths, their length (in nodes,
+   as route_path_show () counts them), and with the nexthop ratios,
+   the probability to reach t and the expected number of hops.
+   a second pass from the sources gives the traversal probability of
+   each nexthop.  the nodes on a routing loop are left unresolved. */
+
+#define ROUTE_DAG_HOP_DIST   0x01 /* also the hop count distribution */
+#define ROUTE_DAG_ORDER_ONLY 0x02 /* only the topological order */
+
+/* the state of a node toward t, by route_dag_verify () */
+#define ROUTE_VERIFY_OK        0
+#define ROUTE_VERIFY_NOROUTE   1  /* no nexthop */
+#define ROUTE_VERIFY_BLACKHOLE 2  /* forwards to a node without nexthop */
+#define ROUTE_VERIFY_LOOP      3  /* on or into a forwarding loop */
+
+struct route_dag
+{
+  struct routing *routing;
+  struct route_flat *flat;
+  unsigned int nnodes;
+  unsigned int t;
+  int flags;
+
+  /* nodes in topological order toward t: t and the dead ends first */
+  unsigned int *order;
+  unsigned int norder;
+
+  /* scratch: the nodes that forward to each node */
+  unsigned int *pred_offset;    /* nnodes + 1 */
+  unsigned int *pred;
+  unsigned int *remain;
+
+  /* by source node id */
+  unsigned long long *count;      /* number of paths, saturating */
+  unsigned long long *length_sum; /* sum of the path sizes */
+  unsigned int *length_max;
+  unsigned int *length_min;       /* UINT_MAX if no path */
+  double *reach;                  /* probability to reach t */
+  double *hops;                   /* expected hops of the packets that
+                                     reach t, times reach */
+  double *hop_dist;               /* [s * nnodes + h]: probability of
+                                     reaching t in h hops */
+
+  /* by the position in the flat table (ROUTE_FLAT_BEGIN ()),
+     relative to base, the first nexthop toward t */
+  unsigned int base;
+  unsigned int nentries;
+  double *ratio;                  /* the ratio used for the nexthop */
+  double *traverse;               /* traversal probability */
+  double *mass;                   /* scratch of the traversal */
+};
+
+struct route_dag *route_dag_create (struct routing *routing, int flags);
+void route_dag_delete (struct route_dag *dag);
+unsigned int route_dag_compute (struct route_dag *dag, unsigned int t);
+void route_dag_traverse (struct route_dag *dag, int source);
+void route_dag_verify (struct route_dag *dag, unsigned char *status);
+
+void route_dag_path_show (struct route_dag *dag, unsigned int s,
+                          FILE *terminal);
+void route_dag_path_show_all (struct routing *routing, FILE *terminal);
+
+EXTERN_COMMAND (show_route_dag_destination);
+EXTERN_COMMAND (show_route_dag_destination_source);
+EXTERN_COMMAND (verify_routing);
+EXTERN_COMMAND (verify_routing_threads);
+
+#endif /*_ROUTE_DAG_H_*/
+
@@ -33,6 +33,9 @@
 #include "network/weight.h"
 #include "network/path.h"
 #include "network/routing.h"
+#include "network/tag-hash.h"
+#include "network/route-dag.h"
+#include "network/tag-forward.h"
 
 #include "routing/algorithms.h"
 
@@ -41,9 +44,6 @@
 struct command_set *cmdset_routing;
 struct vector *routings;
 
-unsigned long *tag_hash_table_create (unsigned long size);
-void tag_hash_table_delete (unsigned long *table);
-
 struct nexthop *
 nexthop_create ()
 {
@@ -63,8 +63,10 @@ void
 nexthop_delete_all (struct vector *nexthops)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct nexthop *nexthop;
-  for (vn = vector_head (nexthops); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (nexthops, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       nexthop = (struct nexthop *) vn->data;
       vector_remove (nexthop, nexthops);
@@ -109,11 +111,12 @@ route_table_delete (int nnodes, struct route **route)
 {
   int i, j;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   for (i = 0; i < nnodes; i++)
     for (j = 0; j < nnodes; j++)
       {
-        for (vn = vector_head (route[i][j].nexthops); vn;
-             vn = vector_next (vn))
+        for (vn = vector_cursor_head (route[i][j].nexthops, &vn_cursor); vn;
+             vn = vector_cursor_next (vn))
           {
             struct nexthop *nexthop = (struct nexthop *) vn->data;
             if (nexthop)
@@ -130,8 +133,10 @@ struct nexthop *
 nexthop_lookup (struct node *nexthop_node, struct vector *nexthops)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct nexthop *match = NULL;
-  for (vn = vector_head (nexthops); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (nexthops, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct nexthop *nexthop = (struct nexthop *) vn->data;
       if (nexthop_node == nexthop->node)
@@ -140,20 +145,203 @@ nexthop_lookup (struct node *nexthop_node, struct vector *nexthops)
   return match;
 }
 
-void
-route_add (struct node *s, struct node *t, struct node *next,
-           struct routing *routing)
+/* the nexthops vector of the route from s to t, for the code that
+   modifies the routes: the routes are thawed first.  the code that
+   only reads the routes should use route_freeze () instead. */
+struct vector *
+route_nexthops (struct routing *routing, u_int s, u_int t)
+{
+  route_thaw (routing);
+  return routing->route[s][t].nexthops;
+}
+
+/* same as route_nexthops (), but for the route[][] thawed already
+   (by route_thaw () or route_clear ()): it never touches
+   routing->flat, so that the workers in threads can modify the
+   routes of their own sources at the same time. */
+struct vector *
+route_nexthops_thawed (struct routing *routing, u_int s, u_int t)
+{
+  assert (routing->route && routing->flat == NULL);
+  return routing->route[s][t].nexthops;
+}
+
+static void
+route_nexthop_insert (struct node *next, struct vector *nexthops)
 {
   struct nexthop *nexthop;
 
-  if (nexthop_lookup (next, routing->route[s->id][t->id].nexthops))
+  if (nexthop_lookup (next, nexthops))
     return;
 
   nexthop = nexthop_create ();
   nexthop->node = next;
   nexthop->ratio = 0.0;
-  vector_add (nexthop, routing->route[s->id][t->id].nexthops);
-  vector_sort ((vector_cmp_t) nexthop_cmp, routing->route[s->id][t->id].nexthops);
+  vector_add_allow_dup (nexthop, nexthops);
+  vector_sort ((vector_cmp_t) nexthop_cmp, nexthops);
+}
+
+void
+route_add (struct node *s, struct node *t, struct node *next,
+           struct routing *routing)
+{
+  route_nexthop_insert (next, route_nexthops (routing, s->id, t->id));
+}
+
+/* same as route_add (), but on the thawed route[][] only. */
+void
+route_install (struct node *s, struct node *t, struct node *next,
+               struct routing *routing)
+{
+  route_nexthop_insert (next, route_nexthops_thawed (routing, s->id, t->id));
+}
+
+static void
+route_flat_delete (struct route_flat *flat)
+{
+  if (! flat->mapped)
+    {
+      free (flat->offset);
+      free (flat->nexthop);
+      free (flat->ratio);
+    }
+  free (flat);
+}
+
+/* drop all the routes, and start building them from scratch
+   (without rebuilding route[][] from the frozen routes). */
+void
+route_clear (struct routing *routing)
+{
+  if (routing->flat)
+    route_flat_delete (routing->flat);
+  routing->flat = NULL;
+  if (routing->route)
+    route_table_delete (routing->nnodes, routing->route);
+  routing->route = route_table_create (routing->nnodes);
+}
+
+/* pack the routes into the flat table (or return the one already
+   built), and release route[][].  the routes stay frozen until
+   route_nexthops () or route_thaw (). */
+struct route_flat *
+route_freeze (struct routing *routing)
+{
+  struct route_flat *flat;
+  struct vector *nexthops;
+  struct nexthop *nexthop;
+  unsigned int s, t, i, o, n;
+
+  if (routing->flat)
+    return routing->flat;
+
+  flat = (struct route_flat *) malloc (sizeof (struct route_flat));
+  memset (flat, 0, sizeof (struct route_flat));
+  flat->nnodes = routing->nnodes;
+  flat->offset = (unsigned int *)
+    malloc ((flat->nnodes * flat->nnodes + 1) * sizeof (unsigned int));
+
+  n = 0;
+  if (routing->route)
+    for (t = 0; t < flat->nnodes; t++)
+      for (s = 0; s < flat->nnodes; s++)
+        n += routing->route[s][t].nexthops->size;
+
+  flat->nexthop = (unsigned int *)
+    malloc ((n ? n : 1) * sizeof (unsigned int));
+  flat->ratio = (double *) malloc ((n ? n : 1) * sizeof (double));
+
+  o = 0;
+  for (t = 0; t < flat->nnodes; t++)
+    for (s = 0; s < flat->nnodes; s++)
+      {
+        flat->offset[t * flat->nnodes + s] = o;
+        if (! routing->route)
+          continue;
+        nexthops = routing->route[s][t].nexthops;
+        for (i = 0; i < nexthops->size; i++)
+          {
+            nexthop = (struct nexthop *) vector_get (nexthops, i);
+            flat->nexthop[o] = nexthop->node->id;
+            flat->ratio[o] = nexthop->ratio;
+            o++;
+          }
+      }
+  flat->offset[flat->nnodes * flat->nnodes] = o;
+
+  if (routing->route)
+    route_table_delete (routing->nnodes, routing->route);
+  routing->route = NULL;
+
+  routing->flat = flat;
+  return flat;
+}
+
+/* rebuild route[][] from the flat table, if the routes are frozen,
+   and drop the flat table. */
+void
+route_thaw (struct routing *routing)
+{
+  struct route_flat *flat = routing->flat;
+  struct nexthop *nexthop;
+  unsigned int s, t, j;
+
+  if (flat == NULL)
+    {
+      if (routing->route == NULL)
+        routing->route = route_table_create (routing->nnodes);
+      return;
+    }
+
+  if (routing->route == NULL)
+    {
+      routing->route = route_table_create (routing->nnodes);
+      for (t = 0; t < flat->nnodes; t++)
+        for (s = 0; s < flat->nnodes; s++)
+          for (j = ROUTE_FLAT_BEGIN (flat, s, t);
+               j < ROUTE_FLAT_END (flat, s, t); j++)
+            {
+              nexthop = nexthop_create ();
+              nexthop->node = node_lookup (flat->nexthop[j], routing->G);
+              nexthop->ratio = flat->ratio[j];
+              vector_add_allow_dup (nexthop,
+                                    routing->route[s][t].nexthops);
+            }
+    }
+
+  routing->flat = NULL;
+  route_flat_delete (flat);
+}
+
+/* the position in csr->otarget[] of the link to each nexthop entry
+   of the flat table (UINT_MAX if the nexthop is not a neighbor), for
+   the forwarding loops that count the link hits.  free () it. */
+unsigned int *
+route_flat_linkpos (struct route_flat *flat, struct graph_csr *csr)
+{
+  unsigned int *linkpos;
+  unsigned int n, t, u, j, pos;
+
+  n = flat->nnodes;
+  linkpos = (unsigned int *)
+    calloc (flat->offset[n * n] + 1, sizeof (unsigned int));
+  for (t = 0; t < n; t++)
+    for (u = 0; u < n; u++)
+      for (j = ROUTE_FLAT_BEGIN (flat, u, t); j < ROUTE_FLAT_END (flat, u, t);
+           j++)
+        {
+          linkpos[j] = UINT_MAX;
+          if (u >= csr->nnodes)
+            continue;
+          for (pos = csr->ooffset[u]; pos < csr->ooffset[u + 1]; pos++)
+            if (csr->otarget[pos] == flat->nexthop[j])
+              {
+                linkpos[j] = pos;
+                break;
+              }
+        }
+
+  return linkpos;
 }
 
 struct routing *
@@ -171,6 +359,8 @@ routing_delete (struct routing *routing)
 {
   if (routing->name)
     free (routing->name);
+  if (routing->flat)
+    route_flat_delete (routing->flat);
   if (routing->route)
     route_table_delete (routing->nnodes, routing->route);
   command_config_clear (routing->config);
@@ -183,10 +373,13 @@ route_path_probability (struct path *path, struct node *dst,
                         struct routing *routing)
 {
   struct node *current, *next;
-  struct vector_node *vn;
-  struct nexthop *n, *nexthop;
+  struct route_flat *flat;
+  unsigned int j;
+  double *ratio;
   int i;
 
+  flat = route_freeze (routing);
+
   path->probability = 1.0;
 
   for (i = 0; i < path->path->size; i++)
@@ -200,16 +393,15 @@ route_path_probability (struct path *path, struct node *dst,
       if (! next)
         break;
 
-      nexthop = NULL;
-      for (vn = vector_head (routing->route[current->id][dst->id].nexthops); vn;
-           vn = vector_next (vn))
+      ratio = NULL;
+      for (j = ROUTE_FLAT_BEGIN (flat, current->id, dst->id);
+           j < ROUTE_FLAT_END (flat, current->id, dst->id); j++)
         {
-          n = (struct nexthop *) vn->data;
-          if (n->node == next)
-            nexthop = n;
+          if (flat->nexthop[j] == next->id)
+            ratio = &flat->ratio[j];
         }
-      assert (nexthop);
-      path->probability *= nexthop->ratio;
+      assert (ratio);
+      path->probability *= *ratio;
     }
 }
 
@@ -219,12 +411,13 @@ route_path_random_forward (struct node *s, struct node *t,
 {
   struct path *path;
   struct node *current = NULL;
-  struct vector *nexthops;
-  struct nexthop *nexthop;
+  struct route_flat *flat;
   double needle;
   double min, max;
-  struct nexthop *selected;
-  struct vector_node *vn;
+  unsigned int j;
+  int selected;
+
+  flat = route_freeze (routing);
 
   current = s;
   path = path_create ();
@@ -232,30 +425,29 @@ route_path_random_forward (struct node *s, struct node *t,
 
   while (current != t)
     {
-      nexthops = routing->route[current->id][t->id].nexthops;
       needle = (random () % 100000) * 0.00001;
 
       min = 0.0;
       max = 0.0;
-      selected = NULL;
-      for (vn = vector_head (nexthops); vn; vn = vector_next (vn))
+      selected = -1;
+      for (j = ROUTE_FLAT_BEGIN (flat, current->id, t->id);
+           j < ROUTE_FLAT_END (flat, current->id, t->id); j++)
         {
-          nexthop = (struct nexthop *) vector_data (vn);
           min = max;
-          max += nexthop->ratio;
+          max += flat->ratio[j];
           if (min <= needle && needle < max)
-            selected = nexthop;
+            selected = j;
         }
-      if (! selected)
+      if (selected < 0)
         {
           fprintf (stderr, "s: %d t: %d current: %d path: ",
                    s->id, t->id, current->id);
           print_nodelist (stderr, path->path);
           fprintf (stderr, "\n");
-          assert (selected);
+          assert (selected >= 0);
         }
 
-      current = selected->node;
+      current = node_lookup (flat->nexthop[selected], routing->G);
       vector_add_allow_dup (current, path->path);
     }
 
@@ -267,15 +459,23 @@ route_forward (struct path *path, struct node *dst,
                struct routing *routing)
 {
   struct node *prev = NULL, *current = NULL, *next = NULL;
-  struct nexthop *nexthop;
+  struct route_flat *flat;
+  unsigned int j;
+
+  flat = route_freeze (routing);
 
   while (path_end (path) != dst)
     {
       prev = current;
       current = path_end (path);
 
-      nexthop = vector_get (routing->route[current->id][dst->id].nexthops, 0);
-      next = nexthop->node;
+      /* no route from current (a blackhole): leave the path there,
+         the callers check whether it has reached the destination. */
+      j = ROUTE_FLAT_BEGIN (flat, current->id, dst->id);
+      if (j == ROUTE_FLAT_END (flat, current->id, dst->id))
+        return;
+
+      next = node_lookup (flat->nexthop[j], routing->G);
       vector_add_allow_dup (next, path->path);
     }
 }
@@ -286,7 +486,10 @@ route_branch (struct path *path, struct node *dst,
 {
   struct node *prev, *current, *next;
   int index;
-  struct vector_node *vn;
+  struct route_flat *flat;
+  unsigned int j, end;
+
+  flat = route_freeze (routing);
 
   /* for each branch level */
   for (index = path->path->size - 1; index > 0; index--)
@@ -296,22 +499,16 @@ route_branch (struct path *path, struct node *dst,
 
       /* find current branch and next branch of the path */
       next = NULL;
-      for (vn = vector_head (routing->route[prev->id][dst->id].nexthops); vn;
-           vn = vector_next (vn))
+      end = ROUTE_FLAT_END (flat, prev->id, dst->id);
+      for (j = ROUTE_FLAT_BEGIN (flat, prev->id, dst->id); j < end; j++)
         {
-          struct nexthop *nexthop = (struct nexthop *) vn->data;
-          struct node *node = nexthop->node;
-
-          if (node != current)
+          if (flat->nexthop[j] != current->id)
             continue;
 
-          vn = vector_next (vn);
-          if (! vn)
+          if (j + 1 >= end)
             break;
 
-          nexthop = (struct nexthop *) vn->data;
-          next = nexthop->node;
-          vector_break (vn);
+          next = node_lookup (flat->nexthop[j + 1], routing->G);
           break;
         }
 
@@ -342,10 +539,12 @@ route_path_first (struct node *src, struct node *dst,
                   struct routing *routing)
 {
   struct path *path = path_create ();
+  struct route_flat *flat;
 
   vector_add (src, path->path);
 
-  if (routing->route[src->id][dst->id].nexthops->size == 0)
+  flat = route_freeze (routing);
+  if (ROUTE_FLAT_SIZE (flat, src->id, dst->id) == 0)
     {
       fprintf (stderr, "no route from %d to %d\n", src->id, dst->id);
       return path;
@@ -384,6 +583,7 @@ route_path_show (struct node *src, struct node *dst, struct routing *routing,
   unsigned int path_size_max;
   unsigned int path_size_min;
   struct path *path;
+  struct route_flat *flat;
 
   /* do not count from dst to dst */
   if (src == dst)
@@ -393,7 +593,8 @@ route_path_show (struct node *src, struct node *dst, struct routing *routing,
   t = dst->id;
 
   /* ignore disconnected nodes */
-  if (routing->route[s][t].nexthops->size == 0)
+  flat = route_freeze (routing);
+  if (ROUTE_FLAT_SIZE (flat, s, t) == 0)
     {
       fprintf (terminal, "no route %d-%d, maybe disconnected\n", s, t);
       return;
@@ -458,6 +659,16 @@ DEFINE_COMMAND (show_route_path_source_destination,
   src = node_lookup (s, routing->G);
   dst = node_lookup (t, routing->G);
 
+  /* the aggregates alone do not need the paths enumerated */
+  if (! detail && src && dst && src != dst)
+    {
+      struct route_dag *dag = route_dag_create (routing, 0);
+      route_dag_compute (dag, t);
+      route_dag_path_show (dag, s, shell->terminal);
+      route_dag_delete (dag);
+      return;
+    }
+
   route_path_show (src, dst, routing, detail, shell->terminal);
 }
 
@@ -483,16 +694,25 @@ DEFINE_COMMAND (show_route_path,
   struct routing *routing = (struct routing *) shell->context;
   struct node *src, *dst;
   struct vector_node *vn, *vnn;
+  struct vector_node vn_cursor, vnn_cursor;
   int detail = 0;
 
   if (argc > 3 && ! strcmp ("detail", argv[3]))
     detail++;
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  if (! detail)
+    {
+      route_dag_path_show_all (routing, shell->terminal);
+      return;
+    }
+
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       src = (struct node *) vn->data;
 
-      for (vnn = vector_head (routing->G->nodes); vnn; vnn = vector_next (vnn))
+      for (vnn = vector_cursor_head (routing->G->nodes, &vnn_cursor); vnn;
+           vnn = vector_cursor_next (vnn))
         {
           dst = (struct node *) vnn->data;
 
@@ -521,16 +741,19 @@ DEFINE_COMMAND (show_packet_forward,
   struct shell *shell = (struct shell *) context;
   struct routing *routing = (struct routing *) shell->context;
   struct vector_node *vn, *vnn;
+  struct vector_node vn_cursor, vnn_cursor;
   struct node *src, *dst, *node, *next;
   struct path *path;
 
   time_t seed;
   struct vector *router_value;
-  struct vector *table;
+  struct route_flat *flat;
+  unsigned int begin, size;
   unsigned long rvalue, tag;
-  unsigned long *rtable;
+  struct tag_hash *th;
   int s, t, i;
-  struct nexthop *nexthop;
+
+  flat = route_freeze (routing);
 
   seed = time (NULL);
   fprintf (stderr, "seed: %lu\n", (unsigned long) seed);
@@ -538,24 +761,26 @@ DEFINE_COMMAND (show_packet_forward,
 
   /* create router values */
   router_value = vector_create ();
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 #define FLOW_LABEL_MASK 0x000fffff
-      rtable = tag_hash_table_create (FLOW_LABEL_MASK);
-#if 0
-      for (i = 0; i < FLOW_LABEL_MASK; i++)
-        fprintf (stderr, "node %d: tag hash table[%#lx]: %#lx\n", node->id, i, rtable[i]);
-#endif
-      vector_set (router_value, node->id, (void *) rtable);
+#define FLOW_LABEL_BITS 20
+      /* the keyed permutation of the tags, instead of the shuffled
+         table of tag_hash_table_create () (8 MB per router) */
+      th = tag_hash_create (FLOW_LABEL_BITS);
+      vector_set (router_value, node->id, (void *) th);
     }
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       src = (struct node *) vn->data;
       s = src->id;
 
-      for (vnn = vector_head (routing->G->nodes); vnn; vnn = vector_next (vnn))
+      for (vnn = vector_cursor_head (routing->G->nodes, &vnn_cursor); vnn;
+           vnn = vector_cursor_next (vnn))
         {
           dst = (struct node *) vnn->data;
           t = dst->id;
@@ -574,14 +799,16 @@ DEFINE_COMMAND (show_packet_forward,
               while (path_end (path) != dst)
                 {
                   node = path_end (path);
-                  rtable = (unsigned long *) vector_get (router_value, node->id);
-                  rvalue = rtable[tag];
-                  table = routing->route[node->id][dst->id].nexthops;
+                  th = (struct tag_hash *) vector_get (router_value, node->id);
+                  rvalue = tag_hash_value (th, tag);
+                  begin = ROUTE_FLAT_BEGIN (flat, node->id, dst->id);
+                  size = ROUTE_FLAT_SIZE (flat, node->id, dst->id);
 
                   fprintf (shell->terminal, "  forward[%d]: tag: %lx rvalue: %lx table-size=%d nth=%lu\n",
-                           node->id, tag, rvalue, table->size, (tag + rvalue) % table->size);
-                  nexthop = vector_get (table, (tag + rvalue) % table->size);
-                  next = nexthop->node;
+                           node->id, tag, rvalue, size, (tag + rvalue) % size);
+                  next = node_lookup (flat->nexthop[begin +
+                                                    (tag + rvalue) % size],
+                                      routing->G);
                   vector_add_allow_dup (next, path->path);
                 }
 
@@ -597,11 +824,12 @@ DEFINE_COMMAND (show_packet_forward,
         }
     }
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
-      rtable = vector_get (router_value, node->id);
-      tag_hash_table_delete (rtable);
+      th = (struct tag_hash *) vector_get (router_value, node->id);
+      tag_hash_delete (th);
     }
   vector_delete (router_value);
 }
@@ -620,11 +848,17 @@ DEFINE_COMMAND (routing_graph,
       fprintf (shell->terminal, "no such graph: graph-%s\n", argv[1]);
       return;
     }
-  R->G = G;
-  R->nnodes = graph_nodes (G);
+  if (R->flat)
+    route_flat_delete (R->flat);
   if (R->route)
     route_table_delete (R->nnodes, R->route);
-  R->route = route_table_create (R->nnodes);
+  R->flat = NULL;
+  R->route = NULL;
+  R->G = G;
+  R->nnodes = graph_nodes (G);
+
+  /* no routes yet */
+  route_freeze (R);
   command_config_add (R->config, argc, argv);
 }
 
@@ -667,22 +901,29 @@ DEFINE_COMMAND (show_route_nexthop_number,
   struct routing *routing = (struct routing *) shell->context;
 
   struct vector_node *vn, *vnn;
+
+  struct vector_node vn_cursor, vnn_cursor;
   struct node *node, *dst;
   int s, t;
   unsigned int nnodes = routing->G->nodes->size;
 
   unsigned int nexthops = 0;
   unsigned int st_pairs = 0;
+  struct route_flat *flat;
+
+  flat = route_freeze (routing);
 
   fprintf (shell->terminal, "EVAL: %2s-%2s %4s\n",
            "ss", "tt", "#nexthops");
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
       s = node->id;
 
-      for (vnn = vector_head (routing->G->nodes); vnn; vnn = vector_next (vnn))
+      for (vnn = vector_cursor_head (routing->G->nodes, &vnn_cursor); vnn;
+           vnn = vector_cursor_next (vnn))
         {
           dst = (struct node *) vnn->data;
           t = dst->id;
@@ -692,10 +933,10 @@ DEFINE_COMMAND (show_route_nexthop_number,
             continue;
 
           st_pairs++;
-          nexthops += routing->route[s][t].nexthops->size;
+          nexthops += ROUTE_FLAT_SIZE (flat, s, t);
 
           fprintf (shell->terminal, "EVAL: %02d-%02d %4d\n",
-                   s, t, routing->route[s][t].nexthops->size);
+                   s, t, ROUTE_FLAT_SIZE (flat, s, t));
 
         }
     }
@@ -733,18 +974,16 @@ routing_show_destination (FILE *terminal, struct routing *R,
                           u_int destination)
 {
   int i;
-  struct vector_node *vn;
+  unsigned int j;
+  struct route_flat *flat;
+  flat = route_freeze (R);
   fprintf (terminal, "Destination: %d\n", destination);
   for (i = 0; i < R->nnodes; i++)
     {
       fprintf (terminal, "Node[%3d]: ", i);
-      for (vn = vector_head (R->route[i][destination].nexthops); vn;
-           vn = vector_next (vn))
-        {
-          struct nexthop *nexthop = (struct nexthop *) vn->data;
-          if (nexthop)
-            fprintf (terminal, " %3d", nexthop->node->id);
-        }
+      for (j = ROUTE_FLAT_BEGIN (flat, i, destination);
+           j < ROUTE_FLAT_END (flat, i, destination); j++)
+        fprintf (terminal, " %3d", flat->nexthop[j]);
       fprintf (terminal, "\n");
     }
 }
@@ -754,21 +993,16 @@ routing_show_source (FILE *terminal, struct routing *R,
                      u_int source)
 {
   int j;
-  struct vector_node *vn;
+  unsigned int k;
+  struct route_flat *flat;
+  flat = route_freeze (R);
   fprintf (terminal, "Node %d: Routing table:\n", source);
   for (j = 0; j < R->nnodes; j++)
     {
       fprintf (terminal, "[%2d]: ", j);
-      for (vn = vector_head (R->route[source][j].nexthops); vn;
-           vn = vector_next (vn))
-        {
-          struct nexthop *nexthop = (struct nexthop *) vn->data;
-          if (nexthop)
-            {
-              fprintf (terminal, " %2d(%f)",
-                       nexthop->node->id, nexthop->ratio);
-            }
-        }
+      for (k = ROUTE_FLAT_BEGIN (flat, source, j);
+           k < ROUTE_FLAT_END (flat, source, j); k++)
+        fprintf (terminal, " %2d(%f)", flat->nexthop[k], flat->ratio[k]);
       fprintf (terminal, "\n");
     }
 }
@@ -803,8 +1037,8 @@ DEFINE_COMMAND (save_route_file,
   struct shell *shell = (struct shell *) context;
   struct routing *routing = (struct routing *) shell->context;
   FILE *fp;
-  struct vector_node *vn;
-  struct nexthop *nexthop;
+  struct route_flat *flat;
+  unsigned int k;
 
   fp = fopen (argv[3], "w+");
   if (! fp)
@@ -813,17 +1047,14 @@ DEFINE_COMMAND (save_route_file,
       return;
     }
 
+  flat = route_freeze (routing);
   for (i = 0; i < routing->nnodes; i++)
     for (j = 0; j < routing->nnodes; j++)
-      for (vn = vector_head (routing->route[i][j].nexthops); vn;
-           vn = vector_next (vn))
-        {
-          nexthop = (struct nexthop *) vn->data;
-          if (nexthop)
-            fprintf (fp, "set route node %d destination %d "
-                     "nexthop %d ratio %f\n",
-                     i, j, nexthop->node->id, nexthop->ratio);
-        }
+      for (k = ROUTE_FLAT_BEGIN (flat, i, j);
+           k < ROUTE_FLAT_END (flat, i, j); k++)
+        fprintf (fp, "set route node %d destination %d "
+                 "nexthop %d ratio %f\n",
+                 i, j, flat->nexthop[k], flat->ratio[k]);
   fclose (fp);
 }
 
@@ -843,9 +1074,7 @@ DEFINE_COMMAND (load_route_file,
   double nexthop_ratio;
   int ret;
 
-  for (i = 0; i < routing->nnodes; i++)
-    for (j = 0; j < routing->nnodes; j++)
-      nexthop_delete_all (routing->route[i][j].nexthops);
+  route_clear (routing);
 
   fp = fopen (argv[3], "r");
   if (! fp)
@@ -865,7 +1094,7 @@ DEFINE_COMMAND (load_route_file,
       nexthop = nexthop_create ();
       nexthop->node = node_get (nexthop_id, routing->G);
       nexthop->ratio = nexthop_ratio;
-      vector_add (nexthop, routing->route[i][j].nexthops);
+      vector_add_allow_dup (nexthop, route_nexthops (routing, i, j));
     }
   fclose (fp);
 }
@@ -883,8 +1112,9 @@ DEFINE_COMMAND (export_gnuplot_path_count,
   FILE *fp;
   struct vector *x;
   struct vector_node *vn, *vnn, *vns, *vnt;
+  struct vector_node vns_cursor, vnt_cursor, vn_cursor, vnn_cursor;
   int val, rest, total, path_count;
-  struct path *path;
+  struct route_dag *dag;
 
   fp = fopen (argv[4], "w+");
   if (! fp)
@@ -894,25 +1124,25 @@ DEFINE_COMMAND (export_gnuplot_path_count,
     }
 
   x = vector_create ();
+  dag = route_dag_create (routing, 0);
 
   total = 0;
-  for (vns = vector_head (routing->G->nodes); vns; vns = vector_next (vns))
+  for (vnt = vector_cursor_head (routing->G->nodes, &vnt_cursor); vnt;
+       vnt = vector_cursor_next (vnt))
     {
-      struct node *src = (struct node *) vns->data;
-      for (vnt = vector_head (routing->G->nodes); vnt; vnt = vector_next (vnt))
+      struct node *dst = (struct node *) vnt->data;
+
+      route_dag_compute (dag, dst->id);
+
+      for (vns = vector_cursor_head (routing->G->nodes, &vns_cursor); vns;
+           vns = vector_cursor_next (vns))
         {
-          struct node *dst = (struct node *) vnt->data;
+          struct node *src = (struct node *) vns->data;
 
           if (src == dst)
             continue;
 
-          path_count = 0;
-          for (path = route_path_first (src, dst, routing); path;
-               path = route_path_next (path, dst, routing))
-            {
-               if (path_end (path) == dst)
-                 path_count++;
-            }
+          path_count = (int) dag->count[src->id];
 
           if (path_count == 0)
             continue;
@@ -926,9 +1156,11 @@ DEFINE_COMMAND (export_gnuplot_path_count,
             vector_set (x, path_count, (void *) (val + 1));
         }
     }
+  route_dag_delete (dag);
 
   fprintf (fp, "# total = %d #nodes = %d \n", total, routing->G->nodes->size);
-  for (vn = vector_head (x); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (x, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       val = (int) vn->data;
 
@@ -936,7 +1168,8 @@ DEFINE_COMMAND (export_gnuplot_path_count,
         continue;
 
       rest = 0;
-      for (vnn = vector_head (x); vnn; vnn = vector_next (vnn))
+      for (vnn = vector_cursor_head (x, &vnn_cursor); vnn;
+           vnn = vector_cursor_next (vnn))
         {
           if (vnn->index > vn->index)
             rest += (int) vnn->data;
@@ -971,7 +1204,15 @@ routing_init ()
   INSTALL_COMMAND (cmdset_routing, show_route_path_detail);
   INSTALL_COMMAND (cmdset_routing, show_route_path_source_destination);
   INSTALL_COMMAND (cmdset_routing, show_route_path_source_destination_detail);
+  INSTALL_COMMAND (cmdset_routing, show_route_dag_destination);
+  INSTALL_COMMAND (cmdset_routing, show_route_dag_destination_source);
+  INSTALL_COMMAND (cmdset_routing, verify_routing);
+  INSTALL_COMMAND (cmdset_routing, verify_routing_threads);
   INSTALL_COMMAND (cmdset_routing, show_packet_forward);
+  INSTALL_COMMAND (cmdset_routing, show_packet_forward_statistics);
+  INSTALL_COMMAND (cmdset_routing, show_packet_forward_statistics_threads);
+  INSTALL_COMMAND (cmdset_routing, benchmark_tag_hash);
+  INSTALL_COMMAND (cmdset_routing, benchmark_packet_forward);
 
   INSTALL_COMMAND (cmdset_routing, export_ampl_append_routing);
   INSTALL_COMMAND (cmdset_routing, export_gnuplot_path_count);
@@ -989,8 +1230,10 @@ void
 routing_finish ()
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct routing *routing;
-  for (vn = vector_head (routings); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routings, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       routing = (struct routing *) vn->data;
       if (routing)
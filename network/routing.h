@@ -32,6 +32,30 @@ struct route
   struct vector *nexthops;
 };
 
+/* frozen (flat) routing table, read by the forwarding code.
+   the nexthops from s to t are the node ids
+   nexthop[offset[t * nnodes + s] .. offset[t * nnodes + s + 1] - 1],
+   with the ratios in the parallel array, in the same order as the
+   nexthops vector of route[s][t] it was built from.  the entries
+   toward the same destination are contiguous.  route_freeze ()
+   releases route[][] after building it, and route_thaw () rebuilds
+   route[][] from it, so only one of them is in memory at a time. */
+struct route_flat
+{
+  u_int nnodes;
+  unsigned int *offset;     /* nnodes * nnodes + 1 */
+  unsigned int *nexthop;    /* nexthop node id */
+  double *ratio;            /* nexthop ratio */
+  int mapped;               /* the arrays are in a snapshot image */
+};
+
+#define ROUTE_FLAT_BEGIN(flat, s, t) \
+  ((flat)->offset[(t) * (flat)->nnodes + (s)])
+#define ROUTE_FLAT_END(flat, s, t) \
+  ((flat)->offset[(t) * (flat)->nnodes + (s) + 1])
+#define ROUTE_FLAT_SIZE(flat, s, t) \
+  (ROUTE_FLAT_END (flat, s, t) - ROUTE_FLAT_BEGIN (flat, s, t))
+
 struct routing
 {
   unsigned long id;
@@ -39,9 +63,19 @@ struct routing
   struct graph *G;
   struct weight *W;
   u_int nnodes;
-  struct route **route;
   struct vector *config;
 
+  /* the routes are either being built in route[][] (thawed), or
+     packed in flat (frozen); the other one is NULL.  the code that
+     modifies the routes gets the nexthops by route_nexthops () (or
+     by route_nexthops_thawed () in the worker threads, once thawed),
+     and the code that reads them uses route_freeze (). */
+  struct route **route;
+  struct route_flat *flat;
+
+  /* candidate list type of the SPF calculation (DIJKSTRA_QUEUE_*) */
+  int spf_queue;
+
   /* algorithm specific data */
   void *data;
   void (*data_free) (void *data);
@@ -55,12 +89,27 @@ EXTERN_COMMAND (show_route_source);
 EXTERN_COMMAND (show_route_destination);
 EXTERN_COMMAND (clear_route);
 
+struct route **route_table_create (int nnodes);
+void route_table_delete (int nnodes, struct route **route);
+
 void nexthop_delete_all (struct vector *nexthops);
 struct nexthop *nexthop_create ();
 void nexthop_delete (struct nexthop *nexthop);
 
+struct vector *route_nexthops (struct routing *routing,
+                               u_int s, u_int t);
 void route_add (struct node *s, struct node *t, struct node *nexthop,
                 struct routing *routing);
+struct vector *route_nexthops_thawed (struct routing *routing,
+                                      u_int s, u_int t);
+void route_install (struct node *s, struct node *t, struct node *nexthop,
+                    struct routing *routing);
+void route_clear (struct routing *routing);
+
+struct route_flat *route_freeze (struct routing *routing);
+void route_thaw (struct routing *routing);
+unsigned int *route_flat_linkpos (struct route_flat *flat,
+                                  struct graph_csr *csr);
 
 void route_path_probability (struct path *path, struct node *dst,
                         struct routing *routing);
@@ -0,0 +1,494 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "timer.h"
+#include "random.h"
+#include "workqueue.h"
+
+#include "network/graph.h"
+#include "network/path.h"
+#include "network/routing.h"
+#include "network/tag-hash.h"
+#include "network/tag-forward.h"
+
+/* the round keys are drawn from the counter-based generator, so that
+   the permutations depend on the seed alone; the stream numbers below
+   nnodes * nnodes are used for the tags of each pair. */
+struct tag_forward *
+tag_forward_create (struct routing *routing, unsigned int bits,
+                    unsigned long long seed)
+{
+  struct tag_forward *tf;
+  struct route_flat *flat;
+  struct graph_csr *csr;
+  struct random_stream stream;
+  unsigned int n, u, i;
+
+  tf = (struct tag_forward *) malloc (sizeof (struct tag_forward));
+  memset (tf, 0, sizeof (struct tag_forward));
+  tf->routing = routing;
+  tf->flat = flat = route_freeze (routing);
+  tf->csr = csr = graph_freeze (routing->G);
+  tf->nnodes = n = flat->nnodes;
+  tf->bits = bits;
+
+  tf->th = (struct tag_hash *) calloc (n + 1, sizeof (struct tag_hash));
+  tf->key = (unsigned int *)
+    calloc ((size_t) n * TAG_HASH_ROUNDS + 1, sizeof (unsigned int));
+  for (u = 0; u < n; u++)
+    {
+      tf->th[u].bits = bits;
+      tf->th[u].half = (bits + 1) / 2;
+      random_stream_init (&stream, seed, (unsigned long long) n * n + u);
+      for (i = 0; i < TAG_HASH_ROUNDS; i++)
+        tf->th[u].key[i] = tf->key[u * TAG_HASH_ROUNDS + i] =
+          (unsigned int) random_stream_next (&stream);
+    }
+
+  /* the link of each nexthop, once, instead of at each hop */
+  tf->linkpos = route_flat_linkpos (flat, csr);
+
+  return tf;
+}
+
+void
+tag_forward_delete (struct tag_forward *tf)
+{
+  free (tf->th);
+  free (tf->key);
+  free (tf->linkpos);
+  free (tf);
+}
+
+void
+tag_forward_count_init (struct tag_forward *tf,
+                        struct tag_forward_count *count)
+{
+  memset (count, 0, sizeof (struct tag_forward_count));
+  count->hits = (unsigned long *)
+    calloc (tf->csr->ooffset[tf->csr->nnodes] + 1, sizeof (unsigned long));
+  count->hist = (unsigned long *)
+    calloc (tf->nnodes + 1, sizeof (unsigned long));
+}
+
+void
+tag_forward_count_add (struct tag_forward *tf,
+                       struct tag_forward_count *sum,
+                       struct tag_forward_count *count)
+{
+  WORKQUEUE_SUM (sum->hits, count->hits, tf->csr->ooffset[tf->csr->nnodes]);
+  WORKQUEUE_SUM (sum->hist, count->hist, tf->nnodes + 1);
+  sum->delivered += count->delivered;
+  sum->dropped += count->dropped;
+  sum->looped += count->looped;
+}
+
+void
+tag_forward_count_finish (struct tag_forward_count *count)
+{
+  free (count->hits);
+  free (count->hist);
+}
+
+/* forward ntags tags from s to t, TAG_FORWARD_BATCH at a time.
+   the lanes that are done keep being hashed with the others (at t,
+   or where they were dropped) so that the rounds stay branch-free. */
+void
+tag_forward_batch (struct tag_forward *tf, unsigned int s, unsigned int t,
+                   unsigned int *tags, unsigned int ntags,
+                   struct tag_forward_count *count)
+{
+  struct route_flat *flat = tf->flat;
+  unsigned int cur[TAG_FORWARD_BATCH], tag[TAG_FORWARD_BATCH];
+  unsigned int left[TAG_FORWARD_BATCH], right[TAG_FORWARD_BATCH];
+  unsigned int hops[TAG_FORWARD_BATCH];
+  unsigned char done[TAG_FORWARD_BATCH];
+  unsigned int half = (tf->bits + 1) / 2;
+  unsigned int mask = (1U << half) - 1;
+  unsigned int i, r, lane, nactive, begin, size, tmp, j;
+  unsigned long value;
+
+  for (i = 0; i < ntags; i += TAG_FORWARD_BATCH)
+    {
+      nactive = 0;
+      for (lane = 0; lane < TAG_FORWARD_BATCH; lane++)
+        {
+          cur[lane] = s;
+          hops[lane] = 0;
+          done[lane] = (i + lane >= ntags);
+          tag[lane] = (done[lane] ? 0 : tags[i + lane]);
+          if (! done[lane])
+            nactive++;
+        }
+
+      while (nactive)
+        {
+          /* the permutation of the router of each lane, in lockstep */
+          for (lane = 0; lane < TAG_FORWARD_BATCH; lane++)
+            {
+              left[lane] = (tag[lane] >> half) & mask;
+              right[lane] = tag[lane] & mask;
+            }
+          for (r = 0; r < TAG_HASH_ROUNDS; r++)
+            for (lane = 0; lane < TAG_FORWARD_BATCH; lane++)
+              {
+                tmp = right[lane];
+                right[lane] = left[lane] ^
+                  (tag_hash_round (right[lane],
+                                   tf->key[cur[lane] * TAG_HASH_ROUNDS + r])
+                   & mask);
+                left[lane] = tmp;
+              }
+
+          /* then the nexthop of each lane */
+          for (lane = 0; lane < TAG_FORWARD_BATCH; lane++)
+            {
+              if (done[lane])
+                continue;
+
+              value = ((unsigned long) left[lane] << half) | right[lane];
+              if (value >> tf->bits)
+                value = tag_hash_value (&tf->th[cur[lane]], value);
+
+              begin = ROUTE_FLAT_BEGIN (flat, cur[lane], t);
+              size = ROUTE_FLAT_END (flat, cur[lane], t) - begin;
+              if (size == 0)
+                {
+                  count->dropped++;
+                  done[lane]++;
+                  nactive--;
+                  continue;
+                }
+
+              j = begin + (tag[lane] + value) % size;
+              if (tf->linkpos[j] != UINT_MAX)
+                count->hits[tf->linkpos[j]]++;
+              cur[lane] = flat->nexthop[j];
+              hops[lane]++;
+
+              if (cur[lane] == t)
+                {
+                  count->hist[hops[lane]]++;
+                  count->delivered++;
+                  done[lane]++;
+                  nactive--;
+                }
+              else if (hops[lane] >= tf->nnodes)
+                {
+                  count->looped++;
+                  done[lane]++;
+                  nactive--;
+                }
+            }
+        }
+    }
+}
+
+/* the tags of the pair s-t */
+static void
+tag_forward_tags (struct tag_forward *tf, unsigned long long seed,
+                  unsigned int s, unsigned int t,
+                  unsigned int *tags, unsigned int ntags)
+{
+  struct random_stream stream;
+  unsigned int i;
+
+  random_stream_init (&stream, seed, (unsigned long long) s * tf->nnodes + t);
+  for (i = 0; i < ntags; i++)
+    tags[i] = (unsigned int) random_stream_next (&stream) &
+              ((1U << tf->bits) - 1);
+}
+
+struct tag_forward_run
+{
+  struct tag_forward *tf;
+  unsigned long long seed;
+  unsigned int ntags;
+  unsigned int **tags;                  /* by worker */
+  struct tag_forward_count *counts;     /* by worker */
+};
+
+static void
+tag_forward_source (void *arg, unsigned int s, unsigned int worker)
+{
+  struct tag_forward_run *run = (struct tag_forward_run *) arg;
+  unsigned int t;
+
+  for (t = 0; t < run->tf->nnodes; t++)
+    {
+      if (s == t)
+        continue;
+      tag_forward_tags (run->tf, run->seed, s, t, run->tags[worker],
+                        run->ntags);
+      tag_forward_batch (run->tf, s, t, run->tags[worker], run->ntags,
+                         &run->counts[worker]);
+    }
+}
+
+#define FLOW_LABEL_BITS 20
+
+DEFINE_COMMAND (show_packet_forward_statistics,
+                "show packet forward statistics ntags <1-1000000> seed <0-4294967295>",
+                "display information\n"
+                "display packet\n"
+                "display packet forwarding along the routes\n"
+                "display the link hits and the path lengths only\n"
+                "specify the number of tags per pair\n"
+                "number of tags per pair\n"
+                "specify the random seed\n"
+                "random seed\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct tag_forward_run run;
+  struct tag_forward_count *sum;
+  struct graph_csr *csr;
+  unsigned int nthreads = 1;
+  unsigned int i, u, k;
+  unsigned long ntotal;
+  timer_counter_t start, end, res;
+
+  if (routing->route == NULL && routing->flat == NULL)
+    {
+      fprintf (shell->terminal, "no route calculated.\n");
+      return;
+    }
+
+  memset (&run, 0, sizeof (run));
+  run.ntags = strtoul (argv[5], NULL, 0);
+  run.seed = strtoull (argv[7], NULL, 0);
+  if (argc > 9)
+    nthreads = strtoul (argv[9], NULL, 0);
+
+  timer_count (start);
+
+  /* the flat table and the CSR are built before the workers start */
+  run.tf = tag_forward_create (routing, FLOW_LABEL_BITS, run.seed);
+  if (nthreads > run.tf->nnodes)
+    nthreads = (run.tf->nnodes ? run.tf->nnodes : 1);
+  csr = run.tf->csr;
+
+  run.tags = (unsigned int **) calloc (nthreads, sizeof (unsigned int *));
+  run.counts = (struct tag_forward_count *)
+    calloc (nthreads, sizeof (struct tag_forward_count));
+  for (i = 0; i < nthreads; i++)
+    {
+      run.tags[i] = (unsigned int *) calloc (run.ntags, sizeof (unsigned int));
+      tag_forward_count_init (run.tf, &run.counts[i]);
+    }
+
+  workqueue_run (nthreads, run.tf->nnodes, tag_forward_source, &run);
+
+  sum = &run.counts[0];
+  for (i = 1; i < nthreads; i++)
+    tag_forward_count_add (run.tf, sum, &run.counts[i]);
+
+  timer_count (end);
+  timer_sub (start, end, res);
+
+  for (u = 0; u < csr->nnodes; u++)
+    for (k = csr->ooffset[u]; k < csr->ooffset[u + 1]; k++)
+      if (sum->hits[k])
+        fprintf (shell->terminal, "EVAL: link %u %u-%u hits: %lu\n",
+                 csr->olink[k], u, csr->otarget[k], sum->hits[k]);
+
+  ntotal = sum->delivered + sum->dropped + sum->looped;
+  for (i = 0; i <= run.tf->nnodes; i++)
+    if (sum->hist[i])
+      fprintf (shell->terminal, "EVAL: hops %u: %lu (%f)\n",
+               i, sum->hist[i], (double) sum->hist[i] / sum->delivered);
+  fprintf (shell->terminal, "EVAL: tags %lu delivered %lu dropped %lu "
+           "looped %lu\n", ntotal, sum->delivered, sum->dropped,
+           sum->looped);
+  fprintf (shell->terminal, "packet forward time: %llu us\n",
+           timer_to_usec (res));
+
+  for (i = 0; i < nthreads; i++)
+    {
+      free (run.tags[i]);
+      tag_forward_count_finish (&run.counts[i]);
+    }
+  free (run.tags);
+  free (run.counts);
+  tag_forward_delete (run.tf);
+}
+
+ALIAS_COMMAND (show_packet_forward_statistics_threads,
+               show_packet_forward_statistics,
+               "show packet forward statistics ntags <1-1000000> seed <0-4294967295> threads <1-1024>",
+               "display information\n"
+               "display packet\n"
+               "display packet forwarding along the routes\n"
+               "display the link hits and the path lengths only\n"
+               "specify the number of tags per pair\n"
+               "number of tags per pair\n"
+               "specify the random seed\n"
+               "random seed\n"
+               "specify the number of threads\n"
+               "number of threads\n")
+
+/* one tag at a time, as show packet forward does (without the output):
+   a path built at each hop, and the link searched in the adjacency. */
+static void
+tag_forward_scalar (struct tag_forward *tf, unsigned int s, unsigned int t,
+                    unsigned int *tags, unsigned int ntags,
+                    struct tag_forward_count *count)
+{
+  struct route_flat *flat = tf->flat;
+  struct graph_csr *csr = tf->csr;
+  struct node *src, *dst, *node, *next;
+  struct path *path;
+  unsigned long rvalue, tag;
+  unsigned int i, k, hops, begin, size;
+
+  src = csr->node[s];
+  dst = csr->node[t];
+  for (i = 0; i < ntags; i++)
+    {
+      path = path_create ();
+      vector_add (src, path->path);
+      tag = tags[i];
+      hops = 0;
+
+      while (path_end (path) != dst)
+        {
+          node = path_end (path);
+          begin = ROUTE_FLAT_BEGIN (flat, node->id, dst->id);
+          size = ROUTE_FLAT_SIZE (flat, node->id, dst->id);
+          if (size == 0)
+            {
+              count->dropped++;
+              break;
+            }
+          if (hops >= tf->nnodes)
+            {
+              count->looped++;
+              break;
+            }
+
+          rvalue = tag_hash_value (&tf->th[node->id], tag);
+          next = csr->node[flat->nexthop[begin + (tag + rvalue) % size]];
+
+          for (k = csr->ooffset[node->id]; k < csr->ooffset[node->id + 1];
+               k++)
+            if (csr->otarget[k] == next->id)
+              {
+                count->hits[k]++;
+                break;
+              }
+
+          vector_add_allow_dup (next, path->path);
+          hops++;
+        }
+
+      if (path_end (path) == dst)
+        {
+          count->hist[hops]++;
+          count->delivered++;
+        }
+      path_delete (path);
+    }
+}
+
+DEFINE_COMMAND (benchmark_packet_forward,
+                "benchmark packet-forward ntags <1-1000000> seed <0-4294967295>",
+                "benchmark routing calculation.\n"
+                "benchmark tag-based packet forwarding\n"
+                "specify the number of tags per pair\n"
+                "number of tags per pair\n"
+                "specify the random seed\n"
+                "random seed\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct tag_forward *tf;
+  struct tag_forward_count count[2];
+  unsigned int *tags;
+  unsigned int ntags, s, t, i, mismatch;
+  unsigned long long seed, usec[2];
+  timer_counter_t start, end, res;
+
+  if (routing->route == NULL && routing->flat == NULL)
+    {
+      fprintf (shell->terminal, "no route calculated.\n");
+      return;
+    }
+
+  ntags = strtoul (argv[3], NULL, 0);
+  seed = strtoull (argv[5], NULL, 0);
+
+  tf = tag_forward_create (routing, FLOW_LABEL_BITS, seed);
+  tags = (unsigned int *) calloc (ntags, sizeof (unsigned int));
+
+  for (i = 0; i < 2; i++)
+    {
+      tag_forward_count_init (tf, &count[i]);
+      timer_count (start);
+      for (s = 0; s < tf->nnodes; s++)
+        for (t = 0; t < tf->nnodes; t++)
+          {
+            if (s == t)
+              continue;
+            tag_forward_tags (tf, seed, s, t, tags, ntags);
+            if (i == 0)
+              tag_forward_scalar (tf, s, t, tags, ntags, &count[i]);
+            else
+              tag_forward_batch (tf, s, t, tags, ntags, &count[i]);
+          }
+      timer_count (end);
+      timer_sub (start, end, res);
+      usec[i] = timer_to_usec (res);
+    }
+
+  mismatch = 0;
+  for (i = 0; i < tf->csr->ooffset[tf->csr->nnodes]; i++)
+    if (count[0].hits[i] != count[1].hits[i])
+      mismatch++;
+  for (i = 0; i <= tf->nnodes; i++)
+    if (count[0].hist[i] != count[1].hist[i])
+      mismatch++;
+  if (count[0].dropped != count[1].dropped ||
+      count[0].looped != count[1].looped)
+    mismatch++;
+
+  fprintf (shell->terminal, "Benchmark: %u nodes, %u tags per pair\n",
+           tf->nnodes, ntags);
+  fprintf (shell->terminal, "  one tag at a time: %llu us\n", usec[0]);
+  fprintf (shell->terminal, "  batch of %d tags: %llu us", TAG_FORWARD_BATCH,
+           usec[1]);
+  if (usec[1])
+    fprintf (shell->terminal, " (%.2fx)", (double) usec[0] / usec[1]);
+  fprintf (shell->terminal, "\n");
+  fprintf (shell->terminal, "  delivered: %lu dropped: %lu looped: %lu\n",
+           count[1].delivered, count[1].dropped, count[1].looped);
+  if (mismatch)
+    fprintf (shell->terminal, "  count mismatch: %u\n", mismatch);
+
+  for (i = 0; i < 2; i++)
+    tag_forward_count_finish (&count[i]);
+  free (tags);
+  tag_forward_delete (tf);
+}
+
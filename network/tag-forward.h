@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _TAG_FORWARD_H_
+#define _TAG_FORWARD_H_
+
+/* batched tag-based multipath forwarding over the flat routing table.
+
+   the tags of a source-destination pair are carried in groups of
+   TAG_FORWARD_BATCH lanes in lockstep: all the lanes are hashed by
+   the keyed permutation of the router they are at (the Feistel rounds
+   run over the lanes, so that the compiler can vectorize them), and
+   then moved to the selected nexthop.  only the per-link hit counts
+   and the path length histogram are kept; no path is built. */
+
+#define TAG_FORWARD_BATCH 16
+
+struct tag_forward_count
+{
+  unsigned long *hits;          /* by CSR out-link position */
+  unsigned long *hist;          /* by hop count, [0, nnodes] */
+  unsigned long delivered;
+  unsigned long dropped;        /* at a node without nexthop */
+  unsigned long looped;         /* more than nnodes hops */
+};
+
+struct tag_forward
+{
+  struct routing *routing;
+  struct route_flat *flat;
+  struct graph_csr *csr;
+  unsigned int nnodes;
+  unsigned int bits;            /* tags are in [0, 2^bits) */
+
+  /* the permutation of each router, with the same bits and half */
+  struct tag_hash *th;          /* by node id */
+  unsigned int *key;            /* [node * TAG_HASH_ROUNDS + round] */
+
+  /* CSR out-link position of each entry of the flat table */
+  unsigned int *linkpos;
+};
+
+struct tag_forward *tag_forward_create (struct routing *routing,
+                                        unsigned int bits,
+                                        unsigned long long seed);
+void tag_forward_delete (struct tag_forward *tf);
+
+void tag_forward_count_init (struct tag_forward *tf,
+                             struct tag_forward_count *count);
+void tag_forward_count_add (struct tag_forward *tf,
+                            struct tag_forward_count *sum,
+                            struct tag_forward_count *count);
+void tag_forward_count_finish (struct tag_forward_count *count);
+
+void tag_forward_batch (struct tag_forward *tf, unsigned int s,
+                        unsigned int t, unsigned int *tags,
+                        unsigned int ntags,
+                        struct tag_forward_count *count);
+
+EXTERN_COMMAND (show_packet_forward_statistics);
+EXTERN_COMMAND (show_packet_forward_statistics_threads);
+EXTERN_COMMAND (benchmark_packet_forward);
+
+#endif /*_TAG_FORWARD_H_*/
+
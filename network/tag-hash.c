@@ -20,6 +20,14 @@
 
 #include <includes.h>
 
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "timer.h"
+#include "bitset.h"
+
+#include "network/tag-hash.h"
+
 unsigned long tmp;
 #define SWAP(a,b,table)      \
   do {                       \
@@ -31,7 +39,7 @@ unsigned long tmp;
 unsigned long *
 tag_hash_table_create (unsigned long size)
 {
-  unsigned long i;
+  unsigned long i, j;
   unsigned long *table;
 
   if (size > 0xffffffff)
@@ -42,8 +50,12 @@ tag_hash_table_create (unsigned long size)
   for (i = 0; i < size; i++)
     table[i] = i;
 
+  /* the index is drawn once: SWAP () evaluates it twice */
   for (i = 0; i < size; i++)
-    SWAP (i, random () % size, table);
+    {
+      j = random () % size;
+      SWAP (i, j, table);
+    }
 
   return table;
 }
@@ -54,4 +66,175 @@ tag_hash_table_delete (unsigned long *table)
   free (table);
 }
 
+/* the round keys are drawn by random (), as the shuffle of the table
+   version does, so srandom () seeds both the same way. */
+struct tag_hash *
+tag_hash_create (unsigned int bits)
+{
+  struct tag_hash *th;
+  int i;
+
+  if (bits < 1 || bits > 32)
+    return NULL;
+
+  th = (struct tag_hash *) malloc (sizeof (struct tag_hash));
+  th->bits = bits;
+  th->half = (bits + 1) / 2;
+  for (i = 0; i < TAG_HASH_ROUNDS; i++)
+    th->key[i] = (unsigned int) random ();
+
+  return th;
+}
+
+void
+tag_hash_delete (struct tag_hash *th)
+{
+  free (th);
+}
+
+#define TAG_HASH_BENCHMARK_BITS  20
+#define TAG_HASH_BENCHMARK_SIZE  0x000fffff  /* FLOW_LABEL_MASK */
+#define TAG_HASH_BENCHMARK_CHECK 32          /* routers to check */
+#define TAG_HASH_BENCHMARK_K     8           /* up to k nexthops */
+
+struct tag_hash_stat
+{
+  unsigned long permutation;    /* routers with a bijection */
+  unsigned long fixed;          /* tags mapped to themselves */
+  double chi2[TAG_HASH_BENCHMARK_K + 1]; /* of (tag + value) % k */
+  unsigned long long lookup;    /* usec of the lookups */
+  unsigned long checksum;       /* sum of the looked up values */
+};
+
+/* the statistical properties that the tag selection relies on: the
+   permutation is a bijection, has about one fixed point like a random
+   permutation, and spreads (tag + value) % k evenly over k nexthops
+   (the chi-square has k - 1 degrees of freedom). */
+static void
+tag_hash_stat_add (struct tag_hash_stat *stat, unsigned long *table,
+                   struct tag_hash *th, unsigned long *seen)
+{
+  unsigned long count[TAG_HASH_BENCHMARK_K + 1][TAG_HASH_BENCHMARK_K];
+  unsigned long tag, value, dup = 0;
+  double expect, d;
+  unsigned int k, i;
+  timer_counter_t start, end, res;
+
+  memset (count, 0, sizeof (count));
+  bitset_clear (seen, TAG_HASH_BENCHMARK_SIZE + 1);
+
+  timer_count (start);
+  if (table)
+    for (tag = 0; tag < TAG_HASH_BENCHMARK_SIZE; tag++)
+      stat->checksum += table[tag];
+  else
+    for (tag = 0; tag < TAG_HASH_BENCHMARK_SIZE; tag++)
+      stat->checksum += tag_hash_value (th, tag);
+  timer_count (end);
+  timer_sub (start, end, res);
+  stat->lookup += timer_to_usec (res);
+
+  for (tag = 0; tag < TAG_HASH_BENCHMARK_SIZE; tag++)
+    {
+      value = (table ? table[tag] : tag_hash_value (th, tag));
+      if (value >= TAG_HASH_BENCHMARK_SIZE + 1 || BITSET_ISSET (seen, value))
+        dup++;
+      else
+        BITSET_SET (seen, value);
+      if (value == tag)
+        stat->fixed++;
+      for (k = 2; k <= TAG_HASH_BENCHMARK_K; k++)
+        count[k][(tag + value) % k]++;
+    }
+
+  if (dup == 0)
+    stat->permutation++;
+
+  for (k = 2; k <= TAG_HASH_BENCHMARK_K; k++)
+    {
+      expect = (double) TAG_HASH_BENCHMARK_SIZE / k;
+      for (i = 0; i < k; i++)
+        {
+          d = count[k][i] - expect;
+          stat->chi2[k] += d * d / expect;
+        }
+    }
+}
+
+DEFINE_COMMAND (benchmark_tag_hash,
+                "benchmark tag-hash <1-100>",
+                "benchmark routing calculation.\n"
+                "benchmark the per-router tag hash\n"
+                "specify number of routers.\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct tag_hash_stat stat[2];
+  unsigned long **tables;
+  struct tag_hash **ths;
+  unsigned long *seen;
+  unsigned long i, nrouters, ncheck;
+  unsigned int k, type;
+  timer_counter_t start, end, res;
+  unsigned long long usec[2];
+
+  nrouters = strtoul (argv[2], NULL, 0);
+  ncheck = (nrouters < TAG_HASH_BENCHMARK_CHECK ?
+            nrouters : TAG_HASH_BENCHMARK_CHECK);
+
+  tables = (unsigned long **) calloc (nrouters, sizeof (unsigned long *));
+  ths = (struct tag_hash **) calloc (nrouters, sizeof (struct tag_hash *));
+
+  srandom (0);
+  timer_count (start);
+  for (i = 0; i < nrouters; i++)
+    tables[i] = tag_hash_table_create (TAG_HASH_BENCHMARK_SIZE);
+  timer_count (end);
+  timer_sub (start, end, res);
+  usec[0] = timer_to_usec (res);
 
+  srandom (0);
+  timer_count (start);
+  for (i = 0; i < nrouters; i++)
+    ths[i] = tag_hash_create (TAG_HASH_BENCHMARK_BITS);
+  timer_count (end);
+  timer_sub (start, end, res);
+  usec[1] = timer_to_usec (res);
+
+  memset (stat, 0, sizeof (stat));
+  seen = bitset_create (TAG_HASH_BENCHMARK_SIZE + 1);
+  for (i = 0; i < ncheck; i++)
+    {
+      tag_hash_stat_add (&stat[0], tables[i], NULL, seen);
+      tag_hash_stat_add (&stat[1], NULL, ths[i], seen);
+    }
+  bitset_delete (seen);
+
+  fprintf (shell->terminal, "Benchmark: %lu routers, %#x tags, "
+           "checked %lu routers\n", nrouters, TAG_HASH_BENCHMARK_SIZE,
+           ncheck);
+  for (type = 0; type < 2; type++)
+    {
+      fprintf (shell->terminal, "  %-5s: setup %llu us, %lu bytes, "
+               "lookup %.2f ns/tag\n", (type ? "keyed" : "table"),
+               usec[type],
+               (type ? nrouters * sizeof (struct tag_hash) :
+                nrouters * TAG_HASH_BENCHMARK_SIZE * sizeof (unsigned long)),
+               (double) stat[type].lookup * 1000.0 /
+               (ncheck * (double) TAG_HASH_BENCHMARK_SIZE));
+      fprintf (shell->terminal, "  %-5s: bijection %lu/%lu, "
+               "fixed points %.2f/router, chi-square (k=2..%d):",
+               (type ? "keyed" : "table"), stat[type].permutation, ncheck,
+               (double) stat[type].fixed / ncheck, TAG_HASH_BENCHMARK_K);
+      for (k = 2; k <= TAG_HASH_BENCHMARK_K; k++)
+        fprintf (shell->terminal, " %.2f", stat[type].chi2[k] / ncheck);
+      fprintf (shell->terminal, "\n");
+    }
+
+  for (i = 0; i < nrouters; i++)
+    {
+      tag_hash_table_delete (tables[i]);
+      tag_hash_delete (ths[i]);
+    }
+  free (tables);
+  free (ths);
+}
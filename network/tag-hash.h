@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _TAG_HASH_H_
+#define _TAG_HASH_H_
+
+/* per-router permutation of the flow label (tag) space.
+
+   tag_hash_table_create () keeps the permutation in a shuffled table
+   of size entries.  struct tag_hash computes a permutation of
+   [0, 2^bits) instead, by a keyed Feistel network over the two halves
+   of the tag: it takes no memory beyond the round keys and no setup.
+   an odd number of bits is handled by cycle-walking over bits + 1. */
+
+#define TAG_HASH_ROUNDS 6
+
+struct tag_hash
+{
+  unsigned int bits;                  /* domain is [0, 2^bits) */
+  unsigned int half;                  /* bits of each Feistel half */
+  unsigned int key[TAG_HASH_ROUNDS];  /* round keys */
+};
+
+unsigned long *tag_hash_table_create (unsigned long size);
+void tag_hash_table_delete (unsigned long *table);
+
+struct tag_hash *tag_hash_create (unsigned int bits);
+void tag_hash_delete (struct tag_hash *th);
+
+static inline unsigned int
+tag_hash_round (unsigned int x, unsigned int key)
+{
+  x ^= key;
+  x ^= x >> 16;
+  x *= 0x85ebca6bU;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35U;
+  x ^= x >> 16;
+  return x;
+}
+
+/* the image of tag (< 2^bits) by the permutation */
+static inline unsigned long
+tag_hash_value (struct tag_hash *th, unsigned long tag)
+{
+  unsigned int mask = (1U << th->half) - 1;
+  unsigned int left, right, tmp;
+  int i;
+
+  do
+    {
+      left = (tag >> th->half) & mask;
+      right = tag & mask;
+      for (i = 0; i < TAG_HASH_ROUNDS; i++)
+        {
+          tmp = right;
+          right = left ^ (tag_hash_round (right, th->key[i]) & mask);
+          left = tmp;
+        }
+      tag = ((unsigned long) left << th->half) | right;
+    }
+  while (tag >> th->bits);
+
+  return tag;
+}
+
+EXTERN_COMMAND (benchmark_tag_hash);
+
+#endif /*_TAG_HASH_H_*/
+
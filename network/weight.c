@@ -36,6 +36,8 @@
 #include "interface/graphviz.h"
 #include "interface/simrouting_file.h"
 
+#include "routing/weight-optimize.h"
+
 struct command_set *cmdset_weight;
 struct vector *weights;
 
@@ -46,15 +48,25 @@ weight_create ()
   weight = (struct weight *) malloc (sizeof (struct weight));
   memset (weight, 0, sizeof (struct weight));
   weight->config = vector_create ();
+  weight->version = graph_version_next ();
   return weight;
 }
 
+/* to be called after any change of W->G or W->weight[], so that the
+   results computed on the old weights (e.g., in the SPF cache) are
+   not used any more. */
+void
+weight_modified (struct weight *W)
+{
+  W->version = graph_version_next ();
+}
+
 void
 weight_delete (struct weight *weight)
 {
   if (weight->name)
     free (weight->name);
-  if (weight->weight)
+  if (weight->weight && ! weight->mapped)
     free (weight->weight);
   command_config_clear (weight->config);
   vector_delete (weight->config);
@@ -66,10 +78,12 @@ weight_setting_graph (struct weight *W, struct graph *G)
 {
   W->G = G;
   W->nedges = graph_edges (G);
-  if (W->weight)
+  if (W->weight && ! W->mapped)
     free (W->weight);
+  W->mapped = 0;
   W->weight = (weight_t *) malloc (sizeof (weight_t) * W->nedges);
   memset (W->weight, 0, sizeof (weight_t) * W->nedges);
+  weight_modified (W);
 }
 
 DEFINE_COMMAND (weight_graph,
@@ -118,6 +132,7 @@ DEFINE_COMMAND (weight_link,
 
   weight = strtoul (argv[4], NULL, 0);
   W->weight[link->id] = weight;
+  weight_modified (W);
 
   command_config_add (W->config, argc, argv);
 }
@@ -178,6 +193,7 @@ weight_setting_minimum_hop (struct weight *W)
   int i;
   for (i = 0; i < W->nedges; i++)
     W->weight[i] = (weight_t) 1;
+  weight_modified (W);
 }
 
 DEFINE_COMMAND (weight_setting_minhop,
@@ -206,6 +222,7 @@ weight_setting_inverse_capacity (struct weight *W)
       if (W->weight[i] == 0)
         W->weight[i] = 1;
     }
+  weight_modified (W);
 }
 
 DEFINE_COMMAND (weight_setting_invcap,
@@ -236,14 +253,14 @@ weight_save_config (struct weight *w)
     return;
 
   snprintf (buf, sizeof (buf), "  weight-graph %s", w->G->name);
-  vector_add (strdup (buf), w->config);
+  vector_add_allow_dup (strdup (buf), w->config);
 
   for (i = 0; i < w->nedges; i++)
     {
       link = link_lookup_by_id (i, w->G);
       snprintf (buf, sizeof (buf), "  link %u %u weight %lu",
                 link->from->id, link->to->id, w->weight[i]);
-      vector_add (strdup (buf), w->config);
+      vector_add_allow_dup (strdup (buf), w->config);
     }
 }
 
@@ -281,14 +298,25 @@ weight_init ()
 #endif /*HAVE_GRAPHVIZ*/
 
   INSTALL_COMMAND (cmdset_weight, save_weight_config);
+
+  INSTALL_COMMAND (cmdset_weight, weight_optimize);
+  INSTALL_COMMAND (cmdset_weight, weight_optimize_time);
+  INSTALL_COMMAND (cmdset_weight, weight_optimize_threads);
+  INSTALL_COMMAND (cmdset_weight, weight_optimize_time_threads);
+  INSTALL_COMMAND (cmdset_weight, weight_optimize_seed);
+  INSTALL_COMMAND (cmdset_weight, weight_optimize_time_seed);
+  INSTALL_COMMAND (cmdset_weight, weight_optimize_threads_seed);
+  INSTALL_COMMAND (cmdset_weight, weight_optimize_time_threads_seed);
 }
 
 void
 weight_finish ()
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct weight *weight;
-  for (vn = vector_head (weights); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (weights, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       weight = (struct weight *) vn->data;
       if (weight)
@@ -30,9 +30,13 @@ struct weight
   struct graph *G;
   u_int nedges;
   weight_t *weight;
+  int mapped;           /* weight[] is in a snapshot image */
+  unsigned long version; /* renewed by weight_modified () */
   struct vector *config;
 };
 
+void weight_modified (struct weight *W);
+void weight_clear_config (struct weight *w);
 void weight_save_config (struct weight *w);
 
 EXTERN_COMMAND (weight_enter);
@@ -35,13 +35,21 @@
 #include "routing/mara-mc-mmmf.h"
 //#include "routing/reverse-dijkstra.h"
 #include "routing/mara-spe.h"
+#include "routing/incremental-dijkstra.h"
+#include "routing/benchmark.h"
+#include "routing/spf-cache.h"
 
 void
 routing_algorithms_commands (struct command_set *cmdset_routing)
 {
+  INSTALL_COMMAND (cmdset_routing, routing_spf_queue);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_dijkstra);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_dijkstra_node);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_dijkstra_node_all);
+  INSTALL_COMMAND (cmdset_routing, routing_algorithm_dijkstra_threads);
+  INSTALL_COMMAND (cmdset_routing, routing_algorithm_dijkstra_failure_sweep);
+  INSTALL_COMMAND (cmdset_routing,
+                   routing_algorithm_dijkstra_failure_sweep_node);
 
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_lfi);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_lfi_node);
@@ -50,14 +58,23 @@ routing_algorithms_commands (struct command_set *cmdset_routing)
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_mc);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_mc_node);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_mc_node_all);
+  INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_mc_threads);
 
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_mmmf);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_mmmf_node);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_mmmf_node_all);
+  INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_mmmf_threads);
 
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_spe);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_spe_node);
   INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_spe_node_all);
+  INSTALL_COMMAND (cmdset_routing, routing_algorithm_mara_spe_threads);
+
+  INSTALL_COMMAND (cmdset_routing, benchmark_dijkstra_all_pairs);
+  INSTALL_COMMAND (cmdset_routing, benchmark_dijkstra_queue);
+
+  /* the SPF result cache is shared by all routing instances */
+  spf_cache_commands (cmdset_default);
 }
 
 
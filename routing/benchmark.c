@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "command_shell.h"
+#include "timer.h"
+
+#include "network/graph.h"
+#include "network/weight.h"
+#include "network/path.h"
+#include "network/routing.h"
+
+#include "routing/dijkstra.h"
+#include "routing/spf-cache.h"
+#include "routing/benchmark.h"
+
+/* walk the vectors that routing_dijkstra_route () walks for all the
+   roots (the nodes, and the nexthops of each destination in the SPF
+   tables), by the malloc()ing vector_head ()/vector_next () (before),
+   or by the cursor (after).  returns microseconds, and the number of
+   the elements visited in *count. */
+static unsigned long long
+benchmark_dijkstra_walk (struct routing *routing, unsigned long rounds,
+                         int cursor, unsigned long *count)
+{
+  struct dijkstra_path **dijkstra_data;
+  struct vector_node *vn, *vnt, *vni;
+  struct vector_node vn_cursor, vnt_cursor, vni_cursor;
+  struct node *root, *dst;
+  struct vector *nexthops;
+  unsigned long i;
+  timer_counter_t start, end, res;
+
+  dijkstra_data = (struct dijkstra_path **) routing->data;
+  *count = 0;
+
+  timer_count (start);
+  for (i = 0; i < rounds; i++)
+    {
+      for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
+        {
+          root = (struct node *) vn->data;
+          if (cursor)
+            vnt = vector_cursor_head (routing->G->nodes, &vnt_cursor);
+          else
+            vnt = vector_head (routing->G->nodes);
+          while (vnt)
+            {
+              dst = (struct node *) vnt->data;
+              nexthops = dijkstra_data[root->id][dst->id].nexthops;
+              if (cursor)
+                {
+                  for (vni = vector_cursor_head (nexthops, &vni_cursor); vni;
+                       vni = vector_cursor_next (vni))
+                    (*count)++;
+                  vnt = vector_cursor_next (vnt);
+                }
+              else
+                {
+                  for (vni = vector_head (nexthops); vni;
+                       vni = vector_next (vni))
+                    (*count)++;
+                  vnt = vector_next (vnt);
+                }
+            }
+        }
+    }
+  timer_count (end);
+  timer_sub (start, end, res);
+
+  return timer_to_usec (res);
+}
+
+DEFINE_COMMAND (benchmark_dijkstra_all_pairs,
+                "benchmark dijkstra all-pairs <1-10000>",
+                "benchmark routing calculation.\n"
+                "benchmark Dijkstra's SPF calculation.\n"
+                "calculate on all node.\n"
+                "specify number of rounds.\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  struct node *node;
+  unsigned long i, rounds;
+  timer_counter_t start, end, res;
+  unsigned long long spf, before, after;
+  unsigned long count;
+  int cache;
+
+  if (routing->G == NULL)
+    {
+      fprintf (shell->terminal, "no graph specified for routing.\n");
+      return;
+    }
+  if (routing->W == NULL)
+    {
+      fprintf (shell->terminal, "no weight specified for routing.\n");
+      return;
+    }
+  if (routing->G != routing->W->G)
+    {
+      fprintf (shell->terminal, "base graph does not match with weight's.\n");
+      return;
+    }
+
+  rounds = strtoul (argv[3], NULL, 0);
+
+  if (! routing->data)
+    routing->data = dijkstra_data_create (routing->G);
+
+  /* the real all-pairs path, as "routing-algorithm dijkstra node all":
+     routing_dijkstra () on the CSR snapshot and routing_dijkstra_route (),
+     each round calculated again */
+  cache = spf_cache_enable (0);
+  timer_count (start);
+  for (i = 0; i < rounds; i++)
+    {
+      dijkstra_data_clear (routing->G, routing->data);
+      for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
+        {
+          node = (struct node *) vn->data;
+          routing_dijkstra (node, routing->W, routing);
+          routing_dijkstra_route (node, routing);
+        }
+    }
+  timer_count (end);
+  timer_sub (start, end, res);
+  spf = timer_to_usec (res);
+  spf_cache_enable (cache);
+
+  /* the vector walks of the path above alone, in the two iteration
+     styles; the path itself uses the cursor */
+  before = benchmark_dijkstra_walk (routing, rounds, 0, &count);
+  after = benchmark_dijkstra_walk (routing, rounds, 1, &count);
+
+  fprintf (shell->terminal, "Benchmark: %d nodes, %lu rounds\n",
+           routing->G->nodes->size, rounds);
+  fprintf (shell->terminal,
+           "  all-pairs Dijkstra (routing_dijkstra, routing_dijkstra_route): "
+           "%llu us/round\n", spf / rounds);
+  fprintf (shell->terminal,
+           "  walk cost of its vectors alone (%lu elements/round):\n",
+           count / rounds);
+  fprintf (shell->terminal,
+           "    vector_head/vector_next walk:   %llu us/round\n",
+           before / rounds);
+  fprintf (shell->terminal,
+           "    vector_cursor_head/next walk:   %llu us/round", after / rounds);
+  if (after)
+    fprintf (shell->terminal, " (%.2fx)", (double) before / after);
+  fprintf (shell->terminal, "\n");
+}
+
+
+DEFINE_COMMAND (benchmark_dijkstra_queue,
+                "benchmark dijkstra queue <1-10000>",
+                "benchmark routing calculation.\n"
+                "benchmark Dijkstra's SPF calculation.\n"
+                "compare the SPF candidate lists.\n"
+                "specify number of rounds.\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct dijkstra_path **dijkstra_data;
+  struct dijkstra_queue *queue;
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  struct node *node;
+  unsigned int *metric;
+  unsigned long i, rounds, mismatch;
+  unsigned int s, t, n;
+  int type, cache;
+  timer_counter_t start, end, res;
+  unsigned long long usec[3];
+
+  if (routing->G == NULL)
+    {
+      fprintf (shell->terminal, "no graph specified for routing.\n");
+      return;
+    }
+  if (routing->W == NULL)
+    {
+      fprintf (shell->terminal, "no weight specified for routing.\n");
+      return;
+    }
+  if (routing->G != routing->W->G)
+    {
+      fprintf (shell->terminal, "base graph does not match with weight's.\n");
+      return;
+    }
+
+  rounds = strtoul (argv[3], NULL, 0);
+
+  if (! routing->data)
+    routing->data = dijkstra_data_create (routing->G);
+  dijkstra_data = (struct dijkstra_path **) routing->data;
+
+  /* the metrics by the binary heap, to check the others against */
+  n = routing->G->nodes->size;
+  metric = (unsigned int *) calloc (n * n, sizeof (unsigned int));
+  mismatch = 0;
+
+  fprintf (shell->terminal, "Benchmark: %d nodes, %lu rounds\n",
+           n, rounds);
+
+  /* measure the SPF calculations, not the cached trees */
+  cache = spf_cache_enable (0);
+
+  graph_freeze (routing->G);
+  route_thaw (routing);
+
+  for (type = DIJKSTRA_QUEUE_BINARY_HEAP;
+       type <= DIJKSTRA_QUEUE_RADIX_HEAP; type++)
+    {
+      queue = dijkstra_queue_create (type, routing->G, routing->W);
+
+      timer_count (start);
+      for (i = 0; i < rounds; i++)
+        {
+          dijkstra_data_clear (routing->G, dijkstra_data);
+          for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+               vn = vector_cursor_next (vn))
+            {
+              node = (struct node *) vn->data;
+              routing_dijkstra_queue (node, routing->W, routing, queue);
+            }
+        }
+      timer_count (end);
+      timer_sub (start, end, res);
+      usec[type] = timer_to_usec (res);
+
+      for (s = 0; s < n; s++)
+        for (t = 0; t < n; t++)
+          {
+            if (type == DIJKSTRA_QUEUE_BINARY_HEAP)
+              metric[s * n + t] = dijkstra_data[s][t].metric;
+            else if (metric[s * n + t] != dijkstra_data[s][t].metric)
+              mismatch++;
+          }
+
+      fprintf (shell->terminal, "  %-12s: %llu us/round",
+               dijkstra_queue_name[type], usec[type] / rounds);
+      if (type != DIJKSTRA_QUEUE_BINARY_HEAP && usec[type])
+        fprintf (shell->terminal, " (%.2fx)",
+                 (double) usec[DIJKSTRA_QUEUE_BINARY_HEAP] / usec[type]);
+      if (queue->type != type)
+        fprintf (shell->terminal, " (weight too large, used %s)",
+                 dijkstra_queue_name[queue->type]);
+      fprintf (shell->terminal, "\n");
+
+      dijkstra_queue_delete (queue);
+    }
+
+  spf_cache_enable (cache);
+
+  if (mismatch)
+    fprintf (shell->terminal, "  metric mismatch: %lu pairs\n", mismatch);
+
+  free (metric);
+
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      node = (struct node *) vn->data;
+      routing_dijkstra_route (node, routing);
+    }
+}
@@ -25,7 +25,10 @@
 #include "command.h"
 #include "command_shell.h"
 #include "pqueue.h"
+#include "bucketq.h"
+#include "radixheap.h"
 #include "timer.h"
+#include "workqueue.h"
 
 #include "network/graph.h"
 #include "network/weight.h"
@@ -33,6 +36,7 @@
 #include "network/routing.h"
 
 #include "routing/dijkstra.h"
+#include "routing/spf-cache.h"
 
 struct dijkstra_path *
 dijkstra_table_create (struct graph *graph)
@@ -40,12 +44,13 @@ dijkstra_table_create (struct graph *graph)
   struct dijkstra_path *table;
   int i;
   table = (struct dijkstra_path *)
-    calloc (graph->nodes->size, sizeof (struct dijkstra_path));
+    calloc (graph->nodes->size + 1, sizeof (struct dijkstra_path));
   for (i = 0; i < graph->nodes->size; i++)
     {
       table[i].pqueue_index = -1;
       table[i].nexthops = vector_create ();
     }
+  DIJKSTRA_TABLE_CLEAN (graph, table) = 1;
   return table;
 }
 
@@ -72,6 +77,7 @@ dijkstra_table_clear (struct graph *graph, struct dijkstra_path *table)
       vector_clear (table[i].nexthops);
       table[i].pqueue_index = -1;
     }
+  DIJKSTRA_TABLE_CLEAN (graph, table) = 1;
 }
 
 void *
@@ -127,23 +133,199 @@ dijkstra_candidate_update (void *data, int index)
   p->pqueue_index = index;
 }
 
+const char *dijkstra_queue_name[] =
+{
+  "binary-heap",
+  "dial",
+  "radix-heap",
+  NULL
+};
+
+/* create a candidate list of the type for the SPF calculations on
+   the graph G with the weight W (NULL for the hop count).  the
+   bucket queue needs the largest edge weight; if it is too large
+   for the buckets, the radix heap is used instead. */
+struct dijkstra_queue *
+dijkstra_queue_create (int type, struct graph *G, struct weight *W)
+{
+  struct dijkstra_queue *queue;
+  unsigned long maxstep = 1;
+  unsigned int i;
+
+  queue = (struct dijkstra_queue *) malloc (sizeof (struct dijkstra_queue));
+  memset (queue, 0, sizeof (struct dijkstra_queue));
+
+  if (type == DIJKSTRA_QUEUE_DIAL && W)
+    {
+      maxstep = 0;
+      for (i = 0; i < W->nedges; i++)
+        if (maxstep < W->weight[i])
+          maxstep = W->weight[i];
+      if (maxstep > DIJKSTRA_DIAL_MAXSTEP)
+        type = DIJKSTRA_QUEUE_RADIX_HEAP;
+    }
+
+  queue->type = type;
+  switch (type)
+    {
+    case DIJKSTRA_QUEUE_DIAL:
+      queue->bucketq = bucketq_create (G->nodes->size, maxstep);
+      break;
+    case DIJKSTRA_QUEUE_RADIX_HEAP:
+      queue->radixheap = radixheap_create (G->nodes->size);
+      break;
+    default:
+      queue->type = DIJKSTRA_QUEUE_BINARY_HEAP;
+      queue->pqueue = pqueue_create ();
+      queue->pqueue->cmp = dijkstra_candidate_cmp;
+      queue->pqueue->update = dijkstra_candidate_update;
+      break;
+    }
+
+  return queue;
+}
+
+void
+dijkstra_queue_delete (struct dijkstra_queue *queue)
+{
+  if (queue->pqueue)
+    pqueue_delete (queue->pqueue);
+  if (queue->bucketq)
+    bucketq_delete (queue->bucketq);
+  if (queue->radixheap)
+    radixheap_delete (queue->radixheap);
+  free (queue);
+}
+
+/* forget the nodes popped in the previous calculation. */
+void
+dijkstra_queue_clear (struct dijkstra_queue *queue)
+{
+  if (queue->bucketq)
+    bucketq_clear (queue->bucketq);
+  if (queue->radixheap)
+    radixheap_clear (queue->radixheap);
+}
+
+/* install the candidate, or update its position after its metric
+   has decreased. */
+void
+dijkstra_queue_push (struct dijkstra_path *c, struct dijkstra_queue *queue)
+{
+  switch (queue->type)
+    {
+    case DIJKSTRA_QUEUE_DIAL:
+      bucketq_push (c->node->id, c->metric, queue->bucketq);
+      break;
+    case DIJKSTRA_QUEUE_RADIX_HEAP:
+      radixheap_push (c->node->id, c->metric, queue->radixheap);
+      break;
+    default:
+      if (c->pqueue_index < 0)
+        pqueue_enqueue (c, queue->pqueue);
+      else
+        pqueue_update (c->pqueue_index, queue->pqueue);
+      break;
+    }
+}
+
+/* get the shortest candidate path; table is the dijkstra table
+   the candidates belong to. */
+struct dijkstra_path *
+dijkstra_queue_pop (struct dijkstra_path *table, struct dijkstra_queue *queue)
+{
+  switch (queue->type)
+    {
+    case DIJKSTRA_QUEUE_DIAL:
+      return &table[bucketq_pop (queue->bucketq)];
+    case DIJKSTRA_QUEUE_RADIX_HEAP:
+      return &table[radixheap_pop (queue->radixheap)];
+    default:
+      return (struct dijkstra_path *) pqueue_dequeue (queue->pqueue);
+    }
+}
+
+unsigned int
+dijkstra_queue_size (struct dijkstra_queue *queue)
+{
+  switch (queue->type)
+    {
+    case DIJKSTRA_QUEUE_DIAL:
+      return queue->bucketq->size;
+    case DIJKSTRA_QUEUE_RADIX_HEAP:
+      return queue->radixheap->size;
+    default:
+      return queue->pqueue->size;
+    }
+}
+
 void
 routing_dijkstra (struct node *root, struct weight *weight,
                         struct routing *R)
+{
+  struct dijkstra_queue *candidate_list;
+
+  graph_freeze (root->g);
+  route_thaw (R);
+
+  /* candidate list of the routing's type */
+  candidate_list = dijkstra_queue_create (R->spf_queue, R->G, weight);
+
+  routing_dijkstra_queue (root, weight, R, candidate_list);
+
+  /* free candidate list */
+  dijkstra_queue_delete (candidate_list);
+}
+
+/* same as routing_dijkstra (), but with the caller's binary heap
+   (empty, with dijkstra_candidate_cmp/update set). */
+void
+routing_dijkstra_pqueue (struct node *root, struct weight *weight,
+                         struct routing *R, struct pqueue *candidate_list)
+{
+  struct dijkstra_queue queue;
+
+  graph_freeze (root->g);
+  route_thaw (R);
+
+  memset (&queue, 0, sizeof (queue));
+  queue.type = DIJKSTRA_QUEUE_BINARY_HEAP;
+  queue.pqueue = candidate_list;
+  routing_dijkstra_queue (root, weight, R, &queue);
+}
+
+/* same as routing_dijkstra (), but with the caller's candidate list,
+   so that it can be reused over the roots.  the caller freezes the
+   graph and thaws the routes beforehand: this only reads the CSR
+   snapshot, and never touches R->flat, even in the worker threads. */
+void
+routing_dijkstra_queue (struct node *root, struct weight *weight,
+                        struct routing *R,
+                        struct dijkstra_queue *candidate_list)
 {
   struct dijkstra_path *c, *v;
-  struct pqueue *candidate_list;
-  struct vector_node *vn;
   struct dijkstra_path **dijkstra_data;
   struct dijkstra_path *dijkstra_table;
+  struct graph_csr *csr;
+  unsigned int i;
+  int cache;
 
   dijkstra_data = (struct dijkstra_path **) R->data;
   dijkstra_table = dijkstra_data[root->id];
 
-  /* candidate list is a priority queue */
-  candidate_list = pqueue_create ();
-  candidate_list->cmp = dijkstra_candidate_cmp;
-  candidate_list->update = dijkstra_candidate_update;
+  assert (root->g->csr);
+  assert (R->flat == NULL);
+
+  /* walk the adjacency on the CSR snapshot */
+  csr = root->g->csr;
+  dijkstra_queue_clear (candidate_list);
+
+  /* the same tree may have been calculated already */
+  cache = spf_cache_usable (root->g, dijkstra_table);
+  DIJKSTRA_TABLE_CLEAN (root->g, dijkstra_table) = 0;
+  if (cache &&
+      spf_cache_lookup (root, weight, SPF_CACHE_FORWARD, dijkstra_table))
+    return;
 
   /* consider the calculating node itself as a starting candidate */
   c = &dijkstra_table[root->id];
@@ -153,27 +335,26 @@ routing_dijkstra (struct node *root, struct weight *weight,
   vector_add (root, c->nexthops);
 
   /* install the calculating node in the candidate list */
-  pqueue_enqueue (c, candidate_list);
+  dijkstra_queue_push (c, candidate_list);
 
   /* continue while the candidate list is not empty */
-  while (candidate_list->size)
+  while (dijkstra_queue_size (candidate_list))
     {
       /* get the shortest candidate path among all candidates */
-      c = pqueue_dequeue (candidate_list);
+      c = dijkstra_queue_pop (dijkstra_table, candidate_list);
 
       /* Call the just added vertex "v" */
       v = c;
 
       /* for each node that is reachable through "v" */
-      for (vn = vector_head (v->node->olinks); vn;
-           vn = vector_next (vn))
+      for (i = csr->ooffset[v->node->id];
+           i < csr->ooffset[v->node->id + 1]; i++)
         {
-          struct link *edge = (struct link *) vn->data;
           unsigned int edge_cost = 0;
 
           /* new candidate */
-          c = &dijkstra_table[edge->to->id];
-          c->node = edge->to;
+          c = &dijkstra_table[csr->otarget[i]];
+          c->node = csr->node[csr->otarget[i]];
 
           /* calculating node (root) has always metric 0, so treat */
           if (c->node == root)
@@ -181,7 +362,7 @@ routing_dijkstra (struct node *root, struct weight *weight,
 
           /* edge cost */
           if (weight)
-            edge_cost = weight->weight[edge->id];
+            edge_cost = weight->weight[csr->olink[i]];
           else
             edge_cost = 1;
 
@@ -217,21 +398,21 @@ routing_dijkstra (struct node *root, struct weight *weight,
             vector_merge (c->nexthops, v->nexthops);
 
           /* install in the candidate list */
-          if (c->pqueue_index < 0)
-            pqueue_enqueue (c, candidate_list);
-          else
-            pqueue_update (c->pqueue_index, candidate_list);
+          dijkstra_queue_push (c, candidate_list);
         }
     }
 
-  /* free candidate list */
-  pqueue_delete (candidate_list);
+  if (cache)
+    spf_cache_insert (root, weight, SPF_CACHE_FORWARD, dijkstra_table);
 }
 
-void
-routing_dijkstra_route (struct node *root, struct routing *R)
+/* set the routes from the root in the thawed route[][], from its
+   spf result table: writes only route[root->id][*]. */
+static void
+routing_dijkstra_route_install (struct node *root, struct routing *R)
 {
   struct vector_node *vn, *vni;
+  struct vector_node vn_cursor, vni_cursor;
   int s = root->id;
   struct dijkstra_path **dijkstra_data;
   struct dijkstra_path *dijkstra_table;
@@ -240,25 +421,34 @@ routing_dijkstra_route (struct node *root, struct routing *R)
   dijkstra_table = dijkstra_data[root->id];
 
   /* set routing table from spf result table */
-  for (vn = vector_head (root->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (root->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *dst = (struct node *) vn->data;
       int t = dst->id;
       struct dijkstra_path *path = &dijkstra_table[dst->id];
 
-      nexthop_delete_all (R->route[s][t].nexthops);
+      nexthop_delete_all (route_nexthops_thawed (R, s, t));
 
       if (! path->nexthops)
         continue;
 
-      for (vni = vector_head (path->nexthops); vni; vni = vector_next (vni))
+      for (vni = vector_cursor_head (path->nexthops, &vni_cursor); vni;
+           vni = vector_cursor_next (vni))
         {
           struct node *nexthop = (struct node *) vector_data (vni);
-          route_add (root, dst, nexthop, R);
+          route_install (root, dst, nexthop, R);
         }
     }
 }
 
+void
+routing_dijkstra_route (struct node *root, struct routing *R)
+{
+  route_thaw (R);
+  routing_dijkstra_route_install (root, R);
+}
+
 DEFINE_COMMAND (routing_algorithm_dijkstra_node,
                 "routing-algorithm dijkstra node "NODE_SPEC,
                 ROUTING_ALGORITHM_HELP_STR
@@ -330,6 +520,7 @@ DEFINE_COMMAND (routing_algorithm_dijkstra_node_all,
   struct routing *routing = (struct routing *) shell->context;
   struct node *node;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct dijkstra_path **dijkstra_data;
   timer_counter_t start, end, res;
 
@@ -355,7 +546,8 @@ DEFINE_COMMAND (routing_algorithm_dijkstra_node_all,
   dijkstra_data = (struct dijkstra_path **) routing->data;
   dijkstra_data_clear (routing->G, dijkstra_data);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 
@@ -387,8 +579,10 @@ DEFINE_COMMAND (routing_algorithm_dijkstra,
   struct shell *shell = (struct shell *) context;
   struct routing *routing = (struct routing *) shell->context;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   struct node *node;
   struct dijkstra_path **dijkstra_data;
+  struct dijkstra_queue *candidate_list;
   int i;
   timer_counter_t start, end, res;
 
@@ -414,20 +608,31 @@ DEFINE_COMMAND (routing_algorithm_dijkstra,
   dijkstra_data = (struct dijkstra_path **) routing->data;
   dijkstra_data_clear (routing->G, dijkstra_data);
 
+  candidate_list = dijkstra_queue_create (routing->spf_queue,
+                                          routing->G, routing->W);
+
+  /* all the routes are replaced */
+  graph_freeze (routing->G);
+  route_clear (routing);
+
   timer_count (start);
 
   /* calculate dijkstra for each node */
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 
       /* execute Dijkstra's SPF */
-      routing_dijkstra (node, routing->W, routing);
+      routing_dijkstra_queue (node, routing->W, routing, candidate_list);
     }
 
   timer_count (end);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  dijkstra_queue_delete (candidate_list);
+
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 
@@ -441,4 +646,114 @@ DEFINE_COMMAND (routing_algorithm_dijkstra,
            timer_to_usec (res));
 }
 
+struct dijkstra_thread_arg
+{
+  struct routing *routing;
+  struct dijkstra_queue **queues;
+};
+
+static void
+dijkstra_thread_root (void *arg, unsigned int item, unsigned int worker)
+{
+  struct dijkstra_thread_arg *targ = (struct dijkstra_thread_arg *) arg;
+  struct routing *routing = targ->routing;
+  struct node *node;
+
+  node = (struct node *) vector_get (routing->G->nodes, item);
+  if (! node)
+    return;
+
+  /* the root writes only its own dijkstra_data[root->id] and
+     routing->route[root->id][*], so no lock is needed. */
+  routing_dijkstra_queue (node, routing->W, routing,
+                          targ->queues[worker]);
+  routing_dijkstra_route_install (node, routing);
+}
+
+DEFINE_COMMAND (routing_algorithm_dijkstra_threads,
+                "routing-algorithm dijkstra threads <1-1024>",
+                ROUTING_ALGORITHM_HELP_STR
+                "Dijkstra's SPF calculation.\n"
+                "calculate in multiple threads.\n"
+                "specify number of threads.\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct dijkstra_thread_arg targ;
+  unsigned int i, nthreads;
+  timer_counter_t start, end, res;
 
+  if (routing->G == NULL)
+    {
+      fprintf (shell->terminal, "no graph specified for routing.\n");
+      return;
+    }
+  if (routing->W == NULL)
+    {
+      fprintf (shell->terminal, "no weight specified for routing.\n");
+      return;
+    }
+  if (routing->G != routing->W->G)
+    {
+      fprintf (shell->terminal, "base graph does not match with weight's.\n");
+      return;
+    }
+
+  nthreads = strtoul (argv[3], NULL, 0);
+
+  /* prepare dijkstra table */
+  if (! routing->data)
+    routing->data = dijkstra_data_create (routing->G);
+  dijkstra_data_clear (routing->G, routing->data);
+
+  /* build the CSR snapshot before the workers share it */
+  graph_freeze (routing->G);
+  /* the workers replace all the routes in route[][] */
+  route_clear (routing);
+
+  /* a candidate list for each worker */
+  targ.routing = routing;
+  targ.queues = (struct dijkstra_queue **)
+    calloc (nthreads, sizeof (struct dijkstra_queue *));
+  for (i = 0; i < nthreads; i++)
+    targ.queues[i] = dijkstra_queue_create (routing->spf_queue,
+                                            routing->G, routing->W);
+
+  timer_count (start);
+
+  workqueue_run (nthreads, routing->G->nodes->size,
+                 dijkstra_thread_root, &targ);
+
+  timer_count (end);
+
+  for (i = 0; i < nthreads; i++)
+    dijkstra_queue_delete (targ.queues[i]);
+  free (targ.queues);
+
+  timer_sub (start, end, res);
+  fprintf (shell->terminal,
+           "Dijkstra overall calculation time (%u threads): %llu us\n",
+           nthreads, timer_to_usec (res));
+}
+
+DEFINE_COMMAND (routing_spf_queue,
+                "routing-spf-queue NAME",
+                "routing's SPF candidate list\n"
+                "binary-heap, dial (bucket queue) or radix-heap\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  int i;
+
+  for (i = 0; dijkstra_queue_name[i]; i++)
+    if (! strcmp (argv[1], dijkstra_queue_name[i]))
+      break;
+  if (! dijkstra_queue_name[i])
+    {
+      fprintf (shell->terminal, "no such SPF queue: %s\n", argv[1]);
+      return;
+    }
+
+  routing->spf_queue = i;
+  command_config_add (routing->config, argc, argv);
+}
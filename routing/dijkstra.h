@@ -30,6 +30,35 @@ struct dijkstra_path
   int pqueue_index;
 };
 
+struct pqueue;
+struct bucketq;
+struct radixheap;
+
+/* candidate list of the SPF calculation, selected per routing
+   instance by routing-spf-queue. */
+#define DIJKSTRA_QUEUE_BINARY_HEAP 0
+#define DIJKSTRA_QUEUE_DIAL        1
+#define DIJKSTRA_QUEUE_RADIX_HEAP  2
+
+/* largest edge weight for the Dial's bucket queue */
+#define DIJKSTRA_DIAL_MAXSTEP (1UL << 20)
+
+/* the tables have an extra entry after the last node's, whose
+   metric tells whether the table is as dijkstra_table_clear () left
+   it (the SPF calculations set it dirty), so that spf_cache_usable ()
+   need not scan the whole table. */
+#define DIJKSTRA_TABLE_CLEAN(G, table) ((table)[(G)->nodes->size].metric)
+
+struct dijkstra_queue
+{
+  int type;
+  struct pqueue *pqueue;
+  struct bucketq *bucketq;
+  struct radixheap *radixheap;
+};
+
+extern const char *dijkstra_queue_name[];
+
 struct dijkstra_path *dijkstra_table_create (struct graph *graph);
 void dijkstra_table_delete (struct graph *graph, struct dijkstra_path *table);
 void dijkstra_table_clear (struct graph *graph, struct dijkstra_path *table);
@@ -40,13 +69,31 @@ void dijkstra_data_clear (struct graph *graph, void *data);
 int dijkstra_candidate_cmp (void *a, void *b);
 void dijkstra_candidate_update (void *data, int index);
 
+struct dijkstra_queue *dijkstra_queue_create (int type, struct graph *G,
+                                              struct weight *W);
+void dijkstra_queue_delete (struct dijkstra_queue *queue);
+void dijkstra_queue_clear (struct dijkstra_queue *queue);
+void dijkstra_queue_push (struct dijkstra_path *c,
+                          struct dijkstra_queue *queue);
+struct dijkstra_path *dijkstra_queue_pop (struct dijkstra_path *table,
+                                          struct dijkstra_queue *queue);
+unsigned int dijkstra_queue_size (struct dijkstra_queue *queue);
+
 void routing_dijkstra (struct node *root, struct weight *weight,
                              struct routing *R);
+void routing_dijkstra_pqueue (struct node *root, struct weight *weight,
+                              struct routing *R,
+                              struct pqueue *candidate_list);
+void routing_dijkstra_queue (struct node *root, struct weight *weight,
+                             struct routing *R,
+                             struct dijkstra_queue *candidate_list);
 void routing_dijkstra_route (struct node *root, struct routing *R);
 
 EXTERN_COMMAND (routing_algorithm_dijkstra_node);
 EXTERN_COMMAND (routing_algorithm_dijkstra_node_all);
 EXTERN_COMMAND (routing_algorithm_dijkstra);
+EXTERN_COMMAND (routing_algorithm_dijkstra_threads);
+EXTERN_COMMAND (routing_spf_queue);
 
 #endif /*_DIJKSTRA_H_*/
 
@@ -0,0 +1,608 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "command_shell.h"
+#include "pqueue.h"
+#include "timer.h"
+
+#include "network/graph.h"
+#include "network/weight.h"
+#include "network/path.h"
+#include "network/routing.h"
+
+#include "routing/dijkstra.h"
+#include "routing/incremental-dijkstra.h"
+
+/* Incremental SPF.  Given the SPF table of a root calculated by
+   routing_dijkstra () and a set of links whose weight has changed
+   (or which went down), repair only the part of the table that
+   depends on them, in the manner of Ramalingam-Reps:
+
+   1. mark the nodes below the worsened links in the shortest path
+      DAG (affected nodes); the others keep their metric.
+   2. reset the affected nodes, and seed them from their unaffected
+      neighbors.
+   3. relax the improved links.
+   4. continue Dijkstra's SPF from the seeded candidates.
+
+   Neither the graph nor the weight is modified. */
+
+struct dijkstra_incremental
+{
+  struct node *root;
+  struct graph_csr *csr;
+  struct dijkstra_path *table;
+  struct pqueue *candidate_list;
+  char *touched_mark;
+  unsigned int *touched_list;
+  struct vector *touched;
+  int ntouched;
+};
+
+#define DIJKSTRA_REACHED(di, x) \
+  ((x) == (di)->root->id || (di)->table[(x)].metric != 0)
+
+static weight_t
+dijkstra_old_weight (struct weight *weight, unsigned int link_id)
+{
+  return (weight ? weight->weight[link_id] : 1);
+}
+
+static weight_t
+dijkstra_new_weight (struct weight *weight, unsigned int link_id,
+                     struct dijkstra_change *changes, int nchanges)
+{
+  int i;
+  for (i = 0; i < nchanges; i++)
+    if (changes[i].link->id == link_id)
+      return changes[i].weight;
+  return dijkstra_old_weight (weight, link_id);
+}
+
+static void
+dijkstra_incremental_touch (struct dijkstra_incremental *di,
+                            unsigned int id)
+{
+  if (di->touched_mark[id])
+    return;
+  di->touched_mark[id]++;
+  di->touched_list[di->ntouched++] = id;
+  if (di->touched)
+    vector_add_allow_dup (&di->table[id], di->touched);
+}
+
+static void
+dijkstra_incremental_relax (struct dijkstra_incremental *di,
+                            unsigned int u, unsigned int v, weight_t cost)
+{
+  struct dijkstra_path *p = &di->table[u];
+  struct dijkstra_path *c = &di->table[v];
+  struct pqueue *candidate_list = di->candidate_list;
+  unsigned int metric = p->metric + cost;
+  int changed = 0, size;
+
+  /* ignore longer path */
+  if (DIJKSTRA_REACHED (di, v) && c->metric < metric)
+    return;
+
+  /* new or shorter path */
+  if (! DIJKSTRA_REACHED (di, v) || c->metric > metric)
+    {
+      dijkstra_incremental_touch (di, v);
+      c->node = di->csr->node[v];
+      c->metric = metric;
+      vector_clear (c->nexthops);
+      changed++;
+    }
+
+  /* calculate nexthop for the candidate */
+  size = c->nexthops->size;
+  if (u == di->root->id)
+    {
+      if (! vector_lookup (c->node, c->nexthops))
+        vector_add (c->node, c->nexthops);
+    }
+  else
+    vector_merge (c->nexthops, p->nexthops);
+  if (c->nexthops->size != size)
+    {
+      dijkstra_incremental_touch (di, v);
+      changed++;
+    }
+
+  if (! changed)
+    return;
+
+  /* install in the candidate list.  the pqueue_index left by the
+     previous calculation may be stale, so check it. */
+  if (c->pqueue_index >= 0 && c->pqueue_index < candidate_list->size &&
+      candidate_list->array[c->pqueue_index] == c)
+    pqueue_update (c->pqueue_index, candidate_list);
+  else
+    pqueue_enqueue (c, candidate_list);
+}
+
+struct dijkstra_incremental_scratch *
+dijkstra_incremental_scratch_create (struct graph *G)
+{
+  struct dijkstra_incremental_scratch *s;
+  unsigned int n;
+
+  s = (struct dijkstra_incremental_scratch *)
+    malloc (sizeof (struct dijkstra_incremental_scratch));
+  memset (s, 0, sizeof (struct dijkstra_incremental_scratch));
+  s->nnodes = n = G->nodes->size;
+  s->candidate_list = pqueue_create ();
+  s->candidate_list->cmp = dijkstra_candidate_cmp;
+  s->candidate_list->update = dijkstra_candidate_update;
+  s->touched_mark = (char *) calloc (n + 1, sizeof (char));
+  s->touched_list = (unsigned int *) calloc (n + 1, sizeof (unsigned int));
+  s->affected = (char *) calloc (n + 1, sizeof (char));
+  s->list = (unsigned int *) calloc (n + 1, sizeof (unsigned int));
+  s->nchanges_max = G->links->size;
+  s->changes = (struct dijkstra_change *)
+    calloc (s->nchanges_max + 1, sizeof (struct dijkstra_change));
+  return s;
+}
+
+void
+dijkstra_incremental_scratch_delete (struct dijkstra_incremental_scratch *s)
+{
+  pqueue_delete (s->candidate_list);
+  free (s->touched_mark);
+  free (s->touched_list);
+  free (s->affected);
+  free (s->list);
+  free (s->changes);
+  free (s);
+}
+
+/* repair the SPF table of the root for the changes.  weight is the
+   weight the table was calculated with.  the entries modified are
+   appended to touched, if given.  scratch is the caller's work space
+   for the graph (NULL to allocate one for this call).  returns the
+   number of the modified entries. */
+int
+routing_dijkstra_incremental (struct node *root, struct weight *weight,
+                              struct dijkstra_change *changes, int nchanges,
+                              struct dijkstra_path *dijkstra_table,
+                              struct vector *touched,
+                              struct dijkstra_incremental_scratch *scratch)
+{
+  struct dijkstra_incremental di;
+  struct dijkstra_incremental_scratch *own = NULL;
+  struct graph_csr *csr;
+  struct dijkstra_path *c;
+  char *affected;
+  unsigned int *list;
+  unsigned int naffected, k, i, u, v, x, y;
+  weight_t old_weight, new_weight;
+
+  csr = graph_freeze (root->g);
+
+  if (scratch == NULL)
+    scratch = own = dijkstra_incremental_scratch_create (root->g);
+  assert (scratch->nnodes == csr->nnodes);
+
+  DIJKSTRA_TABLE_CLEAN (root->g, dijkstra_table) = 0;
+
+  memset (&di, 0, sizeof (di));
+  di.root = root;
+  di.csr = csr;
+  di.table = dijkstra_table;
+  di.touched = touched;
+  di.touched_mark = scratch->touched_mark;
+  di.touched_list = scratch->touched_list;
+  di.candidate_list = scratch->candidate_list;
+
+  affected = scratch->affected;
+  list = scratch->list;
+  naffected = 0;
+
+  /* 1. the heads of the worsened links on the shortest path DAG */
+  for (k = 0; k < nchanges; k++)
+    {
+      u = changes[k].link->from->id;
+      v = changes[k].link->to->id;
+      old_weight = dijkstra_old_weight (weight, changes[k].link->id);
+      new_weight = changes[k].weight;
+
+      if (new_weight != DIJKSTRA_LINK_DOWN && new_weight <= old_weight)
+        continue;
+      if (v == root->id || affected[v])
+        continue;
+      if (! DIJKSTRA_REACHED (&di, u) || ! DIJKSTRA_REACHED (&di, v))
+        continue;
+      if (dijkstra_table[u].metric + old_weight != dijkstra_table[v].metric)
+        continue;
+
+      affected[v]++;
+      list[naffected++] = v;
+    }
+
+  /* and everything below them */
+  for (k = 0; k < naffected; k++)
+    {
+      x = list[k];
+      for (i = csr->ooffset[x]; i < csr->ooffset[x + 1]; i++)
+        {
+          y = csr->otarget[i];
+          if (y == root->id || affected[y] || ! DIJKSTRA_REACHED (&di, y))
+            continue;
+          old_weight = dijkstra_old_weight (weight, csr->olink[i]);
+          if (dijkstra_table[x].metric + old_weight !=
+              dijkstra_table[y].metric)
+            continue;
+          affected[y]++;
+          list[naffected++] = y;
+        }
+    }
+
+  /* 2. reset the affected nodes */
+  for (k = 0; k < naffected; k++)
+    {
+      v = list[k];
+      c = &dijkstra_table[v];
+      dijkstra_incremental_touch (&di, v);
+      c->node = NULL;
+      c->metric = 0;
+      vector_clear (c->nexthops);
+    }
+
+  /* seed them from the unaffected neighbors */
+  for (k = 0; k < naffected; k++)
+    {
+      v = list[k];
+      for (i = csr->ioffset[v]; i < csr->ioffset[v + 1]; i++)
+        {
+          u = csr->isource[i];
+          if (affected[u] || ! DIJKSTRA_REACHED (&di, u))
+            continue;
+          new_weight = dijkstra_new_weight (weight, csr->ilink[i],
+                                            changes, nchanges);
+          if (new_weight == DIJKSTRA_LINK_DOWN)
+            continue;
+          dijkstra_incremental_relax (&di, u, v, new_weight);
+        }
+    }
+
+  /* 3. the improved links */
+  for (k = 0; k < nchanges; k++)
+    {
+      u = changes[k].link->from->id;
+      v = changes[k].link->to->id;
+      old_weight = dijkstra_old_weight (weight, changes[k].link->id);
+      new_weight = changes[k].weight;
+
+      if (new_weight == DIJKSTRA_LINK_DOWN || new_weight >= old_weight)
+        continue;
+      if (v == root->id || affected[u] || ! DIJKSTRA_REACHED (&di, u))
+        continue;
+      dijkstra_incremental_relax (&di, u, v, new_weight);
+    }
+
+  /* 4. continue while the candidate list is not empty */
+  while (di.candidate_list->size)
+    {
+      c = pqueue_dequeue (di.candidate_list);
+      c->pqueue_index = -1;
+      x = c - dijkstra_table;
+
+      for (i = csr->ooffset[x]; i < csr->ooffset[x + 1]; i++)
+        {
+          y = csr->otarget[i];
+          if (y == root->id)
+            continue;
+          new_weight = dijkstra_new_weight (weight, csr->olink[i],
+                                            changes, nchanges);
+          if (new_weight == DIJKSTRA_LINK_DOWN)
+            continue;
+          dijkstra_incremental_relax (&di, x, y, new_weight);
+        }
+    }
+
+  /* leave the work space cleared for the next call */
+  for (k = 0; k < naffected; k++)
+    affected[list[k]] = 0;
+  for (k = 0; k < di.ntouched; k++)
+    di.touched_mark[di.touched_list[k]] = 0;
+
+  if (own)
+    dijkstra_incremental_scratch_delete (own);
+
+  return di.ntouched;
+}
+
+/* repair the SPF table of the root for the failure of the node,
+   i.e., all of its incoming and outgoing links go down.  the node
+   itself is left unreachable (the whole table, if it is the root).
+   the arguments are as routing_dijkstra_incremental (). */
+int
+routing_dijkstra_incremental_node (struct node *root, struct weight *weight,
+                                   struct node *node,
+                                   struct dijkstra_path *dijkstra_table,
+                                   struct vector *touched,
+                                   struct dijkstra_incremental_scratch
+                                   *scratch)
+{
+  struct dijkstra_incremental_scratch *own = NULL;
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  int nchanges, ntouched;
+
+  if (scratch == NULL)
+    scratch = own = dijkstra_incremental_scratch_create (root->g);
+
+  nchanges = 0;
+  for (vn = vector_cursor_head (node->olinks, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      assert (nchanges < scratch->nchanges_max);
+      scratch->changes[nchanges].link = (struct link *) vn->data;
+      scratch->changes[nchanges++].weight = DIJKSTRA_LINK_DOWN;
+    }
+  for (vn = vector_cursor_head (node->ilinks, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      struct link *link = (struct link *) vn->data;
+
+      /* a self loop is in the olinks too */
+      if (link->from == node)
+        continue;
+      assert (nchanges < scratch->nchanges_max);
+      scratch->changes[nchanges].link = link;
+      scratch->changes[nchanges++].weight = DIJKSTRA_LINK_DOWN;
+    }
+
+  ntouched = routing_dijkstra_incremental (root, weight,
+                                           scratch->changes, nchanges,
+                                           dijkstra_table, touched, scratch);
+
+  if (own)
+    dijkstra_incremental_scratch_delete (own);
+
+  return ntouched;
+}
+
+static int
+dijkstra_path_is_same (struct dijkstra_path *a, struct dijkstra_path *b)
+{
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+
+  if (a->metric != b->metric || a->nexthops->size != b->nexthops->size)
+    return 0;
+  for (vn = vector_cursor_head (a->nexthops, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    if (! vector_lookup (vn->data, b->nexthops))
+      return 0;
+  return 1;
+}
+
+static void
+dijkstra_path_restore (struct dijkstra_path *dst, struct dijkstra_path *src)
+{
+  dst->node = src->node;
+  dst->metric = src->metric;
+  dst->pqueue_index = -1;
+  vector_clear (dst->nexthops);
+  vector_merge (dst->nexthops, src->nexthops);
+}
+
+/* repair the tables of all roots for a failure (of the link and its
+   inverse in changes, or of the node), count the routes changed and
+   lost against the base tables, and restore the tables. */
+static void
+dijkstra_failure_sweep_one (struct routing *routing,
+                            struct dijkstra_path **dijkstra_data,
+                            struct dijkstra_path **scratch_data,
+                            struct dijkstra_change *changes, int nchanges,
+                            struct node *node, struct vector *touched,
+                            struct dijkstra_incremental_scratch *scratch,
+                            unsigned long *changed, unsigned long *lost)
+{
+  struct vector_node *vn, *vnt;
+  struct vector_node vn_cursor, vnt_cursor;
+  struct node *root;
+  int id;
+
+  *changed = *lost = 0;
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      root = (struct node *) vn->data;
+
+      vector_clear (touched);
+      if (node)
+        routing_dijkstra_incremental_node (root, routing->W, node,
+                                           scratch_data[root->id], touched,
+                                           scratch);
+      else
+        routing_dijkstra_incremental (root, routing->W,
+                                      changes, nchanges,
+                                      scratch_data[root->id], touched,
+                                      scratch);
+
+      for (vnt = vector_cursor_head (touched, &vnt_cursor); vnt;
+           vnt = vector_cursor_next (vnt))
+        {
+          struct dijkstra_path *p = (struct dijkstra_path *) vnt->data;
+          struct dijkstra_path *base;
+          id = p - scratch_data[root->id];
+          base = &dijkstra_data[root->id][id];
+
+          if (! dijkstra_path_is_same (p, base))
+            {
+              (*changed)++;
+              if (p->metric == 0 && base->metric != 0)
+                (*lost)++;
+            }
+          dijkstra_path_restore (p, base);
+        }
+    }
+}
+
+static void
+dijkstra_failure_sweep (struct shell *shell, struct routing *routing,
+                        int nodes)
+{
+  struct dijkstra_path **dijkstra_data, **scratch_data;
+  struct dijkstra_incremental_scratch *scratch;
+  struct dijkstra_change changes[2];
+  struct vector *touched;
+  struct vector_node *vn, *vnl;
+  struct vector_node vn_cursor, vnl_cursor;
+  struct node *root, *node;
+  struct link *link;
+  unsigned long changed, lost, nfailures = 0;
+  int nchanges, id;
+  timer_counter_t start, end, res;
+
+  if (routing->G == NULL)
+    {
+      fprintf (shell->terminal, "no graph specified for routing.\n");
+      return;
+    }
+  if (routing->W == NULL)
+    {
+      fprintf (shell->terminal, "no weight specified for routing.\n");
+      return;
+    }
+  if (routing->G != routing->W->G)
+    {
+      fprintf (shell->terminal, "base graph does not match with weight's.\n");
+      return;
+    }
+
+  /* the base SPF tables */
+  if (! routing->data)
+    routing->data = dijkstra_data_create (routing->G);
+  dijkstra_data = (struct dijkstra_path **) routing->data;
+  dijkstra_data_clear (routing->G, dijkstra_data);
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      root = (struct node *) vn->data;
+      routing_dijkstra (root, routing->W, routing);
+    }
+
+  /* the copy to be repaired, and restored after each failure */
+  scratch_data = dijkstra_data_create (routing->G);
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
+    {
+      root = (struct node *) vn->data;
+      for (id = 0; id < routing->G->nodes->size; id++)
+        dijkstra_path_restore (&scratch_data[root->id][id],
+                               &dijkstra_data[root->id][id]);
+      DIJKSTRA_TABLE_CLEAN (routing->G, scratch_data[root->id]) = 0;
+    }
+
+  touched = vector_create ();
+  scratch = dijkstra_incremental_scratch_create (routing->G);
+
+  timer_count (start);
+
+  if (nodes)
+    {
+      for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
+        {
+          node = (struct node *) vn->data;
+          dijkstra_failure_sweep_one (routing, dijkstra_data, scratch_data,
+                                      NULL, 0, node, touched, scratch,
+                                      &changed, &lost);
+          fprintf (shell->terminal,
+                   "node %u failure: %lu routes changed, %lu lost\n",
+                   node->id, changed, lost);
+          nfailures++;
+        }
+    }
+  else
+    {
+      for (vnl = vector_cursor_head (routing->G->links, &vnl_cursor); vnl;
+           vnl = vector_cursor_next (vnl))
+        {
+          link = (struct link *) vnl->data;
+
+          /* fail the link together with its inverse, once */
+          if (link->inverse && link->inverse->id < link->id)
+            continue;
+          nchanges = 0;
+          changes[nchanges].link = link;
+          changes[nchanges++].weight = DIJKSTRA_LINK_DOWN;
+          if (link->inverse)
+            {
+              changes[nchanges].link = link->inverse;
+              changes[nchanges++].weight = DIJKSTRA_LINK_DOWN;
+            }
+
+          dijkstra_failure_sweep_one (routing, dijkstra_data, scratch_data,
+                                      changes, nchanges, NULL, touched,
+                                      scratch, &changed, &lost);
+          fprintf (shell->terminal,
+                   "link %u (%u-%u) failure: %lu routes changed, %lu lost\n",
+                   link->id, link->from->id, link->to->id, changed, lost);
+          nfailures++;
+        }
+    }
+
+  timer_count (end);
+
+  dijkstra_incremental_scratch_delete (scratch);
+  vector_delete (touched);
+  dijkstra_data_delete (routing->G, scratch_data);
+
+  timer_sub (start, end, res);
+  fprintf (shell->terminal,
+           "Dijkstra failure sweep time: %llu us (%lu failures)\n",
+           timer_to_usec (res), nfailures);
+}
+
+DEFINE_COMMAND (routing_algorithm_dijkstra_failure_sweep,
+                "routing-algorithm dijkstra failure-sweep",
+                ROUTING_ALGORITHM_HELP_STR
+                "Dijkstra's SPF calculation.\n"
+                "fail each link (both directions) and repair SPF "
+                "incrementally\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  dijkstra_failure_sweep (shell, routing, 0);
+}
+
+DEFINE_COMMAND (routing_algorithm_dijkstra_failure_sweep_node,
+                "routing-algorithm dijkstra failure-sweep node",
+                ROUTING_ALGORITHM_HELP_STR
+                "Dijkstra's SPF calculation.\n"
+                "fail each link (both directions) and repair SPF "
+                "incrementally\n"
+                "fail each node (all of its links) instead\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  dijkstra_failure_sweep (shell, routing, 1);
+}
+
@@ -0,0 +1,74 @@
+
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _INCREMENTAL_DIJKSTRA_H_
+#define _INCREMENTAL_DIJKSTRA_H_
+
+/* a change of a link against the weight the SPF table was
+   calculated with.  DIJKSTRA_LINK_DOWN removes the link. */
+struct dijkstra_change
+{
+  struct link *link;
+  weight_t weight;
+};
+
+#define DIJKSTRA_LINK_DOWN ((weight_t) -1)
+
+/* work space of routing_dijkstra_incremental () for a graph, to be
+   reused over the calls (e.g., over the roots and the failures). */
+struct dijkstra_incremental_scratch
+{
+  unsigned int nnodes;
+  struct pqueue *candidate_list;
+  char *touched_mark;
+  unsigned int *touched_list;
+  char *affected;
+  unsigned int *list;
+
+  /* the changes of routing_dijkstra_incremental_node () */
+  struct dijkstra_change *changes;
+  unsigned int nchanges_max;
+};
+
+struct dijkstra_incremental_scratch *
+dijkstra_incremental_scratch_create (struct graph *G);
+void
+dijkstra_incremental_scratch_delete (struct dijkstra_incremental_scratch *s);
+
+int routing_dijkstra_incremental (struct node *root, struct weight *weight,
+                                  struct dijkstra_change *changes,
+                                  int nchanges,
+                                  struct dijkstra_path *dijkstra_table,
+                                  struct vector *touched,
+                                  struct dijkstra_incremental_scratch *scratch);
+int routing_dijkstra_incremental_node (struct node *root,
+                                       struct weight *weight,
+                                       struct node *node,
+                                       struct dijkstra_path *dijkstra_table,
+                                       struct vector *touched,
+                                       struct dijkstra_incremental_scratch
+                                       *scratch);
+
+EXTERN_COMMAND (routing_algorithm_dijkstra_failure_sweep);
+EXTERN_COMMAND (routing_algorithm_dijkstra_failure_sweep_node);
+
+#endif /*_INCREMENTAL_DIJKSTRA_H_*/
+
@@ -44,13 +44,15 @@ routing_lfi_node_calculation (struct node *node, struct node *neighbor,
   struct dijkstra_path **dijkstra_data;
   struct dijkstra_path *dijkstra_table, *neighbor_table;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   dijkstra_data = (struct dijkstra_path **) routing->data;
   dijkstra_table = dijkstra_data[node->id];
   neighbor_table = dijkstra_data[neighbor->id];
 
   /* for each destination */
-  for (vn = vector_head (node->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (node->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *dst = (struct node *) vector_data (vn);
 
@@ -81,6 +83,7 @@ DEFINE_COMMAND (routing_algorithm_lfi_node,
   struct shell *shell = (struct shell *) context;
   struct routing *routing = (struct routing *) shell->context;
   struct vector_node *vnn;
+  struct vector_node vnn_cursor;
   struct node *node;
   unsigned long node_id;
   struct dijkstra_path **dijkstra_data;
@@ -122,7 +125,8 @@ DEFINE_COMMAND (routing_algorithm_lfi_node,
   routing_dijkstra (node, routing->W, routing);
 
   /* for each neighbor */
-  for (vnn = vector_head (node->olinks); vnn; vnn = vector_next (vnn))
+  for (vnn = vector_cursor_head (node->olinks, &vnn_cursor); vnn;
+       vnn = vector_cursor_next (vnn))
     {
       struct link *link = (struct link *) vnn->data;
       struct node *neighbor = link->to;
@@ -137,7 +141,8 @@ DEFINE_COMMAND (routing_algorithm_lfi_node,
   routing_dijkstra_route (node, routing);
 
   /* for each neighbor */
-  for (vnn = vector_head (node->olinks); vnn; vnn = vector_next (vnn))
+  for (vnn = vector_cursor_head (node->olinks, &vnn_cursor); vnn;
+       vnn = vector_cursor_next (vnn))
     {
       struct link *link = (struct link *) vnn->data;
       struct node *neighbor = link->to;
@@ -163,6 +168,7 @@ DEFINE_COMMAND (routing_algorithm_lfi_node_all,
   struct shell *shell = (struct shell *) context;
   struct routing *routing = (struct routing *) shell->context;
   struct vector_node *vn, *vnn;
+  struct vector_node vn_cursor, vnn_cursor;
   struct node *node;
   struct dijkstra_path **dijkstra_data;
   timer_counter_t start, end, res;
@@ -189,7 +195,8 @@ DEFINE_COMMAND (routing_algorithm_lfi_node_all,
   dijkstra_data = (struct dijkstra_path **) routing->data;
   dijkstra_data_clear (routing->G, dijkstra_data);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 
@@ -202,7 +209,8 @@ DEFINE_COMMAND (routing_algorithm_lfi_node_all,
       routing_dijkstra (node, routing->W, routing);
 
       /* for each neighbor */
-      for (vnn = vector_head (node->olinks); vnn; vnn = vector_next (vnn))
+      for (vnn = vector_cursor_head (node->olinks, &vnn_cursor); vnn;
+           vnn = vector_cursor_next (vnn))
         {
           struct link *link = (struct link *) vnn->data;
           struct node *neighbor = link->to;
@@ -217,7 +225,8 @@ DEFINE_COMMAND (routing_algorithm_lfi_node_all,
       routing_dijkstra_route (node, routing);
 
       /* for each neighbor */
-      for (vnn = vector_head (node->olinks); vnn; vnn = vector_next (vnn))
+      for (vnn = vector_cursor_head (node->olinks, &vnn_cursor); vnn;
+           vnn = vector_cursor_next (vnn))
         {
           struct link *link = (struct link *) vnn->data;
           struct node *neighbor = link->to;
@@ -242,6 +251,7 @@ DEFINE_COMMAND (routing_algorithm_lfi,
   struct shell *shell = (struct shell *) context;
   struct routing *routing = (struct routing *) shell->context;
   struct vector_node *vn, *vnn;
+  struct vector_node vn_cursor, vnn_cursor;
   struct dijkstra_path **dijkstra_data;
   timer_counter_t start, end, res;
 
@@ -270,7 +280,8 @@ DEFINE_COMMAND (routing_algorithm_lfi,
   timer_count (start);
 
   /* calculate dijkstra for each node */
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *node = (struct node *) vn->data;
 
@@ -284,12 +295,14 @@ DEFINE_COMMAND (routing_algorithm_lfi,
   timer_count (end);
 
   /* for each node */
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *node = (struct node *) vn->data;
 
       /* for each neighbor */
-      for (vnn = vector_head (node->olinks); vnn; vnn = vector_next (vnn))
+      for (vnn = vector_cursor_head (node->olinks, &vnn_cursor); vnn;
+           vnn = vector_cursor_next (vnn))
         {
           struct link *link = (struct link *) vector_data (vnn);
           struct node *neighbor = link->to;
@@ -27,6 +27,7 @@
 #include "file.h"
 #include "timer.h"
 #include "pqueue.h"
+#include "workqueue.h"
 
 #include "network/graph.h"
 #include "network/weight.h"
@@ -145,15 +146,31 @@ void
 routing_ma_ordering (struct node *t, cmp_t cmp_func,
                      struct mara_node **mara_data)
 {
-  struct vector_node *vn;
   struct pqueue *pqueue;
-  unsigned int label = 1;
-  struct mara_node *c, *v;
 
   pqueue = pqueue_create ();
   pqueue->cmp = cmp_func;
   pqueue->update = mara_pqueue_index_update;
 
+  routing_ma_ordering_pqueue (t, mara_data, pqueue);
+
+  pqueue_delete (pqueue);
+}
+
+/* same as routing_ma_ordering (), but with the caller's (empty)
+   priority queue, whose cmp decides MARA-MC or MARA-MMMF. */
+void
+routing_ma_ordering_pqueue (struct node *t, struct mara_node **mara_data,
+                            struct pqueue *pqueue)
+{
+  unsigned int label = 1;
+  struct mara_node *c, *v;
+  struct graph_csr *csr;
+  unsigned int i;
+
+  /* walk the adjacency on the CSR snapshot */
+  csr = graph_freeze (t->g);
+
   c = &mara_data[t->id][t->id];
   c->node = t;
 #define MARA_ADJ_INFINITY UINT_MAX
@@ -179,10 +196,10 @@ routing_ma_ordering (struct node *t, cmp_t cmp_func,
                t->id, v->node->id, v->label, v->adjacency);
 #endif /*DEBUG*/
 
-      for (vn = vector_head (v->node->ilinks); vn; vn = vector_next (vn))
+      for (i = csr->ioffset[v->node->id];
+           i < csr->ioffset[v->node->id + 1]; i++)
         {
-          struct link *link = (struct link *) vector_data (vn);
-          struct node *candidate = link->from;
+          struct node *candidate = csr->node[csr->isource[i]];
 
           c = &mara_data[t->id][candidate->id];
           if (c->label > 0)
@@ -190,7 +207,7 @@ routing_ma_ordering (struct node *t, cmp_t cmp_func,
 
           c->node = candidate;
           c->adjacency++;
-          c->bandwidth += (link->bandwidth ? link->bandwidth : 0) ;
+          c->bandwidth += (csr->ibandwidth[i] ? csr->ibandwidth[i] : 0) ;
 
           if (c->pqueue_index < 0)
             pqueue_enqueue (c, pqueue);
@@ -205,18 +222,18 @@ routing_ma_ordering (struct node *t, cmp_t cmp_func,
 #endif /*DEBUG*/
         }
     }
-
-  pqueue_delete (pqueue);
 }
 
 void
 routing_mara_route_node (struct node *s, struct routing *routing)
 {
   struct vector_node *vn, *vnn;
+  struct vector_node vn_cursor, vnn_cursor;
   struct mara_node **mara_data = (struct mara_node **) routing->data;
 
   /* for each destination */
-  for (vn = vector_head (s->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (s->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       struct mara_node *sn = &mara_data[t->id][s->id];
@@ -226,8 +243,9 @@ routing_mara_route_node (struct node *s, struct routing *routing)
         continue;
 
       /* set nexthop */
-      nexthop_delete_all (routing->route[s->id][t->id].nexthops);
-      for (vnn = vector_head (s->olinks); vnn; vnn = vector_next (vnn))
+      nexthop_delete_all (route_nexthops (routing, s->id, t->id));
+      for (vnn = vector_cursor_head (s->olinks, &vnn_cursor); vnn;
+           vnn = vector_cursor_next (vnn))
         {
           struct link *link = (struct link *) vector_data (vnn);
           struct node *nei = link->to;
@@ -251,8 +269,10 @@ void
 routing_mara_mc_node (struct node *node, struct routing *R)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   mara_data_clear (R->G, R->data);
-  for (vn = vector_head (node->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (node->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_ma_ordering (t, mara_mc_cmp, R->data);
@@ -264,8 +284,10 @@ void
 routing_mara_mmmf_node (struct node *node, struct routing *R)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   mara_data_clear (R->G, R->data);
-  for (vn = vector_head (node->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (node->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_ma_ordering (t, mara_mmmf_cmp, R->data);
@@ -277,13 +299,16 @@ void
 routing_mara_mc_all (struct routing *R)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   mara_data_clear (R->G, R->data);
-  for (vn = vector_head (R->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (R->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_ma_ordering (t, mara_mc_cmp, R->data);
     }
-  for (vn = vector_head (R->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (R->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *s = (struct node *) vector_data (vn);
       routing_mara_route_node (s, R);
@@ -294,19 +319,168 @@ void
 routing_mara_mmmf_all (struct routing *R)
 {
   struct vector_node *vn;
+  struct vector_node vn_cursor;
   mara_data_clear (R->G, R->data);
-  for (vn = vector_head (R->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (R->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_ma_ordering (t, mara_mmmf_cmp, R->data);
     }
-  for (vn = vector_head (R->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (R->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *s = (struct node *) vector_data (vn);
       routing_mara_route_node (s, R);
     }
 }
 
+static void
+mara_threads_ma_ordering (struct node *t, struct mara_threads *mt,
+                          unsigned int worker)
+{
+  routing_ma_ordering_pqueue (t, mt->routing->data, mt->pqueues[worker]);
+}
+
+struct mara_threads *
+mara_threads_create (struct routing *routing, unsigned int nthreads,
+                     cmp_t cmp_func)
+{
+  struct mara_threads *mt;
+  unsigned int i;
+
+  mt = (struct mara_threads *) malloc (sizeof (struct mara_threads));
+  memset (mt, 0, sizeof (struct mara_threads));
+
+  mt->routing = routing;
+  mt->nthreads = nthreads;
+  mt->ordering = mara_threads_ma_ordering;
+
+  mt->pqueues = (struct pqueue **)
+    calloc (nthreads, sizeof (struct pqueue *));
+  for (i = 0; i < nthreads; i++)
+    {
+      mt->pqueues[i] = pqueue_create ();
+      mt->pqueues[i]->cmp = cmp_func;
+      mt->pqueues[i]->update = mara_pqueue_index_update;
+    }
+  mt->scratch = (void **) calloc (nthreads, sizeof (void *));
+
+  mt->ordering_usec = (unsigned long long *)
+    calloc (nthreads, sizeof (unsigned long long));
+  mt->route_usec = (unsigned long long *)
+    calloc (nthreads, sizeof (unsigned long long));
+  mt->ordering_count = (unsigned int *)
+    calloc (nthreads, sizeof (unsigned int));
+  mt->route_count = (unsigned int *)
+    calloc (nthreads, sizeof (unsigned int));
+
+  return mt;
+}
+
+void
+mara_threads_delete (struct mara_threads *mt)
+{
+  unsigned int i;
+  for (i = 0; i < mt->nthreads; i++)
+    pqueue_delete (mt->pqueues[i]);
+  free (mt->pqueues);
+  free (mt->scratch);
+  free (mt->ordering_usec);
+  free (mt->route_usec);
+  free (mt->ordering_count);
+  free (mt->route_count);
+  free (mt);
+}
+
+static void
+mara_threads_ordering_item (void *arg, unsigned int item,
+                            unsigned int worker)
+{
+  struct mara_threads *mt = (struct mara_threads *) arg;
+  struct node *t;
+  timer_counter_t start, end, res;
+
+  t = (struct node *) vector_get (mt->routing->G->nodes, item);
+  if (! t)
+    return;
+
+  timer_count (start);
+  (*mt->ordering) (t, mt, worker);
+  timer_count (end);
+
+  timer_sub (start, end, res);
+  mt->ordering_usec[worker] += timer_to_usec (res);
+  mt->ordering_count[worker]++;
+}
+
+static void
+mara_threads_route_item (void *arg, unsigned int item, unsigned int worker)
+{
+  struct mara_threads *mt = (struct mara_threads *) arg;
+  struct node *s;
+  timer_counter_t start, end, res;
+
+  s = (struct node *) vector_get (mt->routing->G->nodes, item);
+  if (! s)
+    return;
+
+  timer_count (start);
+  routing_mara_route_node (s, mt->routing);
+  timer_count (end);
+
+  timer_sub (start, end, res);
+  mt->route_usec[worker] += timer_to_usec (res);
+  mt->route_count[worker]++;
+}
+
+/* run the ordering phase for all destinations, and then the route
+   phase for all sources.  routing->data must be created and cleared. */
+void
+mara_threads_run (struct mara_threads *mt)
+{
+  struct routing *routing = mt->routing;
+  timer_counter_t start, end, res;
+
+  /* build the CSR snapshot before the workers share it */
+  graph_freeze (routing->G);
+  /* the workers install routes in route[][]; thaw it beforehand */
+  route_thaw (routing);
+
+  timer_count (start);
+  workqueue_run (mt->nthreads, routing->G->nodes->size,
+                 mara_threads_ordering_item, mt);
+  timer_count (end);
+  timer_sub (start, end, res);
+  mt->ordering_phase_usec = timer_to_usec (res);
+
+  timer_count (start);
+  workqueue_run (mt->nthreads, routing->G->nodes->size,
+                 mara_threads_route_item, mt);
+  timer_count (end);
+  timer_sub (start, end, res);
+  mt->route_phase_usec = timer_to_usec (res);
+}
+
+void
+mara_threads_show (FILE *terminal, char *name, struct mara_threads *mt)
+{
+  unsigned int i;
+
+  fprintf (terminal, "%s overall calculation time (%u threads): %llu us\n",
+           name, mt->nthreads,
+           mt->ordering_phase_usec + mt->route_phase_usec);
+  fprintf (terminal, "  ordering phase: %llu us\n",
+           mt->ordering_phase_usec);
+  fprintf (terminal, "  route phase: %llu us\n",
+           mt->route_phase_usec);
+  for (i = 0; i < mt->nthreads; i++)
+    fprintf (terminal, "  thread[%u]: ordering: %llu us (%u destinations) "
+             "route: %llu us (%u sources)\n", i,
+             mt->ordering_usec[i], mt->ordering_count[i],
+             mt->route_usec[i], mt->route_count[i]);
+}
+
 DEFINE_COMMAND (routing_algorithm_mara_mc,
                 "routing-algorithm mara-mc",
                 ROUTING_ALGORITHM_HELP_STR
@@ -316,6 +490,7 @@ DEFINE_COMMAND (routing_algorithm_mara_mc,
   struct routing *routing = (struct routing *) shell->context;
   timer_counter_t start, end, res;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   if (routing->G == NULL)
     {
@@ -328,14 +503,16 @@ DEFINE_COMMAND (routing_algorithm_mara_mc,
   mara_data_clear (routing->G, routing->data);
 
   timer_count (start);
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_ma_ordering (t, mara_mc_cmp, routing->data);
     }
   timer_count (end);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *s = (struct node *) vector_data (vn);
       routing_mara_route_node (s, routing);
@@ -356,6 +533,7 @@ DEFINE_COMMAND (routing_algorithm_mara_mmmf,
   struct routing *routing = (struct routing *) shell->context;
   timer_counter_t start, end, res;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   if (routing->G == NULL)
     {
@@ -368,14 +546,16 @@ DEFINE_COMMAND (routing_algorithm_mara_mmmf,
   mara_data_clear (routing->G, routing->data);
 
   timer_count (start);
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_ma_ordering (t, mara_mmmf_cmp, routing->data);
     }
   timer_count (end);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *s = (struct node *) vector_data (vn);
       routing_mara_route_node (s, routing);
@@ -386,6 +566,62 @@ DEFINE_COMMAND (routing_algorithm_mara_mmmf,
            "time: %llu us\n", timer_to_usec (res));
 }
 
+DEFINE_COMMAND (routing_algorithm_mara_mc_threads,
+                "routing-algorithm mara-mc threads <1-1024>",
+                ROUTING_ALGORITHM_HELP_STR
+                "MARA-MC (Maximizing Connectivity).\n"
+                "calculate in multiple threads.\n"
+                "specify number of threads.\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct mara_threads *mt;
+
+  if (routing->G == NULL)
+    {
+      fprintf (shell->terminal, "no graph specified for routing.\n");
+      return;
+    }
+
+  if (routing->data == NULL)
+    routing->data = mara_data_create (routing->G);
+  mara_data_clear (routing->G, routing->data);
+
+  mt = mara_threads_create (routing, strtoul (argv[3], NULL, 0),
+                            mara_mc_cmp);
+  mara_threads_run (mt);
+  mara_threads_show (shell->terminal, "MARA-MC", mt);
+  mara_threads_delete (mt);
+}
+
+DEFINE_COMMAND (routing_algorithm_mara_mmmf_threads,
+                "routing-algorithm mara-mmmf threads <1-1024>",
+                ROUTING_ALGORITHM_HELP_STR
+                "MARA-MMMF (Maximizing Minimum Max-Flow).\n"
+                "calculate in multiple threads.\n"
+                "specify number of threads.\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct mara_threads *mt;
+
+  if (routing->G == NULL)
+    {
+      fprintf (shell->terminal, "no graph specified for routing.\n");
+      return;
+    }
+
+  if (routing->data == NULL)
+    routing->data = mara_data_create (routing->G);
+  mara_data_clear (routing->G, routing->data);
+
+  mt = mara_threads_create (routing, strtoul (argv[3], NULL, 0),
+                            mara_mmmf_cmp);
+  mara_threads_run (mt);
+  mara_threads_show (shell->terminal, "MARA-MMMF", mt);
+  mara_threads_delete (mt);
+}
+
 DEFINE_COMMAND (routing_algorithm_mara_mc_node,
                 "routing-algorithm mara-mc node " NODE_SPEC,
                 ROUTING_ALGORITHM_HELP_STR
@@ -399,6 +635,7 @@ DEFINE_COMMAND (routing_algorithm_mara_mc_node,
   unsigned long node_id;
   timer_counter_t start, end, res;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   if (routing->G == NULL)
     {
@@ -419,7 +656,8 @@ DEFINE_COMMAND (routing_algorithm_mara_mc_node,
   mara_data_clear (routing->G, routing->data);
 
   timer_count (start);
-  for (vn = vector_head (node->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (node->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_ma_ordering (t, mara_mc_cmp, routing->data);
@@ -446,6 +684,7 @@ DEFINE_COMMAND (routing_algorithm_mara_mmmf_node,
   unsigned long node_id;
   timer_counter_t start, end, res;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   if (routing->G == NULL)
     {
@@ -466,7 +705,8 @@ DEFINE_COMMAND (routing_algorithm_mara_mmmf_node,
   mara_data_clear (routing->G, routing->data);
 
   timer_count (start);
-  for (vn = vector_head (node->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (node->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_ma_ordering (t, mara_mmmf_cmp, routing->data);
@@ -491,6 +731,7 @@ DEFINE_COMMAND (routing_algorithm_mara_mc_node_all,
   struct routing *routing = (struct routing *) shell->context;
   struct node *node;
   struct vector_node *vn, *vni;
+  struct vector_node vn_cursor, vni_cursor;
   timer_counter_t start, end, res;
 
   if (routing->G == NULL)
@@ -502,14 +743,16 @@ DEFINE_COMMAND (routing_algorithm_mara_mc_node_all,
   if (routing->data == NULL)
     routing->data = mara_data_create (routing->G);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
 
       mara_data_clear (routing->G, routing->data);
 
       timer_count (start);
-      for (vni = vector_head (node->g->nodes); vni; vni = vector_next (vni))
+      for (vni = vector_cursor_head (node->g->nodes, &vni_cursor); vni;
+           vni = vector_cursor_next (vni))
         {
           struct node *t = (struct node *) vector_data (vni);
           routing_ma_ordering (t, mara_mc_cmp, routing->data);
@@ -535,6 +778,7 @@ DEFINE_COMMAND (routing_algorithm_mara_mmmf_node_all,
   struct routing *routing = (struct routing *) shell->context;
   struct node *node;
   struct vector_node *vn, *vni;
+  struct vector_node vn_cursor, vni_cursor;
   timer_counter_t start, end, res;
 
   if (routing->G == NULL)
@@ -546,13 +790,15 @@ DEFINE_COMMAND (routing_algorithm_mara_mmmf_node_all,
   if (routing->data == NULL)
     routing->data = mara_data_create (routing->G);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       node = (struct node *) vn->data;
       mara_data_clear (routing->G, routing->data);
 
       timer_count (start);
-      for (vni = vector_head (node->g->nodes); vni; vni = vector_next (vni))
+      for (vni = vector_cursor_head (node->g->nodes, &vni_cursor); vni;
+           vni = vector_cursor_next (vni))
         {
           struct node *t = (struct node *) vector_data (vni);
           routing_ma_ordering (t, mara_mmmf_cmp, routing->data);
@@ -30,6 +30,33 @@ struct mara_node
   int pqueue_index;
 };
 
+struct pqueue;
+
+/* state of the threaded MARA calculation.  the ordering phase runs
+   ordering () for each destination t, which fills mara_data[t][*]
+   only; the route phase then runs routing_mara_route_node () for
+   each source s, which fills route[s][*] only. */
+struct mara_threads
+{
+  struct routing *routing;
+  unsigned int nthreads;
+
+  void (*ordering) (struct node *t, struct mara_threads *mt,
+                    unsigned int worker);
+
+  /* per-thread data */
+  struct pqueue **pqueues;
+  void **scratch;                      /* per-algorithm (e.g., SPE) */
+  unsigned long long *ordering_usec;
+  unsigned long long *route_usec;
+  unsigned int *ordering_count;
+  unsigned int *route_count;
+
+  /* per-phase elapsed time */
+  unsigned long long ordering_phase_usec;
+  unsigned long long route_phase_usec;
+};
+
 void mara_pqueue_index_update (void *data, int index);
 
 struct mara_node *mara_table_create (struct graph *graph);
@@ -46,15 +73,28 @@ int mara_mmmf_cmp (void *va, void *vb);
 void routing_mara_pqueue_debug (struct pqueue *pqueue);
 #endif /*DEBUG*/
 
+void routing_ma_ordering (struct node *t, int (*cmp_func) (void *, void *),
+                          struct mara_node **mara_data);
+void routing_ma_ordering_pqueue (struct node *t, struct mara_node **mara_data,
+                                 struct pqueue *pqueue);
 void routing_mara_route_node (struct node *s, struct routing *routing);
 
+struct mara_threads *
+mara_threads_create (struct routing *routing, unsigned int nthreads,
+                     int (*cmp_func) (void *, void *));
+void mara_threads_delete (struct mara_threads *mt);
+void mara_threads_run (struct mara_threads *mt);
+void mara_threads_show (FILE *terminal, char *name, struct mara_threads *mt);
+
 EXTERN_COMMAND (routing_algorithm_mara_mc_node);
 EXTERN_COMMAND (routing_algorithm_mara_mc_node_all);
 EXTERN_COMMAND (routing_algorithm_mara_mc);
+EXTERN_COMMAND (routing_algorithm_mara_mc_threads);
 
 EXTERN_COMMAND (routing_algorithm_mara_mmmf_node_all);
 EXTERN_COMMAND (routing_algorithm_mara_mmmf_node);
 EXTERN_COMMAND (routing_algorithm_mara_mmmf);
+EXTERN_COMMAND (routing_algorithm_mara_mmmf_threads);
 
 #endif /*_MARA_MC_MMMF_H_*/
 
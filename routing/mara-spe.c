@@ -27,6 +27,7 @@
 #include "file.h"
 #include "timer.h"
 #include "pqueue.h"
+#include "workqueue.h"
 
 #include "network/graph.h"
 #include "network/weight.h"
@@ -36,6 +37,7 @@
 #include "routing/mara-mc-mmmf.h"
 #include "routing/dijkstra.h"
 #include "routing/reverse-dijkstra.h"
+#include "routing/mara-spe.h"
 
 typedef int (*cmp_t) (void *, void *);
 
@@ -44,22 +46,51 @@ routing_mara_spe (struct node *t, cmp_t cmp_func, struct weight *weight,
                   struct dijkstra_path *dijkstra_table,
                   struct mara_node **mara_data)
 {
-  struct vector_node *vn;
-  struct pqueue *pqueue;
+  struct pqueue *pqueue, *candidate_list;
+
+  /* Priority queue (Heap sort) */
+  pqueue = pqueue_create ();
+  pqueue->cmp = cmp_func;
+  pqueue->update = mara_pqueue_index_update;
+
+  /* candidate list for the reverse Dijkstra */
+  candidate_list = pqueue_create ();
+  candidate_list->cmp = dijkstra_candidate_cmp;
+  candidate_list->update = dijkstra_candidate_update;
+
+  routing_mara_spe_pqueue (t, weight, dijkstra_table, mara_data,
+                           pqueue, candidate_list);
+
+  pqueue_delete (candidate_list);
+  pqueue_delete (pqueue);
+}
+
+/* same as routing_mara_spe (), but with the caller's (empty) priority
+   queues: pqueue for the MA ordering, and candidate_list for the
+   reverse Dijkstra. */
+void
+routing_mara_spe_pqueue (struct node *t, struct weight *weight,
+                         struct dijkstra_path *dijkstra_table,
+                         struct mara_node **mara_data,
+                         struct pqueue *pqueue,
+                         struct pqueue *candidate_list)
+{
+  struct vector_node vnn_cursor;
   unsigned int label = 1;
   struct mara_node *c, *v;
+  struct graph_csr *csr;
+  unsigned int i;
 
   struct dijkstra_path *w;
   int notyet;
   struct vector_node *vnn;
 
   /* compute SPT */
-  routing_reverse_dijkstra (t, weight, dijkstra_table);
+  routing_reverse_dijkstra_pqueue (t, weight, dijkstra_table,
+                                   candidate_list);
 
-  /* Priority queue (Heap sort) */
-  pqueue = pqueue_create ();
-  pqueue->cmp = cmp_func;
-  pqueue->update = mara_pqueue_index_update;
+  /* walk the adjacency on the CSR snapshot */
+  csr = graph_freeze (t->g);
 
   /* The first candidate is the destination itself */
 #define MARA_ADJ_INFINITY UINT_MAX
@@ -95,10 +126,10 @@ routing_mara_spe (struct node *t, cmp_t cmp_func, struct weight *weight,
 #endif /*DEBUG*/
 
       /* for each neighbor "w" of v */
-      for (vn = vector_head (v->node->ilinks); vn; vn = vector_next (vn))
+      for (i = csr->ioffset[v->node->id];
+           i < csr->ioffset[v->node->id + 1]; i++)
         {
-          struct link *link = (struct link *) vector_data (vn);
-          struct node *candidate = link->from;
+          struct node *candidate = csr->node[csr->isource[i]];
 
           w = &dijkstra_table[candidate->id];
           c = &mara_data[t->id][candidate->id];
@@ -110,13 +141,13 @@ routing_mara_spe (struct node *t, cmp_t cmp_func, struct weight *weight,
           /* update the candidate */
           c->node = candidate;
           c->adjacency++;
-          c->bandwidth += (link->bandwidth ? link->bandwidth : 0) ;
+          c->bandwidth += (csr->ibandwidth[i] ? csr->ibandwidth[i] : 0) ;
 
           /* check whether all successor nodes in the SPT are
              already labeled. */
           notyet = 0;
-          for (vnn = vector_head (w->nexthops); vnn;
-               vnn = vector_next (vnn))
+          for (vnn = vector_cursor_head (w->nexthops, &vnn_cursor); vnn;
+               vnn = vector_cursor_next (vnn))
             {
               struct node *n = (struct node *) vector_data (vnn);
               struct mara_node *u = &mara_data[t->id][n->id];
@@ -142,8 +173,6 @@ routing_mara_spe (struct node *t, cmp_t cmp_func, struct weight *weight,
 #endif /*DEBUG*/
         }
     }
-
-  pqueue_delete (pqueue);
 }
 
 DEFINE_COMMAND (routing_algorithm_mara_spe,
@@ -156,6 +185,7 @@ DEFINE_COMMAND (routing_algorithm_mara_spe,
   timer_counter_t start, end, res;
   struct dijkstra_path **dijkstra_data;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   if (routing->G == NULL)
     {
@@ -177,7 +207,8 @@ DEFINE_COMMAND (routing_algorithm_mara_spe,
   dijkstra_data_clear (routing->G, dijkstra_data);
 
   timer_count (start);
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_mara_spe (t, mara_mc_cmp, routing->W,
@@ -185,7 +216,8 @@ DEFINE_COMMAND (routing_algorithm_mara_spe,
     }
   timer_count (end);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *s = (struct node *) vector_data (vn);
       routing_mara_route_node (s, routing);
@@ -198,6 +230,81 @@ DEFINE_COMMAND (routing_algorithm_mara_spe,
   dijkstra_data_delete (routing->G, dijkstra_data);
 }
 
+/* per-thread scratch of MARA-SPE: the reverse-Dijkstra table and
+   its candidate list. */
+struct mara_spe_scratch
+{
+  struct dijkstra_path *dijkstra_table;
+  struct pqueue *candidate_list;
+};
+
+static void
+mara_threads_spe_ordering (struct node *t, struct mara_threads *mt,
+                           unsigned int worker)
+{
+  struct mara_spe_scratch *scratch = mt->scratch[worker];
+
+  dijkstra_table_clear (mt->routing->G, scratch->dijkstra_table);
+  routing_mara_spe_pqueue (t, mt->routing->W, scratch->dijkstra_table,
+                           mt->routing->data, mt->pqueues[worker],
+                           scratch->candidate_list);
+}
+
+DEFINE_COMMAND (routing_algorithm_mara_spe_threads,
+                "routing-algorithm mara-spe threads <1-1024>",
+                ROUTING_ALGORITHM_HELP_STR
+                "MARA-SPE (Shortest Path Extension).\n"
+                "calculate in multiple threads.\n"
+                "specify number of threads.\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct routing *routing = (struct routing *) shell->context;
+  struct mara_threads *mt;
+  struct mara_spe_scratch *scratch;
+  unsigned int i;
+
+  if (routing->G == NULL)
+    {
+      fprintf (shell->terminal, "no graph specified for routing.\n");
+      return;
+    }
+  if (routing->W == NULL)
+    {
+      fprintf (shell->terminal, "no weight specified for routing.\n");
+      return;
+    }
+
+  if (routing->data == NULL)
+    routing->data = mara_data_create (routing->G);
+  mara_data_clear (routing->G, routing->data);
+
+  mt = mara_threads_create (routing, strtoul (argv[3], NULL, 0),
+                            mara_mc_cmp);
+  mt->ordering = mara_threads_spe_ordering;
+  for (i = 0; i < mt->nthreads; i++)
+    {
+      scratch = (struct mara_spe_scratch *)
+        malloc (sizeof (struct mara_spe_scratch));
+      scratch->dijkstra_table = dijkstra_table_create (routing->G);
+      scratch->candidate_list = pqueue_create ();
+      scratch->candidate_list->cmp = dijkstra_candidate_cmp;
+      scratch->candidate_list->update = dijkstra_candidate_update;
+      mt->scratch[i] = scratch;
+    }
+
+  mara_threads_run (mt);
+  mara_threads_show (shell->terminal, "MARA-SPE", mt);
+
+  for (i = 0; i < mt->nthreads; i++)
+    {
+      scratch = (struct mara_spe_scratch *) mt->scratch[i];
+      dijkstra_table_delete (routing->G, scratch->dijkstra_table);
+      pqueue_delete (scratch->candidate_list);
+      free (scratch);
+    }
+  mara_threads_delete (mt);
+}
+
 DEFINE_COMMAND (routing_algorithm_mara_spe_node,
                 "routing-algorithm mara-spe node " NODE_SPEC,
                 ROUTING_ALGORITHM_HELP_STR
@@ -212,6 +319,7 @@ DEFINE_COMMAND (routing_algorithm_mara_spe_node,
   timer_counter_t start, end, res;
   struct dijkstra_path *dijkstra_table;
   struct vector_node *vn;
+  struct vector_node vn_cursor;
 
   if (routing->G == NULL)
     {
@@ -240,7 +348,8 @@ DEFINE_COMMAND (routing_algorithm_mara_spe_node,
   dijkstra_table_clear (routing->G, dijkstra_table);
 
   timer_count (start);
-  for (vn = vector_head (node->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (node->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *t = (struct node *) vector_data (vn);
       routing_mara_spe (t, mara_mc_cmp, routing->W,
@@ -267,6 +376,7 @@ DEFINE_COMMAND (routing_algorithm_mara_spe_node_all,
   struct shell *shell = (struct shell *) context;
   struct routing *routing = (struct routing *) shell->context;
   struct vector_node *vn, *vni;
+  struct vector_node vn_cursor, vni_cursor;
   timer_counter_t start, end, res;
   struct dijkstra_path **dijkstra_data;
 
@@ -288,7 +398,8 @@ DEFINE_COMMAND (routing_algorithm_mara_spe_node_all,
   dijkstra_data = dijkstra_data_create (routing->G);
   dijkstra_data_clear (routing->G, dijkstra_data);
 
-  for (vn = vector_head (routing->G->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (routing->G->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *node = (struct node *) vector_data (vn);
 
@@ -296,7 +407,8 @@ DEFINE_COMMAND (routing_algorithm_mara_spe_node_all,
       dijkstra_data_clear (routing->G, dijkstra_data);
 
       timer_count (start);
-      for (vni = vector_head (node->g->nodes); vni; vni = vector_next (vni))
+      for (vni = vector_cursor_head (node->g->nodes, &vni_cursor); vni;
+           vni = vector_cursor_next (vni))
         {
           struct node *t = (struct node *) vector_data (vni);
           routing_mara_spe (t, mara_mc_cmp, routing->W,
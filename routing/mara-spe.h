@@ -21,9 +21,20 @@
 #ifndef _MARA_SPE_H_
 #define _MARA_SPE_H_
 
+void routing_mara_spe (struct node *t, int (*cmp_func) (void *, void *),
+                       struct weight *weight,
+                       struct dijkstra_path *dijkstra_table,
+                       struct mara_node **mara_data);
+void routing_mara_spe_pqueue (struct node *t, struct weight *weight,
+                              struct dijkstra_path *dijkstra_table,
+                              struct mara_node **mara_data,
+                              struct pqueue *pqueue,
+                              struct pqueue *candidate_list);
+
 EXTERN_COMMAND (routing_algorithm_mara_spe_node);
 EXTERN_COMMAND (routing_algorithm_mara_spe_node_all);
 EXTERN_COMMAND (routing_algorithm_mara_spe);
+EXTERN_COMMAND (routing_algorithm_mara_spe_threads);
 
 #endif /*_MARA_SPE_H_*/
 
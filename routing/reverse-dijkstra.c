@@ -33,20 +33,65 @@
 #include "network/routing.h"
 
 #include "routing/dijkstra.h"
+#include "routing/reverse-dijkstra.h"
+#include "routing/spf-cache.h"
 
 void
 routing_reverse_dijkstra (struct node *root, struct weight *weight,
                           struct dijkstra_path *dijkstra_table)
 {
-  struct dijkstra_path *c, *v;
   struct pqueue *candidate_list;
-  struct vector_node *vn;
 
   /* candidate list is a priority queue */
   candidate_list = pqueue_create ();
   candidate_list->cmp = dijkstra_candidate_cmp;
   candidate_list->update = dijkstra_candidate_update;
 
+  routing_reverse_dijkstra_pqueue (root, weight, dijkstra_table,
+                                   candidate_list);
+
+  /* free candidate list */
+  pqueue_delete (candidate_list);
+}
+
+/* same as routing_reverse_dijkstra (), but with the caller's
+   binary heap, as routing_dijkstra_pqueue (). */
+void
+routing_reverse_dijkstra_pqueue (struct node *root, struct weight *weight,
+                                 struct dijkstra_path *dijkstra_table,
+                                 struct pqueue *candidate_list)
+{
+  struct dijkstra_queue queue;
+
+  memset (&queue, 0, sizeof (queue));
+  queue.type = DIJKSTRA_QUEUE_BINARY_HEAP;
+  queue.pqueue = candidate_list;
+  routing_reverse_dijkstra_queue (root, weight, dijkstra_table, &queue);
+}
+
+/* same as routing_reverse_dijkstra (), but with the caller's
+   candidate list of any type, as routing_dijkstra_queue (). */
+void
+routing_reverse_dijkstra_queue (struct node *root, struct weight *weight,
+                                struct dijkstra_path *dijkstra_table,
+                                struct dijkstra_queue *candidate_list)
+{
+  struct dijkstra_path *c, *v;
+  struct graph_csr *csr;
+  unsigned int i;
+  int cache;
+
+  /* walk the adjacency on the CSR snapshot */
+  csr = graph_freeze (root->g);
+  dijkstra_queue_clear (candidate_list);
+
+  /* the same tree may have been calculated already */
+  cache = spf_cache_usable (root->g, dijkstra_table);
+  DIJKSTRA_TABLE_CLEAN (root->g, dijkstra_table) = 0;
+  if (cache &&
+      spf_cache_lookup (root, weight, SPF_CACHE_REVERSE, dijkstra_table))
+    return;
+
   /* consider the calculating node itself as a starting candidate */
   c = &dijkstra_table[root->id];
   c->node = root;
@@ -55,27 +100,26 @@ routing_reverse_dijkstra (struct node *root, struct weight *weight,
   vector_add (root, c->nexthops);
 
   /* install the calculating node in the candidate list */
-  pqueue_enqueue (c, candidate_list);
+  dijkstra_queue_push (c, candidate_list);
 
   /* continue while the candidate list is not empty */
-  while (candidate_list->size)
+  while (dijkstra_queue_size (candidate_list))
     {
       /* get the shortest candidate path among all candidates */
-      c = pqueue_dequeue (candidate_list);
+      c = dijkstra_queue_pop (dijkstra_table, candidate_list);
 
       /* Call the just added vertex "v" */
       v = c;
 
       /* for each node that is reachable *to* "v" (reverse) */
-      for (vn = vector_head (v->node->ilinks); vn;
-           vn = vector_next (vn))
+      for (i = csr->ioffset[v->node->id];
+           i < csr->ioffset[v->node->id + 1]; i++)
         {
-          struct link *edge = (struct link *) vn->data;
           unsigned int edge_cost = 0;
 
           /* new candidate */
-          c = &dijkstra_table[edge->from->id];
-          c->node = edge->from;
+          c = &dijkstra_table[csr->isource[i]];
+          c->node = csr->node[csr->isource[i]];
 
           /* calculating node (root) has always metric 0, so treat */
           if (c->node == root)
@@ -83,7 +127,7 @@ routing_reverse_dijkstra (struct node *root, struct weight *weight,
 
           /* edge cost */
           if (weight)
-            edge_cost = weight->weight[edge->id];
+            edge_cost = weight->weight[csr->ilink[i]];
           else
             edge_cost = 1;
 
@@ -116,15 +160,12 @@ routing_reverse_dijkstra (struct node *root, struct weight *weight,
           vector_add (v->node, c->nexthops);
 
           /* install in the candidate list */
-          if (c->pqueue_index < 0)
-            pqueue_enqueue (c, candidate_list);
-          else
-            pqueue_update (c->pqueue_index, candidate_list);
+          dijkstra_queue_push (c, candidate_list);
         }
     }
 
-  /* free candidate list */
-  pqueue_delete (candidate_list);
+  if (cache)
+    spf_cache_insert (root, weight, SPF_CACHE_REVERSE, dijkstra_table);
 }
 
 void
@@ -133,21 +174,24 @@ routing_reverse_dijkstra_route (struct node *root,
                                 struct routing *R)
 {
   struct vector_node *vn, *vni;
+  struct vector_node vn_cursor, vni_cursor;
   int t = root->id;
 
   /* set routing table from spf result table */
-  for (vn = vector_head (root->g->nodes); vn; vn = vector_next (vn))
+  for (vn = vector_cursor_head (root->g->nodes, &vn_cursor); vn;
+       vn = vector_cursor_next (vn))
     {
       struct node *src = (struct node *) vn->data;
       int s = src->id;
       struct dijkstra_path *path = &dijkstra_table[src->id];
 
-      nexthop_delete_all (R->route[s][t].nexthops);
+      nexthop_delete_all (route_nexthops (R, s, t));
 
       if (! path->nexthops)
         continue;
 
-      for (vni = vector_head (path->nexthops); vni; vni = vector_next (vni))
+      for (vni = vector_cursor_head (path->nexthops, &vni_cursor); vni;
+           vni = vector_cursor_next (vni))
         {
           struct node *nexthop = (struct node *) vector_data (vni);
           route_add (src, root, nexthop, R);
@@ -23,6 +23,14 @@
 
 void routing_reverse_dijkstra (struct node *root, struct weight *weight,
                                struct dijkstra_path *dijkstra_table);
+void routing_reverse_dijkstra_pqueue (struct node *root,
+                                      struct weight *weight,
+                                      struct dijkstra_path *dijkstra_table,
+                                      struct pqueue *candidate_list);
+void routing_reverse_dijkstra_queue (struct node *root,
+                                     struct weight *weight,
+                                     struct dijkstra_path *dijkstra_table,
+                                     struct dijkstra_queue *candidate_list);
 void routing_reverse_dijkstra_route (struct node *root,
                                 struct dijkstra_path *dijkstra_table,
                                 struct routing *R);
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "command_shell.h"
+#include "hash.h"
+
+#include "network/graph.h"
+#include "network/weight.h"
+#include "network/path.h"
+#include "network/routing.h"
+
+#include "routing/dijkstra.h"
+#include "routing/spf-cache.h"
+
+/* a shortest path tree in the compact form: the nexthops of the
+   node i are the node ids nexthop[offset[i]] .. nexthop[offset[i+1]-1],
+   in the order of the nexthops vector. a node has no nexthops iff
+   it has not been reached (except the root, which has itself). */
+struct spf_cache_entry
+{
+  unsigned long gversion;
+  unsigned long wversion;
+  unsigned int root;
+  int direction;
+  unsigned int key;
+
+  unsigned int nnodes;
+  unsigned int *metric;
+  unsigned int *offset;
+  unsigned int *nexthop;
+  unsigned long size;
+
+  /* LRU list, the most recently used at the head */
+  struct spf_cache_entry *prev;
+  struct spf_cache_entry *next;
+};
+
+struct spf_cache
+{
+  pthread_mutex_t mutex;
+  struct hash *hash;
+  struct spf_cache_entry *head;
+  struct spf_cache_entry *tail;
+
+  int enable;
+  unsigned long limit;
+  unsigned long size;
+
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+};
+
+static struct spf_cache spf_cache =
+{
+  PTHREAD_MUTEX_INITIALIZER, NULL, NULL, NULL,
+  1, SPF_CACHE_DEFAULT_MEMORY << 20, 0,
+  0, 0, 0
+};
+
+static unsigned int
+spf_cache_key (unsigned long gversion, unsigned long wversion,
+               unsigned int root, int direction)
+{
+  unsigned long x;
+
+  /* mix as hash_pointer_pair () */
+  x = gversion * 0x9e3779b1UL;
+  x ^= wversion + 0x7f4a7c15UL + (x << 6) + (x >> 2);
+  x ^= ((unsigned long) root << 1 | direction)
+       + 0x7f4a7c15UL + (x << 6) + (x >> 2);
+  return (unsigned int) (x ^ (x >> 16) ^ (x >> 32 >> 16));
+}
+
+static void
+spf_cache_lru_unlink (struct spf_cache_entry *e)
+{
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    spf_cache.head = e->next;
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    spf_cache.tail = e->prev;
+  e->prev = e->next = NULL;
+}
+
+static void
+spf_cache_lru_push (struct spf_cache_entry *e)
+{
+  e->prev = NULL;
+  e->next = spf_cache.head;
+  if (spf_cache.head)
+    spf_cache.head->prev = e;
+  else
+    spf_cache.tail = e;
+  spf_cache.head = e;
+}
+
+static void
+spf_cache_remove (struct spf_cache_entry *e)
+{
+  spf_cache_lru_unlink (e);
+  hash_remove (e->key, e, spf_cache.hash);
+  spf_cache.size -= e->size;
+  free (e);
+}
+
+/* evict the least recently used trees until size more bytes fit. */
+static void
+spf_cache_shrink (unsigned long size)
+{
+  while (spf_cache.tail && spf_cache.size + size > spf_cache.limit)
+    {
+      spf_cache_remove (spf_cache.tail);
+      spf_cache.evictions++;
+    }
+}
+
+static struct spf_cache_entry *
+spf_cache_find (unsigned long gversion, unsigned long wversion,
+                unsigned int root, int direction, unsigned int key)
+{
+  struct hash_entry *he;
+  struct spf_cache_entry *e;
+
+  if (spf_cache.hash == NULL)
+    return NULL;
+
+  for (he = hash_head (key, spf_cache.hash); he; he = he->next)
+    {
+      if (he->key != key)
+        continue;
+      e = (struct spf_cache_entry *) he->data;
+      if (e->gversion == gversion && e->wversion == wversion &&
+          e->root == root && e->direction == direction)
+        return e;
+    }
+  return NULL;
+}
+
+/* the cached tree can be used for the table only if the table is
+   as dijkstra_table_clear () leaves it: the SPF calculations depend
+   on the initial contents of the table otherwise. */
+int
+spf_cache_usable (struct graph *G, struct dijkstra_path *table)
+{
+  if (! spf_cache.enable || spf_cache.limit == 0)
+    return 0;
+  return DIJKSTRA_TABLE_CLEAN (G, table);
+}
+
+/* fill the (clean) table with the cached tree, if any.
+   returns 1 on hit, 0 on miss. */
+int
+spf_cache_lookup (struct node *root, struct weight *W, int direction,
+                  struct dijkstra_path *table)
+{
+  struct graph_csr *csr;
+  struct spf_cache_entry *e;
+  unsigned long wversion = (W ? W->version : 0);
+  unsigned int i, j, key;
+
+  /* the callers have frozen the graph already */
+  assert (root->g->csr);
+  csr = root->g->csr;
+  key = spf_cache_key (root->g->version, wversion, root->id, direction);
+
+  pthread_mutex_lock (&spf_cache.mutex);
+
+  e = spf_cache_find (root->g->version, wversion, root->id, direction, key);
+  if (e == NULL || e->nnodes != root->g->nodes->size)
+    {
+      spf_cache.misses++;
+      pthread_mutex_unlock (&spf_cache.mutex);
+      return 0;
+    }
+
+  spf_cache.hits++;
+  spf_cache_lru_unlink (e);
+  spf_cache_lru_push (e);
+
+  for (i = 0; i < e->nnodes; i++)
+    {
+      table[i].metric = e->metric[i];
+      table[i].pqueue_index = -1;
+      if (e->offset[i] == e->offset[i + 1])
+        continue;
+
+      table[i].node = csr->node[i];
+      if (! table[i].nexthops)
+        table[i].nexthops = vector_create ();
+      for (j = e->offset[i]; j < e->offset[i + 1]; j++)
+        vector_add_allow_dup (csr->node[e->nexthop[j]], table[i].nexthops);
+    }
+
+  pthread_mutex_unlock (&spf_cache.mutex);
+  return 1;
+}
+
+/* store the tree just calculated in the table. */
+void
+spf_cache_insert (struct node *root, struct weight *W, int direction,
+                  struct dijkstra_path *table)
+{
+  struct spf_cache_entry *e;
+  struct vector_node *vn;
+  struct vector_node vn_cursor;
+  unsigned long wversion = (W ? W->version : 0);
+  unsigned long size;
+  unsigned int i, n, nnexthops, key;
+
+  n = root->g->nodes->size;
+  nnexthops = 0;
+  for (i = 0; i < n; i++)
+    {
+      unsigned int count;
+      count = (table[i].nexthops ? table[i].nexthops->size : 0);
+
+      /* the reached nodes must be told by their nexthops */
+      if ((table[i].node != NULL) != (count != 0))
+        return;
+      nnexthops += count;
+    }
+
+  size = sizeof (struct spf_cache_entry) +
+    sizeof (unsigned int) * (n + (n + 1) + nnexthops);
+  key = spf_cache_key (root->g->version, wversion, root->id, direction);
+
+  pthread_mutex_lock (&spf_cache.mutex);
+
+  /* too large, or calculated by another thread meanwhile */
+  if (size > spf_cache.limit ||
+      spf_cache_find (root->g->version, wversion, root->id, direction, key))
+    {
+      pthread_mutex_unlock (&spf_cache.mutex);
+      return;
+    }
+
+  spf_cache_shrink (size);
+
+  e = (struct spf_cache_entry *) malloc (size);
+  memset (e, 0, sizeof (struct spf_cache_entry));
+  e->gversion = root->g->version;
+  e->wversion = wversion;
+  e->root = root->id;
+  e->direction = direction;
+  e->key = key;
+  e->nnodes = n;
+  e->metric = (unsigned int *) (e + 1);
+  e->offset = e->metric + n;
+  e->nexthop = e->offset + n + 1;
+  e->size = size;
+
+  nnexthops = 0;
+  for (i = 0; i < n; i++)
+    {
+      e->metric[i] = table[i].metric;
+      e->offset[i] = nnexthops;
+      if (! table[i].nexthops)
+        continue;
+      for (vn = vector_cursor_head (table[i].nexthops, &vn_cursor); vn;
+           vn = vector_cursor_next (vn))
+        {
+          struct node *nexthop = (struct node *) vector_data (vn);
+          e->nexthop[nnexthops++] = nexthop->id;
+        }
+    }
+  e->offset[n] = nnexthops;
+
+  if (spf_cache.hash == NULL)
+    spf_cache.hash = hash_create ();
+  hash_add (key, e, spf_cache.hash);
+  spf_cache_lru_push (e);
+  spf_cache.size += size;
+
+  pthread_mutex_unlock (&spf_cache.mutex);
+}
+
+/* turn the cache on or off (e.g., to measure the SPF calculations
+   themselves), and return the previous setting. */
+int
+spf_cache_enable (int enable)
+{
+  int prev;
+
+  pthread_mutex_lock (&spf_cache.mutex);
+  prev = spf_cache.enable;
+  spf_cache.enable = enable;
+  pthread_mutex_unlock (&spf_cache.mutex);
+  return prev;
+}
+
+void
+spf_cache_clear ()
+{
+  pthread_mutex_lock (&spf_cache.mutex);
+  while (spf_cache.head)
+    spf_cache_remove (spf_cache.head);
+  spf_cache.hits = spf_cache.misses = spf_cache.evictions = 0;
+  pthread_mutex_unlock (&spf_cache.mutex);
+}
+
+DEFINE_COMMAND (spf_cache_memory,
+                "spf-cache memory <0-65535>",
+                "SPF result cache\n"
+                "memory limit of the SPF result cache\n"
+                "specify megabytes (0 to disable the cache)\n")
+{
+  unsigned long megabytes;
+
+  megabytes = strtoul (argv[2], NULL, 0);
+
+  pthread_mutex_lock (&spf_cache.mutex);
+  spf_cache.limit = megabytes << 20;
+  spf_cache_shrink (0);
+  pthread_mutex_unlock (&spf_cache.mutex);
+}
+
+DEFINE_COMMAND (show_spf_cache,
+                "show spf-cache",
+                "display information\n"
+                "display SPF result cache\n")
+{
+  struct shell *shell = (struct shell *) context;
+
+  pthread_mutex_lock (&spf_cache.mutex);
+  fprintf (shell->terminal, "SPF cache: %s, memory limit %lu MB\n",
+           (spf_cache.enable && spf_cache.limit ? "enabled" : "disabled"),
+           spf_cache.limit >> 20);
+  fprintf (shell->terminal, "  entries: %u, memory: %lu bytes\n",
+           (spf_cache.hash ? spf_cache.hash->count : 0), spf_cache.size);
+  fprintf (shell->terminal, "  hits: %lu, misses: %lu, evictions: %lu\n",
+           spf_cache.hits, spf_cache.misses, spf_cache.evictions);
+  pthread_mutex_unlock (&spf_cache.mutex);
+}
+
+DEFINE_COMMAND (clear_spf_cache,
+                "clear spf-cache",
+                "clear information\n"
+                "clear SPF result cache\n")
+{
+  spf_cache_clear ();
+}
+
+void
+spf_cache_commands (struct command_set *cmdset)
+{
+  INSTALL_COMMAND (cmdset, spf_cache_memory);
+  INSTALL_COMMAND (cmdset, show_spf_cache);
+  INSTALL_COMMAND (cmdset, clear_spf_cache);
+}
+
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _SPF_CACHE_H_
+#define _SPF_CACHE_H_
+
+/* the shortest path trees computed by routing_dijkstra_queue () and
+   routing_reverse_dijkstra_queue (), shared by all routing instances.
+   a tree is identified by the versions of the graph and the weight,
+   the root and the direction, so that any modification of the graph
+   or the weight makes the old trees unreachable (they are evicted
+   in the LRU order under the memory limit). */
+
+#define SPF_CACHE_FORWARD 0
+#define SPF_CACHE_REVERSE 1
+
+/* default memory limit (MB) */
+#define SPF_CACHE_DEFAULT_MEMORY 64
+
+int spf_cache_usable (struct graph *G, struct dijkstra_path *table);
+int spf_cache_lookup (struct node *root, struct weight *W, int direction,
+                      struct dijkstra_path *table);
+void spf_cache_insert (struct node *root, struct weight *W, int direction,
+                       struct dijkstra_path *table);
+int spf_cache_enable (int enable);
+void spf_cache_clear ();
+
+void spf_cache_commands (struct command_set *cmdset);
+
+#endif /*_SPF_CACHE_H_*/
+
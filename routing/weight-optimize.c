@@ -0,0 +1,634 @@
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <includes.h>
+
+#include "vector.h"
+#include "shell.h"
+#include "command.h"
+#include "command_shell.h"
+#include "module.h"
+#include "timer.h"
+#include "radixheap.h"
+#include "workqueue.h"
+#include "random.h"
+
+#include "network/graph.h"
+#include "network/weight.h"
+#include "traffic-model/demand.h"
+
+#include "routing/weight-optimize.h"
+
+/* Local search for the link weights (Fortz and Thorup, "Internet
+   traffic engineering by optimizing OSPF weights", INFOCOM 2000).
+   Each round tries WEIGHT_OPTIMIZE_SAMPLE random single weight
+   changes, keeps the one that lowers Phi the most, and the search
+   stops when no move has improved Phi for WEIGHT_OPTIMIZE_STALL
+   times the number of links or the time is up.
+
+   The search keeps, for every destination t, the distances toward t
+   and the load that the demands toward t put on each link.  A change
+   of the weight of link u->v alters the shortest-path DAG toward t
+   only if the link is on it (increase), or if v + w' is as short as
+   u's distance (decrease); only those destinations are recalculated
+   when a move is evaluated, and the others' cached loads are used as
+   they are. */
+
+#define WEIGHT_OPTIMIZE_INFINITY ((unsigned long) -1)
+#define WEIGHT_OPTIMIZE_NONE     ((unsigned int) -1)
+
+struct weight_optimize_move
+{
+  unsigned int link;
+  weight_t weight;              /* new weight */
+  weight_t old;                 /* weight before the move */
+  double phi;
+  double maxutil;
+  unsigned long nspf;
+};
+
+/* per worker */
+struct weight_optimize_scratch
+{
+  struct radixheap *heap;
+  unsigned int *order;
+  double *in;
+  unsigned long *dist;
+  double *load;                 /* a destination's contribution */
+  double *total;                /* the link loads after the move */
+};
+
+struct weight_optimize
+{
+  struct weight *W;
+  struct graph_csr *csr;
+  struct demand_matrix *D;
+  unsigned int nnodes;
+  unsigned int nlinks;
+
+  unsigned int *from;           /* by link id */
+  unsigned int *to;             /* by link id */
+  double *capacity;             /* by link id, 0 if not in the graph */
+  double *demand_to;            /* total demand toward each node */
+
+  unsigned long *dist;          /* [t * nnodes + v]: v's distance to t */
+  double *load_dst;             /* [t * nlinks + l]: t's load on link l */
+  double *load;                 /* sum of load_dst over t */
+  double phi;
+  double maxutil;
+
+  struct weight_optimize_move *moves;
+  unsigned int nmoves;
+  struct weight_optimize_move *applied;  /* for the update, or NULL */
+
+  struct weight_optimize_scratch *scratch;
+  unsigned int nthreads;
+};
+
+/* Fortz-Thorup cost of a link: piecewise linear in the load, with
+   the slopes 1, 3, 10, 70, 500, 5000 as the utilization crosses
+   1/3, 2/3, 9/10, 1 and 11/10. */
+double
+weight_optimize_phi_link (double load, double capacity)
+{
+  double u = load / capacity;
+
+  if (u < 1.0 / 3.0)
+    return load;
+  if (u < 2.0 / 3.0)
+    return 3 * load - 2.0 / 3.0 * capacity;
+  if (u < 9.0 / 10.0)
+    return 10 * load - 16.0 / 3.0 * capacity;
+  if (u < 1.0)
+    return 70 * load - 178.0 / 3.0 * capacity;
+  if (u < 11.0 / 10.0)
+    return 500 * load - 1468.0 / 3.0 * capacity;
+  return 5000 * load - 16318.0 / 3.0 * capacity;
+}
+
+static double
+weight_optimize_phi (struct weight_optimize *wo, double *load,
+                     double *maxutil)
+{
+  unsigned int l;
+  double phi = 0.0, max = 0.0;
+
+  for (l = 0; l < wo->nlinks; l++)
+    {
+      if (wo->capacity[l] <= 0.0)
+        continue;
+      phi += weight_optimize_phi_link (load[l], wo->capacity[l]);
+      if (max < load[l] / wo->capacity[l])
+        max = load[l] / wo->capacity[l];
+    }
+  *maxutil = max;
+  return phi;
+}
+
+/* whether the move changes the shortest-path DAG toward t */
+static int
+weight_optimize_affected (struct weight_optimize *wo, unsigned int t,
+                          struct weight_optimize_move *move)
+{
+  unsigned long *dist = &wo->dist[t * wo->nnodes];
+  unsigned long du = dist[wo->from[move->link]];
+  unsigned long dv = dist[wo->to[move->link]];
+
+  if (dv == WEIGHT_OPTIMIZE_INFINITY)
+    return 0;
+  if (move->weight < move->old)
+    return (dv + move->weight <= du);
+  return (dv + move->old == du);
+}
+
+/* the distances toward t by a reverse Dijkstra, and the load of the
+   demands toward t split evenly over the equal-cost nexthops, with
+   the weight of the link overridden by weight. */
+static void
+weight_optimize_destination (struct weight_optimize *wo, unsigned int t,
+                             unsigned int link, weight_t weight,
+                             struct weight_optimize_scratch *sc,
+                             unsigned long *dist, double *load)
+{
+  struct graph_csr *csr = wo->csr;
+  weight_t *W = wo->W->weight;
+  unsigned int n = wo->nnodes;
+  unsigned int i, j, u, v, l, norder, nexthops;
+  unsigned long d;
+  double share;
+
+  for (v = 0; v < n; v++)
+    dist[v] = WEIGHT_OPTIMIZE_INFINITY;
+  memset (load, 0, wo->nlinks * sizeof (double));
+
+  radixheap_clear (sc->heap);
+  dist[t] = 0;
+  radixheap_push (t, 0, sc->heap);
+  norder = 0;
+  while ((u = radixheap_pop (sc->heap)) != RADIXHEAP_NONE)
+    {
+      sc->order[norder++] = u;
+      for (j = csr->ioffset[u]; j < csr->ioffset[u + 1]; j++)
+        {
+          l = csr->ilink[j];
+          v = csr->isource[j];
+          d = dist[u] + (l == link ? weight : W[l]);
+          if (d < dist[v])
+            {
+              dist[v] = d;
+              radixheap_push (v, d, sc->heap);
+            }
+        }
+    }
+
+  if (wo->demand_to[t] == 0.0)
+    return;
+
+  for (v = 0; v < n; v++)
+    sc->in[v] = (v == t ? 0.0 : wo->D->traffic[v][t]);
+
+  /* farthest first, so that a node has received all of its transit
+     traffic before it forwards. */
+  for (i = norder; i-- > 1; )
+    {
+      u = sc->order[i];
+      if (sc->in[u] == 0.0)
+        continue;
+
+      nexthops = 0;
+      for (j = csr->ooffset[u]; j < csr->ooffset[u + 1]; j++)
+        {
+          l = csr->olink[j];
+          v = csr->otarget[j];
+          if (dist[v] != WEIGHT_OPTIMIZE_INFINITY &&
+              dist[v] + (l == link ? weight : W[l]) == dist[u])
+            nexthops++;
+        }
+      assert (nexthops);
+
+      share = sc->in[u] / nexthops;
+      for (j = csr->ooffset[u]; j < csr->ooffset[u + 1]; j++)
+        {
+          l = csr->olink[j];
+          v = csr->otarget[j];
+          if (dist[v] != WEIGHT_OPTIMIZE_INFINITY &&
+              dist[v] + (l == link ? weight : W[l]) == dist[u])
+            {
+              load[l] += share;
+              sc->in[v] += share;
+            }
+        }
+    }
+}
+
+/* recalculate the cached state of destination t, if the applied
+   move affects it (or for the initial calculation, if none). */
+static void
+weight_optimize_update (void *arg, unsigned int t, unsigned int worker)
+{
+  struct weight_optimize *wo = (struct weight_optimize *) arg;
+
+  /* no load toward t to cache; its distances are not used either */
+  if (wo->demand_to[t] == 0.0)
+    return;
+  if (wo->applied && ! weight_optimize_affected (wo, t, wo->applied))
+    return;
+  weight_optimize_destination (wo, t, WEIGHT_OPTIMIZE_NONE, 0,
+                               &wo->scratch[worker],
+                               &wo->dist[t * wo->nnodes],
+                               &wo->load_dst[t * wo->nlinks]);
+}
+
+static void
+weight_optimize_sum (struct weight_optimize *wo)
+{
+  unsigned int t, l;
+  double *load_dst;
+
+  memset (wo->load, 0, wo->nlinks * sizeof (double));
+  for (t = 0; t < wo->nnodes; t++)
+    {
+      if (wo->demand_to[t] == 0.0)
+        continue;
+      load_dst = &wo->load_dst[t * wo->nlinks];
+      for (l = 0; l < wo->nlinks; l++)
+        wo->load[l] += load_dst[l];
+    }
+  wo->phi = weight_optimize_phi (wo, wo->load, &wo->maxutil);
+}
+
+/* Phi after the move, without changing the cached state */
+static void
+weight_optimize_evaluate (void *arg, unsigned int item, unsigned int worker)
+{
+  struct weight_optimize *wo = (struct weight_optimize *) arg;
+  struct weight_optimize_move *move = &wo->moves[item];
+  struct weight_optimize_scratch *sc = &wo->scratch[worker];
+  unsigned int t, l;
+  double *load_dst;
+
+  memcpy (sc->total, wo->load, wo->nlinks * sizeof (double));
+  move->nspf = 0;
+  for (t = 0; t < wo->nnodes; t++)
+    {
+      if (wo->demand_to[t] == 0.0)
+        continue;
+      if (! weight_optimize_affected (wo, t, move))
+        continue;
+
+      weight_optimize_destination (wo, t, move->link, move->weight, sc,
+                                   sc->dist, sc->load);
+      load_dst = &wo->load_dst[t * wo->nlinks];
+      for (l = 0; l < wo->nlinks; l++)
+        sc->total[l] += sc->load[l] - load_dst[l];
+      move->nspf++;
+    }
+
+  move->phi = weight_optimize_phi (wo, sc->total, &move->maxutil);
+}
+
+static struct weight_optimize *
+weight_optimize_create (struct weight *W, struct demand_matrix *D,
+                        unsigned int nthreads)
+{
+  struct weight_optimize *wo;
+  struct weight_optimize_scratch *sc;
+  struct link *link;
+  unsigned int i, s, t, n, m;
+
+  wo = (struct weight_optimize *) malloc (sizeof (struct weight_optimize));
+  memset (wo, 0, sizeof (struct weight_optimize));
+  wo->W = W;
+  wo->D = D;
+  wo->csr = graph_freeze (W->G);
+  wo->nnodes = n = wo->csr->nnodes;
+  wo->nlinks = m = W->nedges;
+  wo->nthreads = nthreads;
+
+  wo->from = (unsigned int *) calloc (m, sizeof (unsigned int));
+  wo->to = (unsigned int *) calloc (m, sizeof (unsigned int));
+  wo->capacity = (double *) calloc (m, sizeof (double));
+  for (i = 0; i < m; i++)
+    {
+      link = link_lookup_by_id (i, W->G);
+      if (! link || ! link->from || ! link->to)
+        continue;
+      wo->from[i] = link->from->id;
+      wo->to[i] = link->to->id;
+      wo->capacity[i] = link->bandwidth;
+    }
+
+  wo->demand_to = (double *) calloc (n, sizeof (double));
+  for (s = 0; s < n && s < D->nnodes; s++)
+    for (t = 0; t < n && t < D->nnodes; t++)
+      if (s != t)
+        wo->demand_to[t] += D->traffic[s][t];
+
+  wo->dist = (unsigned long *)
+    malloc ((size_t) n * n * sizeof (unsigned long));
+  wo->load_dst = (double *) calloc ((size_t) n * m, sizeof (double));
+  wo->load = (double *) calloc (m, sizeof (double));
+  wo->moves = (struct weight_optimize_move *)
+    calloc (WEIGHT_OPTIMIZE_SAMPLE, sizeof (struct weight_optimize_move));
+
+  wo->scratch = (struct weight_optimize_scratch *)
+    calloc (nthreads, sizeof (struct weight_optimize_scratch));
+  for (i = 0; i < nthreads; i++)
+    {
+      sc = &wo->scratch[i];
+      sc->heap = radixheap_create (n);
+      sc->order = (unsigned int *) malloc (n * sizeof (unsigned int));
+      sc->in = (double *) malloc (n * sizeof (double));
+      sc->dist = (unsigned long *) malloc (n * sizeof (unsigned long));
+      sc->load = (double *) malloc (m * sizeof (double));
+      sc->total = (double *) malloc (m * sizeof (double));
+    }
+
+  return wo;
+}
+
+static void
+weight_optimize_delete (struct weight_optimize *wo)
+{
+  struct weight_optimize_scratch *sc;
+  unsigned int i;
+
+  for (i = 0; i < wo->nthreads; i++)
+    {
+      sc = &wo->scratch[i];
+      radixheap_delete (sc->heap);
+      free (sc->order);
+      free (sc->in);
+      free (sc->dist);
+      free (sc->load);
+      free (sc->total);
+    }
+  free (wo->scratch);
+  free (wo->moves);
+  free (wo->load);
+  free (wo->load_dst);
+  free (wo->dist);
+  free (wo->demand_to);
+  free (wo->capacity);
+  free (wo->to);
+  free (wo->from);
+  free (wo);
+}
+
+DEFINE_COMMAND (weight_optimize,
+                "weight-optimize traffic NAME",
+                "optimize the link weights\n"
+                "minimize Phi of the traffic\n"
+                "specify traffic ID\n")
+{
+  struct shell *shell = (struct shell *) context;
+  struct weight *W = (struct weight *) shell->context;
+  struct traffic *T;
+  struct weight_optimize *wo;
+  struct weight_optimize_move *move, *best;
+  unsigned int i, l, nlinks, nthreads = 1;
+  unsigned long budget = 0;
+  unsigned long rounds, stall, nmoves, nspf, nfull;
+  unsigned int *links;
+  unsigned long long seed = 0;
+  struct random_stream stream;
+  weight_t wmax;
+  double initial, initial_maxutil;
+  timer_counter_t start, now, res;
+
+  if (! W->G)
+    {
+      fprintf (shell->terminal, "no graph specified\n");
+      return;
+    }
+
+  T = (struct traffic *) instance_lookup ("traffic", argv[2]);
+  if (T == NULL)
+    {
+      fprintf (shell->terminal, "no such traffic: traffic-%s\n", argv[2]);
+      return;
+    }
+  if (T->G != W->G || T->demands == NULL)
+    {
+      fprintf (shell->terminal, "traffic does not match with the graph.\n");
+      return;
+    }
+
+  for (i = 3; i + 1 < argc; i += 2)
+    {
+      if (! strcmp (argv[i], "time"))
+        budget = strtoul (argv[i + 1], NULL, 0);
+      else if (! strcmp (argv[i], "threads"))
+        nthreads = strtoul (argv[i + 1], NULL, 0);
+      else if (! strcmp (argv[i], "seed"))
+        seed = strtoul (argv[i + 1], NULL, 0);
+    }
+
+  /* the search tries the weights in [1, wmax].  the weights must be
+     set beforehand: a weight of 0 would make a cycle of equal-cost
+     nexthops, over which the loads cannot be split. */
+  wmax = WEIGHT_OPTIMIZE_WMAX;
+  for (l = 0; l < W->nedges; l++)
+    {
+      if (W->weight[l] == 0 && link_lookup_by_id (l, W->G))
+        {
+          fprintf (shell->terminal, "link %u has weight 0: "
+                   "set the weights first (e.g., weight-setting).\n", l);
+          return;
+        }
+      if (wmax < W->weight[l])
+        wmax = W->weight[l];
+    }
+
+  timer_count (start);
+
+  wo = weight_optimize_create (W, T->demands, nthreads);
+  wo->applied = NULL;
+  workqueue_run (nthreads, wo->nnodes, weight_optimize_update, wo);
+  weight_optimize_sum (wo);
+  initial = wo->phi;
+  initial_maxutil = wo->maxutil;
+
+  /* the moves are drawn from the seed alone, so the same seed gives
+     the same search */
+  random_stream_init (&stream, seed, 0);
+  fprintf (shell->terminal, "seed: %llu\n", seed);
+  fprintf (shell->terminal, "Initial: Phi: %.3f MaxUtil: %.3f\n",
+           wo->phi, wo->maxutil);
+
+  nfull = 0;
+  for (l = 0; l < wo->nnodes; l++)
+    if (wo->demand_to[l] != 0.0)
+      nfull++;
+
+  /* the links in the graph, to draw the moves from */
+  links = (unsigned int *) malloc (wo->nlinks * sizeof (unsigned int));
+  nlinks = 0;
+  for (l = 0; l < wo->nlinks; l++)
+    if (wo->capacity[l] > 0.0)
+      links[nlinks++] = l;
+
+  rounds = stall = nmoves = nspf = 0;
+  while (nlinks && stall < WEIGHT_OPTIMIZE_STALL * nlinks)
+    {
+      timer_count (now);
+      timer_sub (start, now, res);
+      if (budget && timer_to_usec (res) >= budget * 1000000ULL)
+        break;
+
+      /* random new weights on random links */
+      wo->nmoves = WEIGHT_OPTIMIZE_SAMPLE;
+      for (i = 0; i < wo->nmoves; i++)
+        {
+          move = &wo->moves[i];
+          move->link = links[random_stream_next (&stream) % nlinks];
+          move->old = W->weight[move->link];
+          move->weight = 1 + random_stream_next (&stream) % wmax;
+          if (move->weight == move->old)
+            move->weight = move->weight % wmax + 1;
+        }
+
+      workqueue_run (nthreads, wo->nmoves, weight_optimize_evaluate, wo);
+
+      best = NULL;
+      for (i = 0; i < wo->nmoves; i++)
+        {
+          move = &wo->moves[i];
+          nspf += move->nspf;
+          if (! best || move->phi < best->phi)
+            best = move;
+        }
+      nmoves += wo->nmoves;
+      rounds++;
+
+      if (! best || best->phi >= wo->phi)
+        {
+          stall += wo->nmoves;
+          continue;
+        }
+      stall = 0;
+
+      W->weight[best->link] = best->weight;
+      weight_modified (W);
+      wo->applied = best;
+      workqueue_run (nthreads, wo->nnodes, weight_optimize_update, wo);
+      wo->applied = NULL;
+      weight_optimize_sum (wo);
+
+      fprintf (shell->terminal,
+               "Round %lu: link %u (%u -> %u) weight %lu -> %lu: "
+               "Phi: %.3f MaxUtil: %.3f\n",
+               rounds, best->link, wo->from[best->link],
+               wo->to[best->link], best->old, best->weight,
+               wo->phi, wo->maxutil);
+    }
+
+  timer_count (now);
+  timer_sub (start, now, res);
+
+  fprintf (shell->terminal,
+           "Optimized: Phi: %.3f (%.3f) MaxUtil: %.3f (%.3f)\n",
+           wo->phi, initial, wo->maxutil, initial_maxutil);
+  fprintf (shell->terminal,
+           "%lu rounds, %lu moves, %lu SPFs (%lu without the cache), "
+           "%u threads, %llu us\n",
+           rounds, nmoves, nspf, nmoves * nfull, nthreads,
+           timer_to_usec (res));
+
+  free (links);
+  weight_optimize_delete (wo);
+
+  /* keep the optimized weights in the config, as save weight config */
+  weight_clear_config (W);
+  weight_save_config (W);
+}
+
+ALIAS_COMMAND (weight_optimize_time,
+               weight_optimize,
+               "weight-optimize traffic NAME time <1-86400>",
+               "optimize the link weights\n"
+               "minimize Phi of the traffic\n"
+               "specify traffic ID\n"
+               "stop after the time\n"
+               "specify the time in seconds\n");
+
+ALIAS_COMMAND (weight_optimize_threads,
+               weight_optimize,
+               "weight-optimize traffic NAME threads <1-1024>",
+               "optimize the link weights\n"
+               "minimize Phi of the traffic\n"
+               "specify traffic ID\n"
+               "evaluate the moves in multiple threads\n"
+               "specify number of threads\n");
+
+ALIAS_COMMAND (weight_optimize_time_threads,
+               weight_optimize,
+               "weight-optimize traffic NAME time <1-86400> threads <1-1024>",
+               "optimize the link weights\n"
+               "minimize Phi of the traffic\n"
+               "specify traffic ID\n"
+               "stop after the time\n"
+               "specify the time in seconds\n"
+               "evaluate the moves in multiple threads\n"
+               "specify number of threads\n");
+
+ALIAS_COMMAND (weight_optimize_seed,
+               weight_optimize,
+               "weight-optimize traffic NAME seed <0-4294967295>",
+               "optimize the link weights\n"
+               "minimize Phi of the traffic\n"
+               "specify traffic ID\n"
+               "draw the moves with an explicit random seed\n"
+               "specify random seed\n");
+
+ALIAS_COMMAND (weight_optimize_time_seed,
+               weight_optimize,
+               "weight-optimize traffic NAME time <1-86400> seed <0-4294967295>",
+               "optimize the link weights\n"
+               "minimize Phi of the traffic\n"
+               "specify traffic ID\n"
+               "stop after the time\n"
+               "specify the time in seconds\n"
+               "draw the moves with an explicit random seed\n"
+               "specify random seed\n");
+
+ALIAS_COMMAND (weight_optimize_threads_seed,
+               weight_optimize,
+               "weight-optimize traffic NAME threads <1-1024> seed <0-4294967295>",
+               "optimize the link weights\n"
+               "minimize Phi of the traffic\n"
+               "specify traffic ID\n"
+               "evaluate the moves in multiple threads\n"
+               "specify number of threads\n"
+               "draw the moves with an explicit random seed\n"
+               "specify random seed\n");
+
+ALIAS_COMMAND (weight_optimize_time_threads_seed,
+               weight_optimize,
+               "weight-optimize traffic NAME time <1-86400> threads <1-1024> seed <0-4294967295>",
+               "optimize the link weights\n"
+               "minimize Phi of the traffic\n"
+               "specify traffic ID\n"
+               "stop after the time\n"
+               "specify the time in seconds\n"
+               "evaluate the moves in multiple threads\n"
+               "specify number of threads\n"
+               "draw the moves with an explicit random seed\n"
+               "specify random seed\n");
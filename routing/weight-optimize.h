@@ -0,0 +1,51 @@
+
+/*
+ * Copyright (C) 2007  Yasuhiro Ohara
+ * 
+ * This file is part of SimRouting.
+ * 
+ * SimRouting is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * SimRouting is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _WEIGHT_OPTIMIZE_H_
+#define _WEIGHT_OPTIMIZE_H_
+
+/* link weight optimization: a local search over single weight
+   changes minimizing the Fortz-Thorup cost function Phi of the link
+   loads that a traffic matrix puts on the network when routed by
+   OSPF ECMP on the weights. */
+
+/* number of the moves tried in a round */
+#define WEIGHT_OPTIMIZE_SAMPLE 64
+
+/* moves without improvement before giving up, per link */
+#define WEIGHT_OPTIMIZE_STALL  10
+
+/* smallest upper bound of the weights tried */
+#define WEIGHT_OPTIMIZE_WMAX  20
+
+double weight_optimize_phi_link (double load, double capacity);
+
+EXTERN_COMMAND (weight_optimize);
+EXTERN_COMMAND (weight_optimize_time);
+EXTERN_COMMAND (weight_optimize_threads);
+EXTERN_COMMAND (weight_optimize_time_threads);
+EXTERN_COMMAND (weight_optimize_seed);
+EXTERN_COMMAND (weight_optimize_time_seed);
+EXTERN_COMMAND (weight_optimize_threads_seed);
+EXTERN_COMMAND (weight_optimize_time_threads_seed);
+
+#endif /*_WEIGHT_OPTIMIZE_H_*/
+
@@ -37,6 +37,7 @@
 #include "network/network.h"
 
 #include "interface/simrouting_file.h"
+#include "interface/snapshot.h"
 
 #define BUG_ADDRESS "yasu@sfc.wide.ad.jp"
 
@@ -132,12 +133,15 @@ main (int argc, char **argv)
 
   command_shell_init ();
   module_init ();
+  snapshot_init ();
 
   INSTALL_COMMAND (cmdset_default, load_file);
   INSTALL_COMMAND (cmdset_default, clear_file);
   INSTALL_COMMAND (cmdset_default, show_config);
   INSTALL_COMMAND (cmdset_default, write_config);
   INSTALL_COMMAND (cmdset_default, save_config);
+  INSTALL_COMMAND (cmdset_default, save_snapshot);
+  INSTALL_COMMAND (cmdset_default, load_snapshot);
 
   shell = command_shell_create ();
   prompt_default = "simrouting> ";
@@ -162,6 +166,7 @@ main (int argc, char **argv)
   shell_delete (shell);
 
   module_finish ();
+  snapshot_finish ();
   command_shell_finish ();
 
   return 0;
@@ -60,7 +60,7 @@ void
 demand_matrix_delete (struct demand_matrix *demands)
 {
   int i;
-  for (i = 0; i < demands->nnodes; i++)
+  for (i = 0; i < demands->nnodes && ! demands->mapped; i++)
     free (demands->traffic[i]);
   free (demands->traffic);
   free (demands);
@@ -28,6 +28,7 @@ struct demand_matrix
   u_int nnodes;
   demand_t **traffic;
   demand_t total; /* Total amount of traffic flows */
+  int mapped;     /* the rows are in a snapshot image */
 };
 
 struct traffic